@@ -1,7 +1,9 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "utils/Debug.h"
+#include "utils/BankImportJob.h"
 #include "utils/ParameterIDs.h"
+#include "utils/SysExVoiceDump.h"
 #include "dsp/YM2151Registers.h"
 
 using namespace ymulatorsynth;
@@ -21,25 +23,52 @@ YMulatorSynthAudioProcessor::YMulatorSynthAudioProcessor()
        midiProcessor(nullptr), // Will be initialized after other components
        panProcessor(std::make_shared<ymulatorsynth::PanProcessor>(*ymfmWrapper)),
        parameterManager(std::make_unique<ymulatorsynth::ParameterManager>(*ymfmWrapper, *this, panProcessor)),
-       presetManager(std::make_unique<ymulatorsynth::PresetManager>())
+       partManager(std::make_unique<ymulatorsynth::PartManager>(*ymfmWrapper)),
+       mpeManager(std::make_unique<ymulatorsynth::MpeManager>(*ymfmWrapper)),
+       presetManager(std::make_unique<ymulatorsynth::PresetManager>()),
+       arpeggiator(std::make_unique<ymulatorsynth::Arpeggiator>())
 {
     
     CS_DBG(" Constructor called");
     
     // Initialize ParameterManager with parameters
     parameterManager->initializeParameters(parameters);
+    parameterManager->setPartManager(partManager.get());
     
     // Initialize StateManager with dependencies
     stateManager = std::make_unique<ymulatorsynth::StateManager>(parameters, *presetManager, *parameterManager);
+    stateManager->setPartManager(partManager.get());
     
     // Initialize MidiProcessor after other components are ready
-    midiProcessor = std::make_unique<ymulatorsynth::MidiProcessor>(*voiceManager, *ymfmWrapper, parameters, *parameterManager);
+    programSelector = std::make_unique<ymulatorsynth::MidiProgramSelector>(*presetManager, *stateManager);
+    sysExReceiver = std::make_unique<ymulatorsynth::SysExReceiver>(*presetManager);
+    sysExReceiver->onDumpReceived = [this](int firstPresetIndex, bool isSingleVoice)
+    {
+        // A single voice is played straight away, like selecting it in a librarian
+        if (isSingleVoice)
+            setCurrentPreset(firstPresetIndex);
+        parameters.state.setProperty("presetListUpdated", juce::Random::getSystemRandom().nextInt(), nullptr);
+        updateHostDisplay();
+    };
+    auto midi = std::make_unique<ymulatorsynth::MidiProcessor>(*voiceManager, *ymfmWrapper, parameters, *parameterManager);
+    midi->setProgramSelector(programSelector.get());
+    midi->setPartManager(partManager.get());
+    midi->setMpeManager(mpeManager.get());
+    midi->setSysExReceiver(sysExReceiver.get());
+    midi->setArpeggiator(arpeggiator.get());
+    midi->onMidiMappingsChanged = [this]()
+    {
+        // Mappings are saved with the state but are not parameters
+        updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
+    };
+    stateManager->setMidiProcessor(midi.get());
+    midiProcessor = std::move(midi);
     
-    // Initialize preset manager
-    presetManager->initialize();
+    // Factory presets now; banks on disk follow in the background when we can defer
+    initializePresetLibrary();
     
     // Load default preset (Init) 
-    setCurrentProgram(7); // Init preset
+    setCurrentPreset(7); // Init preset
     
     // Add parameter change listener through ValueTree after initial setup
     parameters.state.addListener(this);
@@ -72,7 +101,7 @@ YMulatorSynthAudioProcessor::YMulatorSynthAudioProcessor(std::unique_ptr<YmfmWra
     presetManager->initialize();
     
     // Load default preset (Init) before adding listener
-    setCurrentProgram(7); // Init preset
+    setCurrentPreset(7); // Init preset
     
     // Add parameter change listener through ValueTree after initial setup
     parameters.state.addListener(this);
@@ -80,8 +109,48 @@ YMulatorSynthAudioProcessor::YMulatorSynthAudioProcessor(std::unique_ptr<YmfmWra
     CS_DBG(" Dependency injection constructor completed - default preset: " + juce::String(getCurrentProgram()));
 }
 
+void YMulatorSynthAudioProcessor::initializePresetLibrary()
+{
+    // Deferring needs a message loop to publish the library on. Tests and
+    // tools construct the processor directly and get the whole library at once.
+    auto* messageManager = juce::MessageManager::getInstanceWithoutCreating();
+    if (wrapperType == wrapperType_Undefined || messageManager == nullptr || !messageManager->isThisTheMessageThread())
+    {
+        presetManager->initialize();
+        startWatchingBankDirectories();
+        return;
+    }
+    
+    presetManager->initializeAsync([this]() { presetLibraryReady(); });
+}
+
+void YMulatorSynthAudioProcessor::presetLibraryReady()
+{
+    // The watcher's baseline is the complete library, so loaded banks are not picked up twice
+    startWatchingBankDirectories();
+    
+    if (stateManager) stateManager->handlePresetLibraryReady();
+    
+    parameters.state.setProperty("presetListUpdated", juce::Random::getSystemRandom().nextInt(), nullptr);
+    updateHostDisplay();
+}
+
+void YMulatorSynthAudioProcessor::startWatchingBankDirectories()
+{
+    // Pick up .opm files dropped into the banks or presets folders without a restart
+    presetManager->startWatchingBankDirectories([this]()
+    {
+        parameters.state.setProperty("presetListUpdated", juce::Random::getSystemRandom().nextInt(), nullptr);
+        updateHostDisplay();
+    });
+}
+
 YMulatorSynthAudioProcessor::~YMulatorSynthAudioProcessor()
 {
+    // The watcher and SysEx callbacks refer to our parameters, which are destroyed first
+    presetManager->stopWatchingBankDirectories();
+    if (sysExReceiver) sysExReceiver->onDumpReceived = nullptr;
+    
     // Remove ValueTree listener
     parameters.state.removeListener(this);
     
@@ -132,6 +201,8 @@ void YMulatorSynthAudioProcessor::prepareToPlay(double sampleRate, int samplesPe
     CS_DBG("prepareToPlay called - sampleRate: " + juce::String(sampleRate) + 
            ", samplesPerBlock: " + juce::String(samplesPerBlock));
     
+    if (arpeggiator) arpeggiator->prepare(sampleRate);
+    
     // Initialize ymfm wrapper with OPM for now (only if needed)
     uint32_t currentSampleRate = static_cast<uint32_t>(sampleRate);
     if (!g_ymfmInitialized || g_lastSampleRate != currentSampleRate) {
@@ -147,9 +218,9 @@ void YMulatorSynthAudioProcessor::prepareToPlay(double sampleRate, int samplesPe
     
     // If a preset was set before ymfm was initialized, apply it now
     if (needsPresetReapply) {
-        loadPreset(getCurrentProgram());
+        loadPreset(getCurrentPresetIndex());
         needsPresetReapply = false;
-        CS_DBG("Applied deferred preset " + juce::String(getCurrentProgram()));
+        CS_DBG("Applied deferred preset " + juce::String(getCurrentPresetIndex()));
     }
     
     CS_DBG("ymfm initialization complete");
@@ -196,14 +267,38 @@ void YMulatorSynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     // Clear output buffer
     buffer.clear();
     
+    // Parts changed since the last block, before their notes play
+    if (partManager)
+    {
+        // Channels with a sounding voice stay with their part until the note ends
+        uint8_t soundingChannels = 0;
+        for (int channel = 0; channel < 8; ++channel)
+            if (voiceManager->isVoiceActive(channel))
+                soundingChannels = static_cast<uint8_t>(soundingChannels | (1 << channel));
+        partManager->applyPendingChanges(soundingChannels);
+    }
+    
+    // Arpeggiator tempo and grid for this block; the MidiProcessor hands it the played notes
+    if (arpeggiator) arpeggiator->prepareBlock(getPlayHead(), buffer.getNumSamples());
+    
     // Process all MIDI events through MidiProcessor
     midiProcessor->processMidiMessages(midiMessages);
     
+    if (arpeggiator) arpeggiator->renderSteps();
+    
     // Update parameters periodically (rate limiting handled by ParameterManager)
     updateYmfmParameters();
     
+    // MPE pressure and timbre on top of the levels the update just wrote
+    if (mpeManager) mpeManager->applyExpression();
+    
     // Generate audio samples
     generateAudioSamples(buffer);
+    
+    // Audition previews play on top of the live chip
+    previewPlayer.renderNextBlock(buffer.getWritePointer(0),
+                                  buffer.getNumChannels() > 1 ? buffer.getWritePointer(1) : buffer.getWritePointer(0),
+                                  buffer.getNumSamples());
 }
 
 bool YMulatorSynthAudioProcessor::hasEditor() const
@@ -251,6 +346,107 @@ int YMulatorSynthAudioProcessor::loadOpmFile(const juce::File& file)
     return numLoaded;
 }
 
+std::shared_ptr<ymulatorsynth::BankImportJob> YMulatorSynthAudioProcessor::importOpmFileAsync(const juce::File& file,
+                                                                                              std::function<void(const ymulatorsynth::BankImportJob&)> onComplete)
+{
+    CS_DBG("YMulatorSynthAudioProcessor::importOpmFileAsync - Importing file: " + file.getFullPathName());
+    
+    // Completion runs on the message thread, after the bank has been published
+    return presetManager->importOPMFileAsync(file, [this, onComplete = std::move(onComplete)](const ymulatorsynth::BankImportJob& job)
+    {
+        if (job.getStatus() == ymulatorsynth::BankImportJob::Status::Succeeded)
+        {
+            parameters.state.setProperty("presetListUpdated", juce::Random::getSystemRandom().nextInt(), nullptr);
+            updateHostDisplay();
+        }
+        
+        if (onComplete)
+            onComplete(job);
+    });
+}
+
+void YMulatorSynthAudioProcessor::setMultitimbralMode(bool enabled)
+{
+    if (!partManager || partManager->isEnabled() == enabled)
+        return;
+    
+    if (enabled)
+    {
+        // Parts nobody has set up yet play what single mode was playing
+        const int current = getCurrentPresetIndex();
+        for (int part = 0; part < ymulatorsynth::PartManager::NumParts; ++part)
+        {
+            if (partManager->getPart(part).presetIndex < 0)
+                setPartPreset(part, current);
+        }
+    }
+    
+    partManager->setEnabled(enabled);
+    
+    // Back in single mode the periodic update rewrites the operators; the pan needs restoring
+    if (!enabled)
+        applyGlobalPanToAllChannels();
+}
+
+bool YMulatorSynthAudioProcessor::setPartPreset(int part, int presetIndex)
+{
+    const auto library = presetManager->getSnapshot();
+    const auto* image = library->getRegisterImage(presetIndex);
+    if (!partManager || image == nullptr)
+        return false;
+    
+    auto settings = partManager->getPart(part);
+    settings.presetIndex = presetIndex;
+    settings.image = *image;
+    return partManager->setPart(part, settings);
+}
+
+ymulatorsynth::PresetPreviewRenderer& YMulatorSynthAudioProcessor::getPreviewRenderer()
+{
+    // Previews are rendered at the host rate, like the live chip; a rate change starts a new set
+    const double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    if (previewRenderer == nullptr || previewRenderer->getSettings().sampleRate != sampleRate)
+    {
+        ymulatorsynth::PreviewSettings settings;
+        settings.sampleRate = sampleRate;
+        previewRenderer = std::make_unique<ymulatorsynth::PresetPreviewRenderer>(
+            presetManager->getUserDataDirectory().getChildFile("previews"), settings);
+    }
+    return *previewRenderer;
+}
+
+void YMulatorSynthAudioProcessor::auditionPreset(int presetIndex)
+{
+    const auto library = presetManager->getSnapshot();
+    const auto* image = library->getRegisterImage(presetIndex);
+    if (image == nullptr)
+        return;
+    
+    auto& renderer = getPreviewRenderer();
+    const auto key = ymulatorsynth::PresetPreviewRenderer::makeKey(*image, renderer.getSettings());
+    auditionKey = key;
+    
+    renderer.requestPreview(*image, [this, key](std::shared_ptr<const ymulatorsynth::PresetPreview> preview)
+    {
+        // A slow render must not start after the user has moved on to another preset
+        if (auditionKey.load() == key)
+            previewPlayer.play(std::move(preview));
+    });
+}
+
+void YMulatorSynthAudioProcessor::renderAllPreviews()
+{
+    const auto library = presetManager->getSnapshot();
+    std::vector<ymulatorsynth::RegisterImage> images;
+    images.reserve(static_cast<size_t>(library->getNumPresets()));
+    for (int i = 0; i < library->getNumPresets(); ++i)
+    {
+        if (const auto* image = library->getRegisterImage(i))
+            images.push_back(*image);
+    }
+    getPreviewRenderer().renderMissing(images);
+}
+
 bool YMulatorSynthAudioProcessor::saveCurrentPresetAsOpm(const juce::File& file, const juce::String& presetName)
 {
     CS_DBG("YMulatorSynthAudioProcessor::saveCurrentPresetAsOpm - Saving to: " + file.getFullPathName());
@@ -539,9 +735,9 @@ void YMulatorSynthAudioProcessor::valueTreePropertyChanged(juce::ValueTree& tree
 juce::StringArray YMulatorSynthAudioProcessor::getBankNames() const
 {
     juce::StringArray names;
-    const auto& banks = presetManager->getBanks();
+    const auto banks = presetManager->getBanks();
     
-    for (const auto& bank : banks) {
+    for (const auto& bank : *banks) {
         names.add(bank.name);
     }
     
@@ -561,8 +757,46 @@ void YMulatorSynthAudioProcessor::setCurrentPresetInBank(int bankIndex, int pres
             presetParam->setValueNotifyingHost(presetParam->convertTo0to1(static_cast<float>(presetIndex)));
         }
         
-        setCurrentProgram(globalIndex);
+        setCurrentPreset(globalIndex);
+    }
+}
+
+juce::MemoryBlock YMulatorSynthAudioProcessor::createSysExVoiceDump(int presetIndex) const
+{
+    const auto library = presetManager->getSnapshot();
+    const auto preset = library->getPreset(presetIndex);
+    if (preset == nullptr)
+        return {};
+    
+    return ymulatorsynth::SysExVoiceDump::createVoiceDump(preset->toVOPM());
+}
+
+juce::MemoryBlock YMulatorSynthAudioProcessor::createSysExBankDump(int bankIndex) const
+{
+    const auto library = presetManager->getSnapshot();
+    std::vector<ymulatorsynth::VOPMVoice> voices;
+    for (int program = 0; program < ymulatorsynth::SysExVoiceDump::MaxBankVoices; ++program)
+    {
+        const auto preset = library->getPreset(library->getGlobalPresetIndex(bankIndex, program));
+        if (preset == nullptr)
+            break;
+        voices.push_back(preset->toVOPM());
+        voices.back().number = program;
     }
+    
+    if (voices.empty())
+        return {};
+    return ymulatorsynth::SysExVoiceDump::createBankDump(voices);
+}
+
+bool YMulatorSynthAudioProcessor::saveBankAsSysEx(int bankIndex, const juce::File& file) const
+{
+    const auto dump = createSysExBankDump(bankIndex);
+    if (dump.isEmpty())
+        return false;
+    
+    CS_DBG("Saving bank " + juce::String(bankIndex) + " as SysEx to " + file.getFullPathName());
+    return file.replaceWithData(dump.getData(), dump.getSize());
 }
 
 // applyGlobalPan, applyGlobalPanToAllChannels, setChannelRandomPan methods moved to ParameterManager
@@ -586,6 +820,15 @@ void YMulatorSynthAudioProcessor::processMidiNoteOff(const juce::MidiMessage& me
     midiProcessor->processMidiNoteOff(message);
 }
 
+void YMulatorSynthAudioProcessor::playArpeggiatorEvent(const ymulatorsynth::Arpeggiator::Event& event)
+{
+    // Through the MidiProcessor's note path, so steps honour parts, zones and MPE channels
+    if (event.isNoteOn)
+        midiProcessor->processMidiNoteOn(juce::MidiMessage::noteOn(event.midiChannel + 1, event.note, event.velocity));
+    else
+        midiProcessor->processMidiNoteOff(juce::MidiMessage::noteOff(event.midiChannel + 1, event.note));
+}
+
 void YMulatorSynthAudioProcessor::generateAudioSamples(juce::AudioBuffer<float>& buffer)
 {
     const int numSamples = buffer.getNumSamples();
@@ -602,7 +845,21 @@ void YMulatorSynthAudioProcessor::generateAudioSamples(juce::AudioBuffer<float>&
         float* leftBuffer = buffer.getWritePointer(0);
         float* rightBuffer = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1) : leftBuffer;
         
-        ymfmWrapper->generateSamples(leftBuffer, rightBuffer, numSamples);
+        // Arpeggiator steps play on their own sample: the chip renders up to each one
+        int position = 0;
+        const int numArpeggiatorEvents = arpeggiator ? arpeggiator->getNumEvents() : 0;
+        for (int i = 0; i < numArpeggiatorEvents; ++i)
+        {
+            const auto& event = arpeggiator->getEvent(i);
+            if (event.sampleOffset > position)
+            {
+                ymfmWrapper->generateSamples(leftBuffer + position, rightBuffer + position, event.sampleOffset - position);
+                position = event.sampleOffset;
+            }
+            playArpeggiatorEvent(event);
+        }
+        if (position < numSamples)
+            ymfmWrapper->generateSamples(leftBuffer + position, rightBuffer + position, numSamples - position);
         
         // DEBUG: Measure left/right channel levels for pan analysis
         static int panDebugCounter = 0;
@@ -9,9 +9,16 @@
 #include "core/MidiProcessorInterface.h"
 #include "core/ParameterManager.h"
 #include "core/StateManager.h"
+#include "core/MidiProgramSelector.h"
+#include "core/PartManager.h"
+#include "core/MpeManager.h"
+#include "core/SysExReceiver.h"
+#include "core/Arpeggiator.h"
 #include "core/PanProcessor.h"
 #include "utils/PresetManager.h"
 #include "core/PresetManagerInterface.h"
+#include "dsp/PresetPreviewPlayer.h"
+#include "dsp/PresetPreviewRenderer.h"
 #include <unordered_map>
 #include <memory>
 
@@ -80,17 +87,33 @@ private:
     std::unique_ptr<ymulatorsynth::MidiProcessorInterface> midiProcessor;
     std::shared_ptr<ymulatorsynth::PanProcessor> panProcessor;
     std::unique_ptr<ymulatorsynth::ParameterManager> parameterManager;
+    std::unique_ptr<ymulatorsynth::PartManager> partManager;       // multitimbral mode
+    std::unique_ptr<ymulatorsynth::MpeManager> mpeManager;         // MPE zones
     std::unique_ptr<PresetManagerInterface> presetManager;
     std::unique_ptr<ymulatorsynth::StateManager> stateManager;
+    std::unique_ptr<ymulatorsynth::MidiProgramSelector> programSelector;  // MIDI program changes
+    std::unique_ptr<ymulatorsynth::SysExReceiver> sysExReceiver;          // SysEx voice and bank dumps
+    std::unique_ptr<ymulatorsynth::Arpeggiator> arpeggiator;              // steps played notes in time with the host
     
     // Parameter system
     juce::AudioProcessorValueTreeState parameters;
     bool needsPresetReapply = false;
     
+    // Preset audition: offline-rendered previews mixed over the live output
+    ymulatorsynth::PresetPreviewPlayer previewPlayer;
+    std::atomic<uint64_t> auditionKey { 0 };  // preview that the latest audition request is waiting for
+    std::unique_ptr<ymulatorsynth::PresetPreviewRenderer> previewRenderer;
+    ymulatorsynth::PresetPreviewRenderer& getPreviewRenderer();
+    
     // Legacy MIDI state (deprecated - TODO: remove after full migration)
     std::unordered_map<int, juce::RangedAudioParameter*> ccToParameterMap;
     int currentPitchBend = 8192;
     
+    // Preset library startup (see PresetManager::initializeAsync)
+    void initializePresetLibrary();
+    void presetLibraryReady();
+    void startWatchingBankDirectories();
+    
     // State management delegation methods
     void loadPreset(int index) { if (stateManager) stateManager->loadPreset(index); }
     
@@ -122,6 +145,7 @@ private:
     void processMidiNoteOn(const juce::MidiMessage& message);
     void processMidiNoteOff(const juce::MidiMessage& message);
     void generateAudioSamples(juce::AudioBuffer<float>& buffer);
+    void playArpeggiatorEvent(const ymulatorsynth::Arpeggiator::Event& event);
     
     
 public:
@@ -130,8 +154,12 @@ public:
     // Preset access for UI
     const PresetManagerInterface& getPresetManager() const { return *presetManager; }
     PresetManagerInterface& getPresetManager() { return *presetManager; }
+    // Parameter access for batched changes (ParameterManager::Transaction)
+    ymulatorsynth::ParameterManager& getParameterManager() { return *parameterManager; }
     int getCurrentPresetIndex() const { return stateManager ? stateManager->getCurrentPresetIndex() : 0; }
+    void setCurrentPreset(int index) { if (stateManager) stateManager->setCurrentPreset(index); }
     juce::StringArray getPresetNames() const { return presetManager->getPresetNames(); }
+    std::vector<int> searchPresets(const juce::String& query, int maxResults) const { return presetManager->searchPresets(query, maxResults); }
     
     // Bank access for UI
     juce::StringArray getBankNames() const;
@@ -150,11 +178,49 @@ public:
     
     // OPM file operations
     int loadOpmFile(const juce::File& file);
+    std::shared_ptr<ymulatorsynth::BankImportJob> importOpmFileAsync(const juce::File& file,
+                                                                     std::function<void(const ymulatorsynth::BankImportJob&)> onComplete);
     bool saveCurrentPresetAsOpm(const juce::File& file, const juce::String& presetName);
     
     // User preset management
     bool saveCurrentPresetToUserBank(const juce::String& presetName);
     
+    // Preset audition (message thread)
+    /** Plays a short note of the preset from the preview cache, rendering it first if needed */
+    void auditionPreset(int presetIndex);
+    void stopAudition() { previewPlayer.stop(); }
+    /** Renders previews for the whole library in the background */
+    void renderAllPreviews();
+    
+    // Multitimbral mode (message thread)
+    /** Turns multitimbral mode on or off; parts without a preset start with the current one */
+    void setMultitimbralMode(bool enabled);
+    bool isMultitimbralMode() const { return partManager && partManager->isEnabled(); }
+    /** Binds a library preset to a part, keeping the part's MIDI channel, pool, volume and pan */
+    bool setPartPreset(int part, int presetIndex);
+    ymulatorsynth::PartManager* getPartManager() { return partManager.get(); }
+    
+    // MPE (any thread; MIDI can also set the zones with the MPE Configuration Message)
+    /** Sets the member channels of the lower (master 1) and upper (master 16) zones; 0/0 turns MPE off */
+    void setMpeZones(int lowerMemberChannels, int upperMemberChannels) { if (mpeManager) mpeManager->setZones(lowerMemberChannels, upperMemberChannels); }
+    bool isMpeMode() const { return mpeManager && mpeManager->isEnabled(); }
+    ymulatorsynth::MpeManager* getMpeManager() { return mpeManager.get(); }
+    
+    // Arpeggiator (any thread)
+    /** Turns the arpeggiator on or off; while on, played notes only feed the pattern */
+    void setArpeggiatorEnabled(bool enabled) { if (arpeggiator) arpeggiator->setEnabled(enabled); }
+    bool isArpeggiatorEnabled() const { return arpeggiator && arpeggiator->isEnabled(); }
+    ymulatorsynth::Arpeggiator* getArpeggiator() { return arpeggiator.get(); }
+    
+    // SysEx dumps (message thread). There is no MIDI output, so dumps are handed
+    // out as messages or .syx files for a librarian or the hardware to send on.
+    /** @return A voice dump of a library preset, empty if the index is out of range */
+    juce::MemoryBlock createSysExVoiceDump(int presetIndex) const;
+    /** @return A bank dump of a bank's first 128 presets, empty if the bank has none */
+    juce::MemoryBlock createSysExBankDump(int bankIndex) const;
+    bool saveBankAsSysEx(int bankIndex, const juce::File& file) const;
+    ymulatorsynth::SysExReceiver* getSysExReceiver() { return sysExReceiver.get(); }
+    
     // Testing interface
     ymulatorsynth::MidiProcessorInterface* getMidiProcessor() { return midiProcessor.get(); }
     
@@ -0,0 +1,340 @@
+#include "Arpeggiator.h"
+#include "../utils/Debug.h"
+#include <cmath>
+#include <limits>
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr double Never = std::numeric_limits<double>::max();
+    constexpr double GridTolerance = 1.0e-6;    // in steps; a step a hair behind the play head is now
+    constexpr double SampleTolerance = 1.0e-6;  // keeps rounding error from moving an event a sample early
+
+    int toSampleOffset(double sample)
+    {
+        return static_cast<int>(sample + SampleTolerance);
+    }
+}
+
+void Arpeggiator::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+
+    active = false;
+    numEvents = 0;
+    numInputEvents = 0;
+    numQueuedNoteOns = 0;
+    numHeldNotes = 0;
+    for (auto& notes : pressed) {
+        notes.reset();
+    }
+    clockRunning = false;
+    isSounding = false;
+    noteOffSample = -1.0;
+    lastGridStep = -1;
+    wasSynced = false;
+}
+
+int Arpeggiator::getStepsPerBeat(Rate stepRate)
+{
+    switch (stepRate) {
+        case Rate::Quarter:          return 1;
+        case Rate::Eighth:           return 2;
+        case Rate::EighthTriplet:    return 3;
+        case Rate::Sixteenth:        return 4;
+        case Rate::SixteenthTriplet: return 6;
+        case Rate::ThirtySecond:     return 8;
+    }
+    return 4;
+}
+
+// ============================================================================
+// Audio Thread
+// ============================================================================
+
+void Arpeggiator::prepareBlock(juce::AudioPlayHead* playHead, int numSamples)
+{
+    numEvents = 0;
+    numInputEvents = 0;
+    numQueuedNoteOns = 0;
+    blockSize = numSamples;
+
+    const bool isOn = enabled.load();
+    if (!isOn) {
+        if (active) {
+            // Turned off: the sounding step ends now and held notes are forgotten
+            endSoundingNote(0);
+            numHeldNotes = 0;
+            for (auto& notes : pressed) {
+                notes.reset();
+            }
+            clockRunning = false;
+            CS_DBG("Arpeggiator off");
+        }
+        active = false;
+        return;
+    }
+
+    if (!active) {
+        stepIndex = 0;
+        clockRunning = false;
+        noteOffSample = -1.0;
+        CS_DBG("Arpeggiator on");
+    }
+    active = true;
+    blockMode = static_cast<Mode>(mode.load());
+    blockOctaves = octaves.load();
+
+    double bpm = DefaultBpm;
+    double ppq = 0.0;
+    isSynced = false;
+    if (playHead != nullptr) {
+        if (const auto position = playHead->getPosition()) {
+            if (const auto hostBpm = position->getBpm(); hostBpm.hasValue() && *hostBpm > 0.0) {
+                bpm = *hostBpm;
+            }
+            if (const auto hostPpq = position->getPpqPosition(); hostPpq.hasValue() && position->getIsPlaying()) {
+                ppq = *hostPpq;
+                isSynced = true;
+            }
+        }
+    }
+
+    const int stepsPerBeat = getStepsPerBeat(static_cast<Rate>(rate.load()));
+    samplesPerStep = juce::jmax(static_cast<double>(MinStepSamples), sampleRate * 60.0 / (bpm * stepsPerBeat));
+    gateSamples = samplesPerStep * static_cast<double>(gate.load());
+
+    if (isSynced) {
+        // The grid comes from the host every block, so loops and jumps stay on the beat
+        const double steps = ppq * stepsPerBeat;
+        const double next = std::ceil(steps - GridTolerance);
+        nextStepSample = juce::jmax(0.0, (next - steps) * samplesPerStep);
+        nextGridStep = static_cast<int64_t>(next);
+        if (!wasSynced) {
+            lastGridStep = std::numeric_limits<int64_t>::min();
+        }
+        clockRunning = true;
+    }
+    wasSynced = isSynced;
+}
+
+bool Arpeggiator::noteOn(int midiChannel, uint8_t note, uint8_t velocity, int sampleOffset)
+{
+    if (!active || note > 127 || midiChannel < 0 || midiChannel > 15
+        || numQueuedNoteOns >= MaxQueuedNoteOns || numInputEvents >= InputQueueSize) {
+        return false;
+    }
+
+    auto& input = inputQueue[static_cast<size_t>(numInputEvents++)];
+    input.sampleOffset = juce::jlimit(0, juce::jmax(0, blockSize - 1), sampleOffset);
+    input.held = { note, velocity, midiChannel };
+    input.isNoteOn = true;
+    ++numQueuedNoteOns;
+    pressed[static_cast<size_t>(midiChannel)].set(note);
+    return true;
+}
+
+bool Arpeggiator::noteOff(int midiChannel, uint8_t note, int sampleOffset)
+{
+    if (!active || note > 127 || midiChannel < 0 || midiChannel > 15
+        || !pressed[static_cast<size_t>(midiChannel)].test(note)) {
+        return false;
+    }
+
+    pressed[static_cast<size_t>(midiChannel)].reset(note);
+    if (numInputEvents >= InputQueueSize) {
+        // Cannot happen with the queue sized for every pressed note; release at the block start rather than lose it
+        removeHeldNote(note, midiChannel);
+        return true;
+    }
+
+    auto& input = inputQueue[static_cast<size_t>(numInputEvents++)];
+    input.sampleOffset = juce::jlimit(0, juce::jmax(0, blockSize - 1), sampleOffset);
+    input.held = { note, 0, midiChannel };
+    input.isNoteOn = false;
+    return true;
+}
+
+void Arpeggiator::renderSteps()
+{
+    if (!active) {
+        return;
+    }
+
+    // Held-note changes, gate ends and steps in sample order
+    int inputIndex = 0;
+    for (;;) {
+        const double inputAt = inputIndex < numInputEvents
+            ? static_cast<double>(inputQueue[static_cast<size_t>(inputIndex)].sampleOffset) : Never;
+        const double stepAt = clockRunning ? nextStepSample : Never;
+        const double offAt = isSounding && noteOffSample >= 0.0 ? noteOffSample : Never;
+
+        if (juce::jmin(inputAt, stepAt, offAt) >= static_cast<double>(blockSize)) {
+            break;
+        }
+
+        if (offAt <= inputAt && offAt <= stepAt) {
+            endSoundingNote(toSampleOffset(offAt));
+        } else if (inputAt <= stepAt) {
+            const auto& input = inputQueue[static_cast<size_t>(inputIndex++)];
+            if (input.isNoteOn) {
+                const bool startsPattern = numHeldNotes == 0;
+                addHeldNote(input.held);
+                if (startsPattern) {
+                    stepIndex = 0;
+                    // Free running, the first note plays at once; synced, it waits for the grid
+                    if (!isSynced) {
+                        clockRunning = true;
+                        nextStepSample = inputAt;
+                    }
+                }
+            } else {
+                removeHeldNote(input.held.note, input.held.midiChannel);
+            }
+        } else {
+            // The previous block may have played this grid step on its last sample
+            if (!isSynced || nextGridStep != lastGridStep) {
+                playStep(toSampleOffset(stepAt));
+            }
+            if (isSynced) {
+                lastGridStep = nextGridStep++;
+            }
+            nextStepSample += samplesPerStep;
+        }
+    }
+
+    if (clockRunning) {
+        nextStepSample -= static_cast<double>(blockSize);
+    }
+    if (noteOffSample >= 0.0) {
+        noteOffSample -= static_cast<double>(blockSize);
+    }
+}
+
+void Arpeggiator::playStep(int sampleOffset)
+{
+    // Off before on, so the allocator gives the new step the channel just freed
+    endSoundingNote(sampleOffset);
+
+    if (numHeldNotes == 0) {
+        if (!isSynced) {
+            clockRunning = false;
+        }
+        return;
+    }
+
+    const auto held = selectStepNote();
+    if (!addEvent(sampleOffset, held, true)) {
+        numDroppedSteps.fetch_add(1);
+        return;
+    }
+    isSounding = true;
+    soundingNote = held;
+    noteOffSample = gateSamples < samplesPerStep ? static_cast<double>(sampleOffset) + gateSamples : -1.0;
+    ++stepIndex;
+}
+
+void Arpeggiator::endSoundingNote(int sampleOffset)
+{
+    if (!isSounding) {
+        return;
+    }
+    addEvent(sampleOffset, soundingNote, false);
+    isSounding = false;
+    noteOffSample = -1.0;
+}
+
+bool Arpeggiator::addEvent(int sampleOffset, const HeldNote& held, bool isNoteOn)
+{
+    // A note-on keeps a slot free for its note-off
+    if (numEvents >= (isNoteOn ? EventPoolSize - 1 : EventPoolSize)) {
+        return false;
+    }
+
+    auto& event = events[static_cast<size_t>(numEvents++)];
+    event.sampleOffset = juce::jlimit(0, juce::jmax(0, blockSize - 1), sampleOffset);
+    event.midiChannel = held.midiChannel;
+    event.note = held.note;
+    event.velocity = held.velocity;
+    event.isNoteOn = isNoteOn;
+    return true;
+}
+
+Arpeggiator::HeldNote Arpeggiator::selectStepNote()
+{
+    const int count = numHeldNotes;
+    const int length = count * blockOctaves;
+    int position = 0;
+
+    switch (blockMode) {
+        case Mode::Up:
+        case Mode::AsPlayed:
+            position = stepIndex % length;
+            break;
+        case Mode::Down:
+            position = length - 1 - stepIndex % length;
+            break;
+        case Mode::UpDown: {
+            // The top and bottom notes are not repeated at the turns
+            const int period = length > 1 ? 2 * length - 2 : 1;
+            const int phase = stepIndex % period;
+            position = phase < length ? phase : period - phase;
+            break;
+        }
+        case Mode::Random:
+            position = random.nextInt(length);
+            break;
+    }
+
+    const auto& source = blockMode == Mode::AsPlayed ? heldNotes : sortedNotes;
+    auto held = source[static_cast<size_t>(position % count)];
+    const int note = held.note + 12 * (position / count);
+    if (note <= 127) {
+        held.note = static_cast<uint8_t>(note);
+    }
+    return held;
+}
+
+void Arpeggiator::addHeldNote(const HeldNote& held)
+{
+    if (numHeldNotes >= MaxHeldNotes) {
+        return;
+    }
+    for (int i = 0; i < numHeldNotes; ++i) {
+        if (heldNotes[static_cast<size_t>(i)].note == held.note && heldNotes[static_cast<size_t>(i)].midiChannel == held.midiChannel) {
+            return;
+        }
+    }
+
+    heldNotes[static_cast<size_t>(numHeldNotes)] = held;
+
+    int insertAt = numHeldNotes;
+    while (insertAt > 0 && sortedNotes[static_cast<size_t>(insertAt - 1)].note > held.note) {
+        sortedNotes[static_cast<size_t>(insertAt)] = sortedNotes[static_cast<size_t>(insertAt - 1)];
+        --insertAt;
+    }
+    sortedNotes[static_cast<size_t>(insertAt)] = held;
+    ++numHeldNotes;
+}
+
+void Arpeggiator::removeHeldNote(uint8_t note, int midiChannel)
+{
+    const auto removeFrom = [this, note, midiChannel](std::array<HeldNote, MaxHeldNotes>& notes) {
+        for (int i = 0; i < numHeldNotes; ++i) {
+            if (notes[static_cast<size_t>(i)].note == note && notes[static_cast<size_t>(i)].midiChannel == midiChannel) {
+                for (int j = i; j + 1 < numHeldNotes; ++j) {
+                    notes[static_cast<size_t>(j)] = notes[static_cast<size_t>(j + 1)];
+                }
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (removeFrom(heldNotes)) {
+        removeFrom(sortedNotes);
+        --numHeldNotes;
+    }
+}
+
+} // namespace ymulatorsynth
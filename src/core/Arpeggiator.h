@@ -0,0 +1,192 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+
+namespace ymulatorsynth {
+
+/**
+ * Arpeggiator - Host-synced arpeggiator in front of voice allocation
+ *
+ * While it is on, MidiProcessor hands it the played notes instead of playing
+ * them, each with its sample position in the block. renderSteps() then walks
+ * the block in sample order, merging the held-note changes with the step
+ * grid, and writes the resulting note-ons and note-offs to a fixed-capacity
+ * event pool. The processor renders the chip in segments between those
+ * events, so every step starts on its exact sample rather than on the host
+ * buffer boundary.
+ *
+ * While the host transport plays, the grid follows its PPQ position and
+ * tempo, so steps stay on the beat through loops and jumps. Stopped, it runs
+ * on its own clock at the host tempo (120 BPM without one), and the first
+ * note of a chord starts the pattern straight away.
+ *
+ * A step's note-off comes before the next step's note-on at the same sample,
+ * so the allocator hands the next step the channel the last one just
+ * freed; a running arpeggio stays on one YM2151 channel and only the key
+ * code and key-on are written per step. In multitimbral mode the part's
+ * channel already holds its image, so no registers are rewritten either.
+ *
+ * Everything on the audio thread lives in fixed arrays, so there is no
+ * allocation at any tempo, rate or block size. Steps are at least
+ * MinStepSamples apart; a block that would still overflow the pool loses its
+ * remaining steps (see getNumDroppedSteps) rather than growing it.
+ */
+class Arpeggiator
+{
+public:
+    enum class Mode { Up = 0, Down, UpDown, AsPlayed, Random };
+
+    /** Step length as a note value */
+    enum class Rate { Quarter = 0, Eighth, EighthTriplet, Sixteenth, SixteenthTriplet, ThirtySecond };
+
+    /** A note-on or note-off at a sample position in the current block */
+    struct Event {
+        int sampleOffset = 0;
+        int midiChannel = 0;    // 0-15, the channel the note was played on
+        uint8_t note = 0;
+        uint8_t velocity = 0;
+        bool isNoteOn = false;
+    };
+
+    static constexpr int MaxHeldNotes = 32;
+    static constexpr int MaxQueuedNoteOns = 128;     // per block; later ones are played directly
+    static constexpr int MaxPressedNotes = 16 * 128; // every note on every MIDI channel
+    // The note-ons, and a note-off for each of them and for every note pressed before the block
+    static constexpr int InputQueueSize = 2 * MaxQueuedNoteOns + MaxPressedNotes;
+    static constexpr int EventPoolSize = 512;
+    static constexpr int MinStepSamples = 64;
+    static constexpr int MaxOctaves = 4;
+    static constexpr double DefaultBpm = 120.0;
+
+    Arpeggiator() = default;
+
+    /** Sets the sample rate and stops any running pattern; call before playback */
+    void prepare(double sampleRate);
+
+    // Any thread
+
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled); }
+    bool isEnabled() const { return enabled.load(); }
+
+    void setMode(Mode newMode) { mode.store(static_cast<int>(newMode)); }
+    Mode getMode() const { return static_cast<Mode>(mode.load()); }
+
+    void setRate(Rate newRate) { rate.store(static_cast<int>(newRate)); }
+    Rate getRate() const { return static_cast<Rate>(rate.load()); }
+
+    /** Octaves the pattern spans, 1-4 */
+    void setOctaves(int numOctaves) { octaves.store(juce::jlimit(1, MaxOctaves, numOctaves)); }
+    int getOctaves() const { return octaves.load(); }
+
+    /** Note length as a fraction of the step, 0.05-1.0; 1.0 plays legato */
+    void setGate(float fraction) { gate.store(juce::jlimit(0.05f, 1.0f, fraction)); }
+    float getGate() const { return gate.load(); }
+
+    /** @return Steps skipped because a block's event pool was full */
+    int getNumDroppedSteps() const { return numDroppedSteps.load(); }
+
+    // Audio thread
+
+    /**
+     * Starts a block: takes the settings and reads tempo and position from
+     * the play head, which may be nullptr. Turning the arpeggiator off ends
+     * the sounding step at the start of the block.
+     */
+    void prepareBlock(juce::AudioPlayHead* playHead, int numSamples);
+
+    /** @return true if notes go to the arpeggiator in this block */
+    bool isActive() const { return active; }
+
+    /**
+     * Holds a played note from the current block
+     * @return false if the note was not taken and should be played directly
+     */
+    bool noteOn(int midiChannel, uint8_t note, uint8_t velocity, int sampleOffset);
+
+    /**
+     * Releases a note at its sample position. The queue has room for every note
+     * that can be pressed, so a release is never dropped.
+     * @return false if the note is not held by the arpeggiator, e.g. it was pressed before it came on
+     */
+    bool noteOff(int midiChannel, uint8_t note, int sampleOffset);
+
+    /** Schedules the block's steps into the event pool */
+    void renderSteps();
+
+    /** The block's events in sample order */
+    int getNumEvents() const { return numEvents; }
+    const Event& getEvent(int index) const { return events[static_cast<size_t>(index)]; }
+
+private:
+    struct HeldNote {
+        uint8_t note = 0;
+        uint8_t velocity = 0;
+        int midiChannel = 0;
+    };
+
+    struct InputEvent {
+        int sampleOffset = 0;
+        HeldNote held;
+        bool isNoteOn = false;
+    };
+
+    static int getStepsPerBeat(Rate stepRate);
+
+    void addHeldNote(const HeldNote& held);
+    void removeHeldNote(uint8_t note, int midiChannel);
+    void playStep(int sampleOffset);
+    void endSoundingNote(int sampleOffset);
+    bool addEvent(int sampleOffset, const HeldNote& held, bool isNoteOn);
+    HeldNote selectStepNote();
+
+    // Settings (any thread)
+    std::atomic<bool> enabled { false };
+    std::atomic<int> mode { static_cast<int>(Mode::Up) };
+    std::atomic<int> rate { static_cast<int>(Rate::Sixteenth) };
+    std::atomic<int> octaves { 1 };
+    std::atomic<float> gate { 0.5f };
+    std::atomic<int> numDroppedSteps { 0 };
+
+    double sampleRate = 44100.0;
+
+    // Audio thread: this block
+    bool active = false;
+    int blockSize = 0;
+    Mode blockMode = Mode::Up;
+    int blockOctaves = 1;
+    double samplesPerStep = 0.0;
+    double gateSamples = 0.0;
+    bool isSynced = false;
+    bool wasSynced = false;
+
+    std::array<InputEvent, InputQueueSize> inputQueue;
+    int numInputEvents = 0;
+    int numQueuedNoteOns = 0;
+
+    std::array<Event, EventPoolSize> events;
+    int numEvents = 0;
+
+    // Audio thread: across blocks
+    std::array<HeldNote, MaxHeldNotes> heldNotes;       // in the order they were played
+    std::array<HeldNote, MaxHeldNotes> sortedNotes;     // lowest first
+    int numHeldNotes = 0;
+    std::array<std::bitset<128>, 16> pressed;           // per MIDI channel: taken by the arpeggiator and not yet released
+
+    bool clockRunning = false;
+    double nextStepSample = 0.0;                        // relative to the block start
+    int64_t nextGridStep = 0;                           // host steps since the song start, when synced
+    int64_t lastGridStep = -1;
+    double noteOffSample = -1.0;                        // gate end of the sounding step, -1 = at the next step
+    bool isSounding = false;
+    HeldNote soundingNote;
+    int stepIndex = 0;
+    juce::Random random;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Arpeggiator)
+};
+
+} // namespace ymulatorsynth
@@ -1,6 +1,12 @@
 #include "MidiProcessor.h"
 #include "ParameterManager.h"
+#include "MidiProgramSelector.h"
+#include "PartManager.h"
+#include "MpeManager.h"
+#include "SysExReceiver.h"
+#include "Arpeggiator.h"
 #include "../dsp/YM2151Registers.h"
+#include <utility>
 
 namespace ymulatorsynth {
 
@@ -13,7 +19,18 @@ MidiProcessor::MidiProcessor(VoiceManagerInterface& voiceManager,
     , parameters(parameters)
     , parameterManager(parameterManager)
 {
+    heldControllerValues.fill(-1);
     setupCCMapping();
+    
+    // Without a message loop (tests, offline tools) the owner dispatches the sync itself
+    if (juce::MessageManager::getInstanceWithoutCreating() != nullptr) {
+        startTimerHz(30);
+    }
+}
+
+MidiProcessor::~MidiProcessor()
+{
+    stopTimer();
 }
 
 void MidiProcessor::processMidiMessages(juce::MidiBuffer& midiMessages)
@@ -23,23 +40,142 @@ void MidiProcessor::processMidiMessages(juce::MidiBuffer& midiMessages)
         CS_DBG(" Received " + juce::String(midiMessages.getNumEvents()) + " MIDI events");
     }
     
+    numCoalescedEvents = 0;
+    
+    // A program change that waited for its bank to be staged
+    if (programSelector != nullptr) {
+        programSelector->applyPendingProgram();
+    }
+    
     // Process MIDI events
     for (const auto metadata : midiMessages) {
+        // SysEx dumps are only copied for the parsing thread; a MidiMessage of one would allocate
+        if (metadata.numBytes > 0 && metadata.data[0] == 0xf0) {
+            if (sysExReceiver != nullptr) {
+                sysExReceiver->push(metadata.data, metadata.numBytes);
+            }
+            continue;
+        }
+        
         const auto message = metadata.getMessage();
         
+        if (holdControllerEvent(message)) {
+            continue;
+        }
+        
+        // Notes and order-dependent controllers see every change that came before them
+        flushControllerEvents();
+        
+        // Held notes drive the arpeggiator, whose steps come back through processMidiNoteOn/Off
+        if (arpeggiator != nullptr && arpeggiator->isActive() && takenByArpeggiator(message, metadata.samplePosition)) {
+            continue;
+        }
+        
         if (message.isNoteOn()) {
             processMidiNoteOn(message);
         } else if (message.isNoteOff()) {
             processMidiNoteOff(message);
         } else if (message.isController()) {
-            CS_DBG(" MIDI CC - CC: " + juce::String(message.getControllerNumber()) + 
-                ", Value: " + juce::String(message.getControllerValue()));
-            handleMidiCC(message.getControllerNumber(), message.getControllerValue());
-        } else if (message.isPitchWheel()) {
-            CS_DBG(" Pitch Bend - Value: " + juce::String(message.getPitchWheelValue()));
-            handlePitchBend(message.getPitchWheelValue());
+            handleMidiCC(message.getChannel() - 1, message.getControllerNumber(), message.getControllerValue());
+        } else if (message.isProgramChange()) {
+            handleProgramChange(message.getChannel() - 1, message.getProgramChangeNumber());
         }
     }
+    
+    flushControllerEvents();
+    
+    if (numCoalescedEvents > 0) {
+        CS_DBG(" Coalesced " + juce::String(numCoalescedEvents) + " superseded controller events");
+    }
+}
+
+bool MidiProcessor::takenByArpeggiator(const juce::MidiMessage& message, int samplePosition)
+{
+    const int channel = message.getChannel() - 1;
+    const auto note = static_cast<uint8_t>(message.getNoteNumber());
+    if (message.isNoteOn()) {
+        return arpeggiator->noteOn(channel, note, message.getVelocity(), samplePosition);
+    }
+    if (message.isNoteOff()) {
+        // Notes pressed before the arpeggiator came on are released directly
+        return arpeggiator->noteOff(channel, note, samplePosition);
+    }
+    return false;
+}
+
+bool MidiProcessor::holdControllerEvent(const juce::MidiMessage& message)
+{
+    const int channel = message.getChannel() - 1;
+    if (channel < 0 || channel >= NumMidiChannels) {
+        return false;
+    }
+    
+    int slot;
+    int value;
+    if (message.isController()) {
+        if (isStatefulController(channel, message.getControllerNumber())) {
+            return false;
+        }
+        // Any other CC in between means a following CC 32 is not a Bank Select LSB
+        controllerStates[static_cast<size_t>(channel)].bankLsbExpected = false;
+        slot = ControllerSlotBase + channel * 128 + message.getControllerNumber();
+        value = message.getControllerValue();
+    } else if (message.isPitchWheel()) {
+        slot = PitchBendSlotBase + channel;
+        value = message.getPitchWheelValue();
+    } else if (message.isAftertouch()) {
+        slot = PolyPressureSlotBase + channel * 128 + message.getNoteNumber();
+        value = message.getAfterTouchValue();
+    } else if (message.isChannelPressure()) {
+        slot = ChannelPressureSlotBase + channel;
+        value = message.getChannelPressureValue();
+    } else {
+        return false;
+    }
+    
+    auto& held = heldControllerValues[static_cast<size_t>(slot)];
+    if (held < 0) {
+        heldControllerSlots[static_cast<size_t>(numHeldControllers++)] = static_cast<uint16_t>(slot);
+    } else {
+        ++numCoalescedEvents;
+    }
+    held = value;
+    return true;
+}
+
+void MidiProcessor::flushControllerEvents()
+{
+    for (int i = 0; i < numHeldControllers; ++i) {
+        const int slot = heldControllerSlots[static_cast<size_t>(i)];
+        const int value = std::exchange(heldControllerValues[static_cast<size_t>(slot)], -1);
+        
+        if (slot < PolyPressureSlotBase) {
+            const int channel = (slot - ControllerSlotBase) / 128;
+            const int ccNumber = (slot - ControllerSlotBase) % 128;
+            CS_DBG(" MIDI CC - CC: " + juce::String(ccNumber) + ", Value: " + juce::String(value));
+            handleMidiCC(channel, ccNumber, value);
+        } else if (slot < PitchBendSlotBase) {
+            // Aftertouch only means something to MPE notes
+            const int channel = (slot - PolyPressureSlotBase) / 128;
+            if (isMpeChannel(channel)) {
+                mpeManager->setPolyPressure(channel, (slot - PolyPressureSlotBase) % 128, value);
+            }
+        } else if (slot < ChannelPressureSlotBase) {
+            const int channel = slot - PitchBendSlotBase;
+            CS_DBG(" Pitch Bend - Value: " + juce::String(value));
+            if (isMpeChannel(channel)) {
+                mpeManager->setPitchBend(channel, value);
+            } else if (!isMpe()) {
+                handlePitchBend(value);
+            }
+        } else {
+            const int channel = slot - ChannelPressureSlotBase;
+            if (isMpeChannel(channel)) {
+                mpeManager->setChannelPressure(channel, value);
+            }
+        }
+    }
+    numHeldControllers = 0;
 }
 
 void MidiProcessor::processMidiNoteOn(const juce::MidiMessage& message)
@@ -54,19 +190,23 @@ void MidiProcessor::processMidiNoteOn(const juce::MidiMessage& message)
     CS_DBG(" Note ON - Note: " + juce::String(message.getNoteNumber()) + 
         ", Velocity: " + juce::String(message.getVelocity()));
     
+    if (isMultitimbral()) {
+        processPartNoteOn(message);
+        return;
+    }
+    
+    if (isMpe()) {
+        processMpeNoteOn(message);
+        return;
+    }
+    
     // Check if current preset needs noise (has noise enabled)
     bool needsNoise = currentPresetNeedsNoise();
     
     // Allocate a voice for this note with noise priority consideration
     int channel = voiceManager.allocateVoiceWithNoisePriority(message.getNoteNumber(), message.getVelocity(), needsNoise);
     
-    // Apply global pan setting to the allocated channel (optimized for real-time)
-    auto* panParam = static_cast<juce::AudioParameterChoice*>(parameters.getParameter(ParamID::Global::GlobalPan));
-    if (panParam && panParam->getIndex() == static_cast<int>(GlobalPanPosition::RANDOM)) {
-        // ALWAYS generate new random pan for each note (not just once per channel)
-        setChannelRandomPan(channel);
-    }
-    applyGlobalPan(channel);
+    applyNotePan(channel);
     
     // Tell ymfm to play this note on the allocated channel
     ymfmWrapper.noteOn(channel, message.getNoteNumber(), message.getVelocity());
@@ -80,6 +220,16 @@ void MidiProcessor::processMidiNoteOff(const juce::MidiMessage& message)
     CS_FILE_DBG("MidiProcessor::processMidiNoteOff - Note: " + juce::String(message.getNoteNumber()));
     CS_DBG(" Note OFF - Note: " + juce::String(message.getNoteNumber()));
     
+    if (isMultitimbral()) {
+        processPartNoteOff(message);
+        return;
+    }
+    
+    if (isMpe()) {
+        processMpeNoteOff(message);
+        return;
+    }
+    
     // Find which channel is playing this note
     int channel = voiceManager.getChannelForNote(message.getNoteNumber());
     if (channel >= 0) {
@@ -94,40 +244,489 @@ void MidiProcessor::processMidiNoteOff(const juce::MidiMessage& message)
     }
 }
 
+void MidiProcessor::applyNotePan(int channel)
+{
+    // Apply global pan setting to the allocated channel (optimized for real-time)
+    auto* panParam = static_cast<juce::AudioParameterChoice*>(parameters.getParameter(ParamID::Global::GlobalPan));
+    if (panParam && panParam->getIndex() == static_cast<int>(GlobalPanPosition::RANDOM)) {
+        // ALWAYS generate new random pan for each note (not just once per channel)
+        setChannelRandomPan(channel);
+    }
+    applyGlobalPan(channel);
+}
+
+bool MidiProcessor::isMultitimbral() const
+{
+    return partManager != nullptr && partManager->isEnabled();
+}
+
+void MidiProcessor::processPartNoteOn(const juce::MidiMessage& message)
+{
+    const auto note = static_cast<uint8_t>(message.getNoteNumber());
+    const auto velocity = message.getVelocity();
+    const uint8_t partsOnChannel = partManager->getPartsForMidiChannel(message.getChannel() - 1);
+    
+    // Parts sharing a MIDI channel split or layer by their zones, each on a voice from its own pool
+    for (int part = 0; part < PartManager::NumParts; ++part) {
+        if (((partsOnChannel >> part) & 1) == 0 || !partManager->acceptsNote(part, note, velocity)) {
+            continue;
+        }
+        const int channel = voiceManager.allocateVoiceInPool(note, velocity, selectPartChannels(part, note));
+        if (channel >= 0) {
+            // Registers are only written when the channel last played another zone
+            partManager->claimChannel(part, static_cast<uint8_t>(channel));
+            ymfmWrapper.noteOn(static_cast<uint8_t>(channel), note, velocity);
+        }
+    }
+}
+
+void MidiProcessor::processPartNoteOff(const juce::MidiMessage& message)
+{
+    const auto note = static_cast<uint8_t>(message.getNoteNumber());
+    const uint8_t partsOnChannel = partManager->getPartsForMidiChannel(message.getChannel() - 1);
+    
+    // A part's notes are on the channels holding its image, even after its pool changed;
+    // a stolen channel belongs to the new zone
+    for (int part = 0; part < PartManager::NumParts; ++part) {
+        if (((partsOnChannel >> part) & 1) == 0) {
+            continue;
+        }
+        const int channel = voiceManager.getChannelForNoteInPool(note, partManager->getOwnedChannels(part));
+        if (channel >= 0) {
+            ymfmWrapper.noteOff(static_cast<uint8_t>(channel), note);
+            voiceManager.releaseChannel(channel);
+        }
+    }
+}
+
+uint8_t MidiProcessor::selectPartChannels(int part, uint8_t note) const
+{
+    const uint8_t pool = partManager->getChannelMask(part);
+    const auto owned = static_cast<uint8_t>(pool & partManager->getOwnedChannels(part));
+    
+    // The same note retriggers on its own channel
+    if (voiceManager.getChannelForNoteInPool(note, owned) >= 0) {
+        return owned;
+    }
+    
+    uint8_t freeOwned = 0;
+    uint8_t freeInPool = 0;
+    for (int channel = 0; channel < 8; ++channel) {
+        if (((pool >> channel) & 1) && !voiceManager.isVoiceActive(channel)) {
+            freeInPool = static_cast<uint8_t>(freeInPool | (1 << channel));
+            if ((owned >> channel) & 1) {
+                freeOwned = static_cast<uint8_t>(freeOwned | (1 << channel));
+            }
+        }
+    }
+    
+    if (freeOwned != 0) return freeOwned;
+    if (freeInPool != 0) return freeInPool;
+    
+    // Pool full: steal within the zone before taking a channel from another one
+    return owned != 0 ? owned : pool;
+}
+
+bool MidiProcessor::isMpe() const
+{
+    return mpeManager != nullptr && mpeManager->isEnabled() && !isMultitimbral();
+}
+
+bool MidiProcessor::isMpeChannel(int midiChannel) const
+{
+    return mpeManager != nullptr && !isMultitimbral() && mpeManager->isZoneChannel(midiChannel);
+}
+
+void MidiProcessor::processMpeNoteOn(const juce::MidiMessage& message)
+{
+    const int midiChannel = message.getChannel() - 1;
+    if (!mpeManager->isZoneChannel(midiChannel)) {
+        return;
+    }
+    
+    const auto note = static_cast<uint8_t>(message.getNoteNumber());
+    const auto velocity = message.getVelocity();
+    
+    // A repeated note retriggers its own voice; the same note on another
+    // member channel is a separate voice with its own expression
+    uint8_t pool = 0xFF;
+    const int playing = mpeManager->findVoice(midiChannel, note);
+    if (playing >= 0) {
+        pool = static_cast<uint8_t>(1 << playing);
+    } else {
+        for (int channel = 0; channel < 8; ++channel) {
+            if (voiceManager.isVoiceActive(channel) && voiceManager.getNoteForChannel(channel) == note) {
+                pool = static_cast<uint8_t>(pool & ~(1 << channel));
+            }
+        }
+        if (pool == 0) {
+            pool = 0xFF;  // every voice plays this note; steal one of them
+        }
+    }
+    
+    const int channel = voiceManager.allocateVoiceInPool(note, velocity, pool);
+    if (channel < 0) {
+        return;
+    }
+    
+    applyNotePan(channel);
+    mpeManager->noteOn(channel, midiChannel, note, velocity);
+}
+
+void MidiProcessor::processMpeNoteOff(const juce::MidiMessage& message)
+{
+    const int channel = mpeManager->findVoice(message.getChannel() - 1, static_cast<uint8_t>(message.getNoteNumber()));
+    if (channel >= 0) {
+        mpeManager->noteOff(channel);
+        voiceManager.releaseChannel(channel);
+    }
+}
+
 void MidiProcessor::handleMidiCC(int ccNumber, int value)
+{
+    handleMidiCC(0, ccNumber, value);
+}
+
+void MidiProcessor::handleMidiCC(int midiChannel, int ccNumber, int value)
 {
     // Assert valid CC number and value ranges
     CS_ASSERT_PARAMETER_RANGE(ccNumber, 0, 127);
     CS_ASSERT_PARAMETER_RANGE(value, 0, 127);
     
-    // Handle channel pan CCs (32-39)
-    if (ccNumber >= ParamID::MIDI_CC::Ch0_Pan && ccNumber <= ParamID::MIDI_CC::Ch7_Pan)
-    {
-        int channel = ccNumber - ParamID::MIDI_CC::Ch0_Pan;
-        if (auto* param = dynamic_cast<juce::AudioParameterFloat*>(parameters.getParameter(ParamID::Channel::pan(channel))))
-        {
-            // Normalize CC value (0-127) to parameter range (0.0-1.0)
-            float normalizedValue = juce::jlimit(0.0f, 1.0f, value / 127.0f);
-            param->setValueNotifyingHost(normalizedValue);
-            
-            CS_DBG(" MIDI CC " + juce::String(ccNumber) + " = " + juce::String(value) + 
-                " -> Channel " + juce::String(channel) + " Pan = " + juce::String(normalizedValue, 3));
+    if (midiChannel < 0 || midiChannel >= NumMidiChannels || ccNumber < 0 || ccNumber > 127) {
+        return;
+    }
+    
+    auto& state = controllerStates[static_cast<size_t>(midiChannel)];
+    const auto value7 = static_cast<uint8_t>(juce::jlimit(0, 127, value));
+    
+    // Bank Select: a new MSB starts the bank number over with LSB 0, and
+    // CC 32 is the LSB only straight after it (otherwise it is channel 0 pan)
+    const bool isBankSelectLsb = ccNumber == ParamID::MIDI_CC::BankSelectLsb && state.bankLsbExpected;
+    state.bankLsbExpected = ccNumber == ParamID::MIDI_CC::BankSelectMsb;
+    if (ccNumber == ParamID::MIDI_CC::BankSelectMsb || isBankSelectLsb) {
+        state.bank = isBankSelectLsb ? (state.bank & ~0x7f) | value7 : value7 << 7;
+        if (programSelector != nullptr) {
+            programSelector->requestBank(state.bank);  // staged before the program change arrives
         }
         return;
     }
     
-    auto it = ccToParameterMap.find(ccNumber);
-    if (it != ccToParameterMap.end() && it->second != nullptr)
+    // Parameter numbers and data entry
+    switch (ccNumber) {
+        case ParamID::MIDI_CC::NrpnMsb:
+            state.nrpnMsb = value7;
+            state.rpnSelected = false;
+            return;
+        case ParamID::MIDI_CC::NrpnLsb:
+            state.nrpnLsb = value7;
+            state.rpnSelected = false;
+            return;
+        case ParamID::MIDI_CC::RpnMsb:
+            state.rpnMsb = value7;
+            state.rpnSelected = true;
+            return;
+        case ParamID::MIDI_CC::RpnLsb:
+            state.rpnLsb = value7;
+            state.rpnSelected = true;
+            return;
+        case ParamID::MIDI_CC::DataEntryMsb:
+            // A new MSB starts the value over with LSB 0
+            state.dataEntryMsb = value7;
+            applyDataEntry(midiChannel, state, value7 << 7);
+            return;
+        case ParamID::MIDI_CC::DataIncrement:
+            stepDataEntry(state, 1);
+            return;
+        case ParamID::MIDI_CC::DataDecrement:
+            stepDataEntry(state, -1);
+            return;
+        default:
+            break;
+    }
+    
+    if (ccNumber == ParamID::MIDI_CC::DataEntryLsb && isParameterSelected(state)) {
+        applyDataEntry(midiChannel, state, (state.dataEntryMsb << 7) | value7);
+        return;
+    }
+    
+    // MIDI learn takes the controller instead of applying it
+    if (learnArmed.load() && isAssignableController(ccNumber)) {
+        learnedController.store(ccNumber);
+        learnArmed.store(false);
+        return;
+    }
+    
+    // MPE timbre goes to the notes of its member channel
+    if (ccNumber == ParamID::MIDI_CC::MpeTimbre && isMpeChannel(midiChannel)) {
+        mpeManager->setTimbre(midiChannel, value7);
+        return;
+    }
+    
+    // 14-bit CC pairs: the MSB applies at once, the LSB refines it
+    const ScopedCCMapReader reader(ccMapReaders);
+    const auto* map = ccMap.load();
+    float normalizedValue = value7 / 127.0f;
+    const CCBinding* binding = &map->bindings[static_cast<size_t>(ccNumber)];
+    if (ccNumber < 32 && map->highResolutionPairs[static_cast<size_t>(ccNumber)]) {
+        state.highResolutionMsb[static_cast<size_t>(ccNumber)] = value7;
+    } else if (ccNumber >= 32 && ccNumber < 64 && map->highResolutionPairs[static_cast<size_t>(ccNumber - 32)]) {
+        const int msbNumber = ccNumber - 32;
+        binding = &map->bindings[static_cast<size_t>(msbNumber)];
+        normalizedValue = ((state.highResolutionMsb[static_cast<size_t>(msbNumber)] << 7) | value7) / 16383.0f;
+    }
+    
+    if (binding->parameter == nullptr) {
+        return;
+    }
+    
+    setParameterFromMidi(*binding, normalizedValue);
+    
+    CS_DBG(" MIDI CC " + juce::String(ccNumber) + " = " + juce::String(value) + 
+        " -> " + binding->parameter->name + " = " + juce::String(binding->parameter->getValue()));
+}
+
+void MidiProcessor::handleProgramChange(int midiChannel, int program)
+{
+    // Parts get their presets from the PartManager, not from program changes
+    if (midiChannel < 0 || midiChannel >= NumMidiChannels || programSelector == nullptr || isMultitimbral()) {
+        return;
+    }
+    
+    auto& state = controllerStates[static_cast<size_t>(midiChannel)];
+    state.bankLsbExpected = false;
+    
+    const bool applied = programSelector->selectProgram(state.bank, juce::jlimit(0, 127, program));
+    CS_DBG(" Program Change - Bank: " + juce::String(state.bank) + ", Program: " + juce::String(program)
+        + (applied ? "" : " (waiting for bank or not in bank)"));
+}
+
+void MidiProcessor::setParameterFromMidi(const CCBinding& binding, float normalizedValue)
+{
+    if (binding.parameter == nullptr) {
+        return;
+    }
+    
+    // setValue() only stores the value; the host hears about it later from the message thread
+    binding.parameter->setValue(juce::jlimit(0.0f, 1.0f, normalizedValue));
+    applyCCBinding(binding);
+    queueParameterSync(binding.parameter);
+}
+
+const MidiProcessor::CCBinding* MidiProcessor::getSelectedParameter(const ChannelControllerState& state) const
+{
+    if (state.rpnSelected) {
+        if (state.rpnMsb == 0 && state.rpnLsb == ParamID::NRPN::RpnPitchBendSensitivity) {
+            return &nrpnBindings[static_cast<size_t>(ParamID::NRPN::GlobalGroup * ParamID::NRPN::MaxParametersPerGroup
+                                                     + ParamID::NRPN::PitchBendRange)];
+        }
+        return nullptr;
+    }
+    
+    if (state.nrpnMsb >= ParamID::NRPN::NumGroups || state.nrpnLsb >= ParamID::NRPN::MaxParametersPerGroup) {
+        return nullptr;
+    }
+    const auto& binding = nrpnBindings[static_cast<size_t>(state.nrpnMsb * ParamID::NRPN::MaxParametersPerGroup + state.nrpnLsb)];
+    return binding.parameter != nullptr ? &binding : nullptr;
+}
+
+bool MidiProcessor::isParameterSelected(const ChannelControllerState& state) const
+{
+    return state.rpnSelected ? !(state.rpnMsb == 127 && state.rpnLsb == 127)
+                             : !(state.nrpnMsb == 127 && state.nrpnLsb == 127);
+}
+
+void MidiProcessor::applyDataEntry(int midiChannel, const ChannelControllerState& state, int data)
+{
+    if (applyMpeDataEntry(midiChannel, state, data)) {
+        return;
+    }
+    
+    const auto* binding = getSelectedParameter(state);
+    if (binding == nullptr) {
+        return;
+    }
+    
+    // RPN 0 carries semitones in the MSB (the LSB is cents, which the range does not have)
+    const int rawValue = state.rpnSelected ? (data >> 7) : data;
+    const float normalizedValue = binding->continuous ? rawValue / 16383.0f
+                                                      : binding->parameter->convertTo0to1(static_cast<float>(rawValue));
+    setParameterFromMidi(*binding, normalizedValue);
+}
+
+bool MidiProcessor::applyMpeDataEntry(int midiChannel, const ChannelControllerState& state, int data)
+{
+    if (mpeManager == nullptr || isMultitimbral() || !state.rpnSelected || state.rpnMsb != 0) {
+        return false;
+    }
+    
+    // Both carry their value in the data entry MSB
+    if (state.rpnLsb == ParamID::NRPN::RpnMpeConfiguration) {
+        mpeManager->handleConfigurationMessage(midiChannel, data >> 7);
+        return true;
+    }
+    if (state.rpnLsb == ParamID::NRPN::RpnPitchBendSensitivity && mpeManager->isZoneChannel(midiChannel)) {
+        mpeManager->setBendRange(midiChannel, data >> 7);
+        return true;
+    }
+    return false;
+}
+
+void MidiProcessor::stepDataEntry(const ChannelControllerState& state, int delta)
+{
+    const auto* binding = getSelectedParameter(state);
+    if (binding == nullptr) {
+        return;
+    }
+    
+    // One step in the units data entry uses
+    auto* parameter = binding->parameter;
+    if (binding->continuous) {
+        const int rawValue = juce::roundToInt(parameter->getValue() * 16383.0f) + delta;
+        setParameterFromMidi(*binding, juce::jlimit(0, 16383, rawValue) / 16383.0f);
+    } else {
+        const int rawValue = juce::roundToInt(parameter->convertFrom0to1(parameter->getValue())) + delta;
+        setParameterFromMidi(*binding, parameter->convertTo0to1(static_cast<float>(rawValue)));
+    }
+}
+
+bool MidiProcessor::isStatefulController(int midiChannel, int ccNumber) const
+{
+    switch (ccNumber) {
+        case ParamID::MIDI_CC::NrpnMsb:
+        case ParamID::MIDI_CC::NrpnLsb:
+        case ParamID::MIDI_CC::RpnMsb:
+        case ParamID::MIDI_CC::RpnLsb:
+        case ParamID::MIDI_CC::DataEntryMsb:
+        case ParamID::MIDI_CC::DataIncrement:
+        case ParamID::MIDI_CC::DataDecrement:
+            return true;
+        case ParamID::MIDI_CC::DataEntryLsb:
+            return isParameterSelected(controllerStates[static_cast<size_t>(midiChannel)]);
+        case ParamID::MIDI_CC::BankSelectMsb:
+            return true;
+        case ParamID::MIDI_CC::BankSelectLsb:
+            return controllerStates[static_cast<size_t>(midiChannel)].bankLsbExpected;
+        default:
+            return false;
+    }
+}
+
+void MidiProcessor::applyCCBinding(const CCBinding& binding)
+{
+    // Same scaling as ParameterManager's periodic update, from the stored
+    // (snapped) value, so the next update writes the same registers
+    const float value = binding.parameter->getValue();
+    
+    // Multitimbral parts own the per-channel registers
+    const bool writesChannels = binding.target == CCTarget::OperatorParameter || binding.target == CCTarget::OperatorAmsEnable
+                             || binding.target == CCTarget::Algorithm || binding.target == CCTarget::Feedback;
+    if (writesChannels && !parameterManager.ownsChannelRegisters()) {
+        return;
+    }
+    
+    switch (binding.target) {
+        case CCTarget::OperatorParameter: {
+            const auto field = static_cast<uint8_t>(value * binding.scale);
+            for (uint8_t channel = 0; channel < 8; ++channel) {
+                ymfmWrapper.setOperatorParameter(channel, binding.operatorIndex, binding.operatorParameter, field);
+            }
+            break;
+        }
+        case CCTarget::OperatorAmsEnable:
+            for (uint8_t channel = 0; channel < 8; ++channel) {
+                ymfmWrapper.setOperatorAmsEnable(channel, binding.operatorIndex, value > 0.5f);
+            }
+            break;
+        case CCTarget::Algorithm:
+            for (uint8_t channel = 0; channel < 8; ++channel) {
+                ymfmWrapper.setAlgorithm(channel, static_cast<uint8_t>(value * binding.scale));
+            }
+            break;
+        case CCTarget::Feedback:
+            for (uint8_t channel = 0; channel < 8; ++channel) {
+                ymfmWrapper.setFeedback(channel, static_cast<uint8_t>(value * binding.scale));
+            }
+            break;
+        case CCTarget::Lfo:
+            if (lfoRateParam && lfoAmdParam && lfoPmdParam && lfoWaveformParam) {
+                ymfmWrapper.setLfoParameters(
+                    static_cast<uint8_t>(lfoRateParam->getValue() * 255.0f),
+                    static_cast<uint8_t>(lfoAmdParam->getValue() * 127.0f),
+                    static_cast<uint8_t>(lfoPmdParam->getValue() * 127.0f),
+                    static_cast<uint8_t>(lfoWaveformParam->getIndex()));
+            }
+            break;
+        case CCTarget::Noise:
+            if (noiseEnableParam && noiseFrequencyParam) {
+                ymfmWrapper.setNoiseParameters(noiseEnableParam->getValue() >= 0.5f,
+                                               static_cast<uint8_t>(noiseFrequencyParam->getValue() * 31.0f));
+            }
+            break;
+        case CCTarget::ParameterOnly:
+        case CCTarget::None:
+            break;
+    }
+}
+
+void MidiProcessor::queueParameterSync(juce::RangedAudioParameter* parameter)
+{
+    const auto scope = parameterSyncFifo.write(1);
+    if (scope.blockSize1 > 0) {
+        parameterSyncQueue[static_cast<size_t>(scope.startIndex1)] = parameter;
+    } else {
+        // The message thread is behind; it resends everything instead
+        parameterSyncOverflowed.store(true);
+    }
+}
+
+int MidiProcessor::dispatchPendingParameterSync()
+{
+    std::array<juce::RangedAudioParameter*, ParameterSyncQueueSize> changed;
+    int numChanged = 0;
+    
+    const auto addChanged = [&changed, &numChanged](juce::RangedAudioParameter* parameter) {
+        for (int i = 0; i < numChanged; ++i) {
+            if (changed[static_cast<size_t>(i)] == parameter) {
+                return;
+            }
+        }
+        changed[static_cast<size_t>(numChanged++)] = parameter;
+    };
+    
     {
-        // Normalize CC value (0-127) to parameter range (0.0-1.0)
-        float normalizedValue = juce::jlimit(0.0f, 1.0f, value / 127.0f);
-        
-        // Update parameter (thread-safe)
-        it->second->setValueNotifyingHost(normalizedValue);
-        
-        CS_DBG(" MIDI CC " + juce::String(ccNumber) + " = " + juce::String(value) + 
-            " -> " + it->second->name + " = " + juce::String(it->second->getValue()));
+        const auto scope = parameterSyncFifo.read(parameterSyncFifo.getNumReady());
+        scope.forEach([this, &addChanged](int index) {
+            addChanged(parameterSyncQueue[static_cast<size_t>(index)]);
+        });
+    }
+    
+    if (parameterSyncOverflowed.exchange(false)) {
+        for (const auto& binding : currentCCMap->bindings) {
+            if (binding.parameter != nullptr) {
+                addChanged(binding.parameter);
+            }
+        }
     }
+    
+    // The value is already stored; this sends it to the host, the attachments
+    // and ParameterManager's listener
+    for (int i = 0; i < numChanged; ++i) {
+        auto* parameter = changed[static_cast<size_t>(i)];
+        parameter->setValueNotifyingHost(parameter->getValue());
+    }
+    
+    if (numChanged > 0) {
+        CS_FILE_DBG("MidiProcessor - synced " + juce::String(numChanged) + " CC-controlled parameters");
+    }
+    return numChanged;
+}
+
+void MidiProcessor::timerCallback()
+{
+    dispatchPendingParameterSync();
+    applyLearnedController();
+    reclaimRetiredCCMaps();
 }
 
 void MidiProcessor::handlePitchBend(int pitchBendValue)
@@ -139,7 +738,10 @@ void MidiProcessor::handlePitchBend(int pitchBendValue)
     currentPitchBend = pitchBendValue;
     
     // Get pitch bend range from parameter (1-12 semitones)
-    int pitchBendRange = static_cast<int>(*parameters.getRawParameterValue(ParamID::Global::PitchBendRange));
+    // Read from the parameter, which RPN 0 may have just set
+    const int pitchBendRange = pitchBendRangeParam != nullptr
+        ? juce::roundToInt(pitchBendRangeParam->convertFrom0to1(pitchBendRangeParam->getValue()))
+        : 2;
     
     // Calculate pitch bend amount in semitones
     // MIDI pitch bend: 0-16383, center = 8192
@@ -166,45 +768,268 @@ void MidiProcessor::handlePitchBend(int pitchBendValue)
 
 void MidiProcessor::setupCCMapping()
 {
-    // VOPMex compatible MIDI CC mapping
+    // VOPMex compatible MIDI CC mapping, plus an NRPN for every parameter
+    using OpParam = YmfmWrapperInterface::OperatorParameter;
+    namespace NRPN = ParamID::NRPN;
+    
+    defaultCCBindings.fill({});
+    nrpnBindings.fill({});
+    
+    lfoRateParam = parameters.getParameter(ParamID::Global::LfoRate);
+    lfoAmdParam = parameters.getParameter(ParamID::Global::LfoAmd);
+    lfoPmdParam = parameters.getParameter(ParamID::Global::LfoPmd);
+    lfoWaveformParam = dynamic_cast<juce::AudioParameterChoice*>(parameters.getParameter(ParamID::Global::LfoWaveform));
+    noiseEnableParam = parameters.getParameter(ParamID::Global::NoiseEnable);
+    noiseFrequencyParam = parameters.getParameter(ParamID::Global::NoiseFrequency);
+    pitchBendRangeParam = parameters.getParameter(ParamID::Global::PitchBendRange);
+    
+    const auto bindGlobal = [this](int ccNumber, int nrpn, const CCBinding& binding) {
+        bindCC(ccNumber, binding);
+        bindNRPN(NRPN::GlobalGroup, nrpn, binding);
+    };
     
     // Global parameters
-    ccToParameterMap[ParamID::MIDI_CC::Algorithm] = parameters.getParameter(ParamID::Global::Algorithm);
-    ccToParameterMap[ParamID::MIDI_CC::Feedback] = parameters.getParameter(ParamID::Global::Feedback);
-    ccToParameterMap[ParamID::MIDI_CC::LfoRate] = 
-        parameters.getParameter(ParamID::Global::LfoRate);
-    ccToParameterMap[ParamID::MIDI_CC::LfoAmd] = 
-        parameters.getParameter(ParamID::Global::LfoAmd);
-    ccToParameterMap[ParamID::MIDI_CC::LfoPmd] = 
-        parameters.getParameter(ParamID::Global::LfoPmd);
-    ccToParameterMap[ParamID::MIDI_CC::LfoWaveform] = 
-        parameters.getParameter(ParamID::Global::LfoWaveform);
-    
-    // Noise parameters - AudioParameterBool needs special handling for MIDI CC
-    ccToParameterMap[ParamID::MIDI_CC::NoiseEnable] = 
-        parameters.getParameter(ParamID::Global::NoiseEnable);
-    ccToParameterMap[ParamID::MIDI_CC::NoiseFrequency] = 
-        parameters.getParameter(ParamID::Global::NoiseFrequency);
-    
-    // Operator parameters (Op1-Op4, all 4 operators)
+    bindGlobal(ParamID::MIDI_CC::Algorithm, NRPN::Algorithm,
+               makeBinding(parameters.getParameter(ParamID::Global::Algorithm), CCTarget::Algorithm, 7.0f));
+    bindGlobal(ParamID::MIDI_CC::Feedback, NRPN::Feedback,
+               makeBinding(parameters.getParameter(ParamID::Global::Feedback), CCTarget::Feedback, 7.0f));
+    bindGlobal(ParamID::MIDI_CC::LfoRate, NRPN::LfoRate, makeBinding(lfoRateParam, CCTarget::Lfo));
+    bindGlobal(ParamID::MIDI_CC::LfoAmd, NRPN::LfoAmd, makeBinding(lfoAmdParam, CCTarget::Lfo));
+    bindGlobal(ParamID::MIDI_CC::LfoPmd, NRPN::LfoPmd, makeBinding(lfoPmdParam, CCTarget::Lfo));
+    bindGlobal(ParamID::MIDI_CC::LfoWaveform, NRPN::LfoWaveform, makeBinding(lfoWaveformParam, CCTarget::Lfo));
+    
+    // Noise parameters
+    bindGlobal(ParamID::MIDI_CC::NoiseEnable, NRPN::NoiseEnable, makeBinding(noiseEnableParam, CCTarget::Noise));
+    bindGlobal(ParamID::MIDI_CC::NoiseFrequency, NRPN::NoiseFrequency, makeBinding(noiseFrequencyParam, CCTarget::Noise));
+    
+    // NRPN only: global pan is applied by the parameter listeners, the bend range is read per bend
+    bindNRPN(NRPN::GlobalGroup, NRPN::GlobalPan,
+             makeBinding(parameters.getParameter(ParamID::Global::GlobalPan), CCTarget::ParameterOnly));
+    bindNRPN(NRPN::GlobalGroup, NRPN::PitchBendRange, makeBinding(pitchBendRangeParam, CCTarget::ParameterOnly));
+    
+    // Operator parameters (Op1-Op4, all 4 operators). The NRPN parameter
+    // number is the offset within the operator's block of 11 CCs.
     for (int op = 1; op <= 4; ++op) {
-        int baseCC = ParamID::MIDI_CC::Op1_TL + (op - 1) * 11; // 11 CCs per operator
+        const int baseCC = ParamID::MIDI_CC::Op1_TL + (op - 1) * 11; // 11 CCs per operator
+        const int group = NRPN::Op1Group + op - 1;
+        const auto opIndex = static_cast<uint8_t>(op - 1);
+        const auto bindOp = [&](int offset, const std::string& id, OpParam field, float scale) {
+            const auto binding = makeBinding(parameters.getParameter(id), CCTarget::OperatorParameter, scale, opIndex, field);
+            bindCC(baseCC + offset, binding);
+            bindNRPN(group, offset, binding);
+        };
+        
+        bindOp(NRPN::OpTL, ParamID::Op::tl(op), OpParam::TotalLevel, 127.0f);
+        bindOp(NRPN::OpAR, ParamID::Op::ar(op), OpParam::AttackRate, 31.0f);
+        bindOp(NRPN::OpD1R, ParamID::Op::d1r(op), OpParam::Decay1Rate, 31.0f);
+        bindOp(NRPN::OpD2R, ParamID::Op::d2r(op), OpParam::Decay2Rate, 31.0f);
+        bindOp(NRPN::OpRR, ParamID::Op::rr(op), OpParam::ReleaseRate, 15.0f);
+        bindOp(NRPN::OpD1L, ParamID::Op::d1l(op), OpParam::SustainLevel, 15.0f);
+        bindOp(NRPN::OpKS, ParamID::Op::ks(op), OpParam::KeyScale, 3.0f);
+        bindOp(NRPN::OpMUL, ParamID::Op::mul(op), OpParam::Multiple, 15.0f);
+        bindOp(NRPN::OpDT1, ParamID::Op::dt1(op), OpParam::Detune1, 7.0f);
+        bindOp(NRPN::OpDT2, ParamID::Op::dt2(op), OpParam::Detune2, 3.0f);
         
-        ccToParameterMap[baseCC + 0] = parameters.getParameter(ParamID::Op::tl(op));        // TL
-        ccToParameterMap[baseCC + 1] = parameters.getParameter(ParamID::Op::ar(op));        // AR
-        ccToParameterMap[baseCC + 2] = parameters.getParameter(ParamID::Op::d1r(op));       // D1R
-        ccToParameterMap[baseCC + 3] = parameters.getParameter(ParamID::Op::d2r(op));       // D2R
-        ccToParameterMap[baseCC + 4] = parameters.getParameter(ParamID::Op::rr(op));        // RR
-        ccToParameterMap[baseCC + 5] = parameters.getParameter(ParamID::Op::d1l(op));       // D1L
-        ccToParameterMap[baseCC + 6] = parameters.getParameter(ParamID::Op::ks(op));        // KS
-        ccToParameterMap[baseCC + 7] = parameters.getParameter(ParamID::Op::mul(op));       // MUL
-        ccToParameterMap[baseCC + 8] = parameters.getParameter(ParamID::Op::dt1(op));       // DT1
-        ccToParameterMap[baseCC + 9] = parameters.getParameter(ParamID::Op::dt2(op));       // DT2
-        ccToParameterMap[baseCC + 10] = parameters.getParameter(ParamID::Op::ams_en(op));   // AMS-EN
+        const auto ams = makeBinding(parameters.getParameter(ParamID::Op::ams_en(op)), CCTarget::OperatorAmsEnable, 0.0f, opIndex);
+        bindCC(baseCC + NRPN::OpAmsEnable, ams);
+        bindNRPN(group, NRPN::OpAmsEnable, ams);
+    }
+    
+    // Channel pan CCs (32-39) map straight to each channel's pan parameter. They
+    // overlap the Op2/Op3 range and take precedence, so they are bound last.
+    for (int channel = 0; channel < 8; ++channel) {
+        const auto pan = makeBinding(parameters.getParameter(ParamID::Channel::pan(channel)), CCTarget::ParameterOnly);
+        bindCC(ParamID::MIDI_CC::Ch0_Pan + channel, pan);
+        bindNRPN(NRPN::ChannelGroup, channel, pan);
+    }
+    
+    publishCCMap();
+}
+
+void MidiProcessor::publishCCMap()
+{
+    auto map = std::make_unique<CCMap>();
+    map->bindings = defaultCCBindings;
+    map->mappings = learnedMappings;
+    for (const auto& [ccNumber, parameterId] : learnedMappings) {
+        map->bindings[static_cast<size_t>(ccNumber)] = parameterId.isEmpty() ? CCBinding {} : findLearnBinding(parameterId);
+    }
+    
+    // 14-bit pairs only where the LSB CC is free and the parameter has the steps to use it
+    for (int msbNumber = 0; msbNumber < 32; ++msbNumber) {
+        const auto& msb = map->bindings[static_cast<size_t>(msbNumber)];
+        map->highResolutionPairs[static_cast<size_t>(msbNumber)] =
+            msb.parameter != nullptr
+            && map->bindings[static_cast<size_t>(msbNumber + 32)].parameter == nullptr
+            && msbNumber != ParamID::MIDI_CC::DataEntryMsb
+            && (msb.continuous || msb.parameter->getNumSteps() > 128);
+    }
+    
+    ccMap.store(map.get());
+    if (currentCCMap != nullptr) {
+        retiredCCMaps.push_back(std::move(currentCCMap));
+    }
+    currentCCMap = std::move(map);
+    reclaimRetiredCCMaps();
+}
+
+void MidiProcessor::reclaimRetiredCCMaps()
+{
+    // Readers count themselves before loading the map and stop once done with it, so when
+    // the count is seen at zero nothing can still be reading a map replaced before now.
+    // A map still in use is retried on the next timer tick.
+    if (!retiredCCMaps.empty() && ccMapReaders.load() == 0) {
+        retiredCCMaps.clear();
+    }
+}
+
+// ============================================================================
+// MIDI Learn
+// ============================================================================
+
+bool MidiProcessor::isAssignableController(int ccNumber)
+{
+    switch (ccNumber) {
+        case ParamID::MIDI_CC::BankSelectMsb:
+        case ParamID::MIDI_CC::DataEntryMsb:
+        case ParamID::MIDI_CC::DataEntryLsb:
+        case ParamID::MIDI_CC::DataIncrement:
+        case ParamID::MIDI_CC::DataDecrement:
+        case ParamID::MIDI_CC::NrpnLsb:
+        case ParamID::MIDI_CC::NrpnMsb:
+        case ParamID::MIDI_CC::RpnLsb:
+        case ParamID::MIDI_CC::RpnMsb:
+            return false;
+        default:
+            return ccNumber >= 0 && ccNumber < 120;   // 120-127 are channel mode messages
+    }
+}
+
+MidiProcessor::CCBinding MidiProcessor::findLearnBinding(const juce::String& parameterId) const
+{
+    // The NRPN table has every parameter a CC writes to the chip directly
+    for (const auto& binding : nrpnBindings) {
+        if (binding.parameter != nullptr && binding.parameter->paramID == parameterId) {
+            return binding;
+        }
+    }
+    return makeBinding(parameters.getParameter(parameterId), CCTarget::ParameterOnly);
+}
+
+bool MidiProcessor::armMidiLearn(const juce::String& parameterId)
+{
+    learnArmed.store(false);
+    learnedController.store(-1);
+    learnParameterId = {};
+    
+    if (parameterId.isEmpty() || findLearnBinding(parameterId).parameter == nullptr) {
+        return false;
+    }
+    
+    learnParameterId = parameterId;
+    learnArmed.store(true);
+    CS_DBG(" MIDI learn armed for " + parameterId);
+    return true;
+}
+
+bool MidiProcessor::applyLearnedController()
+{
+    const int ccNumber = learnedController.exchange(-1);
+    if (ccNumber < 0 || learnParameterId.isEmpty()) {
+        return false;
+    }
+    
+    const auto parameterId = learnParameterId;
+    learnParameterId = {};
+    
+    // One learned CC per parameter; the CC it had before goes back to the VOPMex layout
+    for (auto it = learnedMappings.begin(); it != learnedMappings.end();) {
+        it = it->second == parameterId ? learnedMappings.erase(it) : std::next(it);
+    }
+    learnedMappings[ccNumber] = parameterId;
+    publishCCMap();
+    
+    CS_DBG(" MIDI learn - CC " + juce::String(ccNumber) + " -> " + parameterId);
+    if (onMidiLearned) {
+        onMidiLearned(ccNumber, parameterId);
+    }
+    if (onMidiMappingsChanged) {
+        onMidiMappingsChanged();
+    }
+    return true;
+}
+
+bool MidiProcessor::setMidiMapping(int ccNumber, const juce::String& parameterId)
+{
+    if (!isAssignableController(ccNumber)
+        || (parameterId.isNotEmpty() && findLearnBinding(parameterId).parameter == nullptr)) {
+        return false;
+    }
+    
+    learnedMappings[ccNumber] = parameterId;
+    publishCCMap();
+    if (onMidiMappingsChanged) {
+        onMidiMappingsChanged();
+    }
+    return true;
+}
+
+void MidiProcessor::setMidiMappings(const std::map<int, juce::String>& mappings)
+{
+    learnedMappings.clear();
+    for (const auto& [ccNumber, parameterId] : mappings) {
+        if (isAssignableController(ccNumber)) {
+            learnedMappings[ccNumber] = parameterId;
+        }
+    }
+    publishCCMap();
+}
+
+std::map<int, juce::String> MidiProcessor::getMidiMappings() const
+{
+    // learnedMappings is message thread only; the published map is never changed
+    const ScopedCCMapReader reader(ccMapReaders);
+    return ccMap.load()->mappings;
+}
+
+juce::String MidiProcessor::getMappedParameter(int ccNumber) const
+{
+    if (ccNumber < 0 || ccNumber > 127) {
+        return {};
+    }
+    const auto* parameter = currentCCMap->bindings[static_cast<size_t>(ccNumber)].parameter;
+    return parameter != nullptr ? parameter->paramID : juce::String();
+}
+
+MidiProcessor::CCBinding MidiProcessor::makeBinding(juce::RangedAudioParameter* parameter, CCTarget target, float scale,
+                                                    uint8_t operatorIndex, YmfmWrapperInterface::OperatorParameter operatorParameter)
+{
+    CCBinding binding;
+    if (parameter == nullptr) {
+        return binding;
     }
     
-    // Note: Channel pan parameters are handled separately in handleMidiCC() 
-    // for CCs 32-39 to allow direct channel mapping
+    binding.target = target;
+    binding.parameter = parameter;
+    binding.operatorIndex = operatorIndex;
+    binding.operatorParameter = operatorParameter;
+    binding.scale = scale;
+    binding.continuous = dynamic_cast<juce::AudioParameterFloat*>(parameter) != nullptr;
+    return binding;
+}
+
+void MidiProcessor::bindCC(int ccNumber, const CCBinding& binding)
+{
+    if (ccNumber >= 0 && ccNumber < static_cast<int>(defaultCCBindings.size()) && binding.parameter != nullptr) {
+        defaultCCBindings[static_cast<size_t>(ccNumber)] = binding;
+    }
+}
+
+void MidiProcessor::bindNRPN(int group, int index, const CCBinding& binding)
+{
+    if (group >= 0 && group < ParamID::NRPN::NumGroups && index >= 0 && index < ParamID::NRPN::MaxParametersPerGroup) {
+        nrpnBindings[static_cast<size_t>(group * ParamID::NRPN::MaxParametersPerGroup + index)] = binding;
+    }
 }
 
 void MidiProcessor::setChannelRandomPan(int channel)
@@ -221,7 +1046,8 @@ void MidiProcessor::applyGlobalPan(int channel)
 
 bool MidiProcessor::currentPresetNeedsNoise() const
 {
-    return *parameters.getRawParameterValue(ParamID::Global::NoiseEnable) >= 0.5f;
+    // The parameter itself, not the tree's cached value, which lags CC changes until they are synced
+    return noiseEnableParam != nullptr && noiseEnableParam->getValue() >= 0.5f;
 }
 
 } // namespace ymulatorsynth
\ No newline at end of file
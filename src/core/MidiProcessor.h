@@ -7,13 +7,23 @@
 #include "../utils/Debug.h"
 
 #include <juce_audio_processors/juce_audio_processors.h>
-#include <unordered_map>
+#include <array>
 #include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace ymulatorsynth {
 
-// Forward declaration
+// Forward declarations
 class ParameterManager;
+class MidiProgramSelector;
+class PartManager;
+class MpeManager;
+class SysExReceiver;
+class Arpeggiator;
 
 /**
  * Handles MIDI message processing and routing for YMulator-Synth.
@@ -26,8 +36,66 @@ class ParameterManager;
  * 
  * This class extracts MIDI processing logic from PluginProcessor to improve
  * testability and maintain single responsibility principle.
+ *
+ * CC handling is real-time safe: each CC number indexes a flat table of
+ * bindings resolved on the message thread. On the audio thread a CC only
+ * stores the parameter value (an atomic store, no listeners) and writes the
+ * affected registers straight away. Telling the host and the UI about the
+ * change is queued on a lock-free FIFO and done on the message thread by
+ * dispatchPendingParameterSync(), which a timer calls when a message loop
+ * exists.
+ *
+ * Controller events are applied once per block, not per sample, so only the
+ * last one for each controller counts. processMidiMessages() holds CC,
+ * pitch-bend and aftertouch events back and applies only the latest value per
+ * MIDI channel and controller, in arrival order, whenever a note event or the
+ * end of the block is reached. Notes see exactly the controller state they
+ * would have seen without coalescing.
+ *
+ * Every automatable parameter also has an NRPN (see ParamID::NRPN), and RPN 0
+ * sets the pitch bend range. Data entry values are integers in the
+ * parameter's own units, so they reach the registers without 7-bit scaling.
+ * A CC 0-31 bound to a parameter with more than 128 steps takes CC+32 as its
+ * LSB when that CC is free. The parser state is kept per MIDI channel in
+ * fixed arrays; parameter number and data entry CCs are never coalesced.
+ *
+ * Bank Select (CC 0, then optionally CC 32) and Program Change switch presets
+ * through a MidiProgramSelector, which has the selected bank's register
+ * images staged in advance. Without one, both are ignored.
+ *
+ * In multitimbral mode (see PartManager) a note goes to every part listening
+ * on its MIDI channel whose note and velocity zone holds it, and takes a
+ * voice from that part's channel pool. CCs then only change the chip-wide LFO
+ * and noise registers, and program changes are ignored; parts get their
+ * presets through the PartManager.
+ *
+ * With MPE zones set (see MpeManager), notes on a zone's channels play one
+ * voice per note, and the pitch bend, pressure and CC 74 timbre of each
+ * member channel reach only its own notes. RPN 6 on channel 1 or 16 sets the
+ * zones; RPN 0 on a zone channel sets that zone's bend range. Notes and bends
+ * outside the zones are ignored while MPE is on, and MPE is off in
+ * multitimbral mode.
+ *
+ * SysEx messages are handed as raw bytes to a SysExReceiver, which queues
+ * YMulator voice and bank dumps for parsing off the audio thread.
+ *
+ * While an Arpeggiator is active, played notes go to it with their sample
+ * positions instead of being played. Its steps come back through
+ * processMidiNoteOn/Off() and take the same single, multitimbral or MPE path.
+ *
+ * The CC table is a CCMap: the VOPMex layout with the learned mappings on
+ * top. A published map is never changed; the message thread builds a new one
+ * and swaps it in with a single atomic pointer store, so the audio thread
+ * neither locks nor allocates and a remap never glitches running notes.
+ * Readers count themselves while they use a map; a replaced map is freed on
+ * the message thread once that count has been seen at zero after it was
+ * replaced, so none can still be reading it. For
+ * MIDI learn, armMidiLearn() arms a parameter; the audio thread records the
+ * next assignable CC instead of applying it, and the message thread maps it
+ * in applyLearnedController(), which the timer calls.
  */
-class MidiProcessor : public MidiProcessorInterface {
+class MidiProcessor : public MidiProcessorInterface,
+                      private juce::Timer {
 public:
     /**
      * Construct MidiProcessor with required dependencies.
@@ -41,7 +109,7 @@ public:
                  juce::AudioProcessorValueTreeState& parameters,
                  ParameterManager& parameterManager);
     
-    ~MidiProcessor() override = default;
+    ~MidiProcessor() override;
     
     // MidiProcessorInterface implementation
     void processMidiMessages(juce::MidiBuffer& midiMessages) override;
@@ -51,6 +119,40 @@ public:
     void handlePitchBend(int pitchBendValue) override;
     void setupCCMapping() override;
     
+    /**
+     * Handles a CC on a MIDI channel, including NRPN/RPN and 14-bit pairs.
+     * handleMidiCC(ccNumber, value) is this on channel 0.
+     * @param midiChannel MIDI channel (0-15)
+     * @param ccNumber Controller number (0-127)
+     * @param value Controller value (0-127)
+     */
+    void handleMidiCC(int midiChannel, int ccNumber, int value);
+    
+    /**
+     * Switches to a program of the bank last selected on the MIDI channel.
+     * @param midiChannel MIDI channel (0-15)
+     * @param program Program number (0-127)
+     */
+    void handleProgramChange(int midiChannel, int program);
+    
+    /**
+     * Routes Bank Select and Program Change to a selector; nullptr ignores them.
+     * The selector must outlive this processor or be reset first.
+     */
+    void setProgramSelector(MidiProgramSelector* selector) { programSelector = selector; }
+    
+    /** Routes notes to multitimbral parts while the manager's mode is on; nullptr for single mode only */
+    void setPartManager(PartManager* manager) { partManager = manager; }
+    
+    /** Routes MPE zone channels to the manager while it has zones; nullptr for no MPE */
+    void setMpeManager(MpeManager* manager) { mpeManager = manager; }
+    
+    /** Hands YMulator SysEx dumps to a receiver; nullptr ignores SysEx */
+    void setSysExReceiver(SysExReceiver* receiver) { sysExReceiver = receiver; }
+    
+    /** Hands played notes to an arpeggiator while it is active; nullptr plays them directly */
+    void setArpeggiator(Arpeggiator* arp) { arpeggiator = arp; }
+    
     /**
      * Set channel random pan for global pan randomization feature.
      * @param channel Channel number (0-7)
@@ -63,15 +165,247 @@ public:
      */
     void applyGlobalPan(int channel);
     
+    /**
+     * Notifies the host and parameter listeners of the values CCs have set
+     * since the last call. Several CCs for the same parameter are sent as one
+     * notification with the current value. Message thread only.
+     * @return Number of parameters notified
+     */
+    int dispatchPendingParameterSync();
+    
+    /** Capacity of the CC-to-host sync queue; if it fills up, every CC-bound parameter is resent */
+    static constexpr int ParameterSyncQueueSize = 1024;
+    
+    /** @return Controller events the last processMidiMessages() call dropped as superseded */
+    int getNumCoalescedEvents() const { return numCoalescedEvents; }
+    
+    // MIDI learn (message thread)
+    
+    /**
+     * Maps the next assignable CC that arrives to a parameter.
+     * @param parameterId Parameter to learn; an empty ID disarms
+     * @return false if there is no such parameter
+     */
+    bool armMidiLearn(const juce::String& parameterId);
+    bool isMidiLearnArmed() const { return learnArmed.load(); }
+    const juce::String& getArmedParameter() const { return learnParameterId; }
+    
+    /**
+     * Maps the CC the audio thread captured for the armed parameter. Learning
+     * replaces any CC learned for the parameter before.
+     * @return true if a mapping was learned
+     */
+    bool applyLearnedController();
+    
+    /** Called by applyLearnedController() with the new mapping */
+    std::function<void(int ccNumber, const juce::String& parameterId)> onMidiLearned;
+    
+    /** Called when a mapping is learned or set, so the plugin state can be marked changed */
+    std::function<void()> onMidiMappingsChanged;
+    
+    /**
+     * Maps a CC to a parameter on top of the VOPMex layout.
+     * @param parameterId Parameter to control; an empty ID leaves the CC unmapped
+     * @return false if the CC cannot be assigned or there is no such parameter
+     */
+    bool setMidiMapping(int ccNumber, const juce::String& parameterId);
+    
+    /**
+     * Learned mappings, CC number to parameter ID ("" = unmapped). Copied from
+     * the published CCMap, so any thread may call it, e.g. a host saving state.
+     */
+    std::map<int, juce::String> getMidiMappings() const;
+    
+    /** Replaces all learned mappings, e.g. from saved plugin state */
+    void setMidiMappings(const std::map<int, juce::String>& mappings);
+    
+    /** Drops the learned mappings, leaving the VOPMex layout */
+    void clearMidiMappings() { setMidiMappings({}); }
+    
+    /** @return ID of the parameter a CC controls, or empty */
+    juce::String getMappedParameter(int ccNumber) const;
+    
+    /** @return false for Bank Select, NRPN/RPN, data entry and channel mode CCs */
+    static bool isAssignableController(int ccNumber);
+    
 private:
+    /** What a CC writes to the chip once its parameter value is stored */
+    enum class CCTarget : uint8_t {
+        None,
+        OperatorParameter,   // one operator field on all channels
+        OperatorAmsEnable,
+        Algorithm,
+        Feedback,
+        Lfo,                 // LFO rate, AMD, PMD or waveform
+        Noise,               // noise enable or frequency
+        ParameterOnly        // stored only; the periodic update or the listeners apply it
+    };
+    
+    /** One entry of the CC dispatch table, resolved on the message thread */
+    struct CCBinding {
+        CCTarget target = CCTarget::None;
+        juce::RangedAudioParameter* parameter = nullptr;
+        uint8_t operatorIndex = 0;    // 0-based, OperatorParameter/OperatorAmsEnable only
+        YmfmWrapperInterface::OperatorParameter operatorParameter = YmfmWrapperInterface::OperatorParameter::TotalLevel;
+        float scale = 0.0f;           // normalized value to register field
+        bool continuous = false;      // float parameter: 14-bit values span its whole range
+    };
+    
+    /** Immutable once published; the audio thread reads it through ccMap */
+    struct CCMap {
+        std::array<CCBinding, 128> bindings;
+        std::array<bool, 32> highResolutionPairs {};    // CCs 0-31 that take CC+32 as their LSB
+        std::map<int, juce::String> mappings;           // the learned mappings it was built from
+    };
+    
+    /** Counts the caller as a reader of the published CCMap while it is in scope */
+    struct ScopedCCMapReader {
+        explicit ScopedCCMapReader(std::atomic<int>& count) : readers(count) { ++readers; }
+        ~ScopedCCMapReader() { --readers; }
+        std::atomic<int>& readers;
+    };
+    
+    /** NRPN/RPN and 14-bit CC parser state of one MIDI channel */
+    struct ChannelControllerState {
+        uint8_t nrpnMsb = 127, nrpnLsb = 127;       // 127/127 = none selected
+        uint8_t rpnMsb = 127, rpnLsb = 127;
+        bool rpnSelected = false;                   // the last parameter number CC was an RPN one
+        uint8_t dataEntryMsb = 0;
+        std::array<uint8_t, 32> highResolutionMsb {};
+        int bank = 0;                               // Bank Select MSB * 128 + LSB
+        bool bankLsbExpected = false;               // the last CC was Bank Select MSB
+    };
+    
+    static CCBinding makeBinding(juce::RangedAudioParameter* parameter, CCTarget target, float scale = 0.0f,
+                                 uint8_t operatorIndex = 0,
+                                 YmfmWrapperInterface::OperatorParameter operatorParameter = YmfmWrapperInterface::OperatorParameter::TotalLevel);
+    void bindCC(int ccNumber, const CCBinding& binding);
+    void bindNRPN(int group, int index, const CCBinding& binding);
+    
+    /** Binding for a learned parameter: its NRPN binding, or the parameter alone */
+    CCBinding findLearnBinding(const juce::String& parameterId) const;
+    
+    /** Builds a CCMap from the VOPMex layout and the learned mappings and swaps it in */
+    void publishCCMap();
+    
+    /** Frees the replaced maps no reader can still be using; message thread only */
+    void reclaimRetiredCCMaps();
+    
+    /** Stores a normalized value, writes the registers and queues the host sync */
+    void setParameterFromMidi(const CCBinding& binding, float normalizedValue);
+    void applyCCBinding(const CCBinding& binding);
+    
+    /** @return The binding the channel's selected NRPN or RPN addresses, or nullptr */
+    const CCBinding* getSelectedParameter(const ChannelControllerState& state) const;
+    bool isParameterSelected(const ChannelControllerState& state) const;
+    void applyDataEntry(int midiChannel, const ChannelControllerState& state, int data);
+    
+    /** RPN 6, and RPN 0 on an MPE zone channel; @return false if the RPN is not an MPE one */
+    bool applyMpeDataEntry(int midiChannel, const ChannelControllerState& state, int data);
+    void stepDataEntry(const ChannelControllerState& state, int delta);
+    
+    /** Parameter number, data entry and bank select CCs depend on order and are never coalesced */
+    bool isStatefulController(int midiChannel, int ccNumber) const;
+    void queueParameterSync(juce::RangedAudioParameter* parameter);
+    
+    // juce::Timer
+    void timerCallback() override;
+    
+    // Per-block controller coalescing. Every (kind, MIDI channel, number)
+    // has a fixed slot holding the latest value not yet applied.
+    static constexpr int NumMidiChannels = 16;
+    static constexpr int ControllerSlotBase = 0;                                    // + channel * 128 + CC
+    static constexpr int PolyPressureSlotBase = ControllerSlotBase + NumMidiChannels * 128;   // + channel * 128 + note
+    static constexpr int PitchBendSlotBase = PolyPressureSlotBase + NumMidiChannels * 128;    // + channel
+    static constexpr int ChannelPressureSlotBase = PitchBendSlotBase + NumMidiChannels;       // + channel
+    static constexpr int NumControllerSlots = ChannelPressureSlotBase + NumMidiChannels;
+    
+    /** @return true if the arpeggiator took the note on or off; anything else is played as usual */
+    bool takenByArpeggiator(const juce::MidiMessage& message, int samplePosition);
+    
+    /** @return true if multitimbral parts play the notes */
+    bool isMultitimbral() const;
+    
+    /** Note on/off for every part on the message's MIDI channel whose zone holds the note */
+    void processPartNoteOn(const juce::MidiMessage& message);
+    void processPartNoteOff(const juce::MidiMessage& message);
+    
+    /**
+     * Narrows a part's pool for a new note: channels that already hold the
+     * part's image first, then free channels, and only when the pool is
+     * full a channel of another zone
+     */
+    uint8_t selectPartChannels(int part, uint8_t note) const;
+    
+    /** @return true if MPE zones are set and multitimbral mode is off */
+    bool isMpe() const;
+    
+    /** @return true if the MIDI channel's notes and controllers go to the MPE manager */
+    bool isMpeChannel(int midiChannel) const;
+    
+    /** Note on/off on an MPE zone channel, one voice per note */
+    void processMpeNoteOn(const juce::MidiMessage& message);
+    void processMpeNoteOff(const juce::MidiMessage& message);
+    
+    /** Global pan, or a new random pan, for a voice about to start */
+    void applyNotePan(int channel);
+    
+    /** @return false if the message is not a coalescable controller event */
+    bool holdControllerEvent(const juce::MidiMessage& message);
+    
+    /** Applies the held controller values in the order they first arrived */
+    void flushControllerEvents();
+    
     // Dependencies (interfaces for testability)
     VoiceManagerInterface& voiceManager;
     YmfmWrapperInterface& ymfmWrapper;
     juce::AudioProcessorValueTreeState& parameters;
     ParameterManager& parameterManager;
+    MidiProgramSelector* programSelector = nullptr;
+    PartManager* partManager = nullptr;
+    MpeManager* mpeManager = nullptr;
+    SysExReceiver* sysExReceiver = nullptr;
+    Arpeggiator* arpeggiator = nullptr;
+    
+    // MIDI CC dispatch table, indexed by CC number. The audio thread reads the
+    // published map; the rest is message thread only.
+    std::atomic<const CCMap*> ccMap { nullptr };
+    std::unique_ptr<CCMap> currentCCMap;                   // owns *ccMap
+    std::vector<std::unique_ptr<CCMap>> retiredCCMaps;
+    mutable std::atomic<int> ccMapReaders { 0 };           // audio thread and getMidiMappings() while they read it
+    std::array<CCBinding, 128> defaultCCBindings;          // VOPMex layout
+    std::map<int, juce::String> learnedMappings;
+    
+    // MIDI learn: armed on the message thread, captured on the audio thread
+    juce::String learnParameterId;
+    std::atomic<bool> learnArmed { false };
+    std::atomic<int> learnedController { -1 };
+    
+    // NRPN dispatch table, indexed by group * MaxParametersPerGroup + parameter
+    std::array<CCBinding, ParamID::NRPN::NumGroups * ParamID::NRPN::MaxParametersPerGroup> nrpnBindings;
+    
+    std::array<ChannelControllerState, NumMidiChannels> controllerStates;
+    
+    // Parameters the LFO and noise writes read together
+    juce::RangedAudioParameter* lfoRateParam = nullptr;
+    juce::RangedAudioParameter* lfoAmdParam = nullptr;
+    juce::RangedAudioParameter* lfoPmdParam = nullptr;
+    juce::AudioParameterChoice* lfoWaveformParam = nullptr;
+    juce::RangedAudioParameter* noiseEnableParam = nullptr;
+    juce::RangedAudioParameter* noiseFrequencyParam = nullptr;
+    juce::RangedAudioParameter* pitchBendRangeParam = nullptr;
+    
+    // Parameters set by CCs that the host has not heard about yet
+    // (audio thread writes, message thread reads)
+    juce::AbstractFifo parameterSyncFifo { ParameterSyncQueueSize };
+    std::array<juce::RangedAudioParameter*, ParameterSyncQueueSize> parameterSyncQueue {};
+    std::atomic<bool> parameterSyncOverflowed { false };
     
-    // MIDI CC to parameter mapping (VOPMex compatibility)
-    std::unordered_map<int, juce::RangedAudioParameter*> ccToParameterMap;
+    // Held controller values (-1 = none) and the slots holding one, in arrival order
+    std::array<int, NumControllerSlots> heldControllerValues;
+    std::array<uint16_t, NumControllerSlots> heldControllerSlots {};
+    int numHeldControllers = 0;
+    int numCoalescedEvents = 0;
     
     // Current pitch bend value (0-16383, center=8192)
     std::atomic<int> currentPitchBend{8192};
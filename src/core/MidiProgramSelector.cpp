@@ -0,0 +1,149 @@
+#include "MidiProgramSelector.h"
+#include "StateManager.h"
+#include "../utils/PresetManager.h"
+#include "../utils/Debug.h"
+
+namespace ymulatorsynth {
+
+MidiProgramSelector::MidiProgramSelector(PresetManagerInterface& presetManager, StateManager& stateManager)
+    : juce::Thread("MIDI bank staging")
+    , presetManager(presetManager)
+    , stateManager(stateManager)
+{
+    // Bank 0 is ready before the first program change arrives
+    stageBank(0);
+    startThread(juce::Thread::Priority::low);
+}
+
+MidiProgramSelector::~MidiProgramSelector()
+{
+    stopThread(2000);
+}
+
+// ============================================================================
+// Audio Thread
+// ============================================================================
+
+void MidiProgramSelector::requestBank(int bank)
+{
+    // Picked up by the staging thread's next poll
+    requestedBank.store(bank);
+}
+
+bool MidiProgramSelector::selectProgram(int bank, int program)
+{
+    const ScopedBankReader reader(stagedBankReaders);
+    const auto* staged = stagedBank.load();
+    if (staged == nullptr || staged->bank != bank) {
+        // Applied from applyPendingProgram() once the staging thread has the bank
+        pendingProgram.store(bank * NumPrograms + program);
+        requestBank(bank);
+        return false;
+    }
+
+    pendingProgram.store(-1);
+    if (program < 0 || program >= staged->numPrograms) {
+        return false;
+    }
+
+    stateManager.applyStagedProgram(staged->presetIndices[static_cast<size_t>(program)],
+                                    staged->images[static_cast<size_t>(program)]);
+    return true;
+}
+
+void MidiProgramSelector::applyPendingProgram()
+{
+    const int pending = pendingProgram.load();
+    if (pending < 0) {
+        return;
+    }
+
+    const ScopedBankReader reader(stagedBankReaders);
+    const auto* staged = stagedBank.load();
+    if (staged != nullptr && staged->bank == pending / NumPrograms) {
+        selectProgram(pending / NumPrograms, pending % NumPrograms);
+    }
+}
+
+// ============================================================================
+// Staging
+// ============================================================================
+
+void MidiProgramSelector::stageBank(int bank)
+{
+    const auto library = presetManager.getSnapshot();
+    if (library == nullptr) {
+        return;
+    }
+
+    const juce::ScopedLock sl(stagingLock);
+    reclaimRetiredBanks();
+
+    if (currentBank != nullptr && currentBank->bank == bank && currentBank->generation == library->generation) {
+        return;
+    }
+
+    auto staged = std::make_unique<StagedBank>();
+    staged->bank = bank;
+    staged->generation = library->generation;
+    for (int program = 0; program < NumPrograms; ++program) {
+        const int index = library->getGlobalPresetIndex(bank, program);
+        const auto* image = library->getRegisterImage(index);
+        if (image == nullptr) {
+            break;
+        }
+        staged->presetIndices[static_cast<size_t>(program)] = index;
+        staged->images[static_cast<size_t>(program)] = *image;
+        staged->numPrograms = program + 1;
+    }
+
+    stagedBank.store(staged.get());
+    if (currentBank != nullptr) {
+        retiredBanks.push_back(std::move(currentBank));
+    }
+    currentBank = std::move(staged);
+    reclaimRetiredBanks();
+
+    CS_DBG("Staged bank " + juce::String(bank) + " for MIDI program change ("
+           + juce::String(currentBank->numPrograms) + " programs)");
+}
+
+bool MidiProgramSelector::isBankStaged(int bank) const
+{
+    const auto library = presetManager.getSnapshot();
+    const ScopedBankReader reader(stagedBankReaders);
+    const auto* staged = stagedBank.load();
+    return library != nullptr && staged != nullptr && staged->bank == bank && staged->generation == library->generation;
+}
+
+bool MidiProgramSelector::waitUntilStaged(int timeoutMs) const
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMs);
+    while (!isBankStaged(requestedBank.load())) {
+        if (juce::Time::getMillisecondCounter() >= deadline) {
+            return false;
+        }
+        juce::Thread::sleep(1);
+    }
+    return true;
+}
+
+void MidiProgramSelector::reclaimRetiredBanks()
+{
+    // The audio thread counts itself before it loads the staged bank and stops after it is
+    // done, so once the count is seen at zero nothing can still be using a bank retired earlier
+    if (!retiredBanks.empty() && stagedBankReaders.load() == 0) {
+        retiredBanks.clear();
+    }
+}
+
+void MidiProgramSelector::run()
+{
+    // Polls for requested banks and library changes; staging an already staged bank is a no-op
+    while (!threadShouldExit()) {
+        stageBank(requestedBank.load());
+        wait(PollIntervalMs);
+    }
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "PresetManagerInterface.h"
+#include "../dsp/RegisterImage.h"
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace ymulatorsynth {
+
+// Forward declaration
+class StateManager;
+
+/**
+ * Selects presets from MIDI Bank Select and Program Change on the audio thread.
+ *
+ * Before a program in a bank can be played, the bank is staged: a background
+ * thread copies the register images and global preset indices of its first
+ * 128 presets into a fixed-size StagedBank and publishes it through an atomic
+ * pointer. A Program Change is then only a table lookup and a register image
+ * copy to the chip (see StateManager::applyStagedProgram); the JUCE
+ * parameters follow on the message thread. The audio thread never allocates,
+ * locks or signals: a requested bank is only stored, and the staging thread
+ * polls for it every PollIntervalMs.
+ *
+ * A program change that arrives while its bank is still being staged is kept
+ * and applied from applyPendingProgram() once the bank is ready. The staged
+ * bank is rebuilt when the preset library changes. The audio thread counts
+ * itself as a reader while it uses a staged bank; a replaced bank is freed
+ * once that count has been seen at zero after the replacement, the same way
+ * library snapshots are reclaimed.
+ */
+class MidiProgramSelector : private juce::Thread
+{
+public:
+    /** Programs per bank that Program Change can reach */
+    static constexpr int NumPrograms = 128;
+
+    MidiProgramSelector(PresetManagerInterface& presetManager, StateManager& stateManager);
+    ~MidiProgramSelector() override;
+
+    // Audio thread
+
+    /**
+     * Starts staging a bank ahead of the program change that will use it.
+     * @param bank Bank Select number (MSB * 128 + LSB), an index into the library's bank list
+     */
+    void requestBank(int bank);
+
+    /**
+     * Applies a program of a bank, or keeps it until the bank is staged.
+     * @return true if the preset is now on the chip
+     */
+    bool selectProgram(int bank, int program);
+
+    /** Applies a program change that was waiting for its bank; called once per block */
+    void applyPendingProgram();
+
+    // Any thread
+
+    /** Stages a bank on the calling thread unless it is already staged */
+    void stageBank(int bank);
+
+    /** @return true if the bank is staged from the current library */
+    bool isBankStaged(int bank) const;
+
+    /** Blocks until the last requested bank is staged; for tests and tools */
+    bool waitUntilStaged(int timeoutMs) const;
+
+private:
+    /** The part of a bank a program change needs, copied out of a library snapshot */
+    struct StagedBank {
+        int bank = -1;
+        uint32_t generation = 0;      // library generation it was staged from
+        int numPrograms = 0;
+        std::array<int, NumPrograms> presetIndices {};
+        std::array<RegisterImage, NumPrograms> images {};
+    };
+
+    static constexpr int PollIntervalMs = 10;
+
+    /** Counts the caller as a reader of the staged bank while it is in scope */
+    struct ScopedBankReader {
+        explicit ScopedBankReader(std::atomic<int>& count) : readers(count) { ++readers; }
+        ~ScopedBankReader() { --readers; }
+        std::atomic<int>& readers;
+    };
+
+    // juce::Thread
+    void run() override;
+
+    /** Frees the replaced banks no reader can still be using; staging lock held */
+    void reclaimRetiredBanks();
+
+    PresetManagerInterface& presetManager;
+    StateManager& stateManager;
+
+    std::atomic<int> requestedBank { 0 };
+    std::atomic<int> pendingProgram { -1 };   // bank * NumPrograms + program, audio thread only
+    std::atomic<StagedBank*> stagedBank { nullptr };
+    mutable std::atomic<int> stagedBankReaders { 0 };  // audio thread and isBankStaged() while they read it
+
+    // Staging can run on the staging thread and on callers of stageBank()
+    juce::CriticalSection stagingLock;
+    std::unique_ptr<StagedBank> currentBank;  // owns *stagedBank
+    std::vector<std::unique_ptr<StagedBank>> retiredBanks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiProgramSelector)
+};
+
+} // namespace ymulatorsynth
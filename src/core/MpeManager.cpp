@@ -0,0 +1,305 @@
+#include "MpeManager.h"
+#include "../dsp/YM2151Registers.h"
+#include "../utils/Debug.h"
+
+namespace ymulatorsynth {
+
+MpeManager::MpeManager(YmfmWrapperInterface& ymfmWrapper)
+    : ymfmWrapper(ymfmWrapper)
+{
+    resetBendRanges(LowerZone);
+    resetBendRanges(UpperZone);
+}
+
+// ============================================================================
+// Zones
+// ============================================================================
+
+void MpeManager::setZones(int lowerMemberChannels, int upperMemberChannels)
+{
+    const int lower = juce::jlimit(0, MaxMemberChannels, lowerMemberChannels);
+    int upper = juce::jlimit(0, MaxMemberChannels, upperMemberChannels);
+    if (lower > 0 && upper > 0 && lower + upper > NumMidiChannels - 2) {
+        upper = juce::jmax(0, NumMidiChannels - 2 - lower);
+    }
+
+    resetBendRanges(LowerZone);
+    resetBendRanges(UpperZone);
+    zones.store(packZones(lower, upper));
+    CS_DBG("MPE zones - lower: " + juce::String(lower) + " members, upper: " + juce::String(upper) + " members");
+}
+
+int MpeManager::getLowerZoneMemberChannels() const
+{
+    return zones.load() & 0xff;
+}
+
+int MpeManager::getUpperZoneMemberChannels() const
+{
+    return zones.load() >> 8;
+}
+
+bool MpeManager::isEnabled() const
+{
+    return zones.load() != 0;
+}
+
+bool MpeManager::isZoneChannel(int midiChannel) const
+{
+    return getZone(midiChannel) != NoZone;
+}
+
+int MpeManager::getZone(int midiChannel) const
+{
+    const int layout = zones.load();
+    const int lower = layout & 0xff;
+    const int upper = layout >> 8;
+    if (lower > 0 && midiChannel >= 0 && midiChannel <= lower) {
+        return LowerZone;
+    }
+    if (upper > 0 && midiChannel < NumMidiChannels && midiChannel >= NumMidiChannels - 1 - upper) {
+        return UpperZone;
+    }
+    return NoZone;
+}
+
+void MpeManager::handleConfigurationMessage(int midiChannel, int memberChannels)
+{
+    if (midiChannel != getMasterChannel(LowerZone) && midiChannel != getMasterChannel(UpperZone)) {
+        return;
+    }
+
+    const int members = juce::jlimit(0, MaxMemberChannels, memberChannels);
+    int lower = getLowerZoneMemberChannels();
+    int upper = getUpperZoneMemberChannels();
+    const int zone = midiChannel == getMasterChannel(LowerZone) ? LowerZone : UpperZone;
+
+    // The zone being configured keeps its channels; the other one gives way
+    if (zone == LowerZone) {
+        lower = members;
+        if (lower > 0 && upper > 0 && lower + upper > NumMidiChannels - 2) {
+            upper = juce::jmax(0, NumMidiChannels - 2 - lower);
+        }
+    } else {
+        upper = members;
+        if (lower > 0 && upper > 0 && lower + upper > NumMidiChannels - 2) {
+            lower = juce::jmax(0, NumMidiChannels - 2 - upper);
+        }
+    }
+
+    resetBendRanges(zone);
+    zones.store(packZones(lower, upper));
+    CS_DBG("MPE Configuration Message on channel " + juce::String(midiChannel + 1)
+           + " - lower: " + juce::String(lower) + ", upper: " + juce::String(upper));
+}
+
+void MpeManager::resetBendRanges(int zone)
+{
+    memberBendRanges[static_cast<size_t>(zone)].store(DefaultMemberBendRange);
+    masterBendRanges[static_cast<size_t>(zone)].store(DefaultMasterBendRange);
+}
+
+void MpeManager::setBendRange(int midiChannel, int semitones)
+{
+    const int zone = getZone(midiChannel);
+    if (zone == NoZone) {
+        return;
+    }
+
+    const int range = juce::jlimit(0, static_cast<int>(YM2151Regs::MAX_PITCH_BEND_SEMITONES), semitones);
+    auto& ranges = midiChannel == getMasterChannel(zone) ? masterBendRanges : memberBendRanges;
+    ranges[static_cast<size_t>(zone)].store(range);
+
+    // Notes already bent follow the new range
+    for (int voice = 0; voice < NumVoices; ++voice) {
+        const int voiceChannel = voices[static_cast<size_t>(voice)].midiChannel;
+        if (voiceChannel >= 0 && getZone(voiceChannel) == zone) {
+            ymfmWrapper.setPitchBend(static_cast<uint8_t>(voice), getBendSemitones(voiceChannel));
+        }
+    }
+}
+
+// ============================================================================
+// Expression
+// ============================================================================
+
+float MpeManager::getBendSemitones(int midiChannel) const
+{
+    const int zone = getZone(midiChannel);
+    if (zone == NoZone) {
+        return 0.0f;
+    }
+
+    const int master = getMasterChannel(zone);
+    const auto toSemitones = [this](int channel, int range) {
+        return (channels[static_cast<size_t>(channel)].pitchBend - 8192) / 8192.0f * static_cast<float>(range);
+    };
+
+    float semitones = toSemitones(master, masterBendRanges[static_cast<size_t>(zone)].load());
+    if (midiChannel != master) {
+        semitones += toSemitones(midiChannel, memberBendRanges[static_cast<size_t>(zone)].load());
+    }
+    return juce::jlimit(-YM2151Regs::MAX_PITCH_BEND_SEMITONES, YM2151Regs::MAX_PITCH_BEND_SEMITONES, semitones);
+}
+
+void MpeManager::setPitchBend(int midiChannel, int value)
+{
+    const int zone = getZone(midiChannel);
+    if (zone == NoZone) {
+        return;
+    }
+    channels[static_cast<size_t>(midiChannel)].pitchBend = juce::jlimit(0, 16383, value);
+
+    // A master channel bend moves every note of the zone
+    const bool isMaster = midiChannel == getMasterChannel(zone);
+    for (int voice = 0; voice < NumVoices; ++voice) {
+        const int voiceChannel = voices[static_cast<size_t>(voice)].midiChannel;
+        if (voiceChannel == midiChannel || (isMaster && voiceChannel >= 0 && getZone(voiceChannel) == zone)) {
+            ymfmWrapper.setPitchBend(static_cast<uint8_t>(voice), getBendSemitones(voiceChannel));
+        }
+    }
+}
+
+void MpeManager::setChannelPressure(int midiChannel, int value)
+{
+    if (midiChannel < 0 || midiChannel >= NumMidiChannels) {
+        return;
+    }
+
+    const int pressure = juce::jlimit(0, 127, value);
+    channels[static_cast<size_t>(midiChannel)].pressure = pressure;
+    for (auto& voice : voices) {
+        if (voice.midiChannel == midiChannel) {
+            voice.pressure = pressure;
+        }
+    }
+}
+
+void MpeManager::setPolyPressure(int midiChannel, int note, int value)
+{
+    const int voice = findVoice(midiChannel, static_cast<uint8_t>(note));
+    if (voice >= 0) {
+        voices[static_cast<size_t>(voice)].pressure = juce::jlimit(0, 127, value);
+    }
+}
+
+void MpeManager::setTimbre(int midiChannel, int value)
+{
+    if (midiChannel >= 0 && midiChannel < NumMidiChannels) {
+        channels[static_cast<size_t>(midiChannel)].timbre = juce::jlimit(0, 127, value);
+    }
+}
+
+// ============================================================================
+// Notes
+// ============================================================================
+
+void MpeManager::noteOn(int voice, int midiChannel, uint8_t note, uint8_t velocity)
+{
+    if (voice < 0 || voice >= NumVoices || midiChannel < 0 || midiChannel >= NumMidiChannels) {
+        return;
+    }
+
+    auto& state = voices[static_cast<size_t>(voice)];
+    const auto channel = static_cast<uint8_t>(voice);
+
+    // A note this one steals may have moved the TLs away from the preset's
+    if (state.levelsChanged) {
+        for (uint8_t op = 0; op < 4; ++op) {
+            ymfmWrapper.writeRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, op, channel),
+                                      state.startLevels[op]);
+        }
+    }
+
+    state.midiChannel = midiChannel;
+    state.note = note;
+    state.pressure = channels[static_cast<size_t>(midiChannel)].pressure;
+
+    ymfmWrapper.setPitchBend(channel, getBendSemitones(midiChannel));
+    ymfmWrapper.noteOn(channel, note, velocity);
+
+    // Expression is relative to the levels the preset and velocity gave the note
+    state.algorithm = static_cast<uint8_t>(ymfmWrapper.readCurrentRegister(YM2151Regs::REG_ALGORITHM_FEEDBACK_BASE + channel)
+                                           & YM2151Regs::MASK_ALGORITHM);
+    for (uint8_t op = 0; op < 4; ++op) {
+        state.startLevels[op] = static_cast<uint8_t>(ymfmWrapper.readCurrentRegister(
+            YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, op, channel)) & 0x7f);
+    }
+    writeLevels(voice);
+}
+
+void MpeManager::noteOff(int voice)
+{
+    if (voice < 0 || voice >= NumVoices) {
+        return;
+    }
+
+    // The release keeps the expression the note had
+    auto& state = voices[static_cast<size_t>(voice)];
+    if (state.midiChannel >= 0) {
+        ymfmWrapper.noteOff(static_cast<uint8_t>(voice), state.note);
+        state.midiChannel = -1;
+    }
+}
+
+int MpeManager::findVoice(int midiChannel, uint8_t note) const
+{
+    for (int voice = 0; voice < NumVoices; ++voice) {
+        const auto& state = voices[static_cast<size_t>(voice)];
+        if (state.midiChannel == midiChannel && state.note == note) {
+            return voice;
+        }
+    }
+    return -1;
+}
+
+int MpeManager::applyExpression()
+{
+    // Leaving MPE, notes go back to the global bend
+    if (!isEnabled()) {
+        if (wasEnabled) {
+            for (int voice = 0; voice < NumVoices; ++voice) {
+                ymfmWrapper.setPitchBend(static_cast<uint8_t>(voice), 0.0f);
+            }
+            voices.fill({});
+        }
+        wasEnabled = false;
+        return 0;
+    }
+    wasEnabled = true;
+
+    int numWritten = 0;
+    for (int voice = 0; voice < NumVoices; ++voice) {
+        if (voices[static_cast<size_t>(voice)].midiChannel >= 0 && writeLevels(voice)) {
+            ++numWritten;
+        }
+    }
+    return numWritten;
+}
+
+bool MpeManager::writeLevels(int voice)
+{
+    auto& state = voices[static_cast<size_t>(voice)];
+
+    // Pressure opens the carriers (louder), timbre the modulators (brighter)
+    const int pressureOffset = state.pressure * PressureDepth / 127;
+    const int timbreOffset = (channels[static_cast<size_t>(state.midiChannel)].timbre - 64) * TimbreDepth / 64;
+
+    // The wrapper's register cache holds the level last applied to each operator,
+    // whether by this or by a parameter update, so unchanged TLs are not rewritten
+    const auto channel = static_cast<uint8_t>(voice);
+    bool written = false;
+    for (uint8_t op = 0; op < 4; ++op) {
+        const int offset = YM2151Regs::isCarrier(state.algorithm, op) ? pressureOffset : timbreOffset;
+        const int address = YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, op, channel);
+        const auto level = static_cast<uint8_t>(juce::jlimit(0, 127, state.startLevels[op] - offset));
+        if (ymfmWrapper.readCurrentRegister(address) != level) {
+            ymfmWrapper.writeRegister(address, level);
+            written = true;
+        }
+    }
+    state.levelsChanged = state.levelsChanged || written;
+    return written;
+}
+
+} // namespace ymulatorsynth
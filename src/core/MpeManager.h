@@ -0,0 +1,142 @@
+#pragma once
+
+#include "../dsp/YmfmWrapperInterface.h"
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace ymulatorsynth {
+
+/**
+ * MpeManager - MIDI Polyphonic Expression zones and per-voice expression
+ *
+ * Every voice already plays on a YM2151 channel of its own, so MPE only has
+ * to take the controllers of a note's MIDI channel to that voice's registers:
+ * - pitch bend (the member channel's plus the zone master's) to KC/KF
+ * - pressure (channel pressure, or poly aftertouch for the note) to the carrier TLs
+ * - timbre (CC 74) to the modulator TLs
+ *
+ * The lower zone has its master on MIDI channel 1 and members upwards from
+ * channel 2; the upper zone has its master on channel 16 and members
+ * downwards from channel 15. Zones are set with setZones() or by the MPE
+ * Configuration Message (RPN 6 on a master channel), which also resets the
+ * zone's bend ranges to 48 semitones for members and 2 for the master. RPN 0
+ * changes them afterwards.
+ *
+ * MIDI channel and voice state live in fixed arrays that only the audio
+ * thread touches; the zone layout and bend ranges are atomics so the message
+ * thread can set them too. Pitch is written straight away through
+ * setPitchBend(), which finds KC/KF by table lookup. TL offsets are written by
+ * applyExpression() once per block after the parameter update, which would
+ * otherwise overwrite them, relative to the TLs each note started with.
+ */
+class MpeManager
+{
+public:
+    static constexpr int NumMidiChannels = 16;
+    static constexpr int NumVoices = 8;
+    static constexpr int MaxMemberChannels = 15;
+    static constexpr int DefaultMemberBendRange = 48;
+    static constexpr int DefaultMasterBendRange = 2;
+    static constexpr int PressureDepth = 24;   // carrier TL steps (0.75 dB) taken off at full pressure
+    static constexpr int TimbreDepth = 24;     // modulator TL steps either side of timbre 64
+
+    explicit MpeManager(YmfmWrapperInterface& ymfmWrapper);
+
+    // Any thread
+
+    /**
+     * Sets both zones and resets their bend ranges; 0 member channels turns a
+     * zone off. If the zones would overlap, the upper zone shrinks.
+     */
+    void setZones(int lowerMemberChannels, int upperMemberChannels);
+
+    int getLowerZoneMemberChannels() const;
+    int getUpperZoneMemberChannels() const;
+
+    /** @return true if either zone has member channels */
+    bool isEnabled() const;
+
+    // Audio thread
+
+    /** @return true if the MIDI channel (0-15) is the master or a member channel of a zone */
+    bool isZoneChannel(int midiChannel) const;
+
+    /**
+     * MPE Configuration Message, honoured on the master channels (0 and 15).
+     * The zone it configures wins; the other zone shrinks if they would overlap.
+     */
+    void handleConfigurationMessage(int midiChannel, int memberChannels);
+
+    /** RPN 0 on a zone channel: the master range on a master channel, the zone's member range on a member */
+    void setBendRange(int midiChannel, int semitones);
+
+    /** @param value 14-bit pitch bend, centre 8192; on a master channel it bends the whole zone */
+    void setPitchBend(int midiChannel, int value);
+    void setChannelPressure(int midiChannel, int value);
+    void setPolyPressure(int midiChannel, int note, int value);
+    void setTimbre(int midiChannel, int value);
+
+    /** Plays a note on a voice with the pitch and expression of its MIDI channel */
+    void noteOn(int voice, int midiChannel, uint8_t note, uint8_t velocity);
+
+    /** Stops the note on a voice */
+    void noteOff(int voice);
+
+    /** @return The voice playing a note on a MIDI channel, or -1 */
+    int findVoice(int midiChannel, uint8_t note) const;
+
+    /**
+     * Writes the pressure and timbre TL offsets of every sounding voice, only
+     * where the chip does not hold them already.
+     * Called once per block, after the parameter update.
+     * @return Number of voices with a TL written
+     */
+    int applyExpression();
+
+private:
+    enum Zone { LowerZone = 0, UpperZone = 1, NoZone = -1 };
+
+    struct ChannelState {
+        int pitchBend = 8192;
+        int pressure = 0;
+        int timbre = 64;
+    };
+
+    struct VoiceState {
+        int midiChannel = -1;          // -1 = not an MPE note
+        uint8_t note = 0;
+        int pressure = 0;
+        uint8_t algorithm = 0;
+        std::array<uint8_t, 4> startLevels {};   // TLs the preset and velocity gave the note
+        bool levelsChanged = false;               // the chip holds offset TLs, not startLevels
+    };
+
+    /** Zone layout packed as lower | upper << 8, so both halves change together */
+    static int packZones(int lower, int upper) { return lower | (upper << 8); }
+    int getZone(int midiChannel) const;
+    static int getMasterChannel(int zone) { return zone == LowerZone ? 0 : NumMidiChannels - 1; }
+
+    void resetBendRanges(int zone);
+
+    /** @return The bend of a note on the MIDI channel, member and master together, in semitones */
+    float getBendSemitones(int midiChannel) const;
+    /** @return true if any of the voice's TLs had to be written */
+    bool writeLevels(int voice);
+
+    YmfmWrapperInterface& ymfmWrapper;
+
+    std::atomic<int> zones { 0 };
+    std::array<std::atomic<int>, 2> memberBendRanges;
+    std::array<std::atomic<int>, 2> masterBendRanges;
+
+    // Audio thread
+    std::array<ChannelState, NumMidiChannels> channels;
+    std::array<VoiceState, NumVoices> voices;
+    bool wasEnabled = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MpeManager)
+};
+
+} // namespace ymulatorsynth
@@ -1,8 +1,10 @@
 #include "ParameterManager.h"
+#include "PartManager.h"
 #include "../dsp/YM2151Registers.h"
 #include "../utils/Debug.h"
 #include <juce_core/juce_core.h>
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <cmath>
 
 using namespace ymulatorsynth;
 
@@ -188,11 +190,21 @@ void ParameterManager::updateYmfmParameters()
         return;
     }
     
+    // The chip already holds a preset the parameters have not caught up with
+    if (pendingParameterSync.load() >= 0) {
+        return;
+    }
+    
     // CS_FILE_DBG("updateYmfmParameters - Updating all parameters");
     
     // Update global parameters first
     updateGlobalParameters();
     
+    // Multitimbral parts keep their own presets on their channels
+    if (!ownsChannelRegisters()) {
+        return;
+    }
+    
     // Update all channel parameters
     for (int channel = 0; channel < 8; ++channel) {
         updateChannelParameters(channel);
@@ -207,6 +219,11 @@ void ParameterManager::parameterValueChanged(int parameterIndex, float newValue)
         return;
     }
     
+    // A transaction does the follow-up work once, after all of its values are set
+    if (applyingTransaction.load()) {
+        return;
+    }
+    
     // Recursion guard to prevent infinite loops
     if (s_isProcessingParameterChange) {
         CS_FILE_DBG("parameterValueChanged - Recursion detected, skipping to prevent infinite loop");
@@ -262,9 +279,6 @@ void ParameterManager::loadPresetParameters(const Preset* preset, float& preserv
         return;
     }
     
-    // Temporarily disable listeners to prevent feedback during batch loading
-    setupParameterListeners(false);
-    
     CS_FILE_DBG("loadPresetParameters - Loading preset: " + preset->name);
     
     // Preserve global pan setting
@@ -278,44 +292,48 @@ void ParameterManager::loadPresetParameters(const Preset* preset, float& preserv
     
     CS_DBG("Loading preset parameters: " + preset->name);
     
-    // Load operator parameters
+    Transaction transaction(*this);
+    transaction.setAll(getPresetParameterValues(*preset));
+    transaction.notifyProgramChange();
+    const int numChanged = transaction.commit();
+    
+    CS_DBG("Preset parameters loaded successfully (" + juce::String(numChanged) + " changed)");
+}
+
+ParameterManager::ParameterValues ParameterManager::getPresetParameterValues(const Preset& preset)
+{
+    ParameterValues values;
+    values.reserve(4 * 11 + 8);
+    
+    // Operator parameters
     for (int op = 1; op <= 4; ++op) {
-        int opIndex = op - 1; // Convert to 0-based index
-        
-        parametersPtr->getParameter(ParamID::Op::tl(op))->setValueNotifyingHost(
-            preset->operators[opIndex].totalLevel / 127.0f);
-        parametersPtr->getParameter(ParamID::Op::ar(op))->setValueNotifyingHost(
-            preset->operators[opIndex].attackRate / 31.0f);
-        parametersPtr->getParameter(ParamID::Op::d1r(op))->setValueNotifyingHost(
-            preset->operators[opIndex].decay1Rate / 31.0f);
-        parametersPtr->getParameter(ParamID::Op::d1l(op))->setValueNotifyingHost(
-            preset->operators[opIndex].sustainLevel / 15.0f);
-        parametersPtr->getParameter(ParamID::Op::d2r(op))->setValueNotifyingHost(
-            preset->operators[opIndex].decay2Rate / 31.0f);
-        parametersPtr->getParameter(ParamID::Op::rr(op))->setValueNotifyingHost(
-            preset->operators[opIndex].releaseRate / 15.0f);
-        parametersPtr->getParameter(ParamID::Op::ks(op))->setValueNotifyingHost(
-            preset->operators[opIndex].keyScale / 3.0f);
-        parametersPtr->getParameter(ParamID::Op::mul(op))->setValueNotifyingHost(
-            preset->operators[opIndex].multiple / 15.0f);
-        parametersPtr->getParameter(ParamID::Op::dt1(op))->setValueNotifyingHost(
-            preset->operators[opIndex].detune1 / 7.0f);
-        parametersPtr->getParameter(ParamID::Op::dt2(op))->setValueNotifyingHost(
-            preset->operators[opIndex].detune2 / 3.0f);
-        parametersPtr->getParameter(ParamID::Op::ams_en(op))->setValueNotifyingHost(
-            preset->operators[opIndex].amsEnable ? 1.0f : 0.0f);
-    }
-    
-    // Load global parameters
-    parametersPtr->getParameter(ParamID::Global::Algorithm)->setValueNotifyingHost(
-        preset->algorithm / 7.0f);
-    parametersPtr->getParameter(ParamID::Global::Feedback)->setValueNotifyingHost(
-        preset->feedback / 7.0f);
-        
-    // Re-enable listeners
-    setupParameterListeners(true);
+        const auto& opData = preset.operators[op - 1];
+        values.emplace_back(ParamID::Op::tl(op), opData.totalLevel / 127.0f);
+        values.emplace_back(ParamID::Op::ar(op), opData.attackRate / 31.0f);
+        values.emplace_back(ParamID::Op::d1r(op), opData.decay1Rate / 31.0f);
+        values.emplace_back(ParamID::Op::d1l(op), opData.sustainLevel / 15.0f);
+        values.emplace_back(ParamID::Op::d2r(op), opData.decay2Rate / 31.0f);
+        values.emplace_back(ParamID::Op::rr(op), opData.releaseRate / 15.0f);
+        values.emplace_back(ParamID::Op::ks(op), opData.keyScale / 3.0f);
+        values.emplace_back(ParamID::Op::mul(op), opData.multiple / 15.0f);
+        values.emplace_back(ParamID::Op::dt1(op), opData.detune1 / 7.0f);
+        values.emplace_back(ParamID::Op::dt2(op), opData.detune2 / 3.0f);
+        values.emplace_back(ParamID::Op::ams_en(op), opData.amsEnable ? 1.0f : 0.0f);
+    }
+    
+    // Global parameters
+    values.emplace_back(ParamID::Global::Algorithm, preset.algorithm / 7.0f);
+    values.emplace_back(ParamID::Global::Feedback, preset.feedback / 7.0f);
     
-    CS_DBG("Preset parameters loaded successfully");
+    // LFO and noise parameters
+    values.emplace_back(ParamID::Global::LfoRate, preset.lfo.rate / 255.0f);
+    values.emplace_back(ParamID::Global::LfoAmd, preset.lfo.amd / 127.0f);
+    values.emplace_back(ParamID::Global::LfoPmd, preset.lfo.pmd / 127.0f);
+    values.emplace_back(ParamID::Global::LfoWaveform, preset.lfo.waveform / 3.0f);
+    values.emplace_back(ParamID::Global::NoiseEnable, preset.channels[0].noiseEnable != 0 ? 1.0f : 0.0f);
+    values.emplace_back(ParamID::Global::NoiseFrequency, preset.lfo.noiseFreq / 31.0f);
+    
+    return values;
 }
 
 void ParameterManager::applyPresetToYmfm(const Preset* preset)
@@ -327,54 +345,24 @@ void ParameterManager::applyPresetToYmfm(const Preset* preset)
     
     CS_DBG("Applying preset to ymfm: " + preset->name);
     
-    // Apply algorithm and feedback to all channels first
-    for (int ch = 0; ch < 8; ++ch) {
-        ymfmWrapper.setAlgorithm(ch, static_cast<uint8_t>(preset->algorithm));
-        ymfmWrapper.setFeedback(ch, static_cast<uint8_t>(preset->feedback));
-    }
+    applyRegisterImage(preset->toRegisterImage());
     
-    // Apply operator parameters for all channels
-    for (int channel = 0; channel < 8; ++channel) {
-        for (int op = 0; op < 4; ++op) {
-            const auto& opParams = preset->operators[op];
-            
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::TotalLevel, 
-                static_cast<uint8_t>(opParams.totalLevel));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::AttackRate, 
-                static_cast<uint8_t>(opParams.attackRate));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::Decay1Rate, 
-                static_cast<uint8_t>(opParams.decay1Rate));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::SustainLevel, 
-                static_cast<uint8_t>(opParams.sustainLevel));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::Decay2Rate, 
-                static_cast<uint8_t>(opParams.decay2Rate));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::ReleaseRate, 
-                static_cast<uint8_t>(opParams.releaseRate));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::KeyScale, 
-                static_cast<uint8_t>(opParams.keyScale));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::Multiple, 
-                static_cast<uint8_t>(opParams.multiple));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::Detune1, 
-                static_cast<uint8_t>(opParams.detune1));
-            ymfmWrapper.setOperatorParameter(channel, op, 
-                YmfmWrapperInterface::OperatorParameter::Detune2, 
-                static_cast<uint8_t>(opParams.detune2));
-            
-            // AMS enable is handled separately as a boolean
-            ymfmWrapper.setOperatorAmsEnable(channel, op, opParams.amsEnable);
+    CS_DBG("Preset applied to ymfm successfully");
+}
+
+void ParameterManager::applyRegisterImage(const RegisterImage& image)
+{
+    if (ownsChannelRegisters()) {
+        for (int channel = 0; channel < 8; ++channel) {
+            ymfmWrapper.applyRegisterImage(static_cast<uint8_t>(channel), image);
         }
     }
-    
-    CS_DBG("Preset applied to ymfm successfully");
+    ymfmWrapper.applyRegisterImageGlobals(image);
+}
+
+bool ParameterManager::ownsChannelRegisters() const
+{
+    return partManager == nullptr || !partManager->isEnabled();
 }
 
 void ParameterManager::extractCurrentParameterValues(Preset& preset) const
@@ -415,13 +403,103 @@ void ParameterManager::extractCurrentParameterValues(Preset& preset) const
     CS_DBG("Parameter extraction completed");
 }
 
+// ============================================================================
+// Parameter Transactions
+// ============================================================================
+
+ParameterManager::Transaction::Transaction(ParameterManager& parameterManager)
+    : manager(parameterManager)
+{
+}
+
+ParameterManager::Transaction::~Transaction()
+{
+    if (!committed) {
+        commit();
+    }
+}
+
+void ParameterManager::Transaction::set(const juce::String& parameterId, float value)
+{
+    if (!manager.parametersPtr) {
+        return;
+    }
+    
+    if (auto* parameter = manager.parametersPtr->getParameter(parameterId)) {
+        set(*parameter, value);
+    } else {
+        CS_DBG("Transaction - unknown parameter: " + parameterId);
+    }
+}
+
+void ParameterManager::Transaction::set(juce::AudioProcessorParameter& parameter, float value)
+{
+    for (auto& change : changes) {
+        if (change.first == &parameter) {
+            change.second = value;
+            return;
+        }
+    }
+    changes.emplace_back(&parameter, value);
+}
+
+void ParameterManager::Transaction::setAll(const ParameterValues& values)
+{
+    changes.reserve(changes.size() + values.size());
+    for (const auto& [parameterId, value] : values) {
+        set(parameterId, value);
+    }
+}
+
+int ParameterManager::Transaction::commit()
+{
+    committed = true;
+    if (!manager.parametersPtr) {
+        changes.clear();
+        return 0;
+    }
+    
+    auto* globalPanParam = manager.parametersPtr->getParameter(ParamID::Global::GlobalPan);
+    bool globalPanChanged = false;
+    int numChanged = 0;
+    
+    manager.applyingTransaction.store(true);
+    for (const auto& [parameter, value] : changes) {
+        if (isSameParameterValue(*parameter, parameter->getValue(), value)) {
+            continue;
+        }
+        parameter->setValueNotifyingHost(value);
+        globalPanChanged = globalPanChanged || parameter == globalPanParam;
+        ++numChanged;
+    }
+    manager.applyingTransaction.store(false);
+    changes.clear();
+    
+    if (globalPanChanged) {
+        manager.applyGlobalPanToAllChannels();
+    }
+    if (programChanged) {
+        manager.audioProcessor.updateHostDisplay(juce::AudioProcessor::ChangeDetails().withProgramChanged(true));
+    }
+    
+    CS_FILE_DBG("Transaction committed - " + juce::String(numChanged) + " parameters changed");
+    return numChanged;
+}
+
+bool ParameterManager::isSameParameterValue(const juce::AudioProcessorParameter& parameter, float a, float b)
+{
+    if (auto* ranged = dynamic_cast<const juce::RangedAudioParameter*>(&parameter))
+        return std::abs(ranged->convertFrom0to1(a) - ranged->convertFrom0to1(b)) < 1.0e-6f;
+    return std::abs(a - b) < 1.0e-6f;
+}
+
 // ============================================================================
 // Global Pan Management
 // ============================================================================
 
 void ParameterManager::applyGlobalPan(int channel)
 {
-    if (!parametersPtr || !panProcessor) {
+    if (!parametersPtr || !panProcessor || !ownsChannelRegisters()) {
         return;
     }
     
@@ -444,6 +522,11 @@ void ParameterManager::applyGlobalPanToAllChannels()
         return;
     }
     
+    // Parts pan their own channels
+    if (!ownsChannelRegisters()) {
+        return;
+    }
+    
     auto* globalPanParam = static_cast<juce::AudioParameterChoice*>(
         parametersPtr->getParameter(ParamID::Global::GlobalPan));
     
@@ -613,10 +696,12 @@ void ParameterManager::updateGlobalParameters()
     CS_ASSERT_ALGORITHM(algorithmValue);
     CS_ASSERT_FEEDBACK(feedbackValue);
     
-    // Apply algorithm and feedback to all channels
-    for (int ch = 0; ch < 8; ++ch) {
-        ymfmWrapper.setAlgorithm(ch, algorithmValue);
-        ymfmWrapper.setFeedback(ch, feedbackValue);
+    // Apply algorithm and feedback to all channels (multitimbral parts have their own)
+    if (ownsChannelRegisters()) {
+        for (int ch = 0; ch < 8; ++ch) {
+            ymfmWrapper.setAlgorithm(ch, algorithmValue);
+            ymfmWrapper.setFeedback(ch, feedbackValue);
+        }
     }
     
     // LFO Parameters
@@ -9,11 +9,15 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <atomic>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace ymulatorsynth {
 
 // GlobalPanPosition enum moved to utils/GlobalPanPosition.h
 
+class PartManager;
+
 /**
  * ParameterManager - Manages all audio parameter operations for YMulator-Synth
  * 
@@ -93,9 +97,74 @@ public:
     // Preset Parameter Management
     // =========================================================================
     
+    /** Normalized (0.0-1.0) parameter values, keyed by parameter ID */
+    using ParameterValues = std::vector<std::pair<juce::String, float>>;
+    
+    /**
+     * The values loadPresetParameters() gives the JUCE parameters for a preset
+     * @param preset Preset to convert
+     * @return One entry per preset-controlled parameter, in a fixed order
+     */
+    static ParameterValues getPresetParameterValues(const Preset& preset);
+    
+    /**
+     * Transaction - Stages parameter changes and applies them in one pass
+     *
+     * Values set on a transaction are only recorded; commit() (or the
+     * destructor) writes the ones that actually differ from the current
+     * values. While the pass runs, parameterValueChanged() ignores the
+     * changes, and the follow-up work it would have done per parameter
+     * (global pan, host display) runs once at the end instead.
+     *
+     * JUCE reports every parameter set to the host and the attachments
+     * individually, so unchanged values are skipped rather than coalesced.
+     * Message thread only.
+     */
+    class Transaction {
+    public:
+        explicit Transaction(ParameterManager& manager);
+        
+        /** Commits whatever has not been committed yet */
+        ~Transaction();
+        
+        /**
+         * Stages a normalized value; a later value for the same parameter wins
+         * @param parameterId Parameter ID (unknown IDs are ignored)
+         * @param value New value (0.0-1.0)
+         */
+        void set(const juce::String& parameterId, float value);
+        void set(juce::AudioProcessorParameter& parameter, float value);
+        
+        /** Stages every value in the list */
+        void setAll(const ParameterValues& values);
+        
+        /** Sends the host one program-change notification after the commit */
+        void notifyProgramChange() { programChanged = true; }
+        
+        /**
+         * Applies the staged values
+         * @return Number of parameters whose value changed
+         */
+        int commit();
+        
+    private:
+        ParameterManager& manager;
+        std::vector<std::pair<juce::AudioProcessorParameter*, float>> changes;
+        bool programChanged = false;
+        bool committed = false;
+        
+        JUCE_DECLARE_NON_COPYABLE(Transaction)
+    };
+    
+    /**
+     * Compares two normalized values in the parameter's own steps, so float
+     * rounding never counts as a change
+     */
+    static bool isSameParameterValue(const juce::AudioProcessorParameter& parameter, float a, float b);
+    
     /**
      * Loads preset parameter values into JUCE parameter system
-     * Temporarily disables listeners to prevent feedback during batch loading
+     * Applies them as one Transaction, so only differing values are set
      * @param preset Preset to load parameters from
      * @param preservedGlobalPan Reference to store current global pan value
      */
@@ -108,6 +177,39 @@ public:
      */
     void applyPresetToYmfm(const Preset* preset);
     
+    /**
+     * Copies a precompiled register image into all 8 channels and the
+     * chip-wide LFO/noise registers. Allocation- and lock-free, so it may be
+     * called from the audio thread.
+     * @param image Register image compiled from a preset
+     */
+    void applyRegisterImage(const RegisterImage& image);
+    
+    // =========================================================================
+    // Deferred Parameter Sync
+    // =========================================================================
+    
+    /**
+     * Marks the JUCE parameters as lagging behind the chip until the given
+     * preset has been loaded into them. Until then updateYmfmParameters()
+     * leaves the chip alone so stale parameter values cannot undo a preset
+     * that was applied as a register image.
+     * @param presetIndex Preset whose values the parameters must receive
+     */
+    void beginDeferredParameterSync(int presetIndex) { pendingParameterSync.store(presetIndex); }
+    
+    /**
+     * Clears the pending sync if it still refers to the given preset
+     * @return false if a newer preset change is pending
+     */
+    bool completeDeferredParameterSync(int presetIndex) { return pendingParameterSync.compare_exchange_strong(presetIndex, -1); }
+    
+    /** Drops any pending sync (the parameters were loaded synchronously) */
+    void cancelDeferredParameterSync() { pendingParameterSync.store(-1); }
+    
+    /** @return Preset index waiting for parameter sync, or -1 */
+    int getPendingParameterSync() const { return pendingParameterSync.load(); }
+    
     /**
      * Extracts current parameter values into a preset structure
      * Used for saving current state to OPM files or user presets
@@ -115,6 +217,21 @@ public:
      */
     void extractCurrentParameterValues(Preset& preset) const;
     
+    // =========================================================================
+    // Multitimbral Mode
+    // =========================================================================
+    
+    /**
+     * Hands the per-channel registers to a PartManager while its multitimbral
+     * mode is on. The periodic update, register images and global pan then
+     * only write the chip-wide LFO and noise registers.
+     * @param manager Part manager, or nullptr for single mode only
+     */
+    void setPartManager(const PartManager* manager) { partManager = manager; }
+    
+    /** @return false while multitimbral parts own the channel registers */
+    bool ownsChannelRegisters() const;
+    
     // =========================================================================
     // Global Pan Management (Specialized Parameter Handling)
     // =========================================================================
@@ -202,12 +319,19 @@ private:
     juce::AudioProcessor& audioProcessor;
     juce::AudioProcessorValueTreeState* parametersPtr = nullptr;
     std::shared_ptr<PanProcessor> panProcessor;
+    const PartManager* partManager = nullptr;
     
     // =========================================================================
     // Parameter Management State
     // =========================================================================
     
     
+    /// Preset applied to the chip whose values have not reached the JUCE parameters yet (-1 = none)
+    std::atomic<int> pendingParameterSync { -1 };
+    
+    /// Set while a Transaction writes its values; parameterValueChanged() ignores them
+    std::atomic<bool> applyingTransaction { false };
+    
     /// Custom preset detection and management
     bool isCustomPreset = false;
     juce::String customPresetName = "Custom";
@@ -0,0 +1,212 @@
+#include "PartManager.h"
+#include "../utils/Debug.h"
+#include <cmath>
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr int TotalLevelColumn = 1;          // TL in RegisterImage::operators[op][]
+    constexpr float DecibelsPerTotalLevelStep = 0.75f;
+}
+
+PartManager::PartManager(YmfmWrapperInterface& ymfmWrapper)
+    : ymfmWrapper(ymfmWrapper)
+{
+    channelOwners.fill(-1);
+    for (int part = 0; part < NumParts; ++part) {
+        requestedParts[static_cast<size_t>(part)] = makeDefaultPart(part);
+        parts[static_cast<size_t>(part)].settings = requestedParts[static_cast<size_t>(part)];
+        parts[static_cast<size_t>(part)].compiled = compileImage(parts[static_cast<size_t>(part)].settings.image, 1.0f);
+    }
+}
+
+PartSettings PartManager::makeDefaultPart(int part)
+{
+    PartSettings settings;
+    settings.midiChannel = part;
+    settings.channelMask = static_cast<uint8_t>(1 << (part & 7));
+    return settings;
+}
+
+RegisterImage PartManager::compileImage(const RegisterImage& image, float volume)
+{
+    // Whole TL steps of attenuation; silence at zero volume
+    const int attenuation = volume <= 0.0f ? 127
+        : juce::jlimit(0, 127, juce::roundToInt(-20.0f * std::log10(juce::jmin(1.0f, volume)) / DecibelsPerTotalLevelStep));
+
+    RegisterImage compiled = image;
+    const auto algorithm = static_cast<uint8_t>(image.connection & YM2151Regs::MASK_ALGORITHM);
+    for (uint8_t op = 0; op < 4; ++op) {
+        if (YM2151Regs::isCarrier(algorithm, op)) {
+            auto& tl = compiled.operators[op][TotalLevelColumn];
+            tl = static_cast<uint8_t>(juce::jmin(127, (tl & 0x7f) + attenuation));
+        }
+    }
+    return compiled;
+}
+
+// ============================================================================
+// Message Thread
+// ============================================================================
+
+void PartManager::setEnabled(bool shouldBeEnabled)
+{
+    enabled.store(shouldBeEnabled);
+    CS_DBG("Multitimbral mode " + juce::String(shouldBeEnabled ? "on" : "off"));
+}
+
+bool PartManager::setPart(int part, const PartSettings& settings)
+{
+    if (part < 0 || part >= NumParts) {
+        return false;
+    }
+    if (settings.lowNote > settings.highNote || settings.highNote > 127
+        || settings.lowVelocity > settings.highVelocity || settings.highVelocity > 127) {
+        CS_DBG("Part " + juce::String(part) + " has an empty note or velocity range - not changed");
+        return false;
+    }
+
+    const auto scope = updateFifo.write(1);
+    if (scope.blockSize1 == 0) {
+        CS_DBG("Part update queue full - part " + juce::String(part) + " not changed");
+        return false;
+    }
+
+    auto& update = updateQueue[static_cast<size_t>(scope.startIndex1)];
+    update.part = part;
+    update.settings = settings;
+    update.compiled = compileImage(settings.image, settings.volume);
+
+    {
+        const juce::SpinLock::ScopedLockType lock(requestedPartsLock);
+        requestedParts[static_cast<size_t>(part)] = settings;
+    }
+    return true;
+}
+
+const PartSettings& PartManager::getPart(int part) const
+{
+    return requestedParts[static_cast<size_t>(juce::jlimit(0, NumParts - 1, part))];
+}
+
+std::array<PartSettings, PartManager::NumParts> PartManager::getParts() const
+{
+    const juce::SpinLock::ScopedLockType lock(requestedPartsLock);
+    return requestedParts;
+}
+
+// ============================================================================
+// Audio Thread
+// ============================================================================
+
+int PartManager::applyPendingChanges(uint8_t soundingChannels)
+{
+    {
+        const auto scope = updateFifo.read(updateFifo.getNumReady());
+        scope.forEach([this](int index) {
+            const auto& update = updateQueue[static_cast<size_t>(index)];
+            auto& part = parts[static_cast<size_t>(update.part)];
+            part.settings = update.settings;
+            part.compiled = update.compiled;
+            dirtyParts = static_cast<uint8_t>(dirtyParts | (1 << update.part));
+        });
+    }
+
+    // Coming back on, the channels hold whatever single mode left there
+    const bool isOn = enabled.load();
+    if (isOn && !wasEnabled) {
+        dirtyParts = 0xFF;
+        channelOwners.fill(-1);
+    }
+    wasEnabled = isOn;
+
+    if (!isOn || dirtyParts == 0) {
+        return 0;
+    }
+
+    int numRewritten = 0;
+    for (int index = 0; index < NumParts; ++index) {
+        const auto& part = parts[static_cast<size_t>(index)];
+        if (((dirtyParts >> index) & 1) == 0 || part.settings.midiChannel < 0) {
+            continue;
+        }
+
+        // A shared channel goes to the part that changed last until a note claims it back,
+        // unless another part's note is still sounding there and has to find it to end
+        for (uint8_t channel = 0; channel < 8; ++channel) {
+            if (((part.settings.channelMask >> channel) & 1) == 0) {
+                continue;
+            }
+            const int owner = channelOwners[channel];
+            if (owner >= 0 && owner != index && ((soundingChannels >> channel) & 1)) {
+                continue;
+            }
+            writePartToChannel(index, channel);
+            ++numRewritten;
+        }
+    }
+    dirtyParts = 0;
+    return numRewritten;
+}
+
+uint8_t PartManager::getPartsForMidiChannel(int midiChannel) const
+{
+    uint8_t mask = 0;
+    for (int index = 0; index < NumParts; ++index) {
+        if (parts[static_cast<size_t>(index)].settings.midiChannel == midiChannel) {
+            mask = static_cast<uint8_t>(mask | (1 << index));
+        }
+    }
+    return mask;
+}
+
+uint8_t PartManager::getChannelMask(int part) const
+{
+    return part >= 0 && part < NumParts ? parts[static_cast<size_t>(part)].settings.channelMask : 0;
+}
+
+bool PartManager::acceptsNote(int part, uint8_t note, uint8_t velocity) const
+{
+    if (part < 0 || part >= NumParts) {
+        return false;
+    }
+    const auto& settings = parts[static_cast<size_t>(part)].settings;
+    return note >= settings.lowNote && note <= settings.highNote
+        && velocity >= settings.lowVelocity && velocity <= settings.highVelocity;
+}
+
+bool PartManager::claimChannel(int part, uint8_t channel)
+{
+    if (part < 0 || part >= NumParts || channel >= 8 || channelOwners[channel] == part) {
+        return false;
+    }
+    writePartToChannel(part, channel);
+    CS_DBG("Channel " + juce::String(channel) + " switched to part " + juce::String(part));
+    return true;
+}
+
+int PartManager::getChannelOwner(uint8_t channel) const
+{
+    return channel < 8 ? channelOwners[channel] : -1;
+}
+
+uint8_t PartManager::getOwnedChannels(int part) const
+{
+    uint8_t mask = 0;
+    for (uint8_t channel = 0; channel < 8; ++channel) {
+        if (channelOwners[channel] == part) {
+            mask = static_cast<uint8_t>(mask | (1 << channel));
+        }
+    }
+    return mask;
+}
+
+void PartManager::writePartToChannel(int part, uint8_t channel)
+{
+    const auto& state = parts[static_cast<size_t>(part)];
+    ymfmWrapper.applyRegisterImage(channel, state.compiled);
+    ymfmWrapper.setChannelPan(channel, juce::jlimit(0.0f, 1.0f, state.settings.pan));
+    channelOwners[channel] = static_cast<int8_t>(part);
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../dsp/YmfmWrapperInterface.h"
+#include "../dsp/RegisterImage.h"
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace ymulatorsynth {
+
+/**
+ * One part of the multitimbral mode
+ *
+ * The note and velocity ranges make the part a keyboard zone: parts on the
+ * same MIDI channel with disjoint note ranges split the keyboard, disjoint
+ * velocity ranges switch sounds by touch, and overlapping ranges layer.
+ */
+struct PartSettings
+{
+    int midiChannel = -1;       // 0-15, -1 = part off
+    uint8_t channelMask = 0;    // YM2151 channels the part's notes play on (bit N = channel N)
+    uint8_t lowNote = 0;        // lowest MIDI note the part plays
+    uint8_t highNote = 127;     // highest MIDI note the part plays
+    uint8_t lowVelocity = 1;    // softest note-on velocity the part plays
+    uint8_t highVelocity = 127; // hardest note-on velocity the part plays
+    int presetIndex = -1;       // global preset index the image was compiled from, for display and state
+    RegisterImage image;        // the part's preset
+    float volume = 1.0f;        // 0.0-1.0, applied as carrier TL attenuation
+    float pan = 0.5f;           // 0.0 = left, 0.5 = centre, 1.0 = right
+};
+
+/**
+ * PartManager - Multitimbral mode: up to 8 parts, each with its own preset
+ *
+ * A part listens on one MIDI channel and plays on its own pool of YM2151
+ * channels with its own register image. Several parts on the same MIDI
+ * channel split or layer according to their note and velocity ranges, so
+ * one controller can play bass on channels 0-1 and a pad on channels 2-7.
+ *
+ * Pools may be reserved or shared. Each channel remembers which part's
+ * image it holds; a note only rewrites the channel's registers when it
+ * takes the channel from another part (see claimChannel), so notes within
+ * a zone cost no register writes beyond the key-on.
+ *
+ * Per-part volume is folded into the carrier TLs of the image when the part
+ * is set, so it costs nothing at note-on and the modulators (the timbre) are
+ * unaffected. The chip only has left/right enable bits per channel, so pan
+ * selects left, both or right.
+ *
+ * Parts are set on the message thread and reach the audio thread through a
+ * lock-free FIFO. applyPendingChanges() runs once per block and rewrites only
+ * the channels of parts that changed. While the mode is on, ParameterManager
+ * leaves the per-channel registers alone (see ParameterManager::ownsChannelRegisters)
+ * and only drives the chip-wide LFO and noise.
+ */
+class PartManager
+{
+public:
+    static constexpr int NumParts = 8;
+    static constexpr int UpdateQueueSize = 64;
+
+    explicit PartManager(YmfmWrapperInterface& ymfmWrapper);
+
+    /** Part N on MIDI channel N, alone on YM2151 channel N */
+    static PartSettings makeDefaultPart(int part);
+
+    /** The image with the carrier TLs attenuated for the volume */
+    static RegisterImage compileImage(const RegisterImage& image, float volume);
+
+    // Message thread
+
+    /** Turns multitimbral mode on or off; every part is rewritten when it comes on */
+    void setEnabled(bool enabled);
+
+    /**
+     * Queues a part change for the audio thread
+     * @return false if the part index or the note or velocity range is invalid, or the queue is full
+     */
+    bool setPart(int part, const PartSettings& settings);
+
+    /** @return The settings last given to setPart() */
+    const PartSettings& getPart(int part) const;
+
+    // Any thread
+
+    bool isEnabled() const { return enabled.load(); }
+
+    /** A copy of the settings last given to setPart(), e.g. for a host saving state */
+    std::array<PartSettings, NumParts> getParts() const;
+
+    // Audio thread
+
+    /**
+     * Takes queued part changes and writes the parts that changed to the chip.
+     * A shared channel still sounding another part's note keeps that part's
+     * image; the changed part takes it with claimChannel() on its next note.
+     * @param soundingChannels Bit mask of the YM2151 channels with an active voice
+     * @return Number of YM2151 channels rewritten
+     */
+    int applyPendingChanges(uint8_t soundingChannels = 0);
+
+    /** @return Bit mask of the parts listening on a MIDI channel (0-15) */
+    uint8_t getPartsForMidiChannel(int midiChannel) const;
+
+    /** @return The pool of a part as the audio thread sees it */
+    uint8_t getChannelMask(int part) const;
+
+    /** @return true if the note and velocity fall inside the part's zone */
+    bool acceptsNote(int part, uint8_t note, uint8_t velocity) const;
+
+    /**
+     * Makes a channel play a part, writing the part's image only if the
+     * channel currently holds another part's
+     * @return true if the registers were rewritten
+     */
+    bool claimChannel(int part, uint8_t channel);
+
+    /** @return The part whose image a YM2151 channel holds, or -1 */
+    int getChannelOwner(uint8_t channel) const;
+
+    /** @return Bit mask of the YM2151 channels holding a part's image */
+    uint8_t getOwnedChannels(int part) const;
+
+private:
+    struct PartUpdate {
+        int part = 0;
+        PartSettings settings;
+        RegisterImage compiled;
+    };
+
+    struct PartState {
+        PartSettings settings;
+        RegisterImage compiled;
+    };
+
+    YmfmWrapperInterface& ymfmWrapper;
+
+    std::atomic<bool> enabled { false };
+
+    // Message thread; the lock is only for getParts() on other threads, never the audio thread
+    std::array<PartSettings, NumParts> requestedParts;
+    juce::SpinLock requestedPartsLock;
+
+    // Message thread to audio thread
+    juce::AbstractFifo updateFifo { UpdateQueueSize };
+    std::array<PartUpdate, UpdateQueueSize> updateQueue;
+
+    // Audio thread
+    std::array<PartState, NumParts> parts;
+    uint8_t dirtyParts = 0;
+    bool wasEnabled = false;
+    std::array<int8_t, 8> channelOwners;
+
+    void writePartToChannel(int part, uint8_t channel);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartManager)
+};
+
+} // namespace ymulatorsynth
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 #include <memory>
 
 // Forward declarations
@@ -14,6 +15,9 @@ namespace juce {
 namespace ymulatorsynth {
     struct Preset;
     struct Bank;
+    struct PresetLibrarySnapshot;
+    struct RegisterImage;
+    class BankImportJob;
 }
 
 /**
@@ -29,35 +33,61 @@ public:
     // Initialization
     virtual void initialize() = 0;
     
+    // Deferred initialization - factory presets now, the rest in the background;
+    // onReady is called on the message thread once the whole library is published
+    virtual void initializeAsync(std::function<void()> onReady) = 0;
+    virtual bool isLibraryReady() const = 0;
+    virtual bool finishInitialization(int timeoutMs) = 0;
+    
     // File operations
     virtual int loadOPMFile(const juce::File& file) = 0;
+    virtual std::shared_ptr<ymulatorsynth::BankImportJob> importOPMFileAsync(const juce::File& file,
+                                                                     std::function<void(const ymulatorsynth::BankImportJob&)> onComplete) = 0;
     virtual int loadBundledPresets() = 0;
     virtual bool saveOPMFile(const juce::File& file) const = 0;
+    virtual void saveOPMFileAsync(const juce::File& file, std::function<void(bool)> onComplete) = 0;
     virtual bool savePresetAsOPM(const juce::File& file, const ymulatorsynth::Preset& preset) const = 0;
     
-    // Preset access
-    virtual const ymulatorsynth::Preset* getPreset(int id) const = 0;
-    virtual const ymulatorsynth::Preset* getPreset(const juce::String& name) const = 0;
+    // Preset access - safe from any thread; the snapshot keeps a consistent library alive.
+    // Global indices are never reused or shifted: a removed preset leaves an empty slot.
+    virtual std::shared_ptr<const ymulatorsynth::PresetLibrarySnapshot> getSnapshot() const = 0;
+    virtual std::shared_ptr<const ymulatorsynth::Preset> getPreset(int id) const = 0;
+    virtual std::shared_ptr<const ymulatorsynth::Preset> getPreset(const juce::String& name) const = 0;
     virtual juce::StringArray getPresetNames() const = 0;
     virtual int getNumPresets() const = 0;
     
     // Bank management
-    virtual const std::vector<ymulatorsynth::Bank>& getBanks() const = 0;
+    virtual std::shared_ptr<const std::vector<ymulatorsynth::Bank>> getBanks() const = 0;
     virtual juce::StringArray getPresetsForBank(int bankIndex) const = 0;
-    virtual const ymulatorsynth::Preset* getPresetInBank(int bankIndex, int presetIndex) const = 0;
+    virtual std::shared_ptr<const ymulatorsynth::Preset> getPresetInBank(int bankIndex, int presetIndex) const = 0;
     virtual int getGlobalPresetIndex(int bankIndex, int presetIndex) const = 0;
     
+    // Register images
+    virtual std::shared_ptr<const ymulatorsynth::RegisterImage> getRegisterImage(int index) const = 0;
+    
+    // Search
+    virtual std::vector<int> searchPresets(const juce::String& query, int maxResults) const = 0;
+    virtual std::vector<int> findSimilarPresets(int presetIndex, int maxResults) const = 0;
+    
     // Preset modification
     virtual void addPreset(const ymulatorsynth::Preset& preset) = 0;
     virtual void removePreset(int id) = 0;
     virtual void clear() = 0;
     
+    // Presets received over MIDI go to a session bank of that name, created if missing;
+    // returns the global index of the first one, or -1
+    virtual int addReceivedPresets(const juce::String& bankName, const std::vector<ymulatorsynth::Preset>& received) = 0;
+    
     // User presets and data persistence
     virtual bool addUserPreset(const ymulatorsynth::Preset& preset) = 0;
     virtual bool saveUserData() = 0;
     virtual int loadUserData() = 0;
     virtual juce::File getUserDataDirectory() const = 0;
     
+    // Bank directory watching - onLibraryChanged is called on the message thread
+    virtual void startWatchingBankDirectories(std::function<void()> onLibraryChanged) = 0;
+    virtual void stopWatchingBankDirectories() = 0;
+    
     // Factory presets
     virtual std::vector<ymulatorsynth::Preset> getFactoryPresets() = 0;
     
@@ -1,6 +1,11 @@
 #include "StateManager.h"
 #include "ParameterManager.h"
+#include "MidiProcessor.h"
 #include "../utils/Debug.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <type_traits>
 
 namespace ymulatorsynth {
 
@@ -11,33 +16,295 @@ StateManager::StateManager(juce::AudioProcessorValueTreeState& parameters,
     , presetManager(presetManager)
     , parameterManager(parameterManager)
 {
+    // Without a message loop (tests, offline tools) preset changes sync their parameters at once
+    if (juce::MessageManager::getInstanceWithoutCreating() != nullptr) {
+        startTimerHz(30);
+    }
     CS_DBG("StateManager created");
 }
 
+StateManager::~StateManager()
+{
+    stopTimer();
+}
+
 // ============================================================================
 // JUCE AudioProcessor State Interface
 // ============================================================================
 
 void StateManager::getStateInformation(juce::MemoryBlock& destData)
 {
-    auto state = parameters.copyState();
-    
-    // Add current preset number and custom state to state
-    state.setProperty("currentPreset", currentPreset, nullptr);
-    state.setProperty("isCustomPreset", parameterManager.isInCustomMode(), nullptr);
-    state.setProperty("customPresetName", parameterManager.getCustomPresetName(), nullptr);
+    // A state that is still waiting for the library is saved as it was received
+    if (!pendingState.isEmpty()) {
+        destData = pendingState;
+        return;
+    }
     
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    juce::AudioProcessor::copyXmlToBinary(*xml, destData);
+    writeBinaryState(destData);
     
-    CS_DBG(juce::String("State saved - currentPreset: ") + juce::String(currentPreset) + 
-           ", isCustom: " + (parameterManager.isInCustomMode() ? "true" : "false"));
+    CS_DBG(juce::String("State saved - currentPreset: ") + juce::String(currentPreset.load()) + 
+           ", isCustom: " + (parameterManager.isInCustomMode() ? "true" : "false") +
+           ", " + juce::String(static_cast<int>(destData.getSize())) + " bytes");
 }
 
 void StateManager::setStateInformation(const void* data, int sizeInBytes)
 {
     CS_DBG("setStateInformation called - size: " + juce::String(sizeInBytes));
     
+    // The reference preset may be in a bank that is still loading
+    if (!presetManager.isLibraryReady() && data != nullptr && sizeInBytes > 0) {
+        pendingState.replaceAll(data, static_cast<size_t>(sizeInBytes));
+        pendingProgram = -1;
+        CS_DBG("Preset library still loading - state restore deferred");
+        return;
+    }
+    
+    if (data != nullptr && sizeInBytes >= 4
+        && juce::ByteOrder::littleEndianInt(data) == BinaryStateMagic) {
+        readBinaryState(data, sizeInBytes);
+    } else {
+        readXmlState(data, sizeInBytes);  // Sessions saved before the binary format
+    }
+}
+
+namespace {
+    juce::String getParameterId(const juce::AudioProcessorParameter& param)
+    {
+        if (auto* withId = dynamic_cast<const juce::AudioProcessorParameterWithID*>(&param))
+            return withId->paramID;
+        return {};
+    }
+    
+    /** Global indices of the built-in presets, which every session has */
+    const std::vector<int>* getFactoryIndices(const PresetLibrarySnapshot& library)
+    {
+        for (const auto& bank : *library.banks) {
+            if (bank.name == "Factory") {
+                return &bank.presetIndices;
+            }
+        }
+        return nullptr;
+    }
+    
+    bool isFactoryPreset(const PresetLibrarySnapshot& library, int index)
+    {
+        const auto* factory = getFactoryIndices(library);
+        return factory != nullptr && std::find(factory->begin(), factory->end(), index) != factory->end();
+    }
+    
+    // Register bytes only, so the image is stored as it is in memory
+    static_assert(std::is_trivially_copyable_v<RegisterImage> && sizeof(RegisterImage) == 31);
+    
+    constexpr int PartRecordSize = 6 + 4 + 4 + 4 + static_cast<int>(sizeof(RegisterImage));
+    constexpr int MultitimbralFlag = 1;
+}
+
+void StateManager::writeBinaryState(juce::MemoryBlock& destData)
+{
+    // The reference is the preset whose values the parameters were loaded from. Only
+    // factory presets are used: user, imported and received presets can be deleted
+    // or live only for a session, so their values are stored in full.
+    const int presetIndex = currentPreset.load();
+    const auto library = presetManager.getSnapshot();
+    const auto reference = isFactoryPreset(*library, presetIndex) ? library->getPreset(presetIndex) : nullptr;
+    const auto baseline = getBaselineValues(reference.get());
+    const auto& allParams = parameters.processor.getParameters();
+    
+    juce::MemoryOutputStream deltas;
+    int numDeltas = 0;
+    for (int i = 0; i < allParams.size(); ++i) {
+        const float value = allParams[i]->getValue();
+        if (ParameterManager::isSameParameterValue(*allParams[i], value, baseline[static_cast<size_t>(i)])) {
+            continue;
+        }
+        deltas.writeString(getParameterId(*allParams[i]));
+        deltas.writeFloat(value);
+        ++numDeltas;
+    }
+    
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(static_cast<int>(BinaryStateMagic));
+    stream.writeInt(static_cast<int>(BinaryStateVersion));
+    stream.writeInt(presetIndex);
+    stream.writeByte(parameterManager.isInCustomMode() ? 1 : 0);
+    stream.writeString(parameterManager.getCustomPresetName());
+    stream.writeInt(reference != nullptr ? presetIndex : -1);
+    stream.writeInt64(reference != nullptr ? static_cast<juce::int64>(hashPresetParameters(*reference)) : 0);
+    stream.writeShort(static_cast<short>(numDeltas));
+    stream << deltas;
+    
+    const auto mappings = midiProcessor != nullptr ? midiProcessor->getMidiMappings() : std::map<int, juce::String>();
+    stream.writeShort(static_cast<short>(mappings.size()));
+    for (const auto& [ccNumber, parameterId] : mappings) {
+        stream.writeByte(static_cast<char>(ccNumber));
+        stream.writeString(parameterId);
+    }
+    
+    const bool multitimbral = partManager != nullptr && partManager->isEnabled();
+    stream.writeByte(static_cast<char>(multitimbral ? MultitimbralFlag : 0));
+    if (partManager == nullptr) {
+        stream.writeByte(0);
+        return;
+    }
+    
+    const auto parts = partManager->getParts();
+    stream.writeByte(static_cast<char>(parts.size()));
+    for (const auto& part : parts) {
+        stream.writeByte(static_cast<char>(part.midiChannel));
+        stream.writeByte(static_cast<char>(part.channelMask));
+        stream.writeByte(static_cast<char>(part.lowNote));
+        stream.writeByte(static_cast<char>(part.highNote));
+        stream.writeByte(static_cast<char>(part.lowVelocity));
+        stream.writeByte(static_cast<char>(part.highVelocity));
+        stream.writeFloat(part.volume);
+        stream.writeFloat(part.pan);
+        stream.writeInt(part.presetIndex);
+        stream.write(&part.image, sizeof(RegisterImage));
+    }
+}
+
+void StateManager::readBinaryState(const void* data, int sizeInBytes)
+{
+    juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
+    stream.skipNextBytes(4);  // magic, checked by the caller
+    
+    const auto version = static_cast<juce::uint32>(stream.readInt());
+    if (version < 1 || version > BinaryStateVersion) {
+        CS_DBG("Unsupported binary state version " + juce::String(version) + " - state not restored");
+        return;
+    }
+    
+    // Fixed-size fields around the name: preset, flags, then reference, hash and count
+    if (stream.getNumBytesRemaining() < 4 + 1 + 1) {
+        CS_DBG("Binary state truncated - state not restored");
+        return;
+    }
+    const int savedPreset = stream.readInt();
+    const bool isCustom = (stream.readByte() & 1) != 0;
+    const juce::String customName = stream.readString();
+    if (stream.getNumBytesRemaining() < 4 + 8 + 2) {
+        CS_DBG("Binary state truncated - state not restored");
+        return;
+    }
+    const int referenceIndex = stream.readInt();
+    const auto referenceHash = static_cast<uint64_t>(stream.readInt64());
+    const int numDeltas = static_cast<juce::uint16>(stream.readShort());
+    
+    std::vector<std::pair<juce::String, float>> deltas;
+    deltas.reserve(static_cast<size_t>(numDeltas));
+    for (int i = 0; i < numDeltas; ++i) {
+        const juce::String parameterId = stream.readString();
+        if (stream.getNumBytesRemaining() < 4) {
+            CS_DBG("Binary state truncated - state not restored");
+            return;
+        }
+        deltas.emplace_back(parameterId, stream.readFloat());
+    }
+    
+    // Version 1 predates MIDI learn: the session had the VOPMex layout
+    std::map<int, juce::String> mappings;
+    if (version >= 2) {
+        if (stream.getNumBytesRemaining() < 2) {
+            CS_DBG("Binary state truncated - state not restored");
+            return;
+        }
+        const int numMappings = static_cast<juce::uint16>(stream.readShort());
+        for (int i = 0; i < numMappings; ++i) {
+            if (stream.getNumBytesRemaining() < 2) {
+                CS_DBG("Binary state truncated - state not restored");
+                return;
+            }
+            const int ccNumber = static_cast<juce::uint8>(stream.readByte());
+            mappings[ccNumber] = stream.readString();
+        }
+    }
+    
+    // Version 2 and earlier predate saved parts: the session played in single mode
+    bool multitimbral = false;
+    std::array<PartSettings, PartManager::NumParts> parts;
+    for (int part = 0; part < PartManager::NumParts; ++part) {
+        parts[static_cast<size_t>(part)] = PartManager::makeDefaultPart(part);
+    }
+    if (version >= 3) {
+        if (stream.getNumBytesRemaining() < 2) {
+            CS_DBG("Binary state truncated - state not restored");
+            return;
+        }
+        multitimbral = (stream.readByte() & MultitimbralFlag) != 0;
+        const int numParts = static_cast<juce::uint8>(stream.readByte());
+        for (int part = 0; part < numParts; ++part) {
+            if (stream.getNumBytesRemaining() < PartRecordSize) {
+                CS_DBG("Binary state truncated - state not restored");
+                return;
+            }
+            PartSettings settings;
+            settings.midiChannel = juce::jlimit(-1, 15, static_cast<int>(static_cast<signed char>(stream.readByte())));
+            settings.channelMask = static_cast<uint8_t>(stream.readByte());
+            settings.lowNote = static_cast<uint8_t>(stream.readByte());
+            settings.highNote = static_cast<uint8_t>(stream.readByte());
+            settings.lowVelocity = static_cast<uint8_t>(stream.readByte());
+            settings.highVelocity = static_cast<uint8_t>(stream.readByte());
+            settings.volume = juce::jlimit(0.0f, 1.0f, stream.readFloat());
+            settings.pan = juce::jlimit(0.0f, 1.0f, stream.readFloat());
+            settings.presetIndex = stream.readInt();
+            stream.read(&settings.image, sizeof(RegisterImage));
+            if (part < PartManager::NumParts) {
+                parts[static_cast<size_t>(part)] = settings;
+            }
+        }
+    }
+    
+    // Find the reference preset, which may have moved if the library changed since saving
+    const auto library = presetManager.getSnapshot();
+    std::shared_ptr<const Preset> reference;
+    int restoredPreset = savedPreset;
+    if (referenceIndex >= 0) {
+        auto candidate = library->getPreset(referenceIndex);
+        if (candidate != nullptr && hashPresetParameters(*candidate) == referenceHash) {
+            reference = candidate;
+        } else if (const auto* factory = getFactoryIndices(*library)) {
+            // References are factory presets, so only those are searched
+            for (const int i : *factory) {
+                auto preset = library->getPreset(i);
+                if (preset != nullptr && hashPresetParameters(*preset) == referenceHash) {
+                    reference = preset;
+                    if (savedPreset == referenceIndex) {
+                        restoredPreset = i;
+                    }
+                    break;
+                }
+            }
+        }
+        
+        if (reference == nullptr) {
+            CS_DBG("Reference preset " + juce::String(referenceIndex) + " not found - restoring over defaults");
+        }
+    }
+    
+    auto values = getBaselineValues(reference.get());
+    for (const auto& [parameterId, value] : deltas) {
+        if (auto* param = parameters.getParameter(parameterId)) {
+            values[static_cast<size_t>(param->getParameterIndex())] = juce::jlimit(0.0f, 1.0f, value);
+        } else {
+            CS_DBG("Ignoring unknown parameter in state: " + parameterId);
+        }
+    }
+    applyParameterValues(values);
+    
+    currentPreset = restoredPreset;
+    parameterManager.setCustomMode(isCustom, customName);
+    if (midiProcessor != nullptr) {
+        midiProcessor->setMidiMappings(mappings);
+    }
+    if (partManager != nullptr) {
+        restoreParts(multitimbral, parts, *library);
+    }
+    CS_DBG("Binary state restored - currentPreset: " + juce::String(currentPreset.load()) +
+           ", " + juce::String(static_cast<int>(deltas.size())) + " changed parameters");
+}
+
+void StateManager::readXmlState(const void* data, int sizeInBytes)
+{
     std::unique_ptr<juce::XmlElement> xmlState(juce::AudioProcessor::getXmlFromBinary(data, sizeInBytes));
     
     if (xmlState.get() != nullptr)
@@ -50,8 +317,8 @@ void StateManager::setStateInformation(const void* data, int sizeInBytes)
             
             // Restore preset state
             if (newState.hasProperty("currentPreset")) {
-                currentPreset = newState.getProperty("currentPreset", 7);
-                CS_DBG("Restored currentPreset: " + juce::String(currentPreset));
+                currentPreset = static_cast<int>(newState.getProperty("currentPreset", 7));
+                CS_DBG("Restored currentPreset: " + juce::String(currentPreset.load()));
             }
             
             // Restore custom preset state
@@ -72,36 +339,122 @@ void StateManager::setStateInformation(const void* data, int sizeInBytes)
     }
 }
 
+void StateManager::restoreParts(bool multitimbral, const std::array<PartSettings, PartManager::NumParts>& parts,
+                                const PresetLibrarySnapshot& library)
+{
+    for (int part = 0; part < PartManager::NumParts; ++part) {
+        auto settings = parts[static_cast<size_t>(part)];
+        
+        // The image is what the part plays; the index only names it, and only while it still matches
+        const auto* image = library.getRegisterImage(settings.presetIndex);
+        if (image == nullptr || std::memcmp(image, &settings.image, sizeof(RegisterImage)) != 0) {
+            settings.presetIndex = -1;
+        }
+        if (!partManager->setPart(part, settings)) {
+            CS_DBG("Part " + juce::String(part) + " in state not restored");
+        }
+    }
+    
+    const bool wasEnabled = partManager->isEnabled();
+    partManager->setEnabled(multitimbral);
+    
+    // Back in single mode the periodic update rewrites the operators; the pan needs restoring
+    if (wasEnabled && !multitimbral) {
+        parameterManager.applyGlobalPanToAllChannels();
+    }
+}
+
+std::vector<float> StateManager::getBaselineValues(const Preset* preset) const
+{
+    const auto& allParams = parameters.processor.getParameters();
+    std::vector<float> values;
+    values.reserve(static_cast<size_t>(allParams.size()));
+    for (auto* param : allParams) {
+        values.push_back(param->getDefaultValue());
+    }
+    
+    if (preset != nullptr) {
+        for (const auto& [parameterId, value] : ParameterManager::getPresetParameterValues(*preset)) {
+            if (auto* param = parameters.getParameter(parameterId)) {
+                values[static_cast<size_t>(param->getParameterIndex())] = value;
+            }
+        }
+    }
+    return values;
+}
+
+void StateManager::applyParameterValues(const std::vector<float>& values)
+{
+    // The transaction sets only real changes, so listeners and the host hear about nothing else
+    ParameterManager::Transaction transaction(parameterManager);
+    const auto& allParams = parameters.processor.getParameters();
+    for (int i = 0; i < allParams.size() && i < static_cast<int>(values.size()); ++i) {
+        transaction.set(*allParams[i], values[static_cast<size_t>(i)]);
+    }
+    transaction.commit();
+}
+
+uint64_t StateManager::hashPresetParameters(const Preset& preset)
+{
+    // FNV-1a over the float bits, in getPresetParameterValues() order
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& entry : ParameterManager::getPresetParameterValues(preset)) {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &entry.second, sizeof(bits));
+        for (int i = 0; i < 4; ++i) {
+            hash ^= (bits >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
 // ============================================================================
 // JUCE Program Interface
 // ============================================================================
 
 int StateManager::getNumPrograms()
 {
+    // Removed presets keep their global indices but are not offered to the host.
     // Add 1 for custom preset if active
-    return presetManager.getNumPresets() + (parameterManager.isInCustomMode() ? 1 : 0);
+    return presetManager.getSnapshot()->getNumLivePresets() + (parameterManager.isInCustomMode() ? 1 : 0);
 }
 
 int StateManager::getCurrentProgram()
 {
+    const auto library = presetManager.getSnapshot();
     if (parameterManager.isInCustomMode()) {
-        return presetManager.getNumPresets(); // Custom preset index
+        return library->getNumLivePresets(); // Custom preset program
     }
-    return currentPreset;
+    return juce::jmax(0, library->getProgramForPresetIndex(currentPreset.load()));
 }
 
-void StateManager::setCurrentProgram(int index)
+void StateManager::setCurrentProgram(int program)
 {
-    CS_DBG("setCurrentProgram called with index: " + juce::String(index) + 
+    CS_DBG("setCurrentProgram called with program: " + juce::String(program) + 
         ", current isCustomPreset: " + juce::String(parameterManager.isInCustomMode() ? "true" : "false"));
     
-    // Check if this is the custom preset index
-    if (index == presetManager.getNumPresets() && parameterManager.isInCustomMode()) {
+    const auto library = presetManager.getSnapshot();
+    
+    // Check if this is the custom preset program
+    if (program == library->getNumLivePresets() && parameterManager.isInCustomMode()) {
         // Stay in custom mode, don't change anything
         CS_DBG("Staying in custom preset mode");
         return;
     }
     
+    // Until the library is ready only the factory presets are there
+    if (!presetManager.isLibraryReady() && program >= library->getNumLivePresets()) {
+        pendingProgram = program;
+        CS_DBG("Preset library still loading - program " + juce::String(program) + " queued");
+        return;
+    }
+    
+    setCurrentPreset(library->getPresetIndexForProgram(program));
+}
+
+void StateManager::setCurrentPreset(int index)
+{
     // Validate preset index
     if (!isValidPresetIndex(index)) {
         CS_DBG("Invalid preset index: " + juce::String(index));
@@ -109,25 +462,28 @@ void StateManager::setCurrentProgram(int index)
     }
     
     // Load the preset
+    pendingProgram = -1;
     loadPresetInternal(index, true);
     
-    CS_DBG("setCurrentProgram completed - new currentPreset: " + juce::String(currentPreset));
+    CS_DBG("setCurrentPreset completed - new currentPreset: " + juce::String(currentPreset.load()));
 }
 
-const juce::String StateManager::getProgramName(int index)
+const juce::String StateManager::getProgramName(int program)
 {
+    const auto library = presetManager.getSnapshot();
+    
     // Handle custom preset case
-    if (index == presetManager.getNumPresets() && parameterManager.isInCustomMode()) {
+    if (program == library->getNumLivePresets() && parameterManager.isInCustomMode()) {
         return parameterManager.getCustomPresetName();
     }
     
-    // Validate preset index
-    if (!isValidPresetIndex(index)) {
+    // Validate program number
+    const int index = library->getPresetIndexForProgram(program);
+    if (index < 0) {
         return "Invalid";
     }
     
-    auto preset = presetManager.getPreset(index);
-    return preset ? preset->name : "Unknown";
+    return library->getPresetName(index);
 }
 
 void StateManager::changeProgramName(int index, const juce::String& newName)
@@ -153,14 +509,55 @@ void StateManager::loadPresetInternal(int index, bool updateCurrentPreset)
         return;
     }
     
-    auto preset = presetManager.getPreset(index);
-    if (!preset) {
+    // Register image and preset come from one snapshot, which stays alive while they are used
+    const auto library = presetManager.getSnapshot();
+    const auto* image = library->getRegisterImage(index);
+    if (image == nullptr) {
         CS_DBG("Failed to get preset at index: " + juce::String(index));
         return;
     }
     
-    CS_DBG("Loading preset " + juce::String(index) + ": " + preset->name);
+    CS_DBG("Loading preset " + juce::String(index) + ": " + library->getPresetName(index));
+    
+    // Apply the precompiled register image to the sound generation engine
+    parameterManager.applyRegisterImage(*image);
     
+    // Update current preset tracking
+    if (updateCurrentPreset) {
+        currentPreset = index;
+        hasUnsavedState = false;
+    }
+    
+    if (canSyncParametersNow()) {
+        // The full preset is only expanded here, never off the message thread
+        const auto preset = library->getPreset(index);
+        parameterManager.cancelDeferredParameterSync();
+        syncParametersToPreset(*preset);
+        CS_DBG("Preset loaded successfully: " + preset->name);
+    } else {
+        // Off the message thread (e.g. audio thread): the chip already plays the
+        // preset, the JUCE parameters follow when the timer sees the pending index
+        parameterManager.beginDeferredParameterSync(index);
+    }
+}
+
+void StateManager::applyStagedProgram(int index, const RegisterImage& image)
+{
+    // No snapshot and no logging: this runs for MIDI program changes on the audio thread
+    parameterManager.applyRegisterImage(image);
+    currentPreset = index;
+    hasUnsavedState = false;
+    
+    // The periodic parameter update leaves the chip alone until the parameters have caught up.
+    // Nothing here may lock or post a message; the timer picks up the pending index.
+    parameterManager.beginDeferredParameterSync(index);
+    if (canSyncParametersNow()) {
+        dispatchPendingParameterSync();
+    }
+}
+
+void StateManager::syncParametersToPreset(const Preset& preset)
+{
     // Backup current state before loading (for potential undo)
     lastSavedState = parameters.copyState();
     
@@ -168,21 +565,57 @@ void StateManager::loadPresetInternal(int index, bool updateCurrentPreset)
     float preservedGlobalPan = 0.0f;
     
     // Load preset parameters through ParameterManager
-    parameterManager.loadPresetParameters(preset, preservedGlobalPan);
-    
-    // Apply preset to sound generation engine
-    parameterManager.applyPresetToYmfm(preset);
+    parameterManager.loadPresetParameters(&preset, preservedGlobalPan);
     
     // Exit custom mode when loading factory preset
     parameterManager.setCustomMode(false);
+}
+
+bool StateManager::canSyncParametersNow()
+{
+    // Without a message loop (command-line tools, tests) there is nowhere to defer to
+    auto* messageManager = juce::MessageManager::getInstanceWithoutCreating();
+    return messageManager == nullptr || messageManager->isThisTheMessageThread();
+}
+
+void StateManager::timerCallback()
+{
+    dispatchPendingParameterSync();
+}
+
+void StateManager::dispatchPendingParameterSync()
+{
+    const int index = parameterManager.getPendingParameterSync();
+    if (index < 0) {
+        return;
+    }
     
-    // Update current preset tracking
-    if (updateCurrentPreset) {
-        currentPreset = index;
-        hasUnsavedState = false;
+    if (isValidPresetIndex(index)) {
+        const auto library = presetManager.getSnapshot();
+        if (auto preset = library->getPreset(index)) {
+            syncParametersToPreset(*preset);
+            CS_DBG("Deferred parameter sync completed: " + preset->name);
+        }
+    }
+    
+    // A newer preset change re-arms the pending index for the next timer tick
+    parameterManager.completeDeferredParameterSync(index);
+}
+
+void StateManager::handlePresetLibraryReady()
+{
+    if (!pendingState.isEmpty()) {
+        juce::MemoryBlock state;
+        state.swapWith(pendingState);
+        setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+    }
+    
+    const int program = pendingProgram.exchange(-1);
+    if (program >= 0) {
+        setCurrentProgram(program);
     }
     
-    CS_DBG("Preset loaded successfully: " + preset->name);
+    CS_DBG("Preset library ready - pending requests applied");
 }
 
 void StateManager::saveCurrentState()
@@ -2,11 +2,16 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "../core/PresetManagerInterface.h"
+#include "PartManager.h"
+#include <array>
+#include <atomic>
+#include <vector>
 
 namespace ymulatorsynth {
 
 // Forward declarations
 class ParameterManager;
+class MidiProcessor;
 
 /**
  * Handles all plugin state management and preset operations.
@@ -20,7 +25,7 @@ class ParameterManager;
  * This class extracts state management logic from PluginProcessor
  * to improve separation of concerns and testability.
  */
-class StateManager {
+class StateManager : private juce::Timer {
 public:
     /**
      * Construct StateManager with required dependencies.
@@ -32,41 +37,117 @@ public:
                 PresetManagerInterface& presetManager,
                 ParameterManager& parameterManager);
     
-    ~StateManager() = default;
+    ~StateManager() override;
     
     // JUCE AudioProcessor interface implementation
     void getStateInformation(juce::MemoryBlock& destData);
     void setStateInformation(const void* data, int sizeInBytes);
     
-    // JUCE program interface implementation
+    // JUCE program interface implementation. Programs number the presets that
+    // are still in the library (see PresetLibrarySnapshot::getPresetIndexForProgram);
+    // everything else works in global preset indices.
     int getNumPrograms();
     int getCurrentProgram();
-    void setCurrentProgram(int index);
-    const juce::String getProgramName(int index);
+    void setCurrentProgram(int program);
+    const juce::String getProgramName(int program);
     void changeProgramName(int index, const juce::String& newName);
     
+    /** setCurrentProgram() by global preset index (UI, banks, SysEx); replaces a queued program */
+    void setCurrentPreset(int index);
+    
     // State management utilities
     void loadPreset(int index);
+    
+    /**
+     * Switches to a preset whose register image is already at hand (MIDI
+     * program change, see MidiProgramSelector). Real-time safe: the image is
+     * written to the chip at once and the JUCE parameters follow on the
+     * message thread.
+     * @param index Global preset index the image was compiled from
+     * @param image The preset's register image
+     */
+    void applyStagedProgram(int index, const RegisterImage& image);
     void saveCurrentState();
     void restoreLastState();
     
     // Preset state queries
     bool hasUnsavedChanges() const;
-    int getCurrentPresetIndex() const { return currentPreset; }
+    int getCurrentPresetIndex() const { return currentPreset.load(); }
+    
+    /**
+     * Applies the state and program change that arrived while the preset
+     * library was still loading (see PresetManager::initializeAsync).
+     * Message thread only.
+     */
+    void handlePresetLibraryReady();
+    
+    /** Saves and restores the processor's learned MIDI mappings with the state; nullptr leaves them out */
+    void setMidiProcessor(MidiProcessor* processor) { midiProcessor = processor; }
+    
+    /** Saves and restores the multitimbral mode and its parts with the state; nullptr leaves them out */
+    void setPartManager(PartManager* manager) { partManager = manager; }
     
 private:
     // Dependencies
     juce::AudioProcessorValueTreeState& parameters;
     PresetManagerInterface& presetManager;
     ParameterManager& parameterManager;
+    MidiProcessor* midiProcessor = nullptr;
+    PartManager* partManager = nullptr;
     
-    // Current state tracking
-    int currentPreset{7}; // Default to init preset (index 7)
-    bool hasUnsavedState{false};
+    // Current state tracking; MIDI program changes write these on the audio thread
+    std::atomic<int> currentPreset{7}; // Default to init preset (index 7)
+    std::atomic<bool> hasUnsavedState{false};
     
     // State backup for undo functionality
     juce::ValueTree lastSavedState;
     
+    // Requests that need presets the library has not loaded yet
+    juce::MemoryBlock pendingState;          // message thread only
+    std::atomic<int> pendingProgram { -1 };
+    
+    /**
+     * Compact binary state (little endian):
+     *   "YMST" | uint32 version | int32 current preset | uint8 flags | custom preset name
+     *   | int32 reference preset | int64 reference hash | uint16 delta count
+     *   | (parameter ID, float normalized value) per delta
+     *   | uint16 mapping count | (uint8 CC, parameter ID) per learned MIDI mapping
+     *   | uint8 flags (bit 0 = multitimbral mode) | uint8 part count
+     *   | (int8 MIDI channel, uint8 channel mask, uint8 low/high note, uint8 low/high
+     *      velocity, float volume, float pan, int32 preset index, register image) per part
+     *
+     * Parameters are stored only where they differ from the reference preset
+     * (or from their defaults when there is none). Only factory presets are
+     * references; any other preset may be gone when the session is reloaded.
+     * The hash identifies the preset's parameter values, so the reference can
+     * be found again after the library has changed. A part stores its register
+     * image, so it plays the same even if its preset is gone. Sessions saved
+     * as XML are still read, as are version 1 states, which have no MIDI
+     * mappings, and version 2 states, which have no parts.
+     */
+    static constexpr juce::uint32 BinaryStateMagic = 0x54534d59;  // "YMST"
+    static constexpr juce::uint32 BinaryStateVersion = 3;
+    
+    void writeBinaryState(juce::MemoryBlock& destData);
+    void readBinaryState(const void* data, int sizeInBytes);
+    void readXmlState(const void* data, int sizeInBytes);
+    
+    /**
+     * Normalized value of every processor parameter after loading a preset
+     * @param preset Reference preset, or nullptr for the parameter defaults
+     */
+    std::vector<float> getBaselineValues(const Preset* preset) const;
+    
+    /** Sets the parameters that do not already hold the given normalized values */
+    void applyParameterValues(const std::vector<float>& values);
+    
+    /** Sets every part and the multitimbral mode from a restored state */
+    void restoreParts(bool multitimbral, const std::array<PartSettings, PartManager::NumParts>& parts,
+                      const PresetLibrarySnapshot& library);
+    
+    /** Hash of the parameter values a preset loads (see ParameterManager::getPresetParameterValues) */
+    static uint64_t hashPresetParameters(const Preset& preset);
+    
     /**
      * Internal helper to load preset and update state tracking.
      * @param index Preset index to load
@@ -74,6 +155,25 @@ private:
      */
     void loadPresetInternal(int index, bool updateCurrentPreset = true);
     
+    /**
+     * Loads a preset's values into the JUCE parameters (message thread).
+     * @param preset Preset already applied to the chip
+     */
+    void syncParametersToPreset(const Preset& preset);
+    
+    /**
+     * @return true if parameters can be set from the calling thread
+     */
+    static bool canSyncParametersNow();
+    
+    /**
+     * Completes a parameter sync deferred by an audio-thread preset change.
+     * The audio thread only sets ParameterManager's pending index; the timer
+     * polls it, like MidiProcessor's CC-to-host sync. Message thread only.
+     */
+    void dispatchPendingParameterSync();
+    void timerCallback() override;
+    
     /**
      * Update state tracking after parameter changes.
      */
@@ -0,0 +1,172 @@
+#include "SysExReceiver.h"
+#include "../utils/PresetManager.h"
+#include "../utils/SysExVoiceDump.h"
+#include "../utils/Debug.h"
+#include <cstring>
+
+namespace ymulatorsynth {
+
+SysExReceiver::SysExReceiver(PresetManagerInterface& presetManager)
+    : juce::Thread("SysEx dump parsing")
+    , presetManager(presetManager)
+    , ring(static_cast<size_t>(BufferSize))
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+SysExReceiver::~SysExReceiver()
+{
+    cancelPendingUpdate();
+    stopThread(2000);
+}
+
+// ============================================================================
+// Audio Thread
+// ============================================================================
+
+bool SysExReceiver::push(const uint8_t* data, int size)
+{
+    if (!SysExVoiceDump::isYMulatorMessage(data, size)) {
+        return false;
+    }
+
+    if (fifo.getFreeSpace() < size + LengthPrefixSize) {
+        numDropped.fetch_add(1);
+        return false;
+    }
+
+    // Length prefix and message in one write, so the reader never sees half of it
+    const auto length = static_cast<int32_t>(size);
+    const auto copy = [this, &length, data](int start, int count, int offset) {
+        for (int i = 0; i < count; ++i) {
+            const int position = offset + i;
+            ring[static_cast<size_t>(start + i)] = position < LengthPrefixSize
+                ? reinterpret_cast<const uint8_t*>(&length)[position]
+                : data[position - LengthPrefixSize];
+        }
+    };
+    {
+        const auto write = fifo.write(size + LengthPrefixSize);
+        copy(write.startIndex1, write.blockSize1, 0);
+        copy(write.startIndex2, write.blockSize2, write.blockSize1);
+    }
+
+    numQueued.fetch_add(1);
+    return true;
+}
+
+// ============================================================================
+// Parsing Thread
+// ============================================================================
+
+void SysExReceiver::readFromRing(uint8_t* destination, int size)
+{
+    const auto read = fifo.read(size);
+    if (read.blockSize1 > 0) {
+        std::memcpy(destination, ring.data() + read.startIndex1, static_cast<size_t>(read.blockSize1));
+    }
+    if (read.blockSize2 > 0) {
+        std::memcpy(destination + read.blockSize1, ring.data() + read.startIndex2, static_cast<size_t>(read.blockSize2));
+    }
+}
+
+void SysExReceiver::run()
+{
+    std::vector<uint8_t> message;
+    message.reserve(static_cast<size_t>(BufferSize));
+
+    while (!threadShouldExit()) {
+        while (fifo.getNumReady() >= LengthPrefixSize) {
+            int32_t length = 0;
+            readFromRing(reinterpret_cast<uint8_t*>(&length), LengthPrefixSize);
+            message.resize(static_cast<size_t>(length));
+            readFromRing(message.data(), length);
+
+            parseMessage(message);
+            numQueued.fetch_sub(1);
+        }
+        wait(PollIntervalMs);
+    }
+}
+
+void SysExReceiver::parseMessage(const std::vector<uint8_t>& message)
+{
+    auto result = SysExVoiceDump::parse(message.data(), static_cast<int>(message.size()));
+    if (!result.isValid) {
+        numRejected.fetch_add(1);
+        CS_DBG("Rejected SysEx dump: " + result.error);
+        return;
+    }
+    for (const auto& warning : result.warnings) {
+        CS_DBG("SysEx dump: " + warning);
+    }
+
+    // Same conversion as an imported bank
+    ReceivedDump dump;
+    dump.isBank = result.voices.size() > 1 || result.type == SysExVoiceDump::Type::Bank;
+    dump.presets.reserve(result.voices.size());
+    for (const auto& voice : result.voices) {
+        dump.presets.push_back(Preset::fromVOPM(voice));
+        PresetManager::validatePreset(dump.presets.back());
+    }
+
+    {
+        const juce::ScopedLock sl(receivedLock);
+        received.push_back(std::move(dump));
+    }
+    numReceived.fetch_add(1);
+    triggerAsyncUpdate();
+}
+
+bool SysExReceiver::waitUntilParsed(int timeoutMs) const
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMs);
+    while (numQueued.load() > 0) {
+        if (juce::Time::getMillisecondCounter() >= deadline) {
+            return false;
+        }
+        juce::Thread::sleep(1);
+    }
+    return true;
+}
+
+// ============================================================================
+// Message Thread
+// ============================================================================
+
+void SysExReceiver::dispatchPendingUpdates()
+{
+    cancelPendingUpdate();
+    handleAsyncUpdate();
+}
+
+void SysExReceiver::handleAsyncUpdate()
+{
+    std::vector<ReceivedDump> dumps;
+    {
+        const juce::ScopedLock sl(receivedLock);
+        dumps.swap(received);
+    }
+
+    for (auto& dump : dumps) {
+        int index = -1;
+        if (dump.isBank) {
+            index = presetManager.addReceivedPresets("SysEx Bank " + juce::String(++numBanks), dump.presets);
+        } else if (!dump.presets.empty()) {
+            // Saved with the user presets, so a session that selects it can find it again.
+            // addUserPreset appends, so the voice is the last preset in the library.
+            const int numBefore = presetManager.getNumPresets();
+            if (!presetManager.addUserPreset(dump.presets.front())) {
+                CS_DBG("Received voice could not be written to the user presets");
+            }
+            if (presetManager.getNumPresets() > numBefore) {
+                index = presetManager.getNumPresets() - 1;
+            }
+        }
+        if (index >= 0 && onDumpReceived) {
+            onDumpReceived(index, !dump.isBank);
+        }
+    }
+}
+
+} // namespace ymulatorsynth
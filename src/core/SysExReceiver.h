@@ -0,0 +1,108 @@
+#pragma once
+
+#include "PresetManagerInterface.h"
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace ymulatorsynth {
+
+struct Preset;
+
+/**
+ * Receives YMulator voice and bank dumps (see SysExVoiceDump) without
+ * disturbing the audio thread.
+ *
+ * The audio thread only checks the message header and copies the bytes into
+ * a preallocated ring buffer; if the buffer is full the message is dropped
+ * and counted, never waited for. It does not wake the parser either, since
+ * that takes a lock; the parser polls the buffer every PollIntervalMs.
+ * The background thread parses, checksums and
+ * validates the dumps through SysExVoiceDump and VOPMParser and converts them
+ * to presets. The message thread then adds each dump to the library in one
+ * update, so a 128-voice bank appears in a single snapshot.
+ *
+ * A single voice is saved to the User bank like any user preset, so a
+ * session that plays it (onDumpReceived selects it straight away) finds it
+ * again on reload. Each bank dump becomes a bank of its own, "SysEx Bank 1",
+ * "SysEx Bank 2" and so on. Received banks are not backed by files and last
+ * for the session.
+ */
+class SysExReceiver : private juce::Thread,
+                      private juce::AsyncUpdater
+{
+public:
+    /** Ring buffer size; holds a 128-voice OPM text dump */
+    static constexpr int BufferSize = 128 * 1024;
+
+    /** How often the parsing thread looks for queued messages */
+    static constexpr int PollIntervalMs = 10;
+
+    explicit SysExReceiver(PresetManagerInterface& presetManager);
+    ~SysExReceiver() override;
+
+    // Audio thread
+
+    /**
+     * Queues a complete SysEx message, F0 to F7, if it is a YMulator dump.
+     * @return true if it was queued
+     */
+    bool push(const uint8_t* data, int size);
+
+    // Message thread
+
+    /** Called after each dump is added, with the global index of its first preset */
+    std::function<void(int firstPresetIndex, bool isSingleVoice)> onDumpReceived;
+
+    /** Adds converted dumps to the library now instead of waiting for the message loop */
+    void dispatchPendingUpdates();
+
+    // Any thread
+
+    /** Blocks until every queued message has been parsed; for tests and tools */
+    bool waitUntilParsed(int timeoutMs) const;
+
+    int getNumReceived() const { return numReceived.load(); }
+    int getNumRejected() const { return numRejected.load(); }
+    int getNumDropped() const { return numDropped.load(); }
+
+private:
+    /** A parsed dump on its way to the message thread */
+    struct ReceivedDump {
+        bool isBank = false;
+        std::vector<Preset> presets;
+    };
+
+    static constexpr int LengthPrefixSize = static_cast<int>(sizeof(int32_t));
+
+    // juce::Thread
+    void run() override;
+
+    // juce::AsyncUpdater
+    void handleAsyncUpdate() override;
+
+    void readFromRing(uint8_t* destination, int size);
+    void parseMessage(const std::vector<uint8_t>& message);
+
+    PresetManagerInterface& presetManager;
+
+    // Written by the audio thread, read by the parsing thread
+    juce::AbstractFifo fifo { BufferSize };
+    std::vector<uint8_t> ring;
+    std::atomic<int> numQueued { 0 };
+
+    // Parsing thread to message thread
+    juce::CriticalSection receivedLock;
+    std::vector<ReceivedDump> received;
+
+    int numBanks = 0;   // message thread
+    std::atomic<int> numReceived { 0 };
+    std::atomic<int> numRejected { 0 };
+    std::atomic<int> numDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SysExReceiver)
+};
+
+} // namespace ymulatorsynth
@@ -96,6 +96,48 @@ void VoiceManager::releaseAllVoices()
     CS_DBG(" Released all voices");
 }
 
+int VoiceManager::allocateVoiceInPool(uint8_t note, uint8_t velocity, uint8_t channelMask)
+{
+    CS_ASSERT_NOTE(note);
+    CS_ASSERT_VELOCITY(velocity);
+    
+    // The same note retriggers only within the pool; other parts keep theirs
+    int channel = getChannelForNoteInPool(note, channelMask);
+    if (channel < 0) {
+        channel = findAvailableVoiceInPool(channelMask);
+        if (channel < 0) {
+            return -1;
+        }
+    }
+    
+    auto& voice = voices[static_cast<size_t>(channel)];
+    voice.active = true;
+    voice.note = note;
+    voice.velocity = velocity;
+    voice.timestamp = ++currentTimestamp;
+    
+    CS_DBG(" Allocated note " + juce::String(note) + " to channel " + juce::String(channel) +
+           " (pool 0x" + juce::String::toHexString(channelMask) + ")");
+    return channel;
+}
+
+int VoiceManager::getChannelForNoteInPool(uint8_t note, uint8_t channelMask) const
+{
+    CS_ASSERT_NOTE(note);
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        if (((channelMask >> i) & 1) && voices[static_cast<size_t>(i)].active && voices[static_cast<size_t>(i)].note == note) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void VoiceManager::releaseChannel(int channel)
+{
+    if (channel < 0 || channel >= MAX_VOICES) return;
+    voices[static_cast<size_t>(channel)].active = false;
+}
+
 bool VoiceManager::isVoiceActive(int channel) const
 {
     if (channel < 0 || channel >= MAX_VOICES) return false;
@@ -127,24 +169,38 @@ int VoiceManager::getChannelForNote(uint8_t note) const
 
 int VoiceManager::findAvailableVoice()
 {
+    return findAvailableVoiceInPool(ALL_CHANNELS);
+}
+
+int VoiceManager::findAvailableVoiceInPool(uint8_t channelMask)
+{
+    const auto inPool = [channelMask](int channel) { return (channelMask >> channel) & 1; };
+    
     // First, look for an inactive voice, starting from channel 7 (noise-capable)
     // This prioritizes noise-capable channel 7 for rhythm instruments
+    int victimChannel = -1;
     for (int i = MAX_VOICES - 1; i >= 0; --i) {
+        if (!inPool(i)) {
+            continue;
+        }
         CS_FILE_DBG("Checking voice " + juce::String(i) + " - active: " + juce::String(voices[static_cast<size_t>(i)].active ? "true" : "false"));
         if (!voices[static_cast<size_t>(i)].active) {
             CS_FILE_DBG("Found available voice: " + juce::String(i));
             return i;
         }
+        victimChannel = i;  // ends on the lowest channel in the pool
     }
     
-    // All voices are active, need to steal one
-    int victimChannel = 0;
+    if (victimChannel < 0) {
+        return -1;  // empty pool
+    }
     
+    // All voices are active, need to steal one
     switch (stealingPolicy) {
         case StealingPolicy::OLDEST:
             // Find the voice with the smallest timestamp
-            for (int i = 1; i < MAX_VOICES; ++i) {
-                if (voices[static_cast<size_t>(i)].timestamp < voices[victimChannel].timestamp) {
+            for (int i = victimChannel + 1; i < MAX_VOICES; ++i) {
+                if (inPool(i) && voices[static_cast<size_t>(i)].timestamp < voices[static_cast<size_t>(victimChannel)].timestamp) {
                     victimChannel = i;
                 }
             }
@@ -153,8 +209,8 @@ int VoiceManager::findAvailableVoice()
             
         case StealingPolicy::QUIETEST:
             // Find the voice with the lowest velocity
-            for (int i = 1; i < MAX_VOICES; ++i) {
-                if (voices[static_cast<size_t>(i)].velocity < voices[victimChannel].velocity) {
+            for (int i = victimChannel + 1; i < MAX_VOICES; ++i) {
+                if (inPool(i) && voices[static_cast<size_t>(i)].velocity < voices[static_cast<size_t>(victimChannel)].velocity) {
                     victimChannel = i;
                 }
             }
@@ -163,8 +219,8 @@ int VoiceManager::findAvailableVoice()
             
         case StealingPolicy::LOWEST:
             // Find the voice with the lowest note
-            for (int i = 1; i < MAX_VOICES; ++i) {
-                if (voices[static_cast<size_t>(i)].note < voices[victimChannel].note) {
+            for (int i = victimChannel + 1; i < MAX_VOICES; ++i) {
+                if (inPool(i) && voices[static_cast<size_t>(i)].note < voices[static_cast<size_t>(victimChannel)].note) {
                     victimChannel = i;
                 }
             }
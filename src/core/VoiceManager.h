@@ -15,6 +15,7 @@ class VoiceManager : public VoiceManagerInterface
 {
 public:
     static constexpr int MAX_VOICES = 8;  // YM2151 has 8 channels
+    static constexpr uint8_t ALL_CHANNELS = 0xFF;
     
     VoiceManager();
     ~VoiceManager() override = default;
@@ -25,6 +26,11 @@ public:
     void releaseVoice(uint8_t note) override;
     void releaseAllVoices() override;
     
+    // Channel pools
+    int allocateVoiceInPool(uint8_t note, uint8_t velocity, uint8_t channelMask) override;
+    int getChannelForNoteInPool(uint8_t note, uint8_t channelMask) const override;
+    void releaseChannel(int channel) override;
+    
     // Voice state queries
     bool isVoiceActive(int channel) const override;
     uint8_t getNoteForChannel(int channel) const override;
@@ -51,5 +57,6 @@ private:
     
     // Find a free voice or steal one according to policy
     int findAvailableVoice();
+    int findAvailableVoiceInPool(uint8_t channelMask);
     int findAvailableVoiceWithNoisePriority(bool needsNoise);
 };
\ No newline at end of file
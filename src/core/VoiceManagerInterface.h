@@ -17,6 +17,11 @@ public:
     virtual void releaseVoice(uint8_t note) = 0;
     virtual void releaseAllVoices() = 0;
     
+    // Channel pools (multitimbral parts): bit N of channelMask allows channel N
+    virtual int allocateVoiceInPool(uint8_t note, uint8_t velocity, uint8_t channelMask) = 0;
+    virtual int getChannelForNoteInPool(uint8_t note, uint8_t channelMask) const = 0;
+    virtual void releaseChannel(int channel) = 0;
+    
     // Voice state queries
     virtual bool isVoiceActive(int channel) const = 0;
     virtual uint8_t getNoteForChannel(int channel) const = 0;
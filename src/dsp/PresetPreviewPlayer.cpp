@@ -0,0 +1,48 @@
+#include "PresetPreviewPlayer.h"
+
+namespace ymulatorsynth {
+
+void PresetPreviewPlayer::play(std::shared_ptr<const PresetPreview> preview, float gain)
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(lock);
+        std::swap(current, preview);
+        position = 0;
+        currentGain = gain;
+        playing = current != nullptr && !current->samples.empty();
+    }
+    // The previous preview (now in 'preview') is released here, outside the lock
+}
+
+void PresetPreviewPlayer::stop()
+{
+    play(nullptr);
+}
+
+void PresetPreviewPlayer::renderNextBlock(float* left, float* right, int numSamples)
+{
+    if (!playing.load())
+        return;
+
+    const juce::SpinLock::ScopedTryLockType sl(lock);
+    if (!sl.isLocked() || current == nullptr)
+        return;  // A new preview is being swapped in; it starts with the next block
+
+    const auto& samples = current->samples;
+    const int count = static_cast<int>(juce::jmin(static_cast<size_t>(numSamples), samples.size() - position));
+    const float scale = currentGain / 32768.0f;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const float sample = static_cast<float>(samples[position + static_cast<size_t>(i)]) * scale;
+        left[i] += sample;
+        if (right != left)
+            right[i] += sample;
+    }
+
+    position += static_cast<size_t>(count);
+    if (position >= samples.size())
+        playing = false;
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PresetPreviewRenderer.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+
+namespace ymulatorsynth {
+
+/**
+ * PresetPreviewPlayer - Plays a cached preview on top of the live output
+ *
+ * play() and stop() are called from the message thread or a render thread;
+ * renderNextBlock() from the audio thread. The audio thread only try-locks
+ * and never releases a preview, so it cannot block or free memory.
+ */
+class PresetPreviewPlayer
+{
+public:
+    static constexpr float DefaultGain = 0.8f;
+
+    void play(std::shared_ptr<const PresetPreview> preview, float gain = DefaultGain);
+    void stop();
+    bool isPlaying() const { return playing.load(); }
+
+    /** Adds the next samples to the buffers (audio thread) */
+    void renderNextBlock(float* left, float* right, int numSamples);
+
+private:
+    juce::SpinLock lock;
+    std::shared_ptr<const PresetPreview> current;
+    size_t position = 0;
+    float currentGain = DefaultGain;
+    std::atomic<bool> playing { false };
+};
+
+} // namespace ymulatorsynth
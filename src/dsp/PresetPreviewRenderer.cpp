@@ -0,0 +1,286 @@
+#include "PresetPreviewRenderer.h"
+#include "YmfmWrapper.h"
+#include "utils/Debug.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr juce::uint32 FileMagic = 0x56504d59;  // "YMPV"
+    constexpr juce::uint32 FileVersion = 1;
+    constexpr int RenderBlockSize = 512;
+    constexpr int SilenceThreshold = 2;             // in 16-bit steps
+
+    uint64_t fnv1a(uint64_t hash, const uint8_t* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t fnv1a(uint64_t hash, int64_t value)
+    {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i)
+            bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+        return fnv1a(hash, bytes, sizeof(bytes));
+    }
+}
+
+PresetPreviewRenderer::PresetPreviewRenderer(const juce::File& directory, const PreviewSettings& previewSettings)
+    : cacheDirectory(directory),
+      settings(previewSettings),
+      pool(std::make_unique<juce::ThreadPool>(juce::jmax(1, juce::SystemStats::getNumCpus() - 1), 0,
+                                              juce::Thread::Priority::low))
+{
+}
+
+PresetPreviewRenderer::~PresetPreviewRenderer()
+{
+    cancelPendingRenders();
+    pool.reset();
+}
+
+uint64_t PresetPreviewRenderer::makeKey(const RegisterImage& image, const PreviewSettings& settings)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, &image.operators[0][0], sizeof(image.operators));
+    const uint8_t channelAndGlobals[] = {
+        image.connection, image.amsPms, image.lfoRate, image.lfoAmd, image.lfoPmd, image.lfoWaveform, image.noise
+    };
+    hash = fnv1a(hash, channelAndGlobals, sizeof(channelAndGlobals));
+    hash = fnv1a(hash, settings.note);
+    hash = fnv1a(hash, settings.velocity);
+    hash = fnv1a(hash, settings.holdMs);
+    hash = fnv1a(hash, settings.releaseMs);
+    hash = fnv1a(hash, static_cast<int64_t>(std::lround(settings.sampleRate)));
+    return hash;
+}
+
+std::shared_ptr<PresetPreview> PresetPreviewRenderer::render(const RegisterImage& image, const PreviewSettings& settings)
+{
+    // A private chip for this render only
+    YmfmWrapper chip;
+    chip.initialize(YmfmWrapperInterface::ChipType::OPM, static_cast<uint32_t>(std::lround(settings.sampleRate)));
+    chip.applyRegisterImageGlobals(image);
+    chip.applyRegisterImage(0, image);
+
+    auto preview = std::make_shared<PresetPreview>();
+    preview->key = makeKey(image, settings);
+    preview->sampleRate = settings.sampleRate;
+
+    const auto msToSamples = [&settings](int ms) { return static_cast<int>(settings.sampleRate * ms / 1000.0); };
+    const int holdSamples = msToSamples(settings.holdMs);
+    const int totalSamples = holdSamples + msToSamples(settings.releaseMs);
+    preview->samples.resize(static_cast<size_t>(juce::jmax(0, totalSamples)));
+
+    float left[RenderBlockSize];
+    float right[RenderBlockSize];
+
+    chip.noteOn(0, static_cast<uint8_t>(juce::jlimit(0, 127, settings.note)),
+                static_cast<uint8_t>(juce::jlimit(1, 127, settings.velocity)));
+
+    for (int position = 0; position < totalSamples;)
+    {
+        if (position == holdSamples)
+            chip.noteOff(0, static_cast<uint8_t>(juce::jlimit(0, 127, settings.note)));
+
+        // Blocks end at key-off so that it lands on the exact sample
+        const int blockEnd = position < holdSamples ? holdSamples : totalSamples;
+        const int numSamples = juce::jmin(RenderBlockSize, blockEnd - position);
+        chip.generateSamples(left, right, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float mono = (left[i] + right[i]) * 0.5f * 32767.0f;
+            preview->samples[static_cast<size_t>(position + i)] = static_cast<int16_t>(juce::jlimit(-32768.0f, 32767.0f, mono));
+        }
+        position += numSamples;
+    }
+
+    // The release usually dies out well before the end
+    auto lastAudible = std::find_if(preview->samples.rbegin(), preview->samples.rend(),
+                                    [](int16_t sample) { return std::abs(sample) >= SilenceThreshold; });
+    preview->samples.erase(lastAudible.base(), preview->samples.end());
+    preview->samples.shrink_to_fit();
+    return preview;
+}
+
+std::shared_ptr<const PresetPreview> PresetPreviewRenderer::getCachedPreview(const RegisterImage& image)
+{
+    const auto key = makeKey(image, settings);
+    if (auto preview = findInMemory(key))
+        return preview;
+
+    auto preview = loadFromDisk(key);
+    if (preview)
+        remember(preview);
+    return preview;
+}
+
+void PresetPreviewRenderer::requestPreview(const RegisterImage& image, Callback callback)
+{
+    if (auto preview = getCachedPreview(image))
+    {
+        if (callback)
+            callback(std::move(preview));
+        return;
+    }
+
+    queueRender(makeKey(image, settings), image, std::move(callback));
+}
+
+void PresetPreviewRenderer::renderMissing(const std::vector<RegisterImage>& images)
+{
+    int queued = 0;
+    for (const auto& image : images)
+    {
+        const auto key = makeKey(image, settings);
+        if (getCacheFile(key).existsAsFile())
+            continue;
+
+        queueRender(key, image, nullptr);
+        ++queued;
+    }
+    CS_DBG("Queued " + juce::String(queued) + " preset previews for rendering");
+}
+
+void PresetPreviewRenderer::cancelPendingRenders()
+{
+    pool->removeAllJobs(false, 0);
+
+    // Waiting callbacks are dropped; a render that is already running still stores its preview
+    const juce::ScopedLock sl(lock);
+    inFlight.clear();
+}
+
+int PresetPreviewRenderer::getNumPendingRenders() const
+{
+    return pool->getNumJobs();
+}
+
+juce::File PresetPreviewRenderer::getCacheFile(uint64_t key) const
+{
+    return cacheDirectory.getChildFile(juce::String::toHexString(static_cast<juce::int64>(key)).paddedLeft('0', 16) + ".ympv");
+}
+
+std::shared_ptr<const PresetPreview> PresetPreviewRenderer::findInMemory(uint64_t key)
+{
+    const juce::ScopedLock sl(lock);
+    auto it = memoryCache.find(key);
+    if (it == memoryCache.end())
+        return nullptr;
+
+    // A hit counts as a use, so the previews being auditioned stay in memory
+    memoryOrder.erase(std::find(memoryOrder.begin(), memoryOrder.end(), key));
+    memoryOrder.push_back(key);
+    return it->second;
+}
+
+std::shared_ptr<const PresetPreview> PresetPreviewRenderer::loadFromDisk(uint64_t key)
+{
+    juce::FileInputStream stream(getCacheFile(key));
+    if (!stream.openedOk())
+        return nullptr;
+
+    if (static_cast<juce::uint32>(stream.readInt()) != FileMagic || static_cast<juce::uint32>(stream.readInt()) != FileVersion)
+        return nullptr;
+
+    auto preview = std::make_shared<PresetPreview>();
+    preview->key = key;
+    preview->sampleRate = static_cast<double>(static_cast<juce::uint32>(stream.readInt()));
+    const auto numSamples = static_cast<juce::uint32>(stream.readInt());
+
+    if (stream.getNumBytesRemaining() != static_cast<juce::int64>(numSamples) * 2)
+        return nullptr;  // truncated or foreign file; it gets rendered again
+
+    preview->samples.resize(numSamples);
+    if (numSamples > 0)
+        stream.read(preview->samples.data(), static_cast<int>(numSamples * 2));
+
+   #if JUCE_BIG_ENDIAN
+    for (auto& sample : preview->samples)
+        sample = static_cast<int16_t>(juce::ByteOrder::swap(static_cast<juce::uint16>(sample)));
+   #endif
+    return preview;
+}
+
+bool PresetPreviewRenderer::saveToDisk(const PresetPreview& preview) const
+{
+    if (!cacheDirectory.createDirectory())
+        return false;
+
+    const auto file = getCacheFile(preview.key);
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream stream(temp.getFile());
+        if (!stream.openedOk())
+            return false;
+
+        stream.writeInt(static_cast<int>(FileMagic));
+        stream.writeInt(static_cast<int>(FileVersion));
+        stream.writeInt(static_cast<int>(std::lround(preview.sampleRate)));
+        stream.writeInt(static_cast<int>(preview.samples.size()));
+        for (const auto sample : preview.samples)
+            stream.writeShort(sample);
+
+        stream.flush();
+        if (stream.getStatus().failed())
+            return false;
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void PresetPreviewRenderer::remember(const std::shared_ptr<const PresetPreview>& preview)
+{
+    const juce::ScopedLock sl(lock);
+    if (!memoryCache.emplace(preview->key, preview).second)
+        return;
+
+    memoryOrder.push_back(preview->key);
+    while (static_cast<int>(memoryOrder.size()) > MaxPreviewsInMemory)
+    {
+        memoryCache.erase(memoryOrder.front());
+        memoryOrder.pop_front();
+    }
+}
+
+void PresetPreviewRenderer::queueRender(uint64_t key, const RegisterImage& image, Callback callback)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        auto [it, isNew] = inFlight.try_emplace(key);
+        if (callback)
+            it->second.push_back(std::move(callback));
+        if (!isNew)
+            return;  // The queued render delivers to every waiting callback
+    }
+
+    pool->addJob([this, key, image]()
+    {
+        std::shared_ptr<const PresetPreview> preview = render(image, settings);
+        if (!saveToDisk(*preview))
+            CS_DBG("Could not store preset preview " + getCacheFile(key).getFileName());
+        remember(preview);
+
+        std::vector<Callback> callbacks;
+        {
+            const juce::ScopedLock sl(lock);
+            auto it = inFlight.find(key);
+            if (it != inFlight.end())
+            {
+                callbacks.swap(it->second);
+                inFlight.erase(it);
+            }
+        }
+
+        for (auto& callback : callbacks)
+            callback(preview);
+    });
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "RegisterImage.h"
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace ymulatorsynth {
+
+/**
+ * How previews are played: one note on channel 0, held and then released
+ */
+struct PreviewSettings
+{
+    int note = 60;            // MIDI note
+    int velocity = 100;       // passed to noteOn like a live note
+    int holdMs = 800;         // key-on time
+    int releaseMs = 400;      // rendered after key-off
+    double sampleRate = 44100.0;
+};
+
+/**
+ * A rendered preview: mono 16-bit samples, trailing silence trimmed
+ */
+struct PresetPreview
+{
+    uint64_t key = 0;
+    double sampleRate = 0.0;
+    std::vector<int16_t> samples;
+};
+
+/**
+ * PresetPreviewRenderer - Renders audition notes offline and caches them
+ *
+ * Each render creates its own YmfmWrapper, and with it its own ymfm::ym2151,
+ * so nothing is shared with the live chip. Renders run on a low-priority
+ * pool that leaves one core to the audio thread.
+ *
+ * Previews are stored on disk as small raw files named by a hash of the
+ * preset's register image and the preview settings (see makeKey), so any
+ * preset that compiles to the same registers reuses the same file. The most
+ * recently used previews are also kept in memory.
+ *
+ * File format (little endian):
+ *   "YMPV" | uint32 version | uint32 sample rate | uint32 sample count | int16 samples...
+ */
+class PresetPreviewRenderer
+{
+public:
+    /** Called with the finished preview, on a render thread unless it was already cached */
+    using Callback = std::function<void(std::shared_ptr<const PresetPreview>)>;
+
+    static constexpr int MaxPreviewsInMemory = 32;
+
+    PresetPreviewRenderer(const juce::File& cacheDirectory, const PreviewSettings& settings);
+    ~PresetPreviewRenderer();
+
+    const PreviewSettings& getSettings() const { return settings; }
+
+    /** Cache key of a register image rendered with these settings */
+    static uint64_t makeKey(const RegisterImage& image, const PreviewSettings& settings);
+
+    /** Renders synchronously on the calling thread */
+    static std::shared_ptr<PresetPreview> render(const RegisterImage& image, const PreviewSettings& settings);
+
+    /**
+     * Returns the preview from memory or disk without rendering
+     * @return nullptr if it has not been rendered yet
+     */
+    std::shared_ptr<const PresetPreview> getCachedPreview(const RegisterImage& image);
+
+    /**
+     * Delivers the preview, rendering it in the background if it is not cached.
+     * A cached preview is delivered immediately on the calling thread.
+     */
+    void requestPreview(const RegisterImage& image, Callback callback);
+
+    /** Queues background renders for every image that has no preview on disk yet */
+    void renderMissing(const std::vector<RegisterImage>& images);
+
+    /** Drops renders that have not started yet, along with all waiting callbacks */
+    void cancelPendingRenders();
+
+    int getNumPendingRenders() const;
+
+    juce::File getCacheFile(uint64_t key) const;
+
+private:
+    std::shared_ptr<const PresetPreview> findInMemory(uint64_t key);
+    std::shared_ptr<const PresetPreview> loadFromDisk(uint64_t key);
+    bool saveToDisk(const PresetPreview& preview) const;
+    void remember(const std::shared_ptr<const PresetPreview>& preview);
+    void queueRender(uint64_t key, const RegisterImage& image, Callback callback);
+
+    const juce::File cacheDirectory;
+    const PreviewSettings settings;
+
+    mutable juce::CriticalSection lock;
+    std::map<uint64_t, std::shared_ptr<const PresetPreview>> memoryCache;
+    std::deque<uint64_t> memoryOrder;                     // least recently used first
+    std::map<uint64_t, std::vector<Callback>> inFlight;   // renders queued or running
+
+    // Declared last so that running renders finish before the members above go away
+    std::unique_ptr<juce::ThreadPool> pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetPreviewRenderer)
+};
+
+} // namespace ymulatorsynth
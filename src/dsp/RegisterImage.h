@@ -0,0 +1,45 @@
+#pragma once
+
+#include "YM2151Registers.h"
+#include <cstdint>
+
+namespace ymulatorsynth {
+
+/**
+ * RegisterImage - Ready-to-write YM2151 register values for one voice
+ *
+ * A preset compiled to chip format once, so that switching presets is a
+ * straight copy of 26 channel registers (plus the chip-wide LFO and noise
+ * settings) instead of per-field read-modify-write updates.
+ *
+ * Operator rows use the repo's slot order (operator N at slot offset N * 8).
+ * The connection byte carries FB/ALG only; pan bits are kept from the chip.
+ */
+struct RegisterImage
+{
+    static constexpr int RegistersPerOperator = 6;
+
+    /** Register base of each operator column, in operators[op][] order */
+    static constexpr uint8_t OperatorRegisterBases[RegistersPerOperator] = {
+        YM2151Regs::REG_DT1_MUL_BASE,
+        YM2151Regs::REG_TOTAL_LEVEL_BASE,
+        YM2151Regs::REG_KS_AR_BASE,
+        YM2151Regs::REG_AMS_D1R_BASE,
+        YM2151Regs::REG_DT2_D2R_BASE,
+        YM2151Regs::REG_D1L_RR_BASE
+    };
+
+    // Per channel
+    uint8_t operators[4][RegistersPerOperator] = {};  // DT1/MUL, TL, KS/AR, AMS-EN/D1R, DT2/D2R, D1L/RR
+    uint8_t connection = 0;   // FB << 3 | ALG (0x20 + channel, without pan bits)
+    uint8_t amsPms = 0;       // PMS << 4 | AMS (0x38 + channel)
+
+    // Chip-wide
+    uint8_t lfoRate = 0;      // 0-255
+    uint8_t lfoAmd = 0;       // 0-127
+    uint8_t lfoPmd = 0;       // 0-127
+    uint8_t lfoWaveform = 0;  // 0-3
+    uint8_t noise = 0;        // NE << 7 | NFRQ (0x0F)
+};
+
+} // namespace ymulatorsynth
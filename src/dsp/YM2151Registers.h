@@ -180,6 +180,7 @@ constexpr uint8_t MAX_OCTAVE = 7;                    // Maximum octave for YM215
 constexpr uint8_t MIN_OCTAVE = 0;                    // Minimum octave
 constexpr uint8_t NOTES_PER_OCTAVE = 12;             // Chromatic scale
 constexpr uint8_t KF_SCALE_FACTOR = 64;              // KF fractional scaling
+constexpr float MAX_PITCH_BEND_SEMITONES = 96.0f;    // MPE member channels can bend up to 96 semitones
 
 // =============================================================================
 // Default Parameter Values
@@ -241,6 +242,37 @@ constexpr uint8_t getChannelRegister(uint8_t baseReg, uint8_t channel) {
     return baseReg + channel;
 }
 
+// Carrier operators for each algorithm (bit N = operator N, in the slot order
+// addressed by getOperatorRegister: M1, M2, C1, C2)
+constexpr uint8_t ALGORITHM_CARRIER_MASK[8] = {
+    0x08, 0x08, 0x08, 0x08,  // ALG 0-3: C2 only
+    0x0C,                    // ALG 4: C1, C2
+    0x0E, 0x0E,              // ALG 5-6: M2, C1, C2
+    0x0F                     // ALG 7: all operators
+};
+
+// Check whether an operator is a carrier (audible output) for an algorithm
+constexpr bool isCarrier(uint8_t algorithm, uint8_t operator_num) {
+    return (ALGORITHM_CARRIER_MASK[algorithm & MASK_ALGORITHM] >> (operator_num & 0x03)) & 0x01;
+}
+
+// Note field of the key code for each semitone of an octave (codes 3, 7, 11 and 15 are unused)
+constexpr uint8_t NOTE_KEY_CODE[NOTES_PER_OCTAVE] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 11, 13, 14};
+
+// Pitch range of the chip's eight octaves, in KF steps (1/64 semitone) from MIDI note 0
+constexpr int MIN_KEY_PITCH = (MIN_OCTAVE + 1) * NOTES_PER_OCTAVE * KF_SCALE_FACTOR;
+constexpr int MAX_KEY_PITCH = (MAX_OCTAVE + 2) * NOTES_PER_OCTAVE * KF_SCALE_FACTOR - 1;
+
+// KC and KF for a pitch in KF steps (MIDI note * 64 + fraction), packed as
+// (KC << SHIFT_KEY_CODE) | KF. A table lookup and integer maths, so pitch bends
+// cost no pow/log; pitches outside the chip's range are clamped to it.
+constexpr uint16_t pitchToKeyCode(int pitch) {
+    const int clamped = pitch < MIN_KEY_PITCH ? MIN_KEY_PITCH : (pitch > MAX_KEY_PITCH ? MAX_KEY_PITCH : pitch);
+    const int note = clamped / KF_SCALE_FACTOR;
+    const int keyCode = ((note / NOTES_PER_OCTAVE - 1) << SHIFT_OCTAVE) | NOTE_KEY_CODE[note % NOTES_PER_OCTAVE];
+    return static_cast<uint16_t>((keyCode << SHIFT_KEY_CODE) | (clamped % KF_SCALE_FACTOR));
+}
+
 // Convert pan parameter (0.0=left, 0.5=center, 1.0=right) to YM2151 pan bits
 constexpr uint8_t panValueToPanBits(float panValue) {
     if (panValue <= 0.25f) {
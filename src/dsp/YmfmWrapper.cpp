@@ -495,43 +495,16 @@ void YmfmWrapper::setOperatorParameters(uint8_t channel, uint8_t operator_num,
 
 uint16_t YmfmWrapper::noteToFnumWithPitchBend(uint8_t note, float pitchBendSemitones)
 {
-    // Calculate the actual note with pitch bend applied
-    float actualNote = note + pitchBendSemitones;
-    
-    // Calculate frequency from MIDI note
-    float freq = YM2151Regs::REFERENCE_FREQUENCY * std::pow(YM2151Regs::SEMITONE_RATIO, (actualNote - YM2151Regs::MIDI_NOTE_A4) / YM2151Regs::NOTES_PER_OCTAVE);
-    
-    // Convert frequency to YM2151 KC/KF format
-    float fnote = YM2151Regs::NOTES_PER_OCTAVE * log2f(freq / YM2151Regs::REFERENCE_FREQUENCY) + YM2151Regs::MIDI_NOTE_A4;
-    int noteInt = (int)round(fnote);
-    int octave = (noteInt / YM2151Regs::NOTES_PER_OCTAVE) - 1;
-    int noteInOctave = noteInt % YM2151Regs::NOTES_PER_OCTAVE;
-    
-    // Clamp octave to valid range (0-7) for YM2151
-    if (octave < YM2151Regs::MIN_OCTAVE) {
-        octave = YM2151Regs::MIN_OCTAVE;
-        noteInOctave = 0;
-    } else if (octave > YM2151Regs::MAX_OCTAVE) {
-        octave = YM2151Regs::MAX_OCTAVE;
-        noteInOctave = YM2151Regs::NOTES_PER_OCTAVE - 1;
-    }
-    
-    // YM2151 key code calculation
-    const uint8_t noteCode[YM2151Regs::NOTES_PER_OCTAVE] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 11, 13, 14};
-    uint8_t kc = ((octave & YM2151Regs::MASK_OCTAVE) << YM2151Regs::SHIFT_OCTAVE) | noteCode[noteInOctave];
-    
-    // Calculate fine tuning (KF) for the fractional part
-    float fractionalPart = actualNote - noteInt;
-    uint8_t kf = (uint8_t)(fractionalPart * YM2151Regs::KF_SCALE_FACTOR); // 6-bit KF value
-    
-    // Combine KC and KF into a 16-bit value for convenience
-    return (kc << YM2151Regs::SHIFT_KEY_CODE) | (kf & YM2151Regs::MASK_KEY_FRACTION);
+    // Pitch in KF steps (1/64 semitone); the bend's fraction goes to KF below the note it falls after
+    const int pitch = note * YM2151Regs::KF_SCALE_FACTOR
+                    + juce::roundToInt(pitchBendSemitones * YM2151Regs::KF_SCALE_FACTOR);
+    return YM2151Regs::pitchToKeyCode(pitch);
 }
 
 void YmfmWrapper::setPitchBend(uint8_t channel, float semitones)
 {
     CS_ASSERT_CHANNEL(channel);
-    CS_ASSERT_PARAMETER_RANGE(semitones, -12.0f, 12.0f);  // Reasonable pitch bend range
+    CS_ASSERT_PARAMETER_RANGE(semitones, -YM2151Regs::MAX_PITCH_BEND_SEMITONES, YM2151Regs::MAX_PITCH_BEND_SEMITONES);
     
     if (channel >= YM2151Regs::MAX_OPM_CHANNELS) return;
     
@@ -779,6 +752,55 @@ void YmfmWrapper::batchUpdateChannelParameters(uint8_t channel, uint8_t algorith
     }
 }
 
+void YmfmWrapper::applyRegisterImage(uint8_t channel, const ymulatorsynth::RegisterImage& image)
+{
+    CS_ASSERT_CHANNEL(channel);
+    
+    if (channel >= YM2151Regs::MAX_OPM_CHANNELS) return;
+    
+    if (chipType != ChipType::OPM || !opmChip) {
+        // Generic path through writeRegister for other chip types
+        for (int op = 0; op < 4; ++op) {
+            for (int reg = 0; reg < ymulatorsynth::RegisterImage::RegistersPerOperator; ++reg) {
+                writeRegister(YM2151Regs::getOperatorRegister(ymulatorsynth::RegisterImage::OperatorRegisterBases[reg],
+                                                              static_cast<uint8_t>(op), channel),
+                              image.operators[op][reg]);
+            }
+        }
+        
+        const int connectionRegister = YM2151Regs::REG_ALGORITHM_FEEDBACK_BASE + channel;
+        writeRegister(connectionRegister, static_cast<uint8_t>((readCurrentRegister(connectionRegister) & YM2151Regs::MASK_PAN_LR) | image.connection));
+        writeRegister(YM2151Regs::REG_LFO_AMS_PMS_BASE + channel, image.amsPms);
+        return;
+    }
+    
+    // Straight copy: no read-modify-write, no per-write dispatch, no logging
+    for (int op = 0; op < 4; ++op) {
+        const uint8_t slot = static_cast<uint8_t>(op * YM2151Regs::OPERATOR_ADDRESS_STEP + channel);
+        for (int reg = 0; reg < ymulatorsynth::RegisterImage::RegistersPerOperator; ++reg) {
+            writeOpmRegister(ymulatorsynth::RegisterImage::OperatorRegisterBases[reg] + slot, image.operators[op][reg]);
+        }
+    }
+    
+    const uint8_t connectionRegister = YM2151Regs::REG_ALGORITHM_FEEDBACK_BASE + channel;
+    writeOpmRegister(connectionRegister, (currentRegisters[connectionRegister] & YM2151Regs::MASK_PAN_LR) | image.connection);
+    writeOpmRegister(YM2151Regs::REG_LFO_AMS_PMS_BASE + channel, image.amsPms);
+}
+
+void YmfmWrapper::applyRegisterImageGlobals(const ymulatorsynth::RegisterImage& image)
+{
+    setLfoParameters(image.lfoRate, image.lfoAmd, image.lfoPmd, image.lfoWaveform);
+    setNoiseParameters((image.noise & YM2151Regs::MASK_NOISE_ENABLE) != 0,
+                       static_cast<uint8_t>(image.noise & YM2151Regs::MASK_NOISE_FREQUENCY));
+}
+
+void YmfmWrapper::writeOpmRegister(uint8_t address, uint8_t data)
+{
+    currentRegisters[address] = data;
+    opmChip->write_address(address);
+    opmChip->write_data(data);
+}
+
 YmfmWrapper::EnvelopeDebugInfo YmfmWrapper::getEnvelopeDebugInfo(uint8_t channel, uint8_t operator_num) const
 {
     EnvelopeDebugInfo info = {0, 0, 0, false};
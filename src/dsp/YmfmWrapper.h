@@ -65,6 +65,8 @@ public:
     // Batch operations for efficiency - interface implementation
     void batchUpdateChannelParameters(uint8_t channel, uint8_t algorithm, uint8_t feedback,
                                      const std::array<std::array<uint8_t, 10>, 4>& operatorParams) override;
+    void applyRegisterImage(uint8_t channel, const ymulatorsynth::RegisterImage& image) override;
+    void applyRegisterImageGlobals(const ymulatorsynth::RegisterImage& image) override;
     
     // Debug and monitoring - interface implementation
     EnvelopeDebugInfo getEnvelopeDebugInfo(uint8_t channel, uint8_t operator_num) const override;
@@ -112,6 +114,7 @@ private:
     std::array<std::array<float, 4>, 8> velocitySensitivity;
     
     // Helper methods
+    void writeOpmRegister(uint8_t address, uint8_t data);
     void initializeOPM();
     void initializeOPNA();
     uint16_t noteToFnum(uint8_t note);
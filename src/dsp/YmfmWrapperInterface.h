@@ -1,5 +1,6 @@
 #pragma once
 
+#include "RegisterImage.h"
 #include <cstdint>
 #include <array>
 
@@ -93,6 +94,18 @@ public:
     virtual void batchUpdateChannelParameters(uint8_t channel, uint8_t algorithm, uint8_t feedback,
                                             const std::array<std::array<uint8_t, 10>, 4>& operatorParams) = 0;
     
+    // Precompiled preset register images
+    /**
+     * Writes a register image to one channel (operators, FB/ALG, AMS/PMS).
+     * Pan bits of the channel are preserved.
+     */
+    virtual void applyRegisterImage(uint8_t channel, const ymulatorsynth::RegisterImage& image) = 0;
+    
+    /**
+     * Writes the chip-wide part of a register image (LFO and noise)
+     */
+    virtual void applyRegisterImageGlobals(const ymulatorsynth::RegisterImage& image) = 0;
+    
     // Debug and monitoring
     struct EnvelopeDebugInfo {
         uint32_t currentState;     // Current envelope state (attack, decay, sustain, release)
@@ -1,6 +1,7 @@
 #include "PresetUIManager.h"
 #include "../PluginProcessor.h"
 #include "../utils/Debug.h"
+#include "../utils/BankImportJob.h"
 #include "../utils/ParameterIDs.h"
 #include <set>
 
@@ -22,6 +23,11 @@ PresetUIManager::PresetUIManager(YMulatorSynthAudioProcessor& processor)
 
 PresetUIManager::~PresetUIManager()
 {
+    // The bank may still be published later; only the UI goes away
+    stopTimer();
+    if (importJob)
+        importJob->cancel();
+    
     // Remove listener to avoid dangling pointer - check if state is still valid
     try {
         audioProcessor.getParameters().state.removeListener(this);
@@ -48,6 +54,12 @@ void PresetUIManager::resized()
         savePresetButton->setBounds(centeredButtonArea);
     }
     
+    // Search field left of the save button
+    auto searchArea = bounds.removeFromRight(110).reduced(5, 0);
+    if (searchEditor) {
+        searchEditor->setBounds(searchArea.withHeight(25).withCentre(searchArea.getCentre()));
+    }
+    
     // Bank label and ComboBox
     auto bankLabelArea = bounds.removeFromLeft(40);
     if (bankLabel) {
@@ -202,6 +214,11 @@ void PresetUIManager::updatePresetComboBox()
 {
     if (!presetComboBox) return;
     
+    if (isSearchActive()) {
+        updateSearchResults();
+        return;
+    }
+    
     // Get presets for currently selected bank
     int selectedBankId = bankComboBox ? bankComboBox->getSelectedId() : 1;
     int bankIndex = selectedBankId - 1; // Convert to 0-based index
@@ -260,7 +277,7 @@ void PresetUIManager::updatePresetComboBox()
         } else {
             CS_DBG("PresetUIManager preset index invalid, using fallback search");
             // Fallback: Find which preset in the current bank matches the global current preset
-            int currentGlobalIndex = audioProcessor.getCurrentProgram();
+            int currentGlobalIndex = audioProcessor.getCurrentPresetIndex();
             
             // Find the preset index within the current bank
             for (int i = 0; i < presetNames.size(); ++i) {
@@ -330,6 +347,14 @@ void PresetUIManager::setupComponents()
     // Initially disabled - will be enabled when in custom mode
     savePresetButton->setEnabled(false);
     addAndMakeVisible(*savePresetButton);
+    
+    // Preset search
+    searchEditor = std::make_unique<juce::TextEditor>();
+    searchEditor->setTextToShowWhenEmpty("Search", juce::Colours::grey);
+    searchEditor->setTooltip("Search presets by name or bank (alg:N, fb:N, is:noise, is:lfo)");
+    searchEditor->onTextChange = [this]() { onSearchTextChanged(); };
+    searchEditor->onEscapeKey = [this]() { searchEditor->clear(); onSearchTextChanged(); };
+    addAndMakeVisible(*searchEditor);
 }
 
 void PresetUIManager::onBankChanged()
@@ -373,6 +398,20 @@ void PresetUIManager::onPresetChanged()
     int selectedBankId = bankComboBox->getSelectedId();
     CS_FILE_DBG("PresetUIManager onPresetChanged: bankId=" + juce::String(selectedBankId) + ", presetId=" + juce::String(selectedPresetId));
     
+    if (isSearchActive())
+    {
+        // Search results map directly to global preset indices
+        int resultIndex = selectedPresetId - 1;
+        if (resultIndex >= 0 && resultIndex < static_cast<int>(searchResults.size()))
+        {
+            int globalIndex = searchResults[static_cast<size_t>(resultIndex)];
+            juce::MessageManager::callAsync([this, globalIndex]() {
+                audioProcessor.setCurrentPreset(globalIndex);
+            });
+        }
+        return;
+    }
+    
     if (selectedPresetId > 0 && selectedBankId > 0)
     {
         // Convert to 0-based indices
@@ -389,10 +428,59 @@ void PresetUIManager::onPresetChanged()
     }
 }
 
+void PresetUIManager::onSearchTextChanged()
+{
+    if (isSearchActive()) {
+        updateSearchResults();
+    } else {
+        // Back to browsing the selected bank
+        searchResults.clear();
+        presetComboBox->setTextWhenNothingSelected({});
+        presetComboBox->clear(juce::dontSendNotification);
+        updatePresetComboBox();
+    }
+}
+
+bool PresetUIManager::isSearchActive() const
+{
+    return searchEditor != nullptr && searchEditor->getText().trim().isNotEmpty();
+}
+
+void PresetUIManager::updateSearchResults()
+{
+    searchResults = audioProcessor.searchPresets(searchEditor->getText(), maxSearchResults);
+    
+    // Only names are needed, so they are read from the packed library without expanding presets
+    const auto library = audioProcessor.getPresetManager().getSnapshot();
+    isUpdatingFromState = true;
+    presetComboBox->clear(juce::dontSendNotification);
+    
+    for (size_t i = 0; i < searchResults.size(); ++i) {
+        if (library->getPackedPreset(searchResults[i]) != nullptr) {
+            presetComboBox->addItem(library->getPresetName(searchResults[i]), static_cast<int>(i) + 1);
+        }
+    }
+    
+    presetComboBox->setTextWhenNothingSelected(searchResults.empty() ? "No matches" : juce::String(searchResults.size()) + " matches");
+    
+    // Keep the current preset selected if it is among the results
+    int currentGlobalIndex = audioProcessor.getCurrentPresetIndex();
+    for (size_t i = 0; i < searchResults.size(); ++i) {
+        if (searchResults[i] == currentGlobalIndex) {
+            presetComboBox->setSelectedId(static_cast<int>(i) + 1, juce::dontSendNotification);
+            break;
+        }
+    }
+    isUpdatingFromState = false;
+}
+
 void PresetUIManager::loadOpmFileDialog()
 {
     CS_DBG("PresetUIManager loadOpmFileDialog() called");
     
+    if (importJob)
+        return;  // The progress window of the running import is still open
+    
     auto fileChooser = std::make_shared<juce::FileChooser>(
         "Select a VOPM preset file",
         juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
@@ -406,45 +494,87 @@ void PresetUIManager::loadOpmFileDialog()
         auto file = fc.getResult();
         
         if (file.existsAsFile())
+            startOpmImport(file);
+    });
+}
+
+void PresetUIManager::startOpmImport(const juce::File& file)
+{
+    // Parsing runs in the background; the window only shows progress and offers Cancel
+    importProgress = 0.0;
+    importWindow = std::make_unique<juce::AlertWindow>("Importing " + file.getFileName(),
+                                                       "Reading presets...",
+                                                       juce::MessageBoxIconType::NoIcon);
+    importWindow->addProgressBarComponent(importProgress);
+    importWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+    
+    juce::Component::SafePointer<PresetUIManager> safeThis(this);
+    importJob = audioProcessor.importOpmFileAsync(file, [safeThis](const ymulatorsynth::BankImportJob& job)
+    {
+        if (safeThis != nullptr)
+            safeThis->onOpmImportFinished(job);
+    });
+    
+    importWindow->enterModalState(true, juce::ModalCallbackFunction::create([safeThis](int)
+    {
+        // Only reached through the Cancel button; completion closes the window without a result
+        if (safeThis != nullptr && safeThis->importJob)
         {
-            // Load the OPM file through the audio processor
-            int numLoaded = audioProcessor.loadOpmFile(file);
+            safeThis->importJob->cancel();
+            safeThis->importWindow->setVisible(false);
+        }
+    }), false);
+    
+    startTimerHz(20);
+}
+
+void PresetUIManager::timerCallback()
+{
+    if (importJob)
+        importProgress = importJob->getProgress();
+}
+
+void PresetUIManager::onOpmImportFinished(const ymulatorsynth::BankImportJob& job)
+{
+    stopTimer();
+    importJob.reset();
+    if (importWindow)
+    {
+        importWindow->exitModalState(-1);
+        importWindow.reset();
+    }
+    
+    const auto fileName = job.getFile().getFileName();
+    switch (job.getStatus())
+    {
+        case ymulatorsynth::BankImportJob::Status::Succeeded:
+        {
+            // Update the bank list and select the new bank
+            updateBankComboBox();
+            bankComboBox->setSelectedId(job.getBankIndex() + 1, juce::dontSendNotification);
+            updatePresetComboBox();
             
-            if (numLoaded > 0)
-            {
-                // Update the bank list to include the new bank
-                updateBankComboBox();
-                
-                // Select the newly created bank (it will be the last bank before the Import option)
-                auto bankNames = audioProcessor.getBankNames();
-                int newBankIndex = bankNames.size(); // Last bank
-                if (newBankIndex > 0) {
-                    bankComboBox->setSelectedId(newBankIndex, juce::dontSendNotification);
-                }
-                
-                // Update presets for the newly selected bank
-                updatePresetComboBox();
-                
-                // Notify that preset list has been updated
-                audioProcessor.getParameters().state.setProperty("presetListUpdated", juce::var(juce::Random::getSystemRandom().nextInt()), nullptr);
-                
-                // Show success message
-                juce::AlertWindow::showMessageBoxAsync(
-                    juce::MessageBoxIconType::InfoIcon,
-                    "Load Successful",
-                    "Loaded " + juce::String(numLoaded) + " preset(s) from " + file.getFileName()
-                );
-            }
-            else
-            {
-                juce::AlertWindow::showMessageBoxAsync(
-                    juce::MessageBoxIconType::WarningIcon,
-                    "Load Error",
-                    "Failed to load any presets from: " + file.getFileName()
-                );
-            }
+            juce::String message = "Loaded " + juce::String(job.getNumPresets()) + " preset(s) from " + fileName;
+            if (!job.getWarnings().isEmpty())
+                message << "\n\n" << juce::String(job.getWarnings().size()) << " warning(s), first: " << job.getWarnings()[0];
+            
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Load Successful", message);
+            break;
         }
-    });
+        
+        case ymulatorsynth::BankImportJob::Status::Cancelled:
+            CS_DBG("Import of " + fileName + " cancelled");
+            break;
+        
+        case ymulatorsynth::BankImportJob::Status::Pending:
+        case ymulatorsynth::BankImportJob::Status::Failed:
+            juce::AlertWindow::showMessageBoxAsync(
+                juce::MessageBoxIconType::WarningIcon,
+                "Load Error",
+                "Failed to load any presets from: " + fileName + "\n" + job.getErrorMessage()
+            );
+            break;
+    }
 }
 
 void PresetUIManager::savePresetDialog()
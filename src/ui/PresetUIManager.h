@@ -3,22 +3,27 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <atomic>
+#include <vector>
 
 class YMulatorSynthAudioProcessor;
+namespace ymulatorsynth { class BankImportJob; }
 
 /**
  * PresetUIManager - Extracted from MainComponent
  * 
  * Handles all preset-related UI functionality:
  * - Bank and preset selection ComboBoxes
+ * - Incremental preset search field
  * - Save preset button
  * - File dialogs for loading/saving OPM files
+ * - Progress window for background OPM imports
  * - Preset change event handling
  * 
  * Part of Phase 2 refactoring to split MainComponent responsibilities.
  */
 class PresetUIManager : public juce::Component,
-                        public juce::ValueTree::Listener
+                        public juce::ValueTree::Listener,
+                        private juce::Timer
 {
 public:
     explicit PresetUIManager(YMulatorSynthAudioProcessor& processor);
@@ -45,6 +50,11 @@ private:
     std::unique_ptr<juce::ComboBox> presetComboBox;
     std::unique_ptr<juce::Label> presetLabel;
     std::unique_ptr<juce::TextButton> savePresetButton;
+    std::unique_ptr<juce::TextEditor> searchEditor;
+    
+    // Global preset indices currently listed while a search is active
+    std::vector<int> searchResults;
+    static constexpr int maxSearchResults = 200;
     
     // UI state management
     bool isUpdatingFromState = false;
@@ -55,10 +65,21 @@ private:
     // Event handlers
     void onBankChanged();
     void onPresetChanged();
+    void onSearchTextChanged();
+    bool isSearchActive() const;
+    void updateSearchResults();
     void loadOpmFileDialog();
+    void startOpmImport(const juce::File& file);
+    void onOpmImportFinished(const ymulatorsynth::BankImportJob& job);
+    void timerCallback() override;
     void savePresetDialog();
     void savePresetToFile(const juce::File& file, const juce::String& presetName);
     
+    // Background OPM import in progress (at most one at a time)
+    std::shared_ptr<ymulatorsynth::BankImportJob> importJob;
+    std::unique_ptr<juce::AlertWindow> importWindow;
+    double importProgress = 0.0;  // polled by the window's progress bar
+    
     // UI update scheduling
     std::atomic<bool> uiUpdateScheduled { false };
     
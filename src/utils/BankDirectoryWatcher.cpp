@@ -0,0 +1,202 @@
+#include "BankDirectoryWatcher.h"
+#include "Debug.h"
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr const char* BankFilePattern = "*.opm;*.OPM";
+    constexpr int SettleTimeMs = 250;  // Lets a file finish copying before it is parsed
+}
+
+BankDirectoryWatcher::BankDirectoryWatcher(juce::Array<juce::File> watchedDirectories)
+    : juce::Thread("Bank Directory Watcher"),
+      directories(std::move(watchedDirectories))
+{
+}
+
+BankDirectoryWatcher::~BankDirectoryWatcher()
+{
+    stop();
+}
+
+void BankDirectoryWatcher::setBaseline(const juce::Array<juce::File>& loadedFiles)
+{
+    const juce::ScopedLock sl(scanLock);
+    for (const auto& file : loadedFiles)
+    {
+        if (file.existsAsFile())
+            knownFiles[file.getFullPathName()] = getState(file);
+    }
+}
+
+BankDirectoryWatcher::ChangeSet BankDirectoryWatcher::scanForChanges()
+{
+    const juce::ScopedLock sl(scanLock);
+
+    // Directory listing only; the entries already carry size and modification time
+    std::map<juce::String, FileState> current;
+    for (const auto& directory : directories)
+    {
+        if (!directory.isDirectory())
+            continue;
+
+        for (const auto& entry : juce::RangedDirectoryIterator(directory, false, BankFilePattern, juce::File::findFiles))
+            current[entry.getFile().getFullPathName()] = { entry.getFileSize(), entry.getModificationTime().toMilliseconds() };
+    }
+
+    ChangeSet changes;
+    for (const auto& [path, state] : current)
+    {
+        auto known = knownFiles.find(path);
+        if (known != knownFiles.end() && known->second == state)
+            continue;
+
+        // Only files that are new or changed get parsed
+        juce::File file(path);
+        BankFile bankFile { file, VOPMParser::parseFile(file) };
+        if (known == knownFiles.end())
+            changes.added.push_back(std::move(bankFile));
+        else
+            changes.modified.push_back(std::move(bankFile));
+    }
+
+    for (const auto& [path, state] : knownFiles)
+    {
+        if (current.find(path) == current.end())
+            changes.removed.push_back(juce::File(path));
+    }
+
+    knownFiles = std::move(current);
+
+    if (!changes.isEmpty())
+        CS_DBG("Bank directories changed: " + juce::String(changes.added.size()) + " added, "
+               + juce::String(changes.modified.size()) + " modified, "
+               + juce::String(changes.removed.size()) + " removed");
+    return changes;
+}
+
+void BankDirectoryWatcher::start(Listener changeListener, int intervalMs)
+{
+    stop();
+    listener = std::move(changeListener);
+    pollIntervalMs = intervalMs;
+    startThread(juce::Thread::Priority::low);
+}
+
+void BankDirectoryWatcher::stop()
+{
+    stopThread(4000);
+}
+
+BankDirectoryWatcher::FileState BankDirectoryWatcher::getState(const juce::File& file)
+{
+    return { file.getSize(), file.getLastModificationTime().toMilliseconds() };
+}
+
+void BankDirectoryWatcher::run()
+{
+    nativeEvents = openNativeWatches();
+    CS_DBG(juce::String("Watching bank directories ") + (nativeEvents ? "with inotify" : "by polling"));
+
+    while (!threadShouldExit())
+    {
+        if (nativeEvents)
+        {
+            // Short timeout so that stop() is noticed promptly
+            if (!waitForNativeEvents(500))
+                continue;
+
+            // Writers usually produce a burst of events; swallow it before scanning
+            wait(SettleTimeMs);
+            waitForNativeEvents(0);
+        }
+        else
+        {
+            wait(pollIntervalMs);
+        }
+
+        if (threadShouldExit())
+            break;
+
+        auto changes = scanForChanges();
+        if (!changes.isEmpty() && listener)
+            listener(std::move(changes));
+    }
+
+    closeNativeWatches();
+}
+
+#if JUCE_LINUX || JUCE_BSD
+
+bool BankDirectoryWatcher::openNativeWatches()
+{
+    nativeHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (nativeHandle < 0)
+        return false;
+
+    constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO
+                            | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    for (const auto& directory : directories)
+    {
+        if (inotify_add_watch(nativeHandle, directory.getFullPathName().toRawUTF8(), mask) < 0)
+        {
+            // A directory that is missing now may appear later; only polling notices that
+            closeNativeWatches();
+            return false;
+        }
+    }
+    return true;
+}
+
+void BankDirectoryWatcher::closeNativeWatches()
+{
+    if (nativeHandle >= 0)
+        ::close(nativeHandle);
+    nativeHandle = -1;
+}
+
+bool BankDirectoryWatcher::waitForNativeEvents(int timeoutMs)
+{
+    pollfd descriptor { nativeHandle, POLLIN, 0 };
+    if (::poll(&descriptor, 1, timeoutMs) <= 0)
+        return false;
+
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        const auto bytesRead = ::read(nativeHandle, buffer, sizeof(buffer));
+        if (bytesRead <= 0)
+            break;
+
+        for (ssize_t offset = 0; offset < bytesRead;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if ((event->mask & (IN_IGNORED | IN_Q_OVERFLOW)) != 0)
+            {
+                // A watched directory went away or events were lost: poll from now on
+                closeNativeWatches();
+                nativeEvents = false;
+                return true;
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return true;
+}
+
+#else
+
+bool BankDirectoryWatcher::openNativeWatches()               { return false; }
+void BankDirectoryWatcher::closeNativeWatches()              {}
+bool BankDirectoryWatcher::waitForNativeEvents(int)          { return false; }
+
+#endif
+
+} // namespace ymulatorsynth
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "VOPMParser.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace ymulatorsynth {
+
+/**
+ * BankDirectoryWatcher - Detects added, changed and removed .opm files
+ *
+ * Keeps the size and modification time of every .opm file in a set of
+ * directories and reports only the difference on each scan. Files that were
+ * added or changed are parsed during the scan, on the watcher thread, so the
+ * consumer only has to merge the results.
+ *
+ * On Linux the thread sleeps on inotify and scans once events arrive; on
+ * other platforms, or when a directory cannot be watched (e.g. it does not
+ * exist yet), it falls back to scanning at a fixed interval.
+ */
+class BankDirectoryWatcher : private juce::Thread
+{
+public:
+    struct BankFile
+    {
+        juce::File file;
+        std::vector<VOPMVoice> voices;
+    };
+
+    struct ChangeSet
+    {
+        std::vector<BankFile> added;
+        std::vector<BankFile> modified;
+        std::vector<juce::File> removed;
+
+        bool isEmpty() const { return added.empty() && modified.empty() && removed.empty(); }
+    };
+
+    /** Called on the watcher thread with every non-empty change set */
+    using Listener = std::function<void(ChangeSet)>;
+
+    static constexpr int DefaultPollIntervalMs = 2000;
+
+    explicit BankDirectoryWatcher(juce::Array<juce::File> directories);
+    ~BankDirectoryWatcher() override;
+
+    /**
+     * Records the current state of files that are already loaded, so they are
+     * not reported as added. Any other .opm file shows up as added on the next scan.
+     */
+    void setBaseline(const juce::Array<juce::File>& loadedFiles);
+
+    /** Compares the directories with the recorded state and parses what changed */
+    ChangeSet scanForChanges();
+
+    /** Starts the background thread */
+    void start(Listener listener, int pollIntervalMs = DefaultPollIntervalMs);
+    void stop();
+
+    bool isUsingNativeEvents() const { return nativeEvents; }
+
+private:
+    struct FileState
+    {
+        juce::int64 size = 0;
+        juce::int64 modificationTime = 0;
+
+        bool operator==(const FileState& other) const
+        {
+            return size == other.size && modificationTime == other.modificationTime;
+        }
+    };
+
+    void run() override;
+    bool openNativeWatches();
+    void closeNativeWatches();
+    bool waitForNativeEvents(int timeoutMs);
+    static FileState getState(const juce::File& file);
+
+    const juce::Array<juce::File> directories;
+    std::map<juce::String, FileState> knownFiles;  // full path -> last seen state
+    juce::CriticalSection scanLock;
+
+    Listener listener;
+    int pollIntervalMs = DefaultPollIntervalMs;
+    int nativeHandle = -1;
+    std::atomic<bool> nativeEvents { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BankDirectoryWatcher)
+};
+
+} // namespace ymulatorsynth
@@ -0,0 +1,191 @@
+#include "BankImportJob.h"
+#include "Debug.h"
+#include <iterator>
+
+namespace ymulatorsynth {
+
+namespace {
+    // Overall progress at the start of each stage, indexed by Stage
+    constexpr float StageStart[] = { 0.0f, 0.0f, 0.6f, 0.7f, 0.9f, 0.95f, 1.0f };
+    constexpr int NumStages = static_cast<int>(sizeof(StageStart) / sizeof(StageStart[0]));
+
+    constexpr int MaxWarnings = 100;
+}
+
+BankImportJob::BankImportJob(const juce::File& sourceFile, const juce::File& userBanksDirectory, CompletionCallback callback)
+    : file(sourceFile),
+      banksDirectory(userBanksDirectory),
+      onComplete(std::move(callback))
+{
+}
+
+bool BankImportJob::waitUntilReadyToPublish(int timeoutMs) const
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMs);
+    while (!readyToPublish.load())
+    {
+        if (juce::Time::getMillisecondCounter() >= deadline)
+            return false;
+        juce::Thread::sleep(1);
+    }
+    return true;
+}
+
+void BankImportJob::setStage(Stage newStage, float stageProgress)
+{
+    const int index = static_cast<int>(newStage);
+    const float start = StageStart[index];
+    const float end = index + 1 < NumStages ? StageStart[index + 1] : 1.0f;
+
+    stage = newStage;
+    progress = start + (end - start) * juce::jlimit(0.0f, 1.0f, stageProgress);
+}
+
+void BankImportJob::runBackgroundStages()
+{
+    // Failures are recorded here and reported by PresetManager on the message thread
+    auto stop = [this](Status finalStatus, const juce::String& error)
+    {
+        status = finalStatus;
+        errorMessage = error;
+        presets.clear();
+        readyToPublish = true;
+    };
+
+    std::vector<VOPMVoice> voices;
+    if (!parse(voices))
+        return stop(isCancelled() ? Status::Cancelled : Status::Failed, errorMessage);
+
+    // Validate
+    setStage(Stage::Validating, 0.0f);
+    if (static_cast<int>(voices.size()) > MaxVoices)
+    {
+        warnings.add("Only the first " + juce::String(MaxVoices) + " voices were imported");
+        voices.resize(static_cast<size_t>(MaxVoices));
+    }
+
+    if (voices.empty())
+        return stop(Status::Failed, "No voices found in " + file.getFileName());
+
+    for (const auto& voice : voices)
+    {
+        for (const auto& warning : VOPMParser::validate(voice).warnings)
+        {
+            if (warnings.size() < MaxWarnings)
+                warnings.add(voice.name + ": " + warning);
+        }
+    }
+
+    if (isCancelled())
+        return stop(Status::Cancelled, {});
+
+    // Convert
+    setStage(Stage::Converting, 0.0f);
+    presets.reserve(voices.size());
+    for (size_t i = 0; i < voices.size(); ++i)
+    {
+        auto preset = Preset::fromVOPM(voices[i]);
+        PresetManager::validatePreset(preset);
+        presets.push_back(std::move(preset));
+
+        if ((i % VoicesPerBlock) == 0)
+        {
+            if (isCancelled())
+                return stop(Status::Cancelled, {});
+            setStage(Stage::Converting, static_cast<float>(i) / static_cast<float>(voices.size()));
+        }
+    }
+    voices.clear();
+    voices.shrink_to_fit();
+
+    if (isCancelled())
+        return stop(Status::Cancelled, {});
+
+    // Persist - under a name the bank watcher ignores until the bank is published
+    setStage(Stage::Persisting, 0.0f);
+    auto target = banksDirectory.getChildFile(file.getFileName());
+    if (!target.exists())
+    {
+        persistedCopy = banksDirectory.getChildFile(file.getFileName() + ".importing");
+        if (!banksDirectory.createDirectory() || !file.copyFileTo(persistedCopy))
+        {
+            warnings.add("Could not copy " + file.getFileName() + " to the user banks folder; it will not be reloaded on restart");
+            persistedCopy = juce::File();
+        }
+    }
+
+    setStage(Stage::Publishing, 0.0f);
+    readyToPublish = true;
+}
+
+bool BankImportJob::parse(std::vector<VOPMVoice>& voices)
+{
+    setStage(Stage::Parsing, 0.0f);
+
+    if (!file.existsAsFile())
+    {
+        errorMessage = "File not found: " + file.getFullPathName();
+        return false;
+    }
+
+    if (file.getSize() > MaxFileSize)
+    {
+        errorMessage = file.getFileName() + " is too large to be an OPM bank";
+        return false;
+    }
+
+    juce::StringArray lines;
+    lines.addLines(file.loadFileAsString());
+
+    // Parse a block of voices at a time so that progress and cancellation stay responsive
+    juce::String block;
+    int voicesInBlock = 0;
+    auto flushBlock = [&]()
+    {
+        auto parsed = VOPMParser::parseContent(block);
+        voices.insert(voices.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+        block.clear();
+        voicesInBlock = 0;
+    };
+
+    for (int i = 0; i < lines.size() && static_cast<int>(voices.size()) <= MaxVoices; ++i)
+    {
+        const auto& line = lines.getReference(i);
+        if (line.trimStart().startsWith("@:") && ++voicesInBlock > VoicesPerBlock)
+        {
+            flushBlock();
+            voicesInBlock = 1;
+
+            if (isCancelled())
+                return false;
+            setStage(Stage::Parsing, static_cast<float>(i) / static_cast<float>(lines.size()));
+        }
+        block << line << "\n";
+    }
+    flushBlock();
+
+    CS_DBG("BankImportJob parsed " + juce::String(voices.size()) + " voices from " + file.getFileName());
+    return !isCancelled();
+}
+
+void BankImportJob::finish(Status finalStatus, const juce::String& error)
+{
+    // An unpublished copy must not be picked up later as a bank
+    if (persistedCopy.existsAsFile())
+        persistedCopy.deleteFile();
+    persistedCopy = juce::File();
+
+    status = finalStatus;
+    if (error.isNotEmpty())
+        errorMessage = error;
+    presets.clear();
+    presets.shrink_to_fit();
+
+    progress = 1.0f;
+    stage = Stage::Finished;
+
+    if (onComplete)
+        onComplete(*this);
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "PresetManager.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace ymulatorsynth {
+
+/**
+ * BankImportJob - One OPM bank import, run off the message thread
+ *
+ * The work is split into stages so that progress can be reported and
+ * cancellation is checked between steps:
+ *
+ *   Parsing     read the file and parse it in blocks of voices
+ *   Validating  collect warnings, drop voices beyond the bank limit
+ *   Converting  VOPM voices to clamped presets
+ *   Persisting  copy the file next to the user's banks (under a temporary name)
+ *   Publishing  PresetManager adds the bank in one step on the message thread
+ *
+ * Memory stays bounded: files above MaxFileSize are rejected up front and
+ * at most MaxVoices voices are kept.
+ */
+class BankImportJob
+{
+public:
+    enum class Stage
+    {
+        Queued,
+        Parsing,
+        Validating,
+        Converting,
+        Persisting,
+        Publishing,
+        Finished
+    };
+
+    enum class Status
+    {
+        Pending,
+        Succeeded,
+        Cancelled,
+        Failed
+    };
+
+    static constexpr juce::int64 MaxFileSize = 8 * 1024 * 1024;
+    static constexpr int MaxVoices = 4096;
+    static constexpr int VoicesPerBlock = 64;
+
+    using CompletionCallback = std::function<void(const BankImportJob&)>;
+
+    BankImportJob(const juce::File& file, const juce::File& banksDirectory, CompletionCallback onComplete);
+
+    // Progress, readable from any thread
+    Stage getStage() const { return stage.load(); }
+    float getProgress() const { return progress.load(); }
+    bool isFinished() const { return stage.load() == Stage::Finished; }
+
+    /** Requests cancellation; takes effect at the next stage boundary or voice block */
+    void cancel() { cancelled = true; }
+    bool isCancelled() const { return cancelled.load(); }
+
+    /**
+     * Blocks until the background stages are done and the job waits to be published
+     * @return true if the job got there within the timeout
+     */
+    bool waitUntilReadyToPublish(int timeoutMs) const;
+
+    // Result - valid once isFinished() returns true
+    Status getStatus() const { return status; }
+    int getNumPresets() const { return numPresets; }
+    int getBankIndex() const { return bankIndex; }
+    const juce::String& getErrorMessage() const { return errorMessage; }
+    const juce::StringArray& getWarnings() const { return warnings; }
+
+    const juce::File& getFile() const { return file; }
+
+private:
+    friend class PresetManager;
+
+    /** Parse, validate, convert and persist (background thread) */
+    void runBackgroundStages();
+
+    bool parse(std::vector<VOPMVoice>& voices);
+    void finish(Status finalStatus, const juce::String& error = {});
+    void setStage(Stage newStage, float stageProgress);
+
+    const juce::File file;
+    const juce::File banksDirectory;
+    const CompletionCallback onComplete;
+
+    std::atomic<Stage> stage { Stage::Queued };
+    std::atomic<float> progress { 0.0f };
+    std::atomic<bool> cancelled { false };
+    std::atomic<bool> readyToPublish { false };
+
+    // Written by the background stages, read by PresetManager when publishing
+    std::vector<Preset> presets;
+    juce::File persistedCopy;  // temporary copy in the banks directory, renamed on publish
+
+    Status status = Status::Pending;
+    int numPresets = 0;
+    int bankIndex = -1;
+    juce::String errorMessage;
+    juce::StringArray warnings;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BankImportJob)
+};
+
+} // namespace ymulatorsynth
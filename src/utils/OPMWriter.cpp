@@ -0,0 +1,214 @@
+#include "OPMWriter.h"
+#include "PackedPreset.h"
+#include <charconv>
+#include <cstring>
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr const char* OperatorLabels[] = { "M1: ", "C1: ", "M2: ", "C2: " };
+    constexpr size_t MaxIntChars = 12;  // sign plus ten digits, with room to spare
+    constexpr int InternalPanCenter = 3;  // Presets carry no pan; Preset::toVOPM writes center
+}
+
+OPMWriter::OPMWriter(juce::OutputStream& destination)
+    : out(destination),
+      buffer(BufferSize)
+{
+}
+
+OPMWriter::~OPMWriter()
+{
+    flush();
+}
+
+void OPMWriter::writeHeader(const juce::StringArray& commentLines)
+{
+    static constexpr char rule[] = ";==================================================\n";
+    append(rule, sizeof(rule) - 1);
+    for (const auto& line : commentLines)
+    {
+        append("; ", 2);
+        const char* utf8 = line.toRawUTF8();
+        append(utf8, std::strlen(utf8));
+        append('\n');
+    }
+    append(rule, sizeof(rule) - 1);
+    append('\n');
+}
+
+void OPMWriter::writeVoice(const VOPMVoice& voice)
+{
+    writeVoiceBody(voice);
+    append('\n');
+}
+
+void OPMWriter::writeVoiceBody(const VOPMVoice& voice)
+{
+    const char* name = voice.name.toRawUTF8();
+    writeHeaderLine(voice.number, name, std::strlen(name));
+
+    const int lfo[] = { voice.lfo.frequency, voice.lfo.amd, voice.lfo.pmd, voice.lfo.waveform, voice.lfo.noiseFreq };
+    writeLine("LFO: ", lfo, 5);
+
+    const int channel[] = {
+        VOPMParser::convertInternalPanToOpm(voice.channel.pan),
+        voice.channel.feedback,
+        voice.channel.algorithm,
+        voice.channel.ams,
+        voice.channel.pms,
+        VOPMParser::convertInternalSlotToOpm(voice.channel.slotMask),
+        voice.channel.noiseEnable
+    };
+    writeLine("CH: ", channel, 7);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& op = voice.operators[i];
+        const int values[] = {
+            op.attackRate, op.decay1Rate, op.decay2Rate, op.releaseRate, op.decay1Level,
+            op.totalLevel, op.keyScale, op.multiple, op.detune1, op.detune2,
+            VOPMParser::convertInternalAmeToOpm(op.amsEnable)
+        };
+        writeLine(OperatorLabels[i], values, 11);
+    }
+}
+
+void OPMWriter::writeVoice(const PackedPreset& preset, const PresetStringPool& names)
+{
+    // Field for field what Preset::toVOPM produces, read straight from the packed bits
+    const char* name = names.getUTF8(preset.nameOffset);
+    writeHeaderLine(preset.id, name, std::strlen(name));
+
+    const auto& voice = preset.voice;
+    const int lfo[] = {
+        static_cast<int>(voice.lfoRate), static_cast<int>(voice.lfoAmd), static_cast<int>(voice.lfoPmd),
+        static_cast<int>(voice.lfoWaveform), static_cast<int>(voice.noiseFreq)
+    };
+    writeLine("LFO: ", lfo, 5);
+
+    int slotMask = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (preset.operators[i].slotEnable)
+            slotMask |= (1 << i);
+    }
+
+    const int channel[] = {
+        VOPMParser::convertInternalPanToOpm(InternalPanCenter),
+        static_cast<int>(voice.feedback),
+        static_cast<int>(voice.algorithm),
+        static_cast<int>(voice.ams),
+        static_cast<int>(voice.pms),
+        VOPMParser::convertInternalSlotToOpm(slotMask),
+        static_cast<int>(voice.noiseEnable)
+    };
+    writeLine("CH: ", channel, 7);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& op = preset.operators[i];
+        const int values[] = {
+            static_cast<int>(op.attackRate), static_cast<int>(op.decay1Rate), static_cast<int>(op.decay2Rate),
+            static_cast<int>(op.releaseRate), static_cast<int>(op.sustainLevel), static_cast<int>(op.totalLevel),
+            static_cast<int>(op.keyScale), static_cast<int>(op.multiple), static_cast<int>(op.detune1),
+            static_cast<int>(op.detune2), VOPMParser::convertInternalAmeToOpm(static_cast<int>(op.amsEnable))
+        };
+        writeLine(OperatorLabels[i], values, 11);
+    }
+
+    append('\n');
+}
+
+bool OPMWriter::flush()
+{
+    drain();
+    out.flush();
+    return !failed;
+}
+
+bool OPMWriter::writeFile(const juce::File& file, const std::function<void(OPMWriter&)>& writeContent)
+{
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream stream(temp.getFile());
+        if (!stream.openedOk())
+            return false;
+
+        OPMWriter writer(stream);
+        writeContent(writer);
+        if (!writer.flush() || stream.getStatus().failed())
+            return false;
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void OPMWriter::writeHeaderLine(int number, const char* name, size_t nameLength)
+{
+    append("@:", 2);
+    appendInt(number);
+    append(' ');
+    append(name, nameLength);
+    append('\n');
+}
+
+void OPMWriter::writeLine(const char* label, const int* values, int numValues)
+{
+    reserve(std::strlen(label) + static_cast<size_t>(numValues) * (MaxIntChars + 1) + 1);
+    append(label, std::strlen(label));
+    for (int i = 0; i < numValues; ++i)
+    {
+        if (i > 0)
+            append(' ');
+        appendInt(values[i]);
+    }
+    append('\n');
+}
+
+void OPMWriter::append(const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        if (used == BufferSize)
+            drain();
+
+        const size_t chunk = juce::jmin(size, BufferSize - used);
+        std::memcpy(buffer.get() + used, data, chunk);
+        used += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void OPMWriter::append(char c)
+{
+    if (used == BufferSize)
+        drain();
+    buffer[used++] = c;
+}
+
+void OPMWriter::appendInt(int value)
+{
+    reserve(MaxIntChars);
+    char* const begin = buffer.get() + used;
+    const auto result = std::to_chars(begin, begin + MaxIntChars, value);
+    used += static_cast<size_t>(result.ptr - begin);
+}
+
+void OPMWriter::reserve(size_t size)
+{
+    if (BufferSize - used < size)
+        drain();
+}
+
+void OPMWriter::drain()
+{
+    if (used == 0)
+        return;
+
+    if (!failed && !out.write(buffer.get(), used))
+        failed = true;
+    used = 0;
+}
+
+} // namespace ymulatorsynth
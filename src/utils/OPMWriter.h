@@ -0,0 +1,72 @@
+#pragma once
+
+#include "VOPMParser.h"
+#include <juce_core/juce_core.h>
+#include <functional>
+
+namespace ymulatorsynth {
+
+struct PackedPreset;
+class PresetStringPool;
+
+/**
+ * OPMWriter - Streams voices in VOPM text format to an output stream
+ *
+ * Numbers are formatted with std::to_chars straight into a fixed-size
+ * buffer, which is handed to the stream whenever it fills up. Memory use is
+ * independent of the number of voices, so whole libraries can be exported
+ * without building the file in a juce::String first.
+ *
+ * The output is the format produced by VOPMParser::voiceToString, which
+ * itself is written through this class.
+ */
+class OPMWriter
+{
+public:
+    static constexpr size_t BufferSize = 64 * 1024;
+
+    explicit OPMWriter(juce::OutputStream& destination);
+    ~OPMWriter();
+
+    /** Writes a ";====" framed comment block followed by a blank line */
+    void writeHeader(const juce::StringArray& commentLines);
+
+    /** Writes one voice followed by a blank line */
+    void writeVoice(const VOPMVoice& voice);
+
+    /** Writes a packed library entry without expanding it to a Preset first */
+    void writeVoice(const PackedPreset& preset, const PresetStringPool& names);
+
+    /** Writes one voice without the trailing blank line (see VOPMParser::voiceToString) */
+    void writeVoiceBody(const VOPMVoice& voice);
+
+    /**
+     * Hands buffered output to the stream and flushes it
+     * @return false if any write to the stream failed
+     */
+    bool flush();
+
+    /**
+     * Writes a complete file through a temporary file that replaces the target
+     * only once everything was written successfully
+     */
+    static bool writeFile(const juce::File& file, const std::function<void(OPMWriter&)>& writeContent);
+
+private:
+    void writeLine(const char* label, const int* values, int numValues);
+    void writeHeaderLine(int number, const char* name, size_t nameLength);
+    void append(const char* data, size_t size);
+    void append(char c);
+    void appendInt(int value);
+    void reserve(size_t size);
+    void drain();
+
+    juce::OutputStream& out;
+    juce::HeapBlock<char> buffer;
+    size_t used = 0;
+    bool failed = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OPMWriter)
+};
+
+} // namespace ymulatorsynth
@@ -0,0 +1,118 @@
+#include "PackedPreset.h"
+#include "PresetManager.h"
+#include "PresetHash.h"
+#include "PresetSearchIndex.h"
+#include <cstring>
+
+namespace ymulatorsynth {
+
+namespace {
+    uint64_t field(float value, int maxValue)
+    {
+        return static_cast<uint64_t>(juce::jlimit(0, maxValue, static_cast<int>(value)));
+    }
+
+    uint64_t field(int value, int maxValue)
+    {
+        return static_cast<uint64_t>(juce::jlimit(0, maxValue, value));
+    }
+}
+
+uint32_t PresetStringPool::add(const char* utf8)
+{
+    const auto offset = static_cast<uint32_t>(buffer.size());
+    buffer.insert(buffer.end(), utf8, utf8 + std::strlen(utf8) + 1);
+    return offset;
+}
+
+PackedPreset PackedPreset::pack(const Preset& preset, uint32_t nameOffset)
+{
+    PackedPreset packed {};
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& source = preset.operators[i];
+        auto& op = packed.operators[i];
+        op.totalLevel = field(source.totalLevel, 127);
+        op.attackRate = field(source.attackRate, 31);
+        op.decay1Rate = field(source.decay1Rate, 31);
+        op.decay2Rate = field(source.decay2Rate, 31);
+        op.releaseRate = field(source.releaseRate, 15);
+        op.sustainLevel = field(source.sustainLevel, 15);
+        op.keyScale = field(source.keyScale, 3);
+        op.multiple = field(source.multiple, 15);
+        op.detune1 = field(source.detune1, 7);
+        op.detune2 = field(source.detune2, 3);
+        op.amsEnable = source.amsEnable ? 1 : 0;
+        op.slotEnable = source.slotEnable ? 1 : 0;
+    }
+
+    auto& voice = packed.voice;
+    voice.algorithm = field(preset.algorithm, 7);
+    voice.feedback = field(preset.feedback, 7);
+    voice.ams = field(preset.channels[0].ams, 3);
+    voice.pms = field(preset.channels[0].pms, 7);
+    voice.noiseEnable = preset.channels[0].noiseEnable != 0 ? 1 : 0;
+    voice.noiseFreq = field(preset.lfo.noiseFreq, 31);
+    voice.lfoRate = field(preset.lfo.rate, 255);
+    voice.lfoAmd = field(preset.lfo.amd, 127);
+    voice.lfoPmd = field(preset.lfo.pmd, 127);
+    voice.lfoWaveform = field(preset.lfo.waveform, 3);
+
+    packed.soundHash = PresetHash::compute(preset);
+    packed.id = preset.id;
+    packed.nameOffset = nameOffset;
+    packed.tags = makeSearchTags(preset);
+    return packed;
+}
+
+uint32_t PackedPreset::makeSearchTags(const Preset& preset)
+{
+    return PresetSearchIndex::makeTags(preset.algorithm, preset.feedback,
+                                       preset.channels[0].noiseEnable != 0,
+                                       preset.lfo.amd > 0 || preset.lfo.pmd > 0);
+}
+
+Preset PackedPreset::unpack(const PresetStringPool& names) const
+{
+    Preset preset;
+    preset.id = id;
+    preset.name = names.get(nameOffset);
+    preset.algorithm = static_cast<int>(voice.algorithm);
+    preset.feedback = static_cast<int>(voice.feedback);
+
+    preset.lfo.rate = static_cast<int>(voice.lfoRate);
+    preset.lfo.amd = static_cast<int>(voice.lfoAmd);
+    preset.lfo.pmd = static_cast<int>(voice.lfoPmd);
+    preset.lfo.waveform = static_cast<int>(voice.lfoWaveform);
+    preset.lfo.noiseFreq = static_cast<int>(voice.noiseFreq);
+
+    for (auto& channel : preset.channels)
+    {
+        channel.ams = static_cast<int>(voice.ams);
+        channel.pms = static_cast<int>(voice.pms);
+        channel.noiseEnable = static_cast<int>(voice.noiseEnable);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& op = operators[i];
+        auto& target = preset.operators[i];
+        target.totalLevel = static_cast<float>(op.totalLevel);
+        target.attackRate = static_cast<float>(op.attackRate);
+        target.decay1Rate = static_cast<float>(op.decay1Rate);
+        target.decay2Rate = static_cast<float>(op.decay2Rate);
+        target.releaseRate = static_cast<float>(op.releaseRate);
+        target.sustainLevel = static_cast<float>(op.sustainLevel);
+        target.keyScale = static_cast<float>(op.keyScale);
+        target.multiple = static_cast<float>(op.multiple);
+        target.detune1 = static_cast<float>(op.detune1);
+        target.detune2 = static_cast<float>(op.detune2);
+        target.amsEnable = op.amsEnable != 0;
+        target.slotEnable = op.slotEnable != 0;
+    }
+
+    return preset;
+}
+
+} // namespace ymulatorsynth
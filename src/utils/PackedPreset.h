@@ -0,0 +1,113 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace ymulatorsynth {
+
+struct Preset;
+
+/**
+ * PresetStringPool - Append-only storage for preset names
+ *
+ * Names are stored back to back as null-terminated UTF-8 in a single buffer
+ * and referenced by byte offset, so the names of a whole library cost one
+ * allocation instead of one per preset.
+ */
+class PresetStringPool
+{
+public:
+    /** Appends a string and returns its offset */
+    uint32_t add(const juce::String& text) { return add(text.toRawUTF8()); }
+    uint32_t add(const char* utf8);
+
+    const char* getUTF8(uint32_t offset) const { return buffer.data() + offset; }
+    juce::String get(uint32_t offset) const { return juce::String::fromUTF8(getUTF8(offset)); }
+
+    void clear() { buffer.clear(); }
+    size_t getSizeInBytes() const { return buffer.size(); }
+
+private:
+    std::vector<char> buffer;
+};
+
+/**
+ * PackedPreset - Compact, trivially copyable form of a Preset (64 bytes)
+ *
+ * Operator values are bitfields at their hardware widths, the voice-wide
+ * settings share one word, and the name is an offset into a
+ * PresetStringPool. The sound hash and search tags are computed once when
+ * packing, so library scans (search, de-duplication, similarity) read one
+ * cache line per preset and never touch strings or floats.
+ *
+ * Preset stores AMS/PMS/noise per channel, but presets are always
+ * single-voice (see Preset::fromVOPM), so only channel 0 is packed and
+ * unpack() copies it to all eight channels.
+ */
+struct PackedPreset
+{
+    struct Operator
+    {
+        uint64_t totalLevel   : 7;
+        uint64_t attackRate   : 5;
+        uint64_t decay1Rate   : 5;
+        uint64_t decay2Rate   : 5;
+        uint64_t releaseRate  : 4;
+        uint64_t sustainLevel : 4;
+        uint64_t keyScale     : 2;
+        uint64_t multiple     : 4;
+        uint64_t detune1      : 3;
+        uint64_t detune2      : 2;
+        uint64_t amsEnable    : 1;
+        uint64_t slotEnable   : 1;
+    };
+
+    struct Voice
+    {
+        uint64_t algorithm   : 3;
+        uint64_t feedback    : 3;
+        uint64_t ams         : 2;
+        uint64_t pms         : 3;
+        uint64_t noiseEnable : 1;
+        uint64_t noiseFreq   : 5;
+        uint64_t lfoRate     : 8;
+        uint64_t lfoAmd      : 7;
+        uint64_t lfoPmd      : 7;
+        uint64_t lfoWaveform : 2;
+    };
+
+    Operator operators[4];
+    Voice voice;
+    uint64_t soundHash;   // PresetHash::compute() of the source preset
+    int32_t id;
+    uint32_t nameOffset;  // offset into the owning PresetStringPool
+    uint32_t tags;        // PresetSearchIndex tag bits
+    uint32_t flags;       // see Flags
+
+    enum Flags : uint32_t
+    {
+        Removed = 1u << 0   // the slot of a preset removed from the library
+    };
+
+    bool isRemoved() const { return (flags & Removed) != 0; }
+
+    /**
+     * Packs a preset; out-of-range values are clamped
+     * @param preset Source preset
+     * @param nameOffset Offset of the preset's name in the string pool
+     */
+    static PackedPreset pack(const Preset& preset, uint32_t nameOffset);
+
+    /** The PresetSearchIndex tag bits pack() stores for a preset */
+    static uint32_t makeSearchTags(const Preset& preset);
+
+    /** Expands back to the editable Preset form */
+    Preset unpack(const PresetStringPool& names) const;
+};
+
+static_assert(sizeof(PackedPreset) == 64, "PackedPreset should fill exactly one cache line");
+static_assert(std::is_trivially_copyable<PackedPreset>::value, "PackedPreset must stay a POD");
+
+} // namespace ymulatorsynth
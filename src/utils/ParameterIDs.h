@@ -257,6 +257,26 @@ namespace MIDI_CC {
     constexpr int Op3_D1L = 61;
     constexpr int Op4_D1L = 62;
     
+    // Parameter number and data entry controllers (standard MIDI). CC 38 is
+    // also channel 6 pan; it only acts as Data Entry LSB while an NRPN or RPN
+    // is selected on the MIDI channel.
+    constexpr int DataEntryMsb = 6;
+    constexpr int DataEntryLsb = 38;
+    constexpr int DataIncrement = 96;
+    constexpr int DataDecrement = 97;
+    constexpr int NrpnLsb = 98;
+    constexpr int NrpnMsb = 99;
+    constexpr int RpnLsb = 100;
+    constexpr int RpnMsb = 101;
+    
+    // Bank Select (standard MIDI). CC 32 is also channel 0 pan; it only acts
+    // as Bank Select LSB directly after a Bank Select MSB on the MIDI channel.
+    constexpr int BankSelectMsb = 0;
+    constexpr int BankSelectLsb = 32;
+    
+    // MPE timbre (third dimension of expression); only on MPE zone channels
+    constexpr int MpeTimbre = 74;
+    
     // Helper function to get CC number for operator parameter
     inline int getOpCC(int opNum, const char* paramType) {
         if (std::string(paramType) == Op::TotalLevel) {
@@ -284,6 +304,59 @@ namespace MIDI_CC {
     }
 } // namespace MIDI_CC
 
+// =============================================================================
+// NRPN Mapping Constants
+// =============================================================================
+
+// Every automatable parameter has an NRPN: MSB (CC 99) selects the group,
+// LSB (CC 98) the parameter in it. Data entry (CC 6 MSB, CC 38 LSB) carries
+// the value as a 14-bit integer in the parameter's own units, e.g. TL 0-127
+// or LFO rate 0-255, so no value is lost to 7-bit scaling. Channel pans are
+// continuous and use the full 0-16383 range.
+namespace NRPN {
+    constexpr int GlobalGroup = 0;
+    constexpr int Op1Group = 1;        // groups 1-4 are operators 1-4
+    constexpr int ChannelGroup = 5;
+    constexpr int NumGroups = 6;
+    constexpr int MaxParametersPerGroup = 16;
+    
+    // Global group
+    constexpr int Algorithm = 0;
+    constexpr int Feedback = 1;
+    constexpr int LfoRate = 2;
+    constexpr int LfoAmd = 3;
+    constexpr int LfoPmd = 4;
+    constexpr int LfoWaveform = 5;
+    constexpr int NoiseEnable = 6;
+    constexpr int NoiseFrequency = 7;
+    constexpr int GlobalPan = 8;
+    constexpr int PitchBendRange = 9;
+    
+    // Operator groups, in the order of the per-operator CC block
+    constexpr int OpTL = 0;
+    constexpr int OpAR = 1;
+    constexpr int OpD1R = 2;
+    constexpr int OpD2R = 3;
+    constexpr int OpRR = 4;
+    constexpr int OpD1L = 5;
+    constexpr int OpKS = 6;
+    constexpr int OpMUL = 7;
+    constexpr int OpDT1 = 8;
+    constexpr int OpDT2 = 9;
+    constexpr int OpAmsEnable = 10;
+    
+    // Channel group: the LSB is the channel (0-7) and selects its pan
+    
+    // Full 14-bit parameter number (MSB * 128 + LSB)
+    constexpr int number(int group, int parameter) { return group * 128 + parameter; }
+    
+    // Registered parameter for pitch bend sensitivity (RPN 0; data MSB = semitones)
+    constexpr int RpnPitchBendSensitivity = 0;
+    
+    // MPE Configuration Message (RPN 6 on a zone's master channel; data MSB = member channels)
+    constexpr int RpnMpeConfiguration = 6;
+} // namespace NRPN
+
 // =============================================================================
 // Parameter Validation
 // =============================================================================
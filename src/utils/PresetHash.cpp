@@ -0,0 +1,115 @@
+#include "PresetHash.h"
+#include "PresetManager.h"
+#include "../dsp/YM2151Registers.h"
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr int NoiseOperator = 3;  // Noise replaces the C2 slot
+
+    int field(float value, int maxValue)
+    {
+        return juce::jlimit(0, maxValue, static_cast<int>(value));
+    }
+
+    int field(int value, int maxValue)
+    {
+        return juce::jlimit(0, maxValue, value);
+    }
+
+    bool isAudible(const Preset::OperatorData& op)
+    {
+        // AR 0 never starts the attack, so the slot stays fully attenuated
+        return op.slotEnable && field(op.attackRate, 31) > 0;
+    }
+}
+
+PresetHash::CanonicalImage PresetHash::makeCanonicalImage(const Preset& preset)
+{
+    using namespace YM2151Regs;
+
+    CanonicalImage image {};
+    const auto& channel = preset.channels[0];
+    const bool noise = channel.noiseEnable != 0;
+
+    bool audible[4];
+    bool anyAmsEnabled = false;
+    for (int op = 0; op < 4; ++op)
+    {
+        audible[op] = isAudible(preset.operators[op]);
+        anyAmsEnabled = anyAmsEnabled || (audible[op] && preset.operators[op].amsEnable);
+    }
+
+    const int pmd = field(preset.lfo.pmd, 127);
+    const int pms = field(channel.pms, 7);
+    const bool phaseModulation = pmd > 0 && pms > 0;
+
+    const int amd = field(preset.lfo.amd, 127);
+    const int ams = field(channel.ams, 3);
+    const bool amplitudeModulation = amd > 0 && ams > 0 && anyAmsEnabled;
+
+    for (int op = 0; op < 4; ++op)
+    {
+        if (!audible[op])
+            continue;
+
+        const auto& data = preset.operators[op];
+        auto* out = image.data() + op * 6;
+
+        int dt1 = field(data.detune1, 7);
+        int mul = field(data.multiple, 15);
+        int dt2 = field(data.detune2, 3);
+        if (dt1 == 4)
+            dt1 = 0;
+        if (noise && op == NoiseOperator)
+            dt1 = mul = dt2 = 0;
+
+        const bool amsEnable = amplitudeModulation && data.amsEnable;
+
+        out[0] = static_cast<uint8_t>((dt1 << SHIFT_DETUNE1) | mul);
+        out[1] = static_cast<uint8_t>(field(data.totalLevel, 127));
+        out[2] = static_cast<uint8_t>((field(data.keyScale, 3) << SHIFT_KEY_SCALE) | field(data.attackRate, 31));
+        out[3] = static_cast<uint8_t>((amsEnable ? MASK_AMS_PRESERVE : 0) | field(data.decay1Rate, 31));
+        out[4] = static_cast<uint8_t>((dt2 << SHIFT_DETUNE2) | field(data.decay2Rate, 31));
+        out[5] = static_cast<uint8_t>((field(data.sustainLevel, 15) << SHIFT_SUSTAIN_LEVEL) | field(data.releaseRate, 15));
+    }
+
+    auto* channelBytes = image.data() + 4 * 6;
+    const int feedback = audible[0] ? field(preset.feedback, 7) : 0;
+    channelBytes[0] = static_cast<uint8_t>((feedback << SHIFT_FEEDBACK) | field(preset.algorithm, 7));
+    channelBytes[1] = static_cast<uint8_t>(((phaseModulation ? pms : 0) << 4) | (amplitudeModulation ? ams : 0));
+
+    if (phaseModulation || amplitudeModulation)
+    {
+        channelBytes[2] = static_cast<uint8_t>(field(preset.lfo.rate, 255));
+        channelBytes[3] = static_cast<uint8_t>(amplitudeModulation ? amd : 0);
+        channelBytes[4] = static_cast<uint8_t>(phaseModulation ? pmd : 0);
+        channelBytes[5] = static_cast<uint8_t>(field(preset.lfo.waveform, 3));
+    }
+
+    if (noise)
+        channelBytes[6] = static_cast<uint8_t>(MASK_NOISE_ENABLE | field(preset.lfo.noiseFreq, 31));
+
+    return image;
+}
+
+uint64_t PresetHash::compute(const Preset& preset)
+{
+    const auto image = makeCanonicalImage(preset);
+
+    // FNV-1a over the image, then a final avalanche so that presets differing
+    // in a single low bit spread across hash buckets
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (auto byte : image)
+    {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+} // namespace ymulatorsynth
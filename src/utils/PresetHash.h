@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace ymulatorsynth {
+
+struct Preset;
+
+/**
+ * PresetHash - Sound identity of a preset
+ *
+ * A preset is reduced to the register bytes it programs into one YM2151
+ * channel, with every field that cannot change the output zeroed or folded
+ * onto a single value. Two presets with the same canonical image sound the
+ * same regardless of name, voice number or bank.
+ *
+ * Canonicalization rules:
+ *   - DT1 4 is the same as DT1 0 (both are zero detune)
+ *   - Disabled slots and slots with AR 0 never leave full attenuation; all
+ *     of their operator bytes are zeroed
+ *   - Feedback is dropped when M1 is silent
+ *   - AMS-EN bits, AMS and AMD are dropped when amplitude modulation cannot
+ *     reach the output; PMS and PMD likewise for phase modulation
+ *   - LFO rate and waveform are dropped when the LFO modulates nothing
+ *   - Noise frequency is dropped when noise is off; with noise on, the
+ *     C2 pitch fields (DT1, MUL, DT2) are dropped because noise replaces
+ *     its oscillator
+ */
+class PresetHash
+{
+public:
+    static constexpr int ImageSize = 4 * 6 + 7;
+    using CanonicalImage = std::array<uint8_t, ImageSize>;
+
+    /** Builds the canonical register image of a preset */
+    static CanonicalImage makeCanonicalImage(const Preset& preset);
+
+    /** 64-bit hash of the canonical register image */
+    static uint64_t compute(const Preset& preset);
+};
+
+} // namespace ymulatorsynth
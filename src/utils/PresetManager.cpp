@@ -1,6 +1,11 @@
 #include "PresetManager.h"
+#include "UserPresetJournal.h"
+#include "BankImportJob.h"
 #include "Debug.h"
 #include "VOPMParser.h"
+#include "OPMWriter.h"
+#include "../dsp/YM2151Registers.h"
+#include <algorithm>
 
 #ifdef USING_MOCK_BINARY_DATA
 #include "../tests/mocks/MockBinaryData.h"
@@ -213,24 +218,154 @@ VOPMVoice Preset::toVOPM() const
     return voice;
 }
 
+RegisterImage Preset::toRegisterImage() const
+{
+    using namespace YM2151Regs;
+    auto field = [](float value, int maxValue) { return juce::jlimit(0, maxValue, static_cast<int>(value)); };
+    
+    RegisterImage image;
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& op = operators[i];
+        auto* regs = image.operators[i];
+        regs[0] = static_cast<uint8_t>((field(op.detune1, 7) << SHIFT_DETUNE1) | field(op.multiple, 15));
+        regs[1] = static_cast<uint8_t>(field(op.totalLevel, 127));
+        regs[2] = static_cast<uint8_t>((field(op.keyScale, 3) << SHIFT_KEY_SCALE) | field(op.attackRate, 31));
+        regs[3] = static_cast<uint8_t>((op.amsEnable ? MASK_AMS_PRESERVE : 0) | field(op.decay1Rate, 31));
+        regs[4] = static_cast<uint8_t>((field(op.detune2, 3) << SHIFT_DETUNE2) | field(op.decay2Rate, 31));
+        regs[5] = static_cast<uint8_t>((field(op.sustainLevel, 15) << SHIFT_SUSTAIN_LEVEL) | field(op.releaseRate, 15));
+    }
+    
+    image.connection = static_cast<uint8_t>((juce::jlimit(0, 7, feedback) << SHIFT_FEEDBACK) | juce::jlimit(0, 7, algorithm));
+    image.amsPms = static_cast<uint8_t>((juce::jlimit(0, 7, channels[0].pms) << SHIFT_LFO_PMS) | juce::jlimit(0, 3, channels[0].ams));
+    
+    image.lfoRate = static_cast<uint8_t>(juce::jlimit(0, 255, lfo.rate));
+    image.lfoAmd = static_cast<uint8_t>(juce::jlimit(0, 127, lfo.amd));
+    image.lfoPmd = static_cast<uint8_t>(juce::jlimit(0, 127, lfo.pmd));
+    image.lfoWaveform = static_cast<uint8_t>(juce::jlimit(0, 3, lfo.waveform));
+    image.noise = static_cast<uint8_t>((channels[0].noiseEnable != 0 ? MASK_NOISE_ENABLE : 0) | juce::jlimit(0, 31, lfo.noiseFreq));
+    return image;
+}
+
 // PresetManager implementation
+namespace {
+    constexpr const char* BundledCollectionFileName = "ymulator-synth-preset-collection.opm";
+    
+    size_t chunkOf(int index) { return static_cast<size_t>(index / PresetChunk::Capacity); }
+    size_t slotOf(int index) { return static_cast<size_t>(index % PresetChunk::Capacity); }
+    
+    void writeLibrary(OPMWriter& writer, const PresetLibrarySnapshot& library)
+    {
+        writer.writeHeader({ "YMulator Synth Presets", "Generated automatically" });
+        for (const auto& chunk : library.chunks)
+        {
+            for (const auto& packed : chunk->presets)
+            {
+                if (!packed.isRemoved())
+                    writer.writeVoice(packed, chunk->names);
+            }
+        }
+    }
+}
+
 PresetManager::PresetManager()
+    : backgroundPool(std::make_unique<juce::ThreadPool>(1))
 {
+    publishSnapshot();
+}
+
+PresetManager::~PresetManager()
+{
+    // Stop background jobs before the library they read is destroyed
+    stopWatchingBankDirectories();
+    backgroundPool.reset();
 }
 
 void PresetManager::initialize()
 {
-    clear();
-    loadFactoryPresets();
-    loadBundledPresets();
-    initializeBanks();
-    loadUserData();  // Load persistent user data
+    finishInitialization(-1);  // A deferred load still in progress is superseded
+    loadLibrary(readLibrarySources(getPresetsDirectory(), getUserDataDirectory(), getUserJournal()));
+}
+
+void PresetManager::initializeAsync(std::function<void()> onReady)
+{
+    finishInitialization(-1);  // At most one deferred load at a time
     
-    CS_DBG("PresetManager initialized with " + juce::String(presets.size()) + " presets in " + juce::String(banks.size()) + " banks");
+    // The factory presets are compiled in, so the Init voice is there right away
+    {
+        ScopedLibraryUpdate update(*this);
+        clear();
+        loadFactoryPresets();
+        initializeBanks();
+    }
+    
+    auto load = std::make_shared<PendingLibraryLoad>();
+    load->onReady = std::move(onReady);
+    pendingLibraryLoad = load;
+    libraryReady = false;
+    
+    backgroundPool->addJob([this, load, userDataDirectory = getUserDataDirectory(), &journal = getUserJournal()]()
+    {
+        load->sources = readLibrarySources(getPresetsDirectory(), userDataDirectory, journal);
+        load->readFinished.signal();
+        triggerAsyncUpdate();
+    });
+    
+    CS_DBG("PresetManager published " + juce::String(numPresetSlots) + " factory presets, loading the rest in the background");
+}
+
+bool PresetManager::finishInitialization(int timeoutMs)
+{
+    if (pendingLibraryLoad == nullptr)
+        return true;
+    
+    if (!pendingLibraryLoad->readFinished.wait(timeoutMs))
+        return false;
+    
+    auto load = std::move(pendingLibraryLoad);
+    pendingLibraryLoad = nullptr;
+    loadLibrary(std::move(load->sources));
+    libraryReady = true;
+    
+    if (load->onReady)
+        load->onReady();
+    return true;
+}
+
+PresetManager::LibrarySources PresetManager::readLibrarySources(const juce::File& presetsDirectory,
+                                                                const juce::File& userDataDirectory,
+                                                                UserPresetJournal& journal)
+{
+    LibrarySources sources;
+    readBundledPresets(sources, presetsDirectory);
+    readUserPresets(sources, journal);
+    readImportedBanks(sources, userDataDirectory);
+    return sources;
+}
+
+void PresetManager::loadLibrary(LibrarySources sources)
+{
+    {
+        ScopedLibraryUpdate update(*this);
+        deferSearchRebuild = true;
+        clear();
+        loadFactoryPresets();
+        addBundledPresets(sources);
+        initializeBanks();
+        addUserPresets(sources);
+        addImportedBanks(sources);
+        deferSearchRebuild = false;
+    }
+    rebuildSearchIndexAsync();
+    rebuildSimilarityIndexAsync();
+    
+    CS_DBG("PresetManager initialized with " + juce::String(numPresetSlots) + " presets in " + juce::String(banks.size()) + " banks");
 }
 
 int PresetManager::loadOPMFile(const juce::File& file)
 {
+    waitForDeferredLoad();
+    
     if (!file.exists())
     {
         CS_DBG("OPM file does not exist: " + file.getFullPathName());
@@ -239,7 +374,11 @@ int PresetManager::loadOPMFile(const juce::File& file)
     
     auto voices = VOPMParser::parseFile(file);
     CS_DBG("VOPMParser returned " + juce::String(voices.size()) + " voices");
-    
+    return addOPMBank(file, voices);
+}
+
+int PresetManager::addOPMBank(const juce::File& file, const std::vector<VOPMVoice>& voices)
+{
     if (voices.empty()) {
         CS_DBG("No voices found in file: " + file.getFullPathName());
         return 0;
@@ -256,196 +395,1278 @@ int PresetManager::loadOPMFile(const juce::File& file)
         }
     }
     
-    int loaded = 0;
-    int startIndex = static_cast<int>(presets.size());
-    std::vector<int> bankPresetIndices;
+    ScopedLibraryUpdate update(*this);
+    auto bankPresetIndices = appendVoices(voices);
+    const int loaded = static_cast<int>(bankPresetIndices.size());
+    
+    // Create and add the bank with the collected indices
+    Bank newBank(bankName, file.getFileName().toStdString());
+    newBank.presetIndices = bankPresetIndices;
+    banks.push_back(newBank);
+    invalidateCaches();
+    
+    CS_DBG("Loaded " + juce::String(loaded) + " presets from " + file.getFileName() + " as bank '" + bankName + "'");
+    CS_DBG("Bank '" + juce::String(bankName) + "' now has " + juce::String(banks.back().presetIndices.size()) + " preset indices");
+    
+    // Copy the OPM file to persistent storage for future loading
+    auto banksDir = getUserDataDirectory().getChildFile("banks");
+    banksDir.createDirectory();
+    auto targetFile = banksDir.getChildFile(file.getFileName());
+    if (!targetFile.exists()) {
+        file.copyFileTo(targetFile);
+        CS_DBG("Copied OPM file to persistent storage: " + targetFile.getFullPathName());
+    }
+    
+    // Save imported banks list
+    saveImportedBanks();
+    rebuildSearchIndexAsync();
+    rebuildSimilarityIndexAsync();
+    
+    return loaded;
+}
+
+std::vector<int> PresetManager::appendVoices(const std::vector<VOPMVoice>& voices)
+{
+    std::vector<Preset> converted;
+    converted.reserve(voices.size());
+    for (const auto& voice : voices)
+    {
+        CS_DBG("Converting voice " + juce::String(voice.number) + " '" + voice.name + "' to preset");
+        converted.push_back(Preset::fromVOPM(voice));
+        validatePreset(converted.back());
+    }
+    return appendPresets(std::move(converted));
+}
+
+std::vector<int> PresetManager::appendPresets(std::vector<Preset> converted)
+{
+    std::vector<int> bankPresetIndices;
+    bankPresetIndices.reserve(converted.size());
+    int collapsed = 0;
+    
+    for (auto& preset : converted)
+    {
+        if (collapseDuplicatesOnImport)
+        {
+            const int existing = findPresetWithSameSound(preset);
+            if (existing >= 0)
+            {
+                // Same sound already in the library - share it instead of storing a copy
+                bankPresetIndices.push_back(existing);
+                collapsed++;
+                continue;
+            }
+        }
+        
+        // Use simple sequential IDs, skipping any still taken after removals
+        const int presetIndex = numPresetSlots;
+        preset.id = findFreePresetId();
+        
+        CS_DBG("Adding preset id=" + juce::String(preset.id) + " name='" + preset.name + "' at index " + juce::String(presetIndex));
+        appendPreset(preset);
+        
+        // Add to bank indices list
+        bankPresetIndices.push_back(presetIndex);
+    }
+    
+    if (collapsed > 0)
+        CS_DBG("Collapsed " + juce::String(collapsed) + " duplicate voices into existing presets");
+    
+    return bankPresetIndices;
+}
+
+std::shared_ptr<BankImportJob> PresetManager::importOPMFileAsync(const juce::File& file,
+                                                                 std::function<void(const BankImportJob&)> onComplete)
+{
+    waitForDeferredLoad();
+    
+    auto job = std::make_shared<BankImportJob>(file, getUserDataDirectory().getChildFile("banks"), std::move(onComplete));
+    
+    auto queueForPublishing = [this, job]()
+    {
+        {
+            const juce::ScopedLock sl(pendingBankChangesLock);
+            pendingImports.push_back(job);
+        }
+        triggerAsyncUpdate();
+    };
+    
+    if (findBankByFileName(file.getFileName()) >= 0 || backgroundPool == nullptr)
+    {
+        // Nothing to do in the background; still report through the usual path
+        job->status = BankImportJob::Status::Failed;
+        job->errorMessage = "Bank already loaded: " + file.getFileName();
+        job->readyToPublish = true;
+        queueForPublishing();
+        return job;
+    }
+    
+    backgroundPool->addJob([job, queueForPublishing]()
+    {
+        job->runBackgroundStages();
+        queueForPublishing();
+    });
+    return job;
+}
+
+void PresetManager::publishImport(BankImportJob& job)
+{
+    if (job.status != BankImportJob::Status::Pending)
+        return job.finish(job.status);
+    
+    if (job.isCancelled())
+        return job.finish(BankImportJob::Status::Cancelled);
+    
+    const auto fileName = job.file.getFileName();
+    if (findBankByFileName(fileName) >= 0)
+        return job.finish(BankImportJob::Status::Failed, "Bank already loaded: " + fileName);
+    
+    // The presets and the bank are published as one snapshot, before onComplete runs
+    Bank newBank(job.file.getFileNameWithoutExtension().toStdString(), fileName.toStdString());
+    {
+        ScopedLibraryUpdate update(*this);
+        newBank.presetIndices = appendPresets(std::move(job.presets));
+        banks.push_back(newBank);
+        invalidateCaches();
+    }
+    
+    job.numPresets = static_cast<int>(newBank.presetIndices.size());
+    job.bankIndex = static_cast<int>(banks.size()) - 1;
+    
+    if (job.persistedCopy.existsAsFile())
+    {
+        auto target = job.persistedCopy.getSiblingFile(fileName);
+        if (!target.exists() && !job.persistedCopy.moveFileTo(target))
+            job.warnings.add("Could not store " + fileName + " in the user banks folder");
+    }
+    
+    saveImportedBanks();
+    rebuildSearchIndexAsync();
+    rebuildSimilarityIndexAsync();
+    
+    CS_DBG("Imported " + juce::String(job.numPresets) + " presets from " + fileName + " in the background");
+    job.finish(BankImportJob::Status::Succeeded);
+}
+
+void PresetManager::dispatchPendingUpdates()
+{
+    cancelPendingUpdate();
+    handleAsyncUpdate();
+}
+
+void PresetManager::removePresetsAt(const std::vector<int>& indices)
+{
+    // The slots stay empty rather than closing up, so global indices held elsewhere
+    // (the current preset, staged MIDI banks, multitimbral parts) keep their meaning
+    for (int index : indices)
+    {
+        if (findPackedPreset(index) == nullptr)
+            continue;
+        
+        unindexPreset(index);
+        auto& chunk = getWritableChunk(index);
+        chunk.presets[slotOf(index)].flags |= PackedPreset::Removed;
+        chunk.registerImages[slotOf(index)] = RegisterImage();
+        ++numRemovedPresets;
+    }
+}
+
+std::vector<int> PresetManager::findUnreferencedPresets(const std::vector<int>& candidates) const
+{
+    // One pass over the banks, however many candidates there are
+    std::vector<bool> referenced(static_cast<size_t>(numPresetSlots), false);
+    for (const auto& bank : banks)
+    {
+        for (int index : bank.presetIndices)
+        {
+            if (index >= 0 && index < static_cast<int>(referenced.size()))
+                referenced[static_cast<size_t>(index)] = true;
+        }
+    }
+    
+    std::vector<int> unreferenced;
+    for (int index : candidates)
+    {
+        if (index >= 0 && index < static_cast<int>(referenced.size()) && !referenced[static_cast<size_t>(index)])
+            unreferenced.push_back(index);
+    }
+    return unreferenced;
+}
+
+int PresetManager::findBankByFileName(const juce::String& fileName) const
+{
+    const auto name = fileName.toStdString();
+    for (int i = 0; i < static_cast<int>(banks.size()); ++i)
+    {
+        if (banks[i].fileName == name)
+            return i;
+    }
+    return -1;
+}
+
+void PresetManager::startWatchingBankDirectories(std::function<void()> onLibraryChanged)
+{
+    waitForDeferredLoad();
+    
+    stopWatchingBankDirectories();
+    libraryChangedCallback = std::move(onLibraryChanged);
+    
+    juce::Array<juce::File> directories { getUserDataDirectory().getChildFile("banks") };
+    directories.addIfNotAlreadyThere(getPresetsDirectory());
+    bankWatcher = std::make_unique<BankDirectoryWatcher>(directories);
+    
+    // Files that are already loaded are the baseline; anything else is picked up on the first scan
+    juce::Array<juce::File> loadedFiles;
+    for (const auto& directory : directories)
+    {
+        loadedFiles.add(directory.getChildFile(BundledCollectionFileName));
+        for (const auto& bank : banks)
+        {
+            if (!bank.fileName.empty())
+                loadedFiles.add(directory.getChildFile(juce::String(bank.fileName)));
+        }
+    }
+    bankWatcher->setBaseline(loadedFiles);
+    
+    bankWatcher->start([this](BankDirectoryWatcher::ChangeSet changes)
+    {
+        {
+            const juce::ScopedLock sl(pendingBankChangesLock);
+            pendingBankChanges.push_back(std::move(changes));
+        }
+        triggerAsyncUpdate();
+    });
+}
+
+void PresetManager::stopWatchingBankDirectories()
+{
+    bankWatcher.reset();
+    cancelPendingUpdate();
+    
+    const juce::ScopedLock sl(pendingBankChangesLock);
+    pendingBankChanges.clear();
+}
+
+void PresetManager::handleAsyncUpdate()
+{
+    // A deferred initialize() whose background read has finished
+    if (pendingLibraryLoad != nullptr)
+        finishInitialization(0);
+    
+    std::vector<BankDirectoryWatcher::ChangeSet> changeSets;
+    std::vector<std::shared_ptr<BankImportJob>> imports;
+    std::vector<std::function<void()>> exportCompletions;
+    {
+        const juce::ScopedLock sl(pendingBankChangesLock);
+        changeSets.swap(pendingBankChanges);
+        imports.swap(pendingImports);
+        exportCompletions.swap(pendingExportCompletions);
+    }
+    
+    bool changed = false;
+    for (const auto& changes : changeSets)
+        changed = applyBankChanges(changes) || changed;
+    
+    if (changed && libraryChangedCallback)
+        libraryChangedCallback();
+    
+    for (const auto& job : imports)
+        publishImport(*job);
+    
+    for (const auto& completion : exportCompletions)
+        completion();
+}
+
+bool PresetManager::applyBankChanges(const BankDirectoryWatcher::ChangeSet& changes)
+{
+    ScopedLibraryUpdate update(*this);
+    bool changed = false;
+    
+    // Presets that belonged only to a removed or rewritten bank
+    auto releaseBank = [this](int bankIndex)
+    {
+        auto candidates = banks[static_cast<size_t>(bankIndex)].presetIndices;
+        banks[static_cast<size_t>(bankIndex)].presetIndices.clear();
+        removePresetsAt(findUnreferencedPresets(candidates));
+    };
+    
+    for (const auto& file : changes.removed)
+    {
+        const int bankIndex = findBankByFileName(file.getFileName());
+        if (bankIndex < 0 || bankIndex == userBankIndex || banks[static_cast<size_t>(bankIndex)].name == "Factory")
+            continue;
+        
+        releaseBank(bankIndex);
+        banks.erase(banks.begin() + bankIndex);
+        if (userBankIndex > bankIndex)
+            --userBankIndex;
+        changed = true;
+        CS_DBG("Removed bank for deleted file " + file.getFileName());
+    }
+    
+    auto addOrReplace = [this, &changed](const BankDirectoryWatcher::BankFile& bankFile, bool isModified)
+    {
+        const auto fileName = bankFile.file.getFileName();
+        if (fileName == BundledCollectionFileName)
+            return;  // Part of the built-in library, not a bank
+        
+        const int bankIndex = findBankByFileName(fileName);
+        if (bankIndex >= 0 && !isModified)
+            return;  // Imported through PresetManager, which put the file there
+        
+        if (bankIndex >= 0)
+        {
+            releaseBank(bankIndex);
+            banks[static_cast<size_t>(bankIndex)].presetIndices = appendVoices(bankFile.voices);
+            changed = true;
+            CS_DBG("Reloaded bank from " + fileName + ": " + juce::String(bankFile.voices.size()) + " voices");
+        }
+        else if (!bankFile.voices.empty())
+        {
+            Bank newBank(bankFile.file.getFileNameWithoutExtension().toStdString(), fileName.toStdString());
+            newBank.presetIndices = appendVoices(bankFile.voices);
+            banks.push_back(newBank);
+            changed = true;
+            CS_DBG("Added bank from new file " + fileName + ": " + juce::String(bankFile.voices.size()) + " voices");
+        }
+    };
+    
+    for (const auto& bankFile : changes.modified)
+        addOrReplace(bankFile, true);
+    for (const auto& bankFile : changes.added)
+        addOrReplace(bankFile, false);
+    
+    if (!changed)
+        return false;
+    
+    invalidateCaches();
+    saveImportedBanks();
+    rebuildSearchIndexAsync();
+    rebuildSimilarityIndexAsync();
+    return true;
+}
+
+int PresetManager::loadBundledPresets()
+{
+    waitForDeferredLoad();
+    
+    LibrarySources sources;
+    readBundledPresets(sources, getPresetsDirectory());
+    return addBundledPresets(sources);
+}
+
+void PresetManager::readBundledPresets(LibrarySources& sources, const juce::File& presetsDirectory)
+{
+    // First try the bundled binary resources
+    if (BinaryData::ymulatorsynthpresetcollection_opmSize > 0)
+    {
+        juce::String content(static_cast<const char*>(BinaryData::ymulatorsynthpresetcollection_opm), 
+                           BinaryData::ymulatorsynthpresetcollection_opmSize);
+        sources.bundledVoices = VOPMParser::parseContent(content);
+        return;
+    }
+    
+    // Fallback: Try to load from external files
+    if (!presetsDirectory.exists())
+    {
+        CS_DBG("Presets directory does not exist: " + presetsDirectory.getFullPathName());
+        return;
+    }
+    
+    // The main preset collection file comes first
+    auto collectionFile = presetsDirectory.getChildFile(BundledCollectionFileName);
+    if (collectionFile.exists())
+    {
+        sources.presetFiles.emplace_back(collectionFile, VOPMParser::parseFile(collectionFile));
+    }
+    
+    // Then any other .opm files in the directory
+    juce::Array<juce::File> opmFiles;
+    presetsDirectory.findChildFiles(opmFiles, juce::File::findFiles, false, "*.opm");
+    
+    for (const auto& file : opmFiles)
+    {
+        if (file != collectionFile) // Don't load the same file twice
+        {
+            sources.presetFiles.emplace_back(file, VOPMParser::parseFile(file));
+        }
+    }
+}
+
+int PresetManager::addBundledPresets(const LibrarySources& sources)
+{
+    ScopedLibraryUpdate update(*this);
+    int totalLoaded = 0;
+    
+    for (const auto& voice : sources.bundledVoices)
+    {
+        auto preset = Preset::fromVOPM(voice);
+        // Offset OPM preset IDs to avoid conflict with factory presets
+        preset.id += NUM_FACTORY_PRESETS;
+        validatePreset(preset);
+        addPreset(preset);
+        totalLoaded++;
+    }
+    if (!sources.bundledVoices.empty())
+        CS_DBG("Loaded " + juce::String(totalLoaded) + " presets from bundled resources");
+    
+    for (const auto& [file, voices] : sources.presetFiles)
+    {
+        totalLoaded += addOPMBank(file, voices);
+    }
+    
+    return totalLoaded;
+}
+
+std::shared_ptr<PresetChunk> PresetChunk::clone() const
+{
+    auto copy = std::make_shared<PresetChunk>();
+    copy->presets.reserve(Capacity);
+    copy->registerImages.reserve(Capacity);
+    copy->presets = presets;
+    copy->registerImages = registerImages;
+    
+    // Only the names still in use move over, so replaced and renamed ones are dropped here
+    for (auto& packed : copy->presets)
+    {
+        if (!packed.isRemoved())
+            packed.nameOffset = copy->names.add(names.getUTF8(packed.nameOffset));
+    }
+    return copy;
+}
+
+size_t PresetChunk::getSizeInBytes() const
+{
+    return presets.capacity() * sizeof(PackedPreset) + registerImages.capacity() * sizeof(RegisterImage)
+           + names.getSizeInBytes();
+}
+
+const PackedPreset* PresetLibrarySnapshot::getPackedPreset(int index) const
+{
+    if (index < 0 || index >= numPresets)
+        return nullptr;
+    
+    const auto& packed = chunks[chunkOf(index)]->presets[slotOf(index)];
+    return packed.isRemoved() ? nullptr : &packed;
+}
+
+std::shared_ptr<const Preset> PresetLibrarySnapshot::getPreset(int index) const
+{
+    const auto* packed = getPackedPreset(index);
+    if (packed == nullptr)
+        return nullptr;
+    
+    return std::make_shared<const Preset>(packed->unpack(chunks[chunkOf(index)]->names));
+}
+
+const RegisterImage* PresetLibrarySnapshot::getRegisterImage(int index) const
+{
+    if (getPackedPreset(index) == nullptr)
+        return nullptr;
+    
+    return &chunks[chunkOf(index)]->registerImages[slotOf(index)];
+}
+
+const char* PresetLibrarySnapshot::getPresetNameUTF8(int index) const
+{
+    const auto* packed = getPackedPreset(index);
+    return packed != nullptr ? chunks[chunkOf(index)]->names.getUTF8(packed->nameOffset) : "";
+}
+
+juce::StringArray PresetLibrarySnapshot::getPresetNames() const
+{
+    juce::StringArray names;
+    names.ensureStorageAllocated(numPresets);
+    for (int i = 0; i < numPresets; ++i)
+        names.add(getPresetName(i));
+    return names;
+}
+
+juce::StringArray PresetLibrarySnapshot::getBankPresetNames(int bankIndex) const
+{
+    juce::StringArray names;
+    if (bankIndex < 0 || bankIndex >= static_cast<int>(banks->size()))
+        return names;
+    
+    const auto& bank = (*banks)[static_cast<size_t>(bankIndex)];
+    names.ensureStorageAllocated(static_cast<int>(bank.presetIndices.size()));
+    for (int presetIndex : bank.presetIndices)
+    {
+        if (presetIndex >= 0 && presetIndex < numPresets)
+            names.add(getPresetName(presetIndex));
+        else
+            CS_DBG("Bank '" + juce::String(bank.name) + "' references out-of-range preset index " + juce::String(presetIndex));
+    }
+    return names;
+}
+
+int PresetLibrarySnapshot::getGlobalPresetIndex(int bankIndex, int presetIndex) const
+{
+    if (bankIndex < 0 || bankIndex >= static_cast<int>(banks->size()))
+        return -1;
+    
+    const auto& indices = (*banks)[static_cast<size_t>(bankIndex)].presetIndices;
+    if (presetIndex < 0 || presetIndex >= static_cast<int>(indices.size()))
+        return -1;
+    
+    return indices[static_cast<size_t>(presetIndex)];
+}
+
+int PresetLibrarySnapshot::getPresetIndexForProgram(int program) const
+{
+    if (program < 0 || program >= getNumLivePresets())
+        return -1;
+    
+    if (numRemovedPresets == 0)
+        return program;
+    
+    return getLivePresetIndices()[static_cast<size_t>(program)];
+}
+
+int PresetLibrarySnapshot::getProgramForPresetIndex(int index) const
+{
+    if (getPackedPreset(index) == nullptr)
+        return -1;
+    
+    if (numRemovedPresets == 0)
+        return index;
+    
+    const auto& live = getLivePresetIndices();
+    return static_cast<int>(std::lower_bound(live.begin(), live.end(), index) - live.begin());
+}
+
+const std::vector<int>& PresetLibrarySnapshot::getLivePresetIndices() const
+{
+    // Built once per snapshot, and only when presets have been removed
+    std::call_once(liveIndicesBuilt, [this]()
+    {
+        liveIndices.reserve(static_cast<size_t>(getNumLivePresets()));
+        for (int i = 0; i < numPresets; ++i)
+        {
+            if (getPackedPreset(i) != nullptr)
+                liveIndices.push_back(i);
+        }
+    });
+    return liveIndices;
+}
+
+const std::vector<int>* PresetLibrarySnapshot::findNormalizedMatches(const juce::String& name) const
+{
+    // Built once per snapshot by whichever reader asks first
+    std::call_once(nameIndexBuilt, [this]()
+    {
+        nameIndex.reserve(static_cast<size_t>(numPresets));
+        for (int i = 0; i < numPresets; ++i)
+        {
+            if (getPackedPreset(i) != nullptr)
+                nameIndex[PresetManager::normalizeName(getPresetName(i))].push_back(i);
+        }
+    });
+    
+    auto it = nameIndex.find(PresetManager::normalizeName(name));
+    return it != nameIndex.end() && !it->second.empty() ? &it->second : nullptr;
+}
+
+std::shared_ptr<const Preset> PresetLibrarySnapshot::findPresetByName(const juce::String& name) const
+{
+    if (const auto* matches = findNormalizedMatches(name))
+    {
+        for (int index : *matches)
+        {
+            if (getPresetName(index) == name)
+                return getPreset(index);
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const Preset> PresetLibrarySnapshot::findPresetByNormalizedName(const juce::String& name) const
+{
+    const auto* matches = findNormalizedMatches(name);
+    if (matches == nullptr)
+        return nullptr;
+    
+    // Prefer an exact match, fall back to the first normalized match
+    if (auto exact = findPresetByName(name))
+        return exact;
+    return getPreset(matches->front());
+}
+
+size_t PresetLibrarySnapshot::getStorageSizeInBytes() const
+{
+    size_t size = 0;
+    for (const auto& chunk : chunks)
+        size += chunk->getSizeInBytes();
+    return size;
+}
+
+std::shared_ptr<const PresetLibrarySnapshot> PresetManager::getSnapshot() const
+{
+    // Counted as a reader until the reference is taken, so the writer cannot free
+    // the snapshot in between (see reclaimSnapshots)
+    auto& readers = snapshotReaders[static_cast<size_t>(snapshotReaderParity.load())];
+    ++readers;
+    auto current = publishedSnapshot.load()->shared_from_this();
+    --readers;
+    return current;
+}
+
+std::shared_ptr<const Preset> PresetManager::getPreset(int id) const
+{
+    // ID is the index in the presets array
+    return getSnapshot()->getPreset(id);
+}
+
+std::shared_ptr<const Preset> PresetManager::getPreset(const juce::String& name) const
+{
+    return getSnapshot()->findPresetByName(name);
+}
+
+juce::StringArray PresetManager::getPresetNames() const
+{
+    return getSnapshot()->getPresetNames();
+}
+
+int PresetManager::getNumPresets() const
+{
+    return getSnapshot()->getNumPresets();
+}
+
+std::shared_ptr<const std::vector<Bank>> PresetManager::getBanks() const
+{
+    return getSnapshot()->banks;
+}
+
+void PresetManager::addPreset(const Preset& preset)
+{
+    waitForDeferredLoad();
+    
+    // Check if preset with same ID already exists
+    auto it = idIndex.find(preset.id);
+    if (it != idIndex.end())
+    {
+        // Replace existing preset
+        unindexPreset(it->second);
+        storePreset(it->second, preset);
+        indexPreset(it->second);
+        invalidateCaches();
+        return;
+    }
+    
+    // Add new preset
+    appendPreset(preset);
+}
+
+int PresetManager::addReceivedPresets(const juce::String& bankName, const std::vector<Preset>& received)
+{
+    waitForDeferredLoad();
+    
+    if (received.empty())
+        return -1;
+    
+    ScopedLibraryUpdate update(*this);
+    const auto indices = appendPresets(received);
+    
+    // Later dumps of the same name add to the bank instead of starting another one
+    const auto name = bankName.toStdString();
+    auto bank = std::find_if(banks.begin(), banks.end(),
+                             [&name](const Bank& b) { return b.name == name && b.fileName.empty(); });
+    if (bank == banks.end())
+    {
+        banks.emplace_back(name);
+        bank = banks.end() - 1;
+    }
+    bank->presetIndices.insert(bank->presetIndices.end(), indices.begin(), indices.end());
+    invalidateCaches();
+    
+    CS_DBG("Received " + juce::String(static_cast<int>(indices.size())) + " presets into bank '" + bankName + "'");
+    
+    rebuildSearchIndexAsync();
+    rebuildSimilarityIndexAsync();
+    return indices.front();
+}
+
+void PresetManager::removePreset(int id)
+{
+    waitForDeferredLoad();
+    
+    auto it = idIndex.find(id);
+    if (it == idIndex.end())
+        return;
+    
+    // Banks let go of the preset too; User bank positions are journaled as deleteUserPreset() does
+    const int presetIndex = it->second;
+    for (int bankIndex = 0; bankIndex < static_cast<int>(banks.size()); ++bankIndex)
+    {
+        auto& indices = banks[static_cast<size_t>(bankIndex)].presetIndices;
+        for (int position = static_cast<int>(indices.size()); --position >= 0;)
+        {
+            if (indices[static_cast<size_t>(position)] != presetIndex)
+                continue;
+            
+            indices.erase(indices.begin() + position);
+            if (bankIndex == userBankIndex)
+                getUserJournal().appendDelete(position);
+        }
+    }
+    
+    removePresetsAt({ presetIndex });
+    invalidateCaches();
+}
+
+juce::String PresetManager::normalizeName(const juce::String& name)
+{
+    return name.trim().toLowerCase();
+}
+
+const PackedPreset* PresetManager::findPackedPreset(int index) const
+{
+    if (index < 0 || index >= numPresetSlots)
+        return nullptr;
+    
+    const auto& packed = chunks[chunkOf(index)]->presets[slotOf(index)];
+    return packed.isRemoved() ? nullptr : &packed;
+}
+
+Preset PresetManager::unpackPreset(int index) const
+{
+    const auto& chunk = *chunks[chunkOf(index)];
+    return chunk.presets[slotOf(index)].unpack(chunk.names);
+}
+
+PresetChunk& PresetManager::getWritableChunk(int index)
+{
+    const auto chunkIndex = chunkOf(index);
+    if (chunkIndex == chunks.size())
+    {
+        auto chunk = std::make_shared<PresetChunk>();
+        chunk->presets.reserve(PresetChunk::Capacity);
+        chunk->registerImages.reserve(PresetChunk::Capacity);
+        chunks.push_back(std::move(chunk));
+        publishedChunks.push_back(false);
+    }
+    else if (publishedChunks[chunkIndex])
+    {
+        // Readers may be using the published chunk; change a copy
+        chunks[chunkIndex] = chunks[chunkIndex]->clone();
+        publishedChunks[chunkIndex] = false;
+    }
+    return *chunks[chunkIndex];
+}
+
+void PresetManager::storePreset(int index, const Preset& preset)
+{
+    auto& chunk = getWritableChunk(index);
+    const auto slot = slotOf(index);
+    const auto packed = PackedPreset::pack(preset, chunk.names.add(preset.name));
+    
+    if (slot == chunk.presets.size())
+    {
+        chunk.presets.push_back(packed);
+        chunk.registerImages.push_back(preset.toRegisterImage());
+        ++numPresetSlots;
+    }
+    else
+    {
+        chunk.presets[slot] = packed;
+        chunk.registerImages[slot] = preset.toRegisterImage();
+    }
+}
+
+int PresetManager::findFreePresetId() const
+{
+    // Ids follow the global index, but removed presets can leave larger ids still taken
+    int id = numPresetSlots;
+    while (idIndex.count(id) != 0)
+        ++id;
+    return id;
+}
+
+void PresetManager::appendPreset(const Preset& preset)
+{
+    const int index = numPresetSlots;
+    storePreset(index, preset);
+    indexPreset(index);
+    invalidateCaches();
+}
+
+void PresetManager::indexPreset(int index)
+{
+    const auto& packed = *findPackedPreset(index);
+    idIndex.emplace(packed.id, index);
+    soundIndex[packed.soundHash].push_back(index);
+}
+
+void PresetManager::unindexPreset(int index)
+{
+    const auto& packed = *findPackedPreset(index);
+    
+    auto idIt = idIndex.find(packed.id);
+    if (idIt != idIndex.end() && idIt->second == index)
+        idIndex.erase(idIt);
+    
+    auto soundIt = soundIndex.find(packed.soundHash);
+    if (soundIt != soundIndex.end())
+    {
+        auto& indices = soundIt->second;
+        indices.erase(std::remove(indices.begin(), indices.end(), index), indices.end());
+        if (indices.empty())
+            soundIndex.erase(soundIt);
+    }
+}
+
+void PresetManager::rebuildIndexes()
+{
+    idIndex.clear();
+    soundIndex.clear();
+    idIndex.reserve(static_cast<size_t>(numPresetSlots));
+    numRemovedPresets = 0;
+    for (int i = 0; i < numPresetSlots; ++i)
+    {
+        if (findPackedPreset(i) != nullptr)
+            indexPreset(i);
+        else
+            ++numRemovedPresets;
+    }
+}
+
+std::shared_ptr<const RegisterImage> PresetManager::getRegisterImage(int index) const
+{
+    // Shares ownership of the snapshot, so the image outlives later library changes
+    const auto library = getSnapshot();
+    const auto* image = library->getRegisterImage(index);
+    return image != nullptr ? std::shared_ptr<const RegisterImage>(library, image) : nullptr;
+}
+
+const PackedPreset* PresetManager::getPackedPreset(int presetIndex) const
+{
+    return findPackedPreset(presetIndex);
+}
+
+const char* PresetManager::getPackedPresetName(int presetIndex) const
+{
+    const auto* packed = findPackedPreset(presetIndex);
+    return packed != nullptr ? chunks[chunkOf(presetIndex)]->names.getUTF8(packed->nameOffset) : "";
+}
+
+size_t PresetManager::getPackedLibrarySize() const
+{
+    size_t size = 0;
+    for (const auto& chunk : chunks)
+        size += chunk->getSizeInBytes();
+    return size;
+}
+
+uint64_t PresetManager::getPresetHash(int presetIndex) const
+{
+    const auto* packed = getPackedPreset(presetIndex);
+    return packed != nullptr ? packed->soundHash : 0;
+}
+
+int PresetManager::findPresetWithSameSound(const Preset& preset) const
+{
+    const auto image = PresetHash::makeCanonicalImage(preset);
+    auto it = soundIndex.find(PresetHash::compute(preset));
+    if (it == soundIndex.end())
+        return -1;
+    
+    // Compare images so that a hash collision can never merge different sounds
+    for (int index : it->second)
+    {
+        if (PresetHash::makeCanonicalImage(unpackPreset(index)) == image)
+            return index;
+    }
+    return -1;
+}
+
+std::vector<std::vector<int>> PresetManager::getDuplicateGroups() const
+{
+    std::vector<std::vector<int>> groups;
     
-    for (const auto& voice : voices)
+    for (const auto& entry : soundIndex)
     {
-        auto preset = Preset::fromVOPM(voice);
-        CS_DBG("Converting voice " + juce::String(voice.number) + " '" + voice.name + "' to preset");
-        
-        // Offset OPM preset IDs to avoid conflict with factory presets
-        preset.id = startIndex + loaded;  // Use simple sequential ID
-        validatePreset(preset);
-        
-        CS_DBG("Adding preset id=" + juce::String(preset.id) + " name='" + preset.name + "' at index " + juce::String(startIndex + loaded));
-        addPreset(preset);
+        if (entry.second.size() < 2)
+            continue;
         
-        // Add to bank indices list
-        bankPresetIndices.push_back(startIndex + loaded);
-        loaded++;
+        // Split a bucket by exact image in case two different sounds share a hash
+        std::vector<int> remaining = entry.second;
+        std::sort(remaining.begin(), remaining.end());
+        while (!remaining.empty())
+        {
+            const auto image = PresetHash::makeCanonicalImage(unpackPreset(remaining.front()));
+            std::vector<int> group, rest;
+            for (int index : remaining)
+            {
+                if (PresetHash::makeCanonicalImage(unpackPreset(index)) == image)
+                    group.push_back(index);
+                else
+                    rest.push_back(index);
+            }
+            if (group.size() > 1)
+                groups.push_back(std::move(group));
+            remaining = std::move(rest);
+        }
     }
     
-    // Create and add the bank with the collected indices
-    Bank newBank(bankName, file.getFileName().toStdString());
-    newBank.presetIndices = bankPresetIndices;
-    banks.push_back(newBank);
-    
-    CS_DBG("Loaded " + juce::String(loaded) + " presets from " + file.getFileName() + " as bank '" + bankName + "'");
-    CS_DBG("Bank '" + juce::String(bankName) + "' now has " + juce::String(banks.back().presetIndices.size()) + " preset indices");
-    
-    // Copy the OPM file to persistent storage for future loading
-    auto banksDir = getUserDataDirectory().getChildFile("banks");
-    banksDir.createDirectory();
-    auto targetFile = banksDir.getChildFile(file.getFileName());
-    if (!targetFile.exists()) {
-        file.copyFileTo(targetFile);
-        CS_DBG("Copied OPM file to persistent storage: " + targetFile.getFullPathName());
+    // Stable order for callers: by first member
+    std::sort(groups.begin(), groups.end(),
+              [](const std::vector<int>& a, const std::vector<int>& b) { return a.front() < b.front(); });
+    return groups;
+}
+
+void PresetManager::invalidateCaches()
+{
+    ++libraryGeneration;
+    snapshotDirty = true;
+    if (libraryUpdateDepth == 0)
+        publishSnapshot();
+}
+
+void PresetManager::publishSnapshot()
+{
+    // Only chunk pointers are copied; from now on the writer copies a chunk before changing it.
+    // Most changes leave the banks alone, so an unchanged bank list is shared too.
+    auto next = std::make_shared<PresetLibrarySnapshot>();
+    next->generation = libraryGeneration.load();
+    next->chunks.assign(chunks.begin(), chunks.end());
+    next->numPresets = numPresetSlots;
+    next->numRemovedPresets = numRemovedPresets;
+    if (snapshot != nullptr && *snapshot->banks == banks)
+        next->banks = snapshot->banks;
+    else
+        next->banks = std::make_shared<const std::vector<Bank>>(banks);
+    publishedChunks.assign(chunks.size(), true);
+    snapshotDirty = false;
+    
+    auto previous = std::exchange(snapshot, std::move(next));
+    publishedSnapshot.store(snapshot.get());
+    if (previous != nullptr)
+        retiredSnapshots.push_back({ std::move(previous) });
+    reclaimSnapshots();
+    
+    if (userJournalCompactionPending)
+    {
+        userJournalCompactionPending = false;
+        compactUserJournal();
+    }
+}
+
+void PresetManager::reclaimSnapshots()
+{
+    // New readers count under the other parity from now on, so this one drains
+    snapshotReaderParity.store(snapshotReaderParity.load() ^ 1);
+    
+    // A reader that loaded a retired snapshot is counted under one of the parities until
+    // it holds its own reference. Once both counts have been seen at zero since the
+    // snapshot was retired, no reader can reach it any more; it is freed here when no
+    // reader still holds it either, so the audio thread never drops the last reference.
+    const bool drained[] = { snapshotReaders[0].load() == 0, snapshotReaders[1].load() == 0 };
+    for (auto& retired : retiredSnapshots)
+    {
+        retired.drained[0] = retired.drained[0] || drained[0];
+        retired.drained[1] = retired.drained[1] || drained[1];
     }
     
-    // Save imported banks list
-    saveImportedBanks();
-    
-    return loaded;
+    retiredSnapshots.erase(std::remove_if(retiredSnapshots.begin(), retiredSnapshots.end(),
+                                          [](const RetiredSnapshot& retired)
+                                          {
+                                              return retired.drained[0] && retired.drained[1] && retired.snapshot.use_count() == 1;
+                                          }),
+                           retiredSnapshots.end());
 }
 
-int PresetManager::loadBundledPresets()
+std::vector<int> PresetManager::searchPresets(const juce::String& query, int maxResults) const
 {
-    int totalLoaded = 0;
+    const uint32_t generation = libraryGeneration.load();
+    auto index = std::atomic_load(&searchIndex);
     
-    // First try to load from bundled binary resources
-    if (BinaryData::ymulatorsynthpresetcollection_opmSize > 0)
+    if (index == nullptr || index->getGeneration() != generation)
     {
-        juce::String content(static_cast<const char*>(BinaryData::ymulatorsynthpresetcollection_opm), 
-                           BinaryData::ymulatorsynthpresetcollection_opmSize);
+        // Index is missing or stale - scan the snapshot's packed presets and names in place and build a fresh one
+        rebuildSearchIndexAsync();
+        
+        const auto parsed = PresetSearchIndex::parseQuery(query);
+        std::vector<int> results;
+        if (parsed.isEmpty())
+            return results;
         
-        auto voices = VOPMParser::parseContent(content);
-        for (const auto& voice : voices)
+        const auto library = getSnapshot();
+        const int numPresets = library->getNumPresets();
+        
+        // A preset is searched under the first bank that lists it
+        std::vector<int> bankOf(static_cast<size_t>(numPresets), -1);
+        const auto& libraryBanks = *library->banks;
+        for (int b = static_cast<int>(libraryBanks.size()); --b >= 0;)
         {
-            auto preset = Preset::fromVOPM(voice);
-            // Offset OPM preset IDs to avoid conflict with factory presets
-            preset.id += NUM_FACTORY_PRESETS;
-            validatePreset(preset);
-            addPreset(preset);
-            totalLoaded++;
+            for (int presetIndex : libraryBanks[static_cast<size_t>(b)].presetIndices)
+            {
+                if (presetIndex >= 0 && presetIndex < numPresets)
+                    bankOf[static_cast<size_t>(presetIndex)] = b;
+            }
         }
         
-        CS_DBG("Loaded " + juce::String(totalLoaded) + " presets from bundled resources");
-        return totalLoaded;
+        juce::StringArray bankNames;
+        for (const auto& bank : libraryBanks)
+            bankNames.add(juce::String(bank.name));
+        const juce::String noBank;
+        
+        for (int i = 0; i < numPresets && static_cast<int>(results.size()) < maxResults; ++i)
+        {
+            const auto* packed = library->getPackedPreset(i);
+            if (packed == nullptr)
+                continue;
+            
+            const int b = bankOf[static_cast<size_t>(i)];
+            const auto& bankName = b >= 0 ? bankNames.getReference(b) : noBank;
+            if (PresetSearchIndex::matches(juce::CharPointer_UTF8(library->getPresetNameUTF8(i)), bankName.toUTF8(),
+                                           packed->tags, parsed))
+                results.push_back(i);
+        }
+        return results;
     }
     
-    // Fallback: Try to load from external files
-    auto presetsDir = getPresetsDirectory();
-    if (!presetsDir.exists())
+    std::vector<int> results;
+    const auto normalizedQuery = query.trim().toLowerCase();
+    const auto parsed = PresetSearchIndex::parseQuery(normalizedQuery);
+    
+    // While typing, a query that extends the previous one can only narrow a complete result set
+    if (lastSearchRefinable && lastSearchGeneration == generation
+        && parsed.requiredTags == 0 && normalizedQuery.startsWith(lastSearchQuery))
     {
-        CS_DBG("Presets directory does not exist: " + presetsDir.getFullPathName());
-        return 0;
+        results = index->refine(lastSearchResults, normalizedQuery, maxResults);
     }
-    
-    // Look for the main preset collection file
-    auto collectionFile = presetsDir.getChildFile("ymulator-synth-preset-collection.opm");
-    if (collectionFile.exists())
+    else
     {
-        totalLoaded += loadOPMFile(collectionFile);
+        results = index->search(normalizedQuery, maxResults);
     }
     
-    // Load any other .opm files in the directory
-    juce::Array<juce::File> opmFiles;
-    presetsDir.findChildFiles(opmFiles, juce::File::findFiles, false, "*.opm");
+    // Refining is only sound for plain substring terms: short terms match word
+    // prefixes and tag tokens change meaning as they are typed
+    bool refinable = static_cast<int>(results.size()) < maxResults && !parsed.isEmpty()
+                     && parsed.requiredTags == 0 && !normalizedQuery.containsChar(':');
+    for (const auto& term : parsed.terms)
+        refinable = refinable && term.length() >= 3;
+    
+    lastSearchQuery = normalizedQuery;
+    lastSearchResults = results;
+    lastSearchRefinable = refinable;
+    lastSearchGeneration = generation;
+    return results;
+}
+
+bool PresetManager::isSearchIndexReady() const
+{
+    auto index = std::atomic_load(&searchIndex);
+    return index != nullptr && index->getGeneration() == libraryGeneration.load();
+}
+
+bool PresetManager::waitForSearchIndex(int timeoutMs) const
+{
+    rebuildSearchIndexAsync();
     
-    for (const auto& file : opmFiles)
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMs);
+    while (!isSearchIndexReady())
     {
-        if (file != collectionFile) // Don't load the same file twice
-        {
-            totalLoaded += loadOPMFile(file);
-        }
+        if (juce::Time::getMillisecondCounter() >= deadline)
+            return false;
+        juce::Thread::sleep(1);
     }
+    return true;
+}
+
+void PresetManager::rebuildSearchIndexAsync() const
+{
+    if (deferSearchRebuild || backgroundPool == nullptr)
+        return;
     
-    return totalLoaded;
+    const uint32_t generation = libraryGeneration.load();
+    if (scheduledSearchGeneration.exchange(generation) == generation)
+        return; // Already scheduled for this library state
+    
+    // Documents are snapshotted here; the heavy indexing runs on the pool thread
+    auto documents = std::make_shared<std::vector<PresetSearchIndex::Document>>(makeSearchDocuments());
+    
+    backgroundPool->addJob([this, documents, generation]()
+    {
+        auto index = std::make_shared<const PresetSearchIndex>(std::move(*documents), generation);
+        if (libraryGeneration.load() == generation)
+            std::atomic_store(&searchIndex, std::shared_ptr<const PresetSearchIndex>(index));
+    });
 }
 
-const Preset* PresetManager::getPreset(int id) const
+std::vector<int> PresetManager::findSimilarPresets(int presetIndex, int maxResults) const
 {
-    // ID is the index in the presets array
-    if (id >= 0 && id < static_cast<int>(presets.size()))
+    if (findPackedPreset(presetIndex) == nullptr)
+        return {};
+    
+    const auto& features = getFeatureVectors();
+    return findSimilarInternal(features[static_cast<size_t>(presetIndex)], maxResults, presetIndex);
+}
+
+std::vector<int> PresetManager::findPresetsSimilarTo(const Preset& preset, int maxResults) const
+{
+    return findSimilarInternal(PresetSimilarityIndex::extractFeatures(preset), maxResults, -1);
+}
+
+bool PresetManager::isSimilarityIndexReady() const
+{
+    auto index = std::atomic_load(&similarityIndex);
+    return index != nullptr && index->getGeneration() == libraryGeneration.load();
+}
+
+std::vector<int> PresetManager::findSimilarInternal(const PresetSimilarityIndex::FeatureVector& query, int maxResults, int excludeIndex) const
+{
+    std::vector<PresetSimilarityIndex::Neighbour> neighbours;
+    auto index = std::atomic_load(&similarityIndex);
+    
+    // Removed slots still have features, so ask for enough neighbours to skip all of them
+    const int numCandidates = maxResults + numRemovedPresets;
+    if (index != nullptr && index->getGeneration() == libraryGeneration.load())
     {
-        return &presets[id];
+        neighbours = index->findNearest(query, numCandidates, excludeIndex);
     }
-    return nullptr;
+    else
+    {
+        // No current index yet - brute force and build one in the background
+        rebuildSimilarityIndexAsync();
+        neighbours = PresetSimilarityIndex::findNearestLinear(getFeatureVectors(), query, numCandidates, excludeIndex);
+    }
+    
+    std::vector<int> results;
+    results.reserve(static_cast<size_t>(juce::jmax(0, maxResults)));
+    for (const auto& neighbour : neighbours)
+    {
+        if (static_cast<int>(results.size()) >= maxResults)
+            break;
+        if (findPackedPreset(neighbour.presetIndex) != nullptr)
+            results.push_back(neighbour.presetIndex);
+    }
+    return results;
 }
 
-const Preset* PresetManager::getPreset(const juce::String& name) const
+const std::vector<PresetSimilarityIndex::FeatureVector>& PresetManager::getFeatureVectors() const
 {
-    for (const auto& preset : presets)
+    const uint32_t generation = libraryGeneration.load();
+    if (cachedFeaturesGeneration != generation)
     {
-        if (preset.name == name)
-            return &preset;
+        cachedFeatures.clear();
+        cachedFeatures.reserve(static_cast<size_t>(numPresetSlots));
+        for (const auto& chunk : chunks)
+        {
+            for (const auto& packed : chunk->presets)
+                cachedFeatures.push_back(PresetSimilarityIndex::extractFeatures(packed));
+        }
+        cachedFeaturesGeneration = generation;
     }
-    return nullptr;
+    return cachedFeatures;
 }
 
-juce::StringArray PresetManager::getPresetNames() const
+void PresetManager::rebuildSimilarityIndexAsync() const
 {
-    juce::StringArray names;
-    for (const auto& preset : presets)
+    if (deferSearchRebuild || backgroundPool == nullptr)
+        return;
+    
+    const uint32_t generation = libraryGeneration.load();
+    if (scheduledSimilarityGeneration.exchange(generation) == generation)
+        return; // Already scheduled for this library state
+    
+    auto features = std::make_shared<std::vector<PresetSimilarityIndex::FeatureVector>>(getFeatureVectors());
+    
+    backgroundPool->addJob([this, features, generation]()
     {
-        names.add(preset.name);
-    }
-    return names;
+        auto index = std::make_shared<const PresetSimilarityIndex>(std::move(*features), generation);
+        if (libraryGeneration.load() == generation)
+            std::atomic_store(&similarityIndex, std::shared_ptr<const PresetSimilarityIndex>(index));
+    });
 }
 
-void PresetManager::addPreset(const Preset& preset)
+std::vector<PresetSearchIndex::Document> PresetManager::makeSearchDocuments() const
 {
-    // Check if preset with same ID already exists
-    for (auto& existing : presets)
+    std::vector<PresetSearchIndex::Document> documents(static_cast<size_t>(numPresetSlots));
+    
+    size_t i = 0;
+    for (const auto& chunk : chunks)
     {
-        if (existing.id == preset.id)
+        for (const auto& packed : chunk->presets)
         {
-            // Replace existing preset
-            existing = preset;
-            return;
+            // An empty document never matches, which suits an empty slot
+            auto& doc = documents[i++];
+            if (packed.isRemoved())
+                continue;
+            
+            doc.name = chunk->names.get(packed.nameOffset);
+            doc.tags = packed.tags;
         }
     }
     
-    // Add new preset
-    presets.push_back(preset);
+    for (const auto& bank : banks)
+    {
+        const juce::String bankName(bank.name);
+        for (int presetIndex : bank.presetIndices)
+        {
+            if (presetIndex >= 0 && presetIndex < static_cast<int>(documents.size())
+                && documents[static_cast<size_t>(presetIndex)].bankName.isEmpty())
+                documents[static_cast<size_t>(presetIndex)].bankName = bankName;
+        }
+    }
+    
+    return documents;
 }
 
-void PresetManager::removePreset(int id)
+bool PresetManager::saveOPMFile(const juce::File& file) const
 {
-    presets.erase(
-        std::remove_if(presets.begin(), presets.end(),
-                      [id](const Preset& p) { return p.id == id; }),
-        presets.end());
+    const auto library = getSnapshot();
+    return OPMWriter::writeFile(file, [&library](OPMWriter& writer)
+    {
+        writeLibrary(writer, *library);
+    });
 }
 
-bool PresetManager::saveOPMFile(const juce::File& file) const
+void PresetManager::saveOPMFileAsync(const juce::File& file, std::function<void(bool)> onComplete)
 {
-    juce::String content;
-    content << ";==================================================\n";
-    content << "; YMulator Synth Presets\n";
-    content << "; Generated automatically\n";
-    content << ";==================================================\n\n";
+    // The published snapshot shares the packed chunks; the text is never held in memory
+    auto library = getSnapshot();
     
-    for (const auto& preset : presets)
+    backgroundPool->addJob([this, file, library, onComplete = std::move(onComplete)]()
     {
-        auto voice = preset.toVOPM();
-        content << VOPMParser::voiceToString(voice) << "\n";
-    }
-    
-    return file.replaceWithText(content);
+        const bool saved = OPMWriter::writeFile(file, [&library](OPMWriter& writer)
+        {
+            writeLibrary(writer, *library);
+        });
+        
+        CS_DBG("Exported " + juce::String(library->getNumPresets()) + " presets to " + file.getFullPathName()
+               + (saved ? "" : " (failed)"));
+        if (!onComplete)
+            return;
+        
+        // Reported on the message thread, as imports are
+        {
+            const juce::ScopedLock sl(pendingBankChangesLock);
+            pendingExportCompletions.push_back([onComplete, saved]() { onComplete(saved); });
+        }
+        triggerAsyncUpdate();
+    });
 }
 
 bool PresetManager::savePresetAsOPM(const juce::File& file, const Preset& preset) const
 {
-    juce::String content;
-    content << ";==================================================\n";
-    content << "; YMulator Synth Preset\n";
-    content << "; " << preset.name << "\n";
-    content << "; Generated automatically\n";
-    content << ";==================================================\n\n";
-    
-    auto voice = preset.toVOPM();
-    content << VOPMParser::voiceToString(voice) << "\n";
-    
-    return file.replaceWithText(content);
+    return OPMWriter::writeFile(file, [&preset](OPMWriter& writer)
+    {
+        writer.writeHeader({ "YMulator Synth Preset", preset.name, "Generated automatically" });
+        writer.writeVoice(preset.toVOPM());
+    });
 }
 
 void PresetManager::clear()
 {
-    presets.clear();
+    waitForDeferredLoad();
+    
+    chunks.clear();
+    publishedChunks.clear();
+    numPresetSlots = 0;
     banks.clear();
+    rebuildIndexes();
+    invalidateCaches();
 }
 
 std::vector<Preset> PresetManager::getFactoryPresets()
@@ -472,7 +1693,7 @@ void PresetManager::loadFactoryPresets()
     {
         auto preset = Preset::fromVOPM(FACTORY_VOICES[i]);
         validatePreset(preset);
-        presets.push_back(preset);
+        appendPreset(preset);
     }
     
     CS_DBG("Loaded " + juce::String(NUM_FACTORY_PRESETS) + " factory presets");
@@ -513,7 +1734,7 @@ juce::File PresetManager::getPresetsDirectory() const
                      .getChildFile("presets");
 }
 
-void PresetManager::validatePreset(Preset& preset) const
+void PresetManager::validatePreset(Preset& preset)
 {
     // Clamp values to valid ranges
     preset.algorithm = juce::jlimit(0, 7, preset.algorithm);
@@ -553,76 +1774,41 @@ void PresetManager::initializeBanks()
 {
     // Create Factory bank
     Bank factoryBank("Factory");
-    for (int i = 0; i < NUM_FACTORY_PRESETS && i < static_cast<int>(presets.size()); ++i) {
+    for (int i = 0; i < NUM_FACTORY_PRESETS && i < numPresetSlots; ++i) {
         factoryBank.presetIndices.push_back(i);
     }
     banks.insert(banks.begin(), factoryBank);
+    invalidateCaches();
 }
 
 juce::StringArray PresetManager::getPresetsForBank(int bankIndex) const
 {
-    juce::StringArray names;
-    
-    CS_DBG("getPresetsForBank called with bankIndex=" + juce::String(bankIndex));
-    CS_DBG("Total banks: " + juce::String(banks.size()));
-    
-    if (bankIndex < 0 || bankIndex >= static_cast<int>(banks.size())) {
-        CS_DBG("Bank index out of range!");
-        return names;
-    }
-    
-    const auto& bank = banks[bankIndex];
-    CS_DBG("Bank '" + juce::String(bank.name) + "' has " + juce::String(bank.presetIndices.size()) + " preset indices");
-    
-    for (int presetIndex : bank.presetIndices) {
-        CS_DBG("  Checking preset index " + juce::String(presetIndex) + " (total presets: " + juce::String(presets.size()) + ")");
-        if (presetIndex >= 0 && presetIndex < static_cast<int>(presets.size())) {
-            names.add(presets[presetIndex].name);
-            CS_DBG("    Added preset: " + presets[presetIndex].name);
-        } else {
-            CS_DBG("    Index out of range!");
-        }
+    auto current = getSnapshot();
+    if (bankIndex < 0 || bankIndex >= static_cast<int>(current->banks->size())) {
+        CS_DBG("getPresetsForBank: bank index " + juce::String(bankIndex) + " out of range");
+        return {};
     }
     
-    CS_DBG("Returning " + juce::String(names.size()) + " preset names");
-    return names;
+    return current->getBankPresetNames(bankIndex);
 }
 
-const Preset* PresetManager::getPresetInBank(int bankIndex, int presetIndex) const
+std::shared_ptr<const Preset> PresetManager::getPresetInBank(int bankIndex, int presetIndex) const
 {
-    if (bankIndex < 0 || bankIndex >= static_cast<int>(banks.size())) {
-        return nullptr;
-    }
-    
-    const auto& bank = banks[bankIndex];
-    if (presetIndex < 0 || presetIndex >= static_cast<int>(bank.presetIndices.size())) {
-        return nullptr;
-    }
-    
-    int globalIndex = bank.presetIndices[presetIndex];
-    if (globalIndex >= 0 && globalIndex < static_cast<int>(presets.size())) {
-        return &presets[globalIndex];
-    }
-    
-    return nullptr;
+    // One snapshot for both lookups, so a concurrent change cannot mix two libraries
+    auto current = getSnapshot();
+    return current->getPreset(current->getGlobalPresetIndex(bankIndex, presetIndex));
 }
 
 int PresetManager::getGlobalPresetIndex(int bankIndex, int presetIndex) const
 {
-    if (bankIndex < 0 || bankIndex >= static_cast<int>(banks.size())) {
-        return -1;
-    }
-    
-    const auto& bank = banks[bankIndex];
-    if (presetIndex < 0 || presetIndex >= static_cast<int>(bank.presetIndices.size())) {
-        return -1;
-    }
-    
-    return bank.presetIndices[presetIndex];
+    return getSnapshot()->getGlobalPresetIndex(bankIndex, presetIndex);
 }
 
 juce::File PresetManager::getUserDataDirectory() const
 {
+    if (userDataDirectoryOverride != juce::File())
+        return userDataDirectoryOverride;
+    
     return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
                      .getChildFile("YMulator-Synth");
 }
@@ -641,27 +1827,86 @@ void PresetManager::ensureUserBank()
     Bank userBank("User", "");
     banks.insert(banks.begin() + 1, userBank); // Insert after Factory bank
     userBankIndex = 1;
+    invalidateCaches();
     
     CS_DBG("Created User bank at index " + juce::String(userBankIndex));
 }
 
 bool PresetManager::addUserPreset(const Preset& preset)
 {
+    waitForDeferredLoad();
+    
+    ScopedLibraryUpdate update(*this);
     ensureUserBank();
     
     // Add preset to main collection
-    int presetIndex = static_cast<int>(presets.size());
+    int presetIndex = numPresetSlots;
     Preset userPreset = preset;
-    userPreset.id = presetIndex;
-    presets.push_back(userPreset);
+    userPreset.id = findFreePresetId();
+    appendPreset(userPreset);
     
     // Add to User bank
-    banks[userBankIndex].presetIndices.push_back(presetIndex);
+    auto& userBank = banks[userBankIndex];
+    userBank.presetIndices.push_back(presetIndex);
+    invalidateCaches();
     
     CS_DBG("Added user preset '" + preset.name + "' to User bank");
     
-    // Save to persistent storage
-    return saveUserData();
+    // Journal the addition; the write happens in the background
+    auto& journal = getUserJournal();
+    journal.appendAdd(static_cast<int>(userBank.presetIndices.size()) - 1, userPreset);
+    compactUserJournalIfNeeded();
+    return journal.isHealthy();
+}
+
+bool PresetManager::renameUserPreset(int userPresetIndex, const juce::String& newName)
+{
+    waitForDeferredLoad();
+    
+    if (userBankIndex < 0 || userBankIndex >= static_cast<int>(banks.size()))
+        return false;
+    
+    const auto& userBank = banks[userBankIndex];
+    if (userPresetIndex < 0 || userPresetIndex >= static_cast<int>(userBank.presetIndices.size()))
+        return false;
+    
+    const int presetIndex = userBank.presetIndices[userPresetIndex];
+    
+    // The old name stays in a published chunk and is dropped when that chunk is copied
+    auto renamed = unpackPreset(presetIndex);
+    renamed.name = newName;
+    unindexPreset(presetIndex);
+    storePreset(presetIndex, renamed);
+    indexPreset(presetIndex);
+    invalidateCaches();
+    
+    auto& journal = getUserJournal();
+    journal.appendRename(userPresetIndex, newName);
+    compactUserJournalIfNeeded();
+    return journal.isHealthy();
+}
+
+bool PresetManager::deleteUserPreset(int userPresetIndex)
+{
+    waitForDeferredLoad();
+    
+    if (userBankIndex < 0 || userBankIndex >= static_cast<int>(banks.size()))
+        return false;
+    
+    auto& userIndices = banks[userBankIndex].presetIndices;
+    if (userPresetIndex < 0 || userPresetIndex >= static_cast<int>(userIndices.size()))
+        return false;
+    
+    const int presetIndex = userIndices[userPresetIndex];
+    userIndices.erase(userIndices.begin() + userPresetIndex);
+    
+    removePresetsAt(findUnreferencedPresets({ presetIndex }));
+    invalidateCaches();
+    
+    auto& journal = getUserJournal();
+    journal.appendDelete(userPresetIndex);
+    compactUserJournalIfNeeded();
+    return journal.isHealthy();
 }
 
 bool PresetManager::saveUserData()
@@ -672,64 +1917,48 @@ bool PresetManager::saveUserData()
         return false;
     }
     
-    return saveUserPresets() && saveImportedBanks();
+    // Fold the journal into a fresh snapshot (written in the background)
+    compactUserJournal();
+    return saveImportedBanks() && getUserJournal().isHealthy();
 }
 
-bool PresetManager::saveUserPresets()
+bool PresetManager::waitForUserDataWrites(int timeoutMs)
 {
-    if (userBankIndex < 0 || userBankIndex >= static_cast<int>(banks.size())) {
-        return true; // No user presets to save
-    }
-    
-    auto userPresetsFile = getUserDataDirectory().getChildFile("user-presets.xml");
-    
-    juce::XmlElement root("UserPresets");
+    return userJournal == nullptr || (userJournal->waitUntilWritten(timeoutMs) && userJournal->isHealthy());
+}
+
+void PresetManager::setUserDataDirectory(const juce::File& directory)
+{
+    waitForDeferredLoad();  // The background read uses the current journal
+    userJournal.reset();
+    userDataDirectoryOverride = directory;
+}
+
+UserPresetJournal& PresetManager::getUserJournal()
+{
+    if (userJournal == nullptr)
+        userJournal = std::make_unique<UserPresetJournal>(getUserDataDirectory());
     
-    const auto& userBank = banks[userBankIndex];
-    for (int presetIndex : userBank.presetIndices) {
-        if (presetIndex >= 0 && presetIndex < static_cast<int>(presets.size())) {
-            const auto& preset = presets[presetIndex];
-            
-            auto presetElement = root.createNewChildElement("Preset");
-            presetElement->setAttribute("name", preset.name);
-            presetElement->setAttribute("algorithm", preset.algorithm);
-            presetElement->setAttribute("feedback", preset.feedback);
-            
-            // LFO settings
-            auto lfoElement = presetElement->createNewChildElement("LFO");
-            lfoElement->setAttribute("rate", preset.lfo.rate);
-            lfoElement->setAttribute("amd", preset.lfo.amd);
-            lfoElement->setAttribute("pmd", preset.lfo.pmd);
-            lfoElement->setAttribute("waveform", preset.lfo.waveform);
-            lfoElement->setAttribute("noiseFreq", preset.lfo.noiseFreq);
-            
-            // Operators
-            for (int op = 0; op < 4; ++op) {
-                auto opElement = presetElement->createNewChildElement("Operator");
-                opElement->setAttribute("index", op);
-                opElement->setAttribute("totalLevel", preset.operators[op].totalLevel);
-                opElement->setAttribute("multiple", preset.operators[op].multiple);
-                opElement->setAttribute("detune1", preset.operators[op].detune1);
-                opElement->setAttribute("detune2", preset.operators[op].detune2);
-                opElement->setAttribute("keyScale", preset.operators[op].keyScale);
-                opElement->setAttribute("attackRate", preset.operators[op].attackRate);
-                opElement->setAttribute("decay1Rate", preset.operators[op].decay1Rate);
-                opElement->setAttribute("decay2Rate", preset.operators[op].decay2Rate);
-                opElement->setAttribute("releaseRate", preset.operators[op].releaseRate);
-                opElement->setAttribute("sustainLevel", preset.operators[op].sustainLevel);
-                opElement->setAttribute("amsEnable", preset.operators[op].amsEnable);
-                opElement->setAttribute("slotEnable", preset.operators[op].slotEnable);
-            }
-            
-            // Channel settings (first channel as template)
-            auto channelElement = presetElement->createNewChildElement("Channel");
-            channelElement->setAttribute("ams", preset.channels[0].ams);
-            channelElement->setAttribute("pms", preset.channels[0].pms);
-            channelElement->setAttribute("noiseEnable", preset.channels[0].noiseEnable);
-        }
+    return *userJournal;
+}
+
+void PresetManager::compactUserJournal()
+{
+    // The writer thread reads the User bank from the published snapshot, so nothing
+    // is copied here; inside a library update, wait for that update's snapshot
+    if (snapshotDirty)
+    {
+        userJournalCompactionPending = true;
+        return;
     }
     
-    return root.writeTo(userPresetsFile);
+    getUserJournal().compact(getSnapshot(), userBankIndex);
+}
+
+void PresetManager::compactUserJournalIfNeeded()
+{
+    if (getUserJournal().needsCompaction())
+        compactUserJournal();
 }
 
 bool PresetManager::saveImportedBanks()
@@ -757,6 +1986,9 @@ bool PresetManager::saveImportedBanks()
 
 int PresetManager::loadUserData()
 {
+    waitForDeferredLoad();
+    
+    ScopedLibraryUpdate update(*this);
     int loaded = 0;
     loaded += loadUserPresets();
     loaded += loadImportedBanks();
@@ -765,78 +1997,56 @@ int PresetManager::loadUserData()
 
 bool PresetManager::loadUserPresets()
 {
-    auto userPresetsFile = getUserDataDirectory().getChildFile("user-presets.xml");
-    if (!userPresetsFile.exists()) {
-        return true; // No user presets to load
+    LibrarySources sources;
+    readUserPresets(sources, getUserJournal());
+    addUserPresets(sources);
+    return true;
+}
+
+void PresetManager::readUserPresets(LibrarySources& sources, UserPresetJournal& journal)
+{
+    if (!journal.getSnapshotFile().exists() && !journal.getJournalFile().exists()) {
+        return; // No user presets to load
     }
     
-    auto xml = juce::XmlDocument::parse(userPresetsFile);
-    if (!xml) {
-        CS_DBG("Failed to parse user presets XML");
-        return false;
+    sources.hasUserData = true;
+    sources.userPresets = journal.load();
+}
+
+void PresetManager::addUserPresets(LibrarySources& sources)
+{
+    if (!sources.hasUserData) {
+        return;
     }
     
     ensureUserBank();
     
     int loaded = 0;
-    for (auto* presetElement : xml->getChildWithTagNameIterator("Preset")) {
-        Preset preset;
-        preset.name = presetElement->getStringAttribute("name", "User Preset");
-        preset.algorithm = presetElement->getIntAttribute("algorithm", 0);
-        preset.feedback = presetElement->getIntAttribute("feedback", 0);
-        
-        // Load LFO settings
-        if (auto* lfoElement = presetElement->getChildByName("LFO")) {
-            preset.lfo.rate = lfoElement->getIntAttribute("rate", 0);
-            preset.lfo.amd = lfoElement->getIntAttribute("amd", 0);
-            preset.lfo.pmd = lfoElement->getIntAttribute("pmd", 0);
-            preset.lfo.waveform = lfoElement->getIntAttribute("waveform", 0);
-            preset.lfo.noiseFreq = lfoElement->getIntAttribute("noiseFreq", 0);
-        }
-        
-        // Load operators
-        for (auto* opElement : presetElement->getChildWithTagNameIterator("Operator")) {
-            int opIndex = opElement->getIntAttribute("index", 0);
-            if (opIndex >= 0 && opIndex < 4) {
-                preset.operators[opIndex].totalLevel = opElement->getDoubleAttribute("totalLevel", 0.0);
-                preset.operators[opIndex].multiple = opElement->getDoubleAttribute("multiple", 1.0);
-                preset.operators[opIndex].detune1 = opElement->getDoubleAttribute("detune1", 3.0);
-                preset.operators[opIndex].detune2 = opElement->getDoubleAttribute("detune2", 0.0);
-                preset.operators[opIndex].keyScale = opElement->getDoubleAttribute("keyScale", 0.0);
-                preset.operators[opIndex].attackRate = opElement->getDoubleAttribute("attackRate", 31.0);
-                preset.operators[opIndex].decay1Rate = opElement->getDoubleAttribute("decay1Rate", 0.0);
-                preset.operators[opIndex].decay2Rate = opElement->getDoubleAttribute("decay2Rate", 0.0);
-                preset.operators[opIndex].releaseRate = opElement->getDoubleAttribute("releaseRate", 7.0);
-                preset.operators[opIndex].sustainLevel = opElement->getDoubleAttribute("sustainLevel", 0.0);
-                preset.operators[opIndex].amsEnable = opElement->getBoolAttribute("amsEnable", false);
-                preset.operators[opIndex].slotEnable = opElement->getBoolAttribute("slotEnable", true);
-            }
-        }
-        
-        // Load channel settings
-        if (auto* channelElement = presetElement->getChildByName("Channel")) {
-            for (int ch = 0; ch < 8; ++ch) {
-                preset.channels[ch].ams = channelElement->getIntAttribute("ams", 0);
-                preset.channels[ch].pms = channelElement->getIntAttribute("pms", 0);
-                preset.channels[ch].noiseEnable = channelElement->getIntAttribute("noiseEnable", 0);
-            }
-        }
-        
+    for (auto& preset : sources.userPresets) {
         // Add to presets and User bank
-        int presetIndex = static_cast<int>(presets.size());
-        preset.id = presetIndex;
-        presets.push_back(preset);
+        int presetIndex = numPresetSlots;
+        preset.id = findFreePresetId();
+        appendPreset(preset);
         banks[userBankIndex].presetIndices.push_back(presetIndex);
         loaded++;
     }
     
+    invalidateCaches();
     CS_DBG("Loaded " + juce::String(loaded) + " user presets");
-    return true;
 }
 
 bool PresetManager::loadImportedBanks()
 {
-    auto banksFile = getUserDataDirectory().getChildFile("imported-banks.xml");
+    LibrarySources sources;
+    if (!readImportedBanks(sources, getUserDataDirectory())) {
+        return false;
+    }
+    return addImportedBanks(sources) > 0;
+}
+
+bool PresetManager::readImportedBanks(LibrarySources& sources, const juce::File& userDataDirectory)
+{
+    auto banksFile = userDataDirectory.getChildFile("imported-banks.xml");
     if (!banksFile.exists()) {
         return true; // No imported banks to load
     }
@@ -847,32 +2057,45 @@ bool PresetManager::loadImportedBanks()
         return false;
     }
     
-    auto banksDir = getUserDataDirectory().getChildFile("banks");
-    int loaded = 0;
+    auto banksDir = userDataDirectory.getChildFile("banks");
     
     for (auto* bankElement : xml->getChildWithTagNameIterator("Bank")) {
         juce::String fileName = bankElement->getStringAttribute("fileName");
         if (fileName.isNotEmpty()) {
             auto bankFile = banksDir.getChildFile(fileName);
             if (bankFile.exists()) {
-                int bankLoaded = loadOPMFile(bankFile);
-                if (bankLoaded > 0) {
-                    loaded += bankLoaded;
-                }
+                sources.importedBanks.emplace_back(bankFile, VOPMParser::parseFile(bankFile));
             }
         }
     }
+    return true;
+}
+
+int PresetManager::addImportedBanks(const LibrarySources& sources)
+{
+    ScopedLibraryUpdate update(*this);
+    int loaded = 0;
+    
+    for (const auto& [file, voices] : sources.importedBanks) {
+        loaded += addOPMBank(file, voices);
+    }
     
     CS_DBG("Loaded " + juce::String(loaded) + " presets from imported banks");
-    return loaded > 0;
+    return loaded;
 }
 
 void PresetManager::reset()
 {
+    waitForDeferredLoad();
+    
     // Clear all presets and banks
-    presets.clear();
+    chunks.clear();
+    publishedChunks.clear();
+    numPresetSlots = 0;
     banks.clear();
     userBankIndex = -1;
+    rebuildIndexes();
+    invalidateCaches();
     
     CS_DBG("PresetManager reset to initial state");
 }
@@ -4,11 +4,25 @@
 #include <juce_core/juce_core.h>
 #include <juce_data_structures/juce_data_structures.h>
 #include "VOPMParser.h"
+#include "PresetSearchIndex.h"
+#include "PresetSimilarityIndex.h"
+#include "PresetHash.h"
+#include "PackedPreset.h"
+#include "BankDirectoryWatcher.h"
+#include "../dsp/RegisterImage.h"
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 namespace ymulatorsynth {
 
+class UserPresetJournal;
+class BankImportJob;
+
 /**
  * Preset data structure for internal use
  */
@@ -62,6 +76,11 @@ struct Preset
      * Convert to VOPM voice format
      */
     VOPMVoice toVOPM() const;
+    
+    /**
+     * Compile to YM2151 register values, ready to copy into the chip
+     */
+    RegisterImage toRegisterImage() const;
 };
 
 /**
@@ -71,53 +90,325 @@ struct Bank
 {
     std::string name;
     std::string fileName; // Original file name for imported banks
-    std::vector<int> presetIndices; // Indices into the main presets vector
+    std::vector<int> presetIndices; // Global preset indices
     
     Bank(const std::string& bankName, const std::string& file = "") 
         : name(bankName), fileName(file) {}
+    
+    bool operator==(const Bank& other) const
+    {
+        return name == other.name && fileName == other.fileName && presetIndices == other.presetIndices;
+    }
+};
+
+/**
+ * Packed storage for PresetChunk::Capacity consecutive global indices
+ *
+ * The library is a list of chunks shared by the writer and the published
+ * snapshots. A published chunk is never modified; the writer copies it
+ * before its next change, keeping only the names still in use, so a rename
+ * or replacement does not leave the old name in the pool for good.
+ */
+struct PresetChunk
+{
+    static constexpr int Capacity = 256;
+    
+    std::vector<PackedPreset> presets;          // flagged PackedPreset::Removed for empty slots
+    std::vector<RegisterImage> registerImages;  // compiled presets, parallel to presets
+    PresetStringPool names;
+    
+    /** Copy with a compacted name pool */
+    std::shared_ptr<PresetChunk> clone() const;
+    
+    size_t getSizeInBytes() const;
+};
+
+/**
+ * Immutable view of the preset library
+ *
+ * PresetManager publishes a new snapshot after every change and never
+ * modifies one that has been published, so readers on any thread see a
+ * consistent library for as long as they hold it. Unchanged chunks are
+ * shared between snapshots rather than copied.
+ *
+ * Presets are stored packed (see PackedPreset); getPreset() expands one on
+ * demand, so hold on to the result rather than calling it in a loop when
+ * only names or scan data are needed.
+ *
+ * Snapshots are always owned by a shared_ptr; PresetManager::getSnapshot()
+ * takes its reference through shared_from_this().
+ */
+struct PresetLibrarySnapshot : public std::enable_shared_from_this<PresetLibrarySnapshot>
+{
+    uint32_t generation = 0;                               // library generation it was taken from
+    std::vector<std::shared_ptr<const PresetChunk>> chunks;
+    int numPresets = 0;
+    int numRemovedPresets = 0;                             // empty slots among numPresets
+    std::shared_ptr<const std::vector<Bank>> banks;        // never null; shared while unchanged
+    
+    /** Number of global indices, including the empty slots of removed presets */
+    int getNumPresets() const { return numPresets; }
+    
+    /**
+     * Host program numbers count the presets that are still there, in global
+     * index order, so removed presets never show up as empty programs.
+     * Without removals a program number is the global index.
+     */
+    int getNumLivePresets() const { return numPresets - numRemovedPresets; }
+    
+    /** @return -1 if the program is out of range */
+    int getPresetIndexForProgram(int program) const;
+    
+    /** @return -1 if the index is out of range or its preset was removed */
+    int getProgramForPresetIndex(int index) const;
+    
+    /** @return nullptr if the index is out of range or its preset was removed */
+    std::shared_ptr<const Preset> getPreset(int index) const;
+    const PackedPreset* getPackedPreset(int index) const;
+    const RegisterImage* getRegisterImage(int index) const;
+    
+    /** Name as stored in the chunk's pool; empty for an out-of-range index or an empty slot */
+    const char* getPresetNameUTF8(int index) const;
+    juce::String getPresetName(int index) const { return juce::String::fromUTF8(getPresetNameUTF8(index)); }
+    
+    /** Names by global index, and by position in a bank; built on demand */
+    juce::StringArray getPresetNames() const;
+    juce::StringArray getBankPresetNames(int bankIndex) const;
+    
+    /** @return -1 if either index is out of range */
+    int getGlobalPresetIndex(int bankIndex, int presetIndex) const;
+    
+    /**
+     * Finds the first preset with exactly this name. The name index is built
+     * on first use and shared with findPresetByNormalizedName().
+     */
+    std::shared_ptr<const Preset> findPresetByName(const juce::String& name) const;
+    
+    /**
+     * Finds a preset ignoring case and surrounding whitespace (see
+     * PresetManager::normalizeName), preferring an exact match.
+     */
+    std::shared_ptr<const Preset> findPresetByNormalizedName(const juce::String& name) const;
+    
+    /** Bytes held by the preset storage (packed presets, register images and names) */
+    size_t getStorageSizeInBytes() const;
+    
+private:
+    const std::vector<int>* findNormalizedMatches(const juce::String& name) const;
+    const std::vector<int>& getLivePresetIndices() const;
+    
+    mutable std::once_flag nameIndexBuilt;
+    mutable std::unordered_map<juce::String, std::vector<int>> nameIndex;  // normalized name -> indices
+    mutable std::once_flag liveIndicesBuilt;
+    mutable std::vector<int> liveIndices;                                  // program -> global index
 };
 
 /**
  * Manages preset loading, saving, and organization
  */
-class PresetManager : public PresetManagerInterface
+class PresetManager : public PresetManagerInterface,
+                      private juce::AsyncUpdater
 {
 public:
     PresetManager();
-    ~PresetManager() override = default;
+    ~PresetManager() override;
     
     // Interface implementation - Initialization
     void initialize() override;
     
+    /**
+     * Deferred initialize(): publishes the factory presets right away and
+     * reads the bundled, user and imported banks on the background thread.
+     * The complete library is published on the message thread, then onReady
+     * is called. Library changes made before that wait for the load first.
+     */
+    void initializeAsync(std::function<void()> onReady) override;
+    
+    /** @return false while a deferred load is pending; safe to call from any thread */
+    bool isLibraryReady() const override { return libraryReady.load(); }
+    
+    /**
+     * Publishes a deferred load without waiting for the message loop.
+     * Message thread only (or the thread that owns the manager).
+     * @param timeoutMs How long to wait for the background read (-1 = forever)
+     * @return false if the background read did not finish in time
+     */
+    bool finishInitialization(int timeoutMs) override;
+    
     // Interface implementation - File operations
     int loadOPMFile(const juce::File& file) override;
+    
+    /**
+     * Imports an OPM file on the background thread (see BankImportJob).
+     * The bank is added and onComplete is called on the message thread.
+     */
+    std::shared_ptr<BankImportJob> importOPMFileAsync(const juce::File& file,
+                                                      std::function<void(const BankImportJob&)> onComplete) override;
+    
+    /**
+     * Publishes finished imports and bank directory changes right away
+     * instead of waiting for the message loop (used by tests and tools)
+     */
+    void dispatchPendingUpdates();
+    
     int loadBundledPresets() override;
     bool saveOPMFile(const juce::File& file) const override;
+    
+    /**
+     * Exports the library on the background thread from a snapshot of the
+     * packed presets, so later library changes do not affect the file.
+     * onComplete is called on the message thread with the result, like an
+     * import's.
+     */
+    void saveOPMFileAsync(const juce::File& file, std::function<void(bool)> onComplete) override;
     bool savePresetAsOPM(const juce::File& file, const Preset& preset) const override;
     
+    /**
+     * The current library snapshot; never null. Safe to call from any thread,
+     * including the audio thread: it takes no lock and does not allocate, and a
+     * replaced snapshot is freed by the writer, never by the last reader to let go.
+     * Hold on to it when presets are used for longer than a single call.
+     */
+    std::shared_ptr<const PresetLibrarySnapshot> getSnapshot() const override;
+    
     // Interface implementation - Preset access
-    const Preset* getPreset(int id) const override;
-    const Preset* getPreset(const juce::String& name) const override;
+    // These read the current snapshot. Presets are expanded from the packed library on
+    // each call; everything returned shares ownership of what it points into, so it stays
+    // valid however the library changes afterwards.
+    std::shared_ptr<const Preset> getPreset(int id) const override;
+    std::shared_ptr<const Preset> getPreset(const juce::String& name) const override;
     juce::StringArray getPresetNames() const override;
-    int getNumPresets() const override { return static_cast<int>(presets.size()); }
+    int getNumPresets() const override;
     
     // Interface implementation - Bank management
-    const std::vector<Bank>& getBanks() const override { return banks; }
+    std::shared_ptr<const std::vector<Bank>> getBanks() const override;
     juce::StringArray getPresetsForBank(int bankIndex) const override;
-    const Preset* getPresetInBank(int bankIndex, int presetIndex) const override;
+    std::shared_ptr<const Preset> getPresetInBank(int bankIndex, int presetIndex) const override;
     int getGlobalPresetIndex(int bankIndex, int presetIndex) const override;
     
+    // Interface implementation - Register images (compiled when the preset is added)
+    std::shared_ptr<const RegisterImage> getRegisterImage(int index) const override;
+    
+    // Interface implementation - Search
+    std::vector<int> searchPresets(const juce::String& query, int maxResults = 256) const override;
+    
+    /**
+     * Returns true once the background search index matches the current library.
+     * Until then searchPresets() falls back to a linear scan.
+     */
+    bool isSearchIndexReady() const;
+    
+    /**
+     * Blocks until the search index is up to date (used by tests and tools)
+     * @return true if the index became ready within the timeout
+     */
+    bool waitForSearchIndex(int timeoutMs) const;
+    
+    // Interface implementation - Timbre similarity
+    std::vector<int> findSimilarPresets(int presetIndex, int maxResults) const override;
+    
+    /**
+     * Finds library presets that sound most like an arbitrary preset
+     * (e.g. the current edited sound)
+     * @return Global preset indices, most similar first
+     */
+    std::vector<int> findPresetsSimilarTo(const Preset& preset, int maxResults) const;
+    
+    /**
+     * Returns true once the background similarity index matches the current library
+     */
+    bool isSimilarityIndexReady() const;
+    
+    /**
+     * Canonical sound hash of a preset (see PresetHash)
+     * @return 0 if the index is out of range
+     */
+    uint64_t getPresetHash(int presetIndex) const;
+    
+    /**
+     * Finds a preset that sounds identical to the given one
+     * @return Global preset index, or -1 if the library has no such preset
+     */
+    int findPresetWithSameSound(const Preset& preset) const;
+    
+    /**
+     * Groups of presets with identical canonical register images
+     * @return Global preset indices per group (ascending); only groups of two or more
+     */
+    std::vector<std::vector<int>> getDuplicateGroups() const;
+    
+    /**
+     * Stored form of a preset (see PackedPreset); message thread only, and valid
+     * until the library next changes. Other threads read it from a snapshot.
+     * @return nullptr if the index is out of range or its preset was removed
+     */
+    const PackedPreset* getPackedPreset(int presetIndex) const;
+    
+    /** Name of a packed preset, as stored in its chunk's string pool */
+    const char* getPackedPresetName(int presetIndex) const;
+    
+    /** Bytes held by the preset storage (packed presets, register images and names) */
+    size_t getPackedLibrarySize() const;
+    
+    /**
+     * When enabled, loadOPMFile() does not store voices that sound identical to
+     * a preset already in the library; the new bank refers to the existing preset instead.
+     */
+    void setCollapseDuplicatesOnImport(bool shouldCollapse) { collapseDuplicatesOnImport = shouldCollapse; }
+    bool getCollapseDuplicatesOnImport() const { return collapseDuplicatesOnImport; }
+    
     // Interface implementation - Preset modification
     void addPreset(const Preset& preset) override;
     void removePreset(int id) override;
     void clear() override;
     
+    /**
+     * Appends presets received as a SysEx dump to a bank that is not backed by
+     * a file, in a single library update
+     * @return Global index of the first received preset, or -1 if there was none
+     */
+    int addReceivedPresets(const juce::String& bankName, const std::vector<Preset>& received) override;
+    
     // Interface implementation - User presets and data persistence
     bool addUserPreset(const Preset& preset) override;
     bool saveUserData() override;
     int loadUserData() override;
     juce::File getUserDataDirectory() const override;
     
+    /**
+     * Renames a preset in the User bank
+     * @param userPresetIndex Position within the User bank
+     */
+    bool renameUserPreset(int userPresetIndex, const juce::String& newName);
+    
+    /**
+     * Deletes a preset from the User bank (and from the library unless
+     * another bank still refers to it). The global indices of the other
+     * presets do not change.
+     * @param userPresetIndex Position within the User bank
+     */
+    bool deleteUserPreset(int userPresetIndex);
+    
+    /**
+     * Blocks until queued user data writes have reached the disk
+     * @return true if everything was written within the timeout
+     */
+    bool waitForUserDataWrites(int timeoutMs);
+    
+    /** Redirects user data (used by tests and portable installs) */
+    void setUserDataDirectory(const juce::File& directory);
+    
+    // Interface implementation - Bank directory watching
+    void startWatchingBankDirectories(std::function<void()> onLibraryChanged) override;
+    void stopWatchingBankDirectories() override;
+    
+    /**
+     * Merges added, changed and removed bank files into the library.
+     * Only the files in the change set are touched; other banks keep their presets.
+     * @return true if the library changed
+     */
+    bool applyBankChanges(const BankDirectoryWatcher::ChangeSet& changes);
+    
     // Interface implementation - Factory presets
     std::vector<Preset> getFactoryPresets() override;
     
@@ -127,20 +418,165 @@ public:
     // Interface implementation - Reset functionality for testing
     void reset() override;
 
+    /**
+     * Normalizes a preset name for case- and whitespace-insensitive lookup
+     */
+    static juce::String normalizeName(const juce::String& name);
+    
+    /**
+     * Clamps every preset field to its hardware range
+     */
+    static void validatePreset(Preset& preset);
+
 private:
-    std::vector<Preset> presets;
+    // Writer-side library, changed on the message thread only. Chunks are
+    // shared with the published snapshots and copied before they change.
+    std::vector<std::shared_ptr<PresetChunk>> chunks;
+    std::vector<bool> publishedChunks;   // parallel to chunks
+    int numPresetSlots = 0;              // global indices in use, including empty slots
     std::vector<Bank> banks;
     int userBankIndex = -1;  // Index of the User bank
+    juce::File userDataDirectoryOverride;
+    std::unique_ptr<UserPresetJournal> userJournal;  // created on first use
+    
+    // Bank directory watching; change sets are handed over to the message thread
+    std::unique_ptr<BankDirectoryWatcher> bankWatcher;
+    std::function<void()> libraryChangedCallback;
+    juce::CriticalSection pendingBankChangesLock;
+    std::vector<BankDirectoryWatcher::ChangeSet> pendingBankChanges;
+    std::vector<std::shared_ptr<BankImportJob>> pendingImports;  // guarded by pendingBankChangesLock
+    std::vector<std::function<void()>> pendingExportCompletions;  // guarded by pendingBankChangesLock
+    
+    // Lookup indexes, maintained incrementally on every mutation
+    std::unordered_map<int, int> idIndex;                       // preset id -> global index
+    std::unordered_map<uint64_t, std::vector<int>> soundIndex;    // canonical sound hash -> global indices
+    int numRemovedPresets = 0;                                   // empty slots left by removals
+    bool collapseDuplicatesOnImport = false;
+    
+    // Published library. The writer owns the current snapshot and readers find it
+    // through the raw pointer (see getSnapshot). A replaced snapshot is retired and
+    // freed on a later publish, once no reader can still be between loading the
+    // pointer and taking its reference and none still holds one. Readers in between
+    // are counted under one of two parities; the writer flips the parity on every
+    // publish so the old count drains.
+    struct RetiredSnapshot
+    {
+        std::shared_ptr<const PresetLibrarySnapshot> snapshot;
+        std::array<bool, 2> drained {};  // reader count of each parity seen at zero since retirement
+    };
+    std::shared_ptr<const PresetLibrarySnapshot> snapshot;
+    std::atomic<const PresetLibrarySnapshot*> publishedSnapshot { nullptr };
+    mutable std::array<std::atomic<int>, 2> snapshotReaders {};
+    std::atomic<int> snapshotReaderParity { 0 };
+    std::vector<RetiredSnapshot> retiredSnapshots;
+    int libraryUpdateDepth = 0;  // > 0 while a ScopedLibraryUpdate is active
+    bool snapshotDirty = false;
+    bool userJournalCompactionPending = false;  // compact once the pending snapshot is published
+    
+    /** Publishes one snapshot for a group of mutations instead of one per step */
+    struct ScopedLibraryUpdate
+    {
+        explicit ScopedLibraryUpdate(PresetManager& owner) : manager(owner) { ++manager.libraryUpdateDepth; }
+        ~ScopedLibraryUpdate()
+        {
+            if (--manager.libraryUpdateDepth == 0 && manager.snapshotDirty)
+                manager.publishSnapshot();
+        }
+        PresetManager& manager;
+    };
+    
+    // Search index, rebuilt on a background thread after the library changes.
+    // Accessed through std::atomic_load/atomic_store.
+    mutable std::shared_ptr<const PresetSearchIndex> searchIndex;
+    std::atomic<uint32_t> libraryGeneration { 1 };
+    mutable std::atomic<uint32_t> scheduledSearchGeneration { 0 };
+    bool deferSearchRebuild = false;  // Set while initialize() loads in bulk
+    
+    // Timbre similarity index, built alongside the search index
+    mutable std::shared_ptr<const PresetSimilarityIndex> similarityIndex;
+    mutable std::atomic<uint32_t> scheduledSimilarityGeneration { 0 };
+    mutable std::vector<PresetSimilarityIndex::FeatureVector> cachedFeatures;
+    mutable uint32_t cachedFeaturesGeneration = 0;
+    
+    // Last query, reused to narrow results while the user types
+    mutable juce::String lastSearchQuery;
+    mutable std::vector<int> lastSearchResults;
+    mutable bool lastSearchRefinable = false;
+    mutable uint32_t lastSearchGeneration = 0;
+    
+    /** Everything initialize() reads from disk, parsed but not yet in the library */
+    struct LibrarySources
+    {
+        std::vector<VOPMVoice> bundledVoices;                                    // built-in collection
+        std::vector<std::pair<juce::File, std::vector<VOPMVoice>>> presetFiles;  // presets folder, if nothing is built in
+        bool hasUserData = false;
+        std::vector<Preset> userPresets;
+        std::vector<std::pair<juce::File, std::vector<VOPMVoice>>> importedBanks;
+    };
+    
+    /** A deferred initialize(); the background read fills in sources */
+    struct PendingLibraryLoad
+    {
+        LibrarySources sources;
+        juce::WaitableEvent readFinished { true };
+        std::function<void()> onReady;
+    };
+    std::shared_ptr<PendingLibraryLoad> pendingLibraryLoad;  // message thread only
+    std::atomic<bool> libraryReady { true };
+    
+    /** Completes a pending deferred load before the library is changed */
+    void waitForDeferredLoad() { if (pendingLibraryLoad != nullptr) finishInitialization(-1); }
+    
+    static LibrarySources readLibrarySources(const juce::File& presetsDirectory,
+                                             const juce::File& userDataDirectory,
+                                             UserPresetJournal& journal);
+    static void readBundledPresets(LibrarySources& sources, const juce::File& presetsDirectory);
+    static void readUserPresets(LibrarySources& sources, UserPresetJournal& journal);
+    static bool readImportedBanks(LibrarySources& sources, const juce::File& userDataDirectory);
+    void loadLibrary(LibrarySources sources);
+    int addBundledPresets(const LibrarySources& sources);
+    void addUserPresets(LibrarySources& sources);
+    int addImportedBanks(const LibrarySources& sources);
+    int addOPMBank(const juce::File& file, const std::vector<VOPMVoice>& voices);
+    
+    const PackedPreset* findPackedPreset(int index) const;
+    Preset unpackPreset(int index) const;
+    PresetChunk& getWritableChunk(int index);
+    void storePreset(int index, const Preset& preset);
+    void appendPreset(const Preset& preset);
+    int findFreePresetId() const;
+    std::vector<int> appendVoices(const std::vector<VOPMVoice>& voices);
+    std::vector<int> appendPresets(std::vector<Preset> converted);
+    void publishImport(BankImportJob& job);
+    void removePresetsAt(const std::vector<int>& indices);
+    std::vector<int> findUnreferencedPresets(const std::vector<int>& candidates) const;
+    int findBankByFileName(const juce::String& fileName) const;
+    void handleAsyncUpdate() override;
+    void indexPreset(int index);
+    void unindexPreset(int index);
+    void rebuildIndexes();
+    void invalidateCaches();
+    void publishSnapshot();
+    void reclaimSnapshots();
+    void rebuildSearchIndexAsync() const;
+    std::vector<PresetSearchIndex::Document> makeSearchDocuments() const;
+    void rebuildSimilarityIndexAsync() const;
+    const std::vector<PresetSimilarityIndex::FeatureVector>& getFeatureVectors() const;
+    std::vector<int> findSimilarInternal(const PresetSimilarityIndex::FeatureVector& query, int maxResults, int excludeIndex) const;
     
     void loadFactoryPresets();
     void initializeBanks();
     juce::File getPresetsDirectory() const;
-    void validatePreset(Preset& preset) const;
     void ensureUserBank();
-    bool saveUserPresets();
+    UserPresetJournal& getUserJournal();
+    void compactUserJournal();
+    void compactUserJournalIfNeeded();
     bool loadUserPresets();
     bool saveImportedBanks();
     bool loadImportedBanks();
+    
+    // Declared last so pending jobs finish before the members they use go away
+    std::unique_ptr<juce::ThreadPool> backgroundPool;
 };
 
 } // namespace ymulatorsynth
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "PresetSearchIndex.h"
+#include "Debug.h"
+#include <algorithm>
+
+namespace ymulatorsynth {
+
+namespace {
+    bool isWordChar(juce::juce_wchar c)
+    {
+        return juce::CharacterFunctions::isLetterOrDigit(c);
+    }
+
+    const std::vector<int> emptyPostingList;
+}
+
+PresetSearchIndex::PresetSearchIndex(std::vector<Document> sourceDocuments, uint32_t libraryGeneration)
+    : generation(libraryGeneration)
+{
+    documents.reserve(sourceDocuments.size());
+
+    for (int docIndex = 0; docIndex < static_cast<int>(sourceDocuments.size()); ++docIndex)
+    {
+        const auto& source = sourceDocuments[static_cast<size_t>(docIndex)];
+        IndexedDocument doc;
+        doc.name = source.name.trim().toLowerCase();
+        doc.bankName = source.bankName.trim().toLowerCase();
+        doc.tags = source.tags;
+
+        // Tag postings
+        for (int bit = 0; bit < NumTagBits; ++bit)
+        {
+            if (doc.tags & (1u << bit))
+                tagPostings[static_cast<size_t>(bit)].push_back(docIndex);
+        }
+
+        addPostings(doc.name, docIndex);
+        addPostings(doc.bankName, docIndex);
+        documents.push_back(std::move(doc));
+    }
+
+    CS_DBG("PresetSearchIndex built: " + juce::String(documents.size()) + " documents, "
+           + juce::String(trigramPostings.size()) + " trigrams, generation " + juce::String(generation));
+}
+
+void PresetSearchIndex::addPostings(const juce::String& text, int docIndex)
+{
+    // Documents are visited in order, so checking the last entry is enough to
+    // keep every list sorted and unique
+    const int length = text.length();
+    const auto utf32 = text.toUTF32();
+    const auto* chars = utf32.getAddress();
+
+    for (int i = 0; i + 3 <= length; ++i)
+    {
+        auto& list = trigramPostings[makeKey(chars + i, 3)];
+        if (list.empty() || list.back() != docIndex)
+            list.push_back(docIndex);
+    }
+
+    for (int i = 0; i < length; ++i)
+    {
+        if (!isWordChar(chars[i]) || (i > 0 && isWordChar(chars[i - 1])))
+            continue;
+
+        for (int prefixLength = 1; prefixLength <= 2 && i + prefixLength <= length; ++prefixLength)
+        {
+            if (!isWordChar(chars[i + prefixLength - 1]))
+                break;
+
+            auto& list = prefixPostings[makeKey(chars + i, prefixLength)];
+            if (list.empty() || list.back() != docIndex)
+                list.push_back(docIndex);
+        }
+    }
+}
+
+std::vector<int> PresetSearchIndex::search(const juce::String& queryString, int maxResults) const
+{
+    std::vector<int> results;
+    const auto query = parseQuery(queryString);
+    if (query.isEmpty() || maxResults <= 0)
+        return results;
+
+    const auto* candidates = findSmallestPostingList(query);
+    if (candidates == nullptr)
+        return results;
+
+    for (int docIndex : *candidates)
+    {
+        if (matchesIndexed(docIndex, query))
+        {
+            results.push_back(docIndex);
+            if (static_cast<int>(results.size()) >= maxResults)
+                break;
+        }
+    }
+
+    return results;
+}
+
+std::vector<int> PresetSearchIndex::refine(const std::vector<int>& previousResults, const juce::String& queryString, int maxResults) const
+{
+    std::vector<int> results;
+    const auto query = parseQuery(queryString);
+    if (query.isEmpty() || maxResults <= 0)
+        return results;
+
+    for (int docIndex : previousResults)
+    {
+        if (docIndex >= 0 && docIndex < static_cast<int>(documents.size()) && matchesIndexed(docIndex, query))
+        {
+            results.push_back(docIndex);
+            if (static_cast<int>(results.size()) >= maxResults)
+                break;
+        }
+    }
+
+    return results;
+}
+
+uint32_t PresetSearchIndex::makeTags(int algorithm, int feedback, bool noiseEnabled, bool lfoInUse)
+{
+    uint32_t tags = 0;
+    tags |= 1u << (AlgorithmTagShift + juce::jlimit(0, 7, algorithm));
+    tags |= 1u << (FeedbackTagShift + juce::jlimit(0, 7, feedback));
+    if (noiseEnabled) tags |= NoiseTag;
+    if (lfoInUse) tags |= LfoTag;
+    return tags;
+}
+
+PresetSearchIndex::Query PresetSearchIndex::parseQuery(const juce::String& queryString)
+{
+    Query query;
+    auto tokens = juce::StringArray::fromTokens(queryString.toLowerCase(), " \t\r\n", "");
+    tokens.removeEmptyStrings();
+
+    for (const auto& token : tokens)
+    {
+        if (token.startsWith("alg:") || token.startsWith("fb:"))
+        {
+            const auto valueText = token.fromFirstOccurrenceOf(":", false, false);
+            const int value = valueText.getIntValue();
+            if (valueText.containsOnly("0123456789") && valueText.isNotEmpty() && value >= 0 && value <= 7)
+            {
+                const int shift = token.startsWith("alg:") ? AlgorithmTagShift : FeedbackTagShift;
+                query.requiredTags |= 1u << (shift + value);
+                continue;
+            }
+        }
+        else if (token == "is:noise")
+        {
+            query.requiredTags |= NoiseTag;
+            continue;
+        }
+        else if (token == "is:lfo")
+        {
+            query.requiredTags |= LfoTag;
+            continue;
+        }
+
+        query.terms.add(token);
+    }
+
+    return query;
+}
+
+bool PresetSearchIndex::matches(juce::CharPointer_UTF8 name, juce::CharPointer_UTF8 bankName, uint32_t tags, const Query& query)
+{
+    if ((tags & query.requiredTags) != query.requiredTags)
+        return false;
+
+    // Terms never contain whitespace, so a term matches the name or the bank, never across both
+    for (const auto& term : query.terms)
+    {
+        if (!textMatches(name, term) && !textMatches(bankName, term))
+            return false;
+    }
+    return true;
+}
+
+bool PresetSearchIndex::matches(const juce::String& name, const juce::String& bankName, uint32_t tags, const Query& query)
+{
+    return matches(name.toUTF8(), bankName.toUTF8(), tags, query);
+}
+
+bool PresetSearchIndex::matches(const Document& document, const Query& query)
+{
+    return matches(document.name, document.bankName, document.tags, query);
+}
+
+bool PresetSearchIndex::textMatches(juce::CharPointer_UTF8 text, const juce::String& term)
+{
+    // Terms are lower case (see parseQuery); the text may be either, so names are matched in place
+    if (term.length() >= 3)
+        return juce::CharacterFunctions::indexOfIgnoreCase(text, term.getCharPointer()) >= 0;
+
+    // Short terms only match at the start of a word
+    auto previous = juce::juce_wchar(0);
+    for (auto p = text; !p.isEmpty(); )
+    {
+        const auto start = p;
+        const auto c = p.getAndAdvance();
+        if (isWordChar(c) && !isWordChar(previous)
+            && juce::CharacterFunctions::compareIgnoreCaseUpTo(start, term.getCharPointer(), term.length()) == 0)
+            return true;
+        previous = c;
+    }
+    return false;
+}
+
+uint64_t PresetSearchIndex::makeKey(const juce::juce_wchar* chars, int length)
+{
+    // 21 bits per code point; one- and two-character keys cannot collide
+    // because every character is non-zero
+    uint64_t key = 0;
+    for (int i = 0; i < length; ++i)
+        key = (key << 21) | (static_cast<uint64_t>(chars[i]) & 0x1FFFFF);
+    return key;
+}
+
+const std::vector<int>* PresetSearchIndex::findSmallestPostingList(const Query& query) const
+{
+    const std::vector<int>* smallest = nullptr;
+    auto consider = [&smallest](const std::vector<int>* list)
+    {
+        if (smallest == nullptr || list->size() < smallest->size())
+            smallest = list;
+    };
+
+    for (int bit = 0; bit < NumTagBits; ++bit)
+    {
+        if (query.requiredTags & (1u << bit))
+            consider(&tagPostings[static_cast<size_t>(bit)]);
+    }
+
+    for (const auto& term : query.terms)
+    {
+        const auto utf32 = term.toUTF32();
+        const auto* chars = utf32.getAddress();
+        const int length = term.length();
+
+        if (length >= 3)
+        {
+            for (int i = 0; i + 3 <= length; ++i)
+            {
+                auto it = trigramPostings.find(makeKey(chars + i, 3));
+                if (it == trigramPostings.end())
+                    return &emptyPostingList;
+                consider(&it->second);
+            }
+        }
+        else if (isWordChar(chars[0]))
+        {
+            // Prefixes are indexed up to the first non-word character
+            const int prefixLength = length == 2 && isWordChar(chars[1]) ? 2 : 1;
+            auto it = prefixPostings.find(makeKey(chars, prefixLength));
+            if (it == prefixPostings.end())
+                return &emptyPostingList;
+            consider(&it->second);
+        }
+        else
+        {
+            // A short term has to start a word, so one starting with punctuation never matches
+            return &emptyPostingList;
+        }
+    }
+
+    return smallest;
+}
+
+bool PresetSearchIndex::matchesIndexed(int documentIndex, const Query& query) const
+{
+    const auto& doc = documents[static_cast<size_t>(documentIndex)];
+    return matches(doc.name, doc.bankName, doc.tags, query);
+}
+
+} // namespace ymulatorsynth
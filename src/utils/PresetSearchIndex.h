@@ -0,0 +1,123 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ymulatorsynth {
+
+/**
+ * PresetSearchIndex - Immutable search index over the preset library
+ *
+ * Preset and bank names are indexed by character trigrams (substring terms)
+ * and by one/two character word prefixes (short terms). Derived tags
+ * (algorithm, feedback, noise, LFO) are kept in an inverted index.
+ *
+ * The index is built once from a document list, usually on a background
+ * thread, and is read-only afterwards, so it can be shared between threads.
+ *
+ * Query syntax - whitespace separated terms that must all match:
+ *   alg:N      algorithm N (0-7)
+ *   fb:N       feedback N (0-7)
+ *   is:noise   noise enabled
+ *   is:lfo     LFO in use (AMD or PMD non-zero)
+ *   anything else is matched against the preset and bank name
+ */
+class PresetSearchIndex
+{
+public:
+    /** Tag bits stored per document */
+    enum TagBits : uint32_t
+    {
+        AlgorithmTagShift = 0,   // bits 0-7: one bit per algorithm
+        FeedbackTagShift = 8,    // bits 8-15: one bit per feedback level
+        NoiseTag = 1u << 16,
+        LfoTag = 1u << 17,
+        NumTagBits = 18
+    };
+
+    /**
+     * One searchable entry. The position in the document list is the global
+     * preset index returned by search().
+     */
+    struct Document
+    {
+        juce::String name;
+        juce::String bankName;
+        uint32_t tags = 0;
+    };
+
+    /** Parsed form of a query string */
+    struct Query
+    {
+        juce::StringArray terms;   // normalized text terms
+        uint32_t requiredTags = 0;
+        bool isEmpty() const { return terms.isEmpty() && requiredTags == 0; }
+    };
+
+    /**
+     * Builds the index
+     * @param documents One document per preset, in preset index order
+     * @param generation Library generation the documents were taken from
+     */
+    PresetSearchIndex(std::vector<Document> documents, uint32_t generation);
+
+    /**
+     * Runs a query against the index
+     * @param query Query string (see class description)
+     * @param maxResults Maximum number of preset indices to return
+     * @return Matching preset indices in ascending order
+     */
+    std::vector<int> search(const juce::String& query, int maxResults) const;
+
+    /**
+     * Narrows a previous, complete result set to a new query.
+     * Used while typing, when the new query only extends the old one.
+     */
+    std::vector<int> refine(const std::vector<int>& previousResults, const juce::String& query, int maxResults) const;
+
+    int getNumDocuments() const { return static_cast<int>(documents.size()); }
+    uint32_t getGeneration() const { return generation; }
+
+    /** Computes the tag bits for a preset's derived properties */
+    static uint32_t makeTags(int algorithm, int feedback, bool noiseEnabled, bool lfoInUse);
+
+    /** Parses a query string into text terms and required tags */
+    static Query parseQuery(const juce::String& query);
+
+    /**
+     * Checks one preset against a parsed query without an index. The index
+     * uses the same test on its candidates, so both always agree. The UTF-8
+     * form matches names where they are stored, e.g. in a PresetStringPool.
+     */
+    static bool matches(juce::CharPointer_UTF8 name, juce::CharPointer_UTF8 bankName, uint32_t tags, const Query& query);
+    static bool matches(const juce::String& name, const juce::String& bankName, uint32_t tags, const Query& query);
+    static bool matches(const Document& document, const Query& query);
+
+private:
+    struct IndexedDocument
+    {
+        juce::String name;       // normalized
+        juce::String bankName;   // normalized
+        uint32_t tags = 0;
+    };
+
+    std::vector<IndexedDocument> documents;
+    std::unordered_map<uint64_t, std::vector<int>> trigramPostings;
+    std::unordered_map<uint64_t, std::vector<int>> prefixPostings;
+    std::array<std::vector<int>, NumTagBits> tagPostings;
+    uint32_t generation = 0;
+
+    static bool textMatches(juce::CharPointer_UTF8 text, const juce::String& term);
+    void addPostings(const juce::String& text, int docIndex);
+    static uint64_t makeKey(const juce::juce_wchar* chars, int length);
+
+    const std::vector<int>* findSmallestPostingList(const Query& query) const;
+    bool matchesIndexed(int documentIndex, const Query& query) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetSearchIndex)
+};
+
+} // namespace ymulatorsynth
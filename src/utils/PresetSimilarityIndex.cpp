@@ -0,0 +1,252 @@
+#include "PresetSimilarityIndex.h"
+#include "PresetManager.h"
+#include "PackedPreset.h"
+#include "Debug.h"
+#include "../dsp/YM2151Registers.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace ymulatorsynth {
+
+namespace {
+    // Operator feature order: TL, AR, D1R, D2R, RR, D1L, KS, MUL, DT1, DT2, AMS-EN
+    constexpr int OperatorFeatureCount = 11;
+    constexpr int OperatorFeatureMax[OperatorFeatureCount] = { 127, 31, 31, 31, 15, 15, 3, 15, 6, 3, 1 };
+
+    // Weights out of 16. Carriers are heard directly, so their envelope matters
+    // most; modulators shape the spectrum, so level and frequency ratio dominate.
+    constexpr int CarrierWeights[OperatorFeatureCount]   = { 10, 14, 12, 10, 12, 12, 6, 12, 4, 8, 4 };
+    constexpr int ModulatorWeights[OperatorFeatureCount] = { 16, 10, 10, 6, 4, 8, 6, 16, 6, 10, 4 };
+
+    constexpr int ChannelFeatureBase = 4 * OperatorFeatureCount;  // 44
+    constexpr int AlgorithmFeatureBase = ChannelFeatureBase + 7;  // 51, one-hot over 8 algorithms
+
+    uint8_t quantize(int value, int maxValue, int weight)
+    {
+        const int clamped = juce::jlimit(0, maxValue, value);
+        return static_cast<uint8_t>((clamped * 255 / maxValue) * weight / 16);
+    }
+
+    // DT1 0-3 detune upwards and 4-7 downwards (4 equals 0); map onto -3..+3
+    int detune1Ordinal(int dt1)
+    {
+        dt1 &= 7;
+        return dt1 < 4 ? 3 + dt1 : 3 - (dt1 - 4);
+    }
+}
+
+struct PresetSimilarityIndex::SearchState
+{
+    const FeatureVector& query;
+    int k;
+    int excludeIndex;
+    std::priority_queue<std::pair<float, int>> heap;  // max-heap of current best
+    float tau = std::numeric_limits<float>::max();
+
+    void offer(int index, float distance)
+    {
+        if (index == excludeIndex)
+            return;
+
+        if (static_cast<int>(heap.size()) < k)
+        {
+            heap.emplace(distance, index);
+        }
+        else if (distance < heap.top().first)
+        {
+            heap.pop();
+            heap.emplace(distance, index);
+        }
+
+        if (static_cast<int>(heap.size()) == k)
+            tau = heap.top().first;
+    }
+
+    std::vector<Neighbour> takeSorted()
+    {
+        std::vector<Neighbour> result(heap.size());
+        for (auto i = result.size(); i-- > 0; heap.pop())
+            result[i] = { heap.top().second, heap.top().first };
+        return result;
+    }
+};
+
+PresetSimilarityIndex::PresetSimilarityIndex(std::vector<FeatureVector> presetFeatures, uint32_t libraryGeneration)
+    : features(std::move(presetFeatures)), generation(libraryGeneration)
+{
+    std::vector<int> items(features.size());
+    for (size_t i = 0; i < items.size(); ++i)
+        items[i] = static_cast<int>(i);
+
+    distanceScratch.resize(features.size());
+    nodes.reserve(features.size());
+
+    juce::Random random(0x594d32);  // fixed seed keeps the tree reproducible
+    root = buildNode(items, 0, static_cast<int>(items.size()), random);
+    distanceScratch.clear();
+    distanceScratch.shrink_to_fit();
+
+    CS_DBG("PresetSimilarityIndex built: " + juce::String(features.size()) + " presets, generation " + juce::String(generation));
+}
+
+std::vector<PresetSimilarityIndex::Neighbour> PresetSimilarityIndex::findNearest(const FeatureVector& query, int k, int excludeIndex) const
+{
+    if (k <= 0 || root < 0)
+        return {};
+
+    SearchState state { query, k, excludeIndex, {} };
+    searchNode(root, state);
+    return state.takeSorted();
+}
+
+PresetSimilarityIndex::FeatureVector PresetSimilarityIndex::extractFeatures(const Preset& preset)
+{
+    return extractFeatures(PackedPreset::pack(preset, 0));
+}
+
+PresetSimilarityIndex::FeatureVector PresetSimilarityIndex::extractFeatures(const PackedPreset& preset)
+{
+    FeatureVector f {};
+    const int algorithm = static_cast<int>(preset.voice.algorithm);
+
+    for (int op = 0; op < 4; ++op)
+    {
+        const auto& data = preset.operators[op];
+        const bool carrier = YM2151Regs::isCarrier(static_cast<uint8_t>(algorithm), static_cast<uint8_t>(op));
+        const int* weights = carrier ? CarrierWeights : ModulatorWeights;
+        auto* out = f.data() + op * OperatorFeatureCount;
+
+        if (!data.slotEnable)
+        {
+            // A disabled slot is silent: same as fully attenuated and nothing else
+            out[0] = quantize(127, 127, weights[0]);
+            continue;
+        }
+
+        const int values[OperatorFeatureCount] = {
+            static_cast<int>(data.totalLevel),
+            static_cast<int>(data.attackRate),
+            static_cast<int>(data.decay1Rate),
+            static_cast<int>(data.decay2Rate),
+            static_cast<int>(data.releaseRate),
+            static_cast<int>(data.sustainLevel),
+            static_cast<int>(data.keyScale),
+            static_cast<int>(data.multiple),
+            detune1Ordinal(static_cast<int>(data.detune1)),
+            static_cast<int>(data.detune2),
+            static_cast<int>(data.amsEnable)
+        };
+
+        for (int i = 0; i < OperatorFeatureCount; ++i)
+            out[i] = quantize(values[i], OperatorFeatureMax[i], weights[i]);
+    }
+
+    // Channel-level features. LFO rate only matters when the LFO modulates something.
+    const auto& voice = preset.voice;
+    const bool lfoInUse = voice.lfoAmd > 0 || voice.lfoPmd > 0;
+    f[ChannelFeatureBase + 0] = quantize(static_cast<int>(voice.feedback), 7, 12);
+    f[ChannelFeatureBase + 1] = lfoInUse ? quantize(static_cast<int>(voice.lfoRate), 255, 4) : 0;
+    f[ChannelFeatureBase + 2] = quantize(static_cast<int>(voice.lfoAmd), 127, 8);
+    f[ChannelFeatureBase + 3] = quantize(static_cast<int>(voice.lfoPmd), 127, 8);
+    f[ChannelFeatureBase + 4] = quantize(static_cast<int>(voice.ams), 3, 6);
+    f[ChannelFeatureBase + 5] = quantize(static_cast<int>(voice.pms), 7, 6);
+    f[ChannelFeatureBase + 6] = voice.noiseEnable != 0 ? quantize(1, 1, 16) : 0;
+
+    f[AlgorithmFeatureBase + algorithm] = quantize(1, 1, 16);
+    return f;
+}
+
+uint32_t PresetSimilarityIndex::distanceSquared(const FeatureVector& a, const FeatureVector& b) noexcept
+{
+    // Fixed trip count over contiguous bytes with an integer accumulator;
+    // vectorised by the compiler on both x86-64 and arm64 builds
+    uint32_t sum = 0;
+    for (int i = 0; i < FeatureCount; ++i)
+    {
+        const int d = static_cast<int>(a[static_cast<size_t>(i)]) - static_cast<int>(b[static_cast<size_t>(i)]);
+        sum += static_cast<uint32_t>(d * d);
+    }
+    return sum;
+}
+
+std::vector<PresetSimilarityIndex::Neighbour> PresetSimilarityIndex::findNearestLinear(const std::vector<FeatureVector>& allFeatures,
+                                                                                       const FeatureVector& query, int k, int excludeIndex)
+{
+    if (k <= 0)
+        return {};
+
+    SearchState state { query, k, excludeIndex, {} };
+    for (size_t i = 0; i < allFeatures.size(); ++i)
+        state.offer(static_cast<int>(i), std::sqrt(static_cast<float>(distanceSquared(query, allFeatures[i]))));
+    return state.takeSorted();
+}
+
+int PresetSimilarityIndex::buildNode(std::vector<int>& items, int begin, int end, juce::Random& random)
+{
+    if (begin >= end)
+        return -1;
+
+    const int nodeIndex = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+
+    // Random vantage point, moved to the front of the range
+    std::swap(items[static_cast<size_t>(begin)], items[static_cast<size_t>(begin + random.nextInt(end - begin))]);
+    const int vantage = items[static_cast<size_t>(begin)];
+    nodes[static_cast<size_t>(nodeIndex)].item = vantage;
+
+    if (end - begin == 1)
+        return nodeIndex;
+
+    // Split the remaining items at the median distance to the vantage point
+    const auto& vp = features[static_cast<size_t>(vantage)];
+    for (int i = begin + 1; i < end; ++i)
+    {
+        const int item = items[static_cast<size_t>(i)];
+        distanceScratch[static_cast<size_t>(item)] = distanceSquared(vp, features[static_cast<size_t>(item)]);
+    }
+
+    const int mid = (begin + 1 + end) / 2;
+    std::nth_element(items.begin() + begin + 1, items.begin() + mid, items.begin() + end,
+                     [this](int a, int b) { return distanceScratch[static_cast<size_t>(a)] < distanceScratch[static_cast<size_t>(b)]; });
+
+    const float threshold = std::sqrt(static_cast<float>(distanceScratch[static_cast<size_t>(items[static_cast<size_t>(mid)])]));
+    const int inside = buildNode(items, begin + 1, mid, random);
+    const int outside = buildNode(items, mid, end, random);
+
+    // nodes may have reallocated during the recursive calls
+    auto& node = nodes[static_cast<size_t>(nodeIndex)];
+    node.threshold = threshold;
+    node.inside = inside;
+    node.outside = outside;
+    return nodeIndex;
+}
+
+void PresetSimilarityIndex::searchNode(int nodeIndex, SearchState& state) const
+{
+    if (nodeIndex < 0)
+        return;
+
+    const auto& node = nodes[static_cast<size_t>(nodeIndex)];
+    const float d = std::sqrt(static_cast<float>(distanceSquared(state.query, features[static_cast<size_t>(node.item)])));
+    state.offer(node.item, d);
+
+    // Inside holds distances <= threshold, outside holds distances >= threshold
+    if (d < node.threshold)
+    {
+        if (d - state.tau <= node.threshold)
+            searchNode(node.inside, state);
+        if (d + state.tau >= node.threshold)
+            searchNode(node.outside, state);
+    }
+    else
+    {
+        if (d + state.tau >= node.threshold)
+            searchNode(node.outside, state);
+        if (d - state.tau <= node.threshold)
+            searchNode(node.inside, state);
+    }
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ymulatorsynth {
+
+struct Preset;
+struct PackedPreset;
+
+/**
+ * PresetSimilarityIndex - "More like this" nearest-neighbour lookup over timbres
+ *
+ * Each preset is reduced to a quantized 64-byte feature vector. Operator
+ * parameters are weighted by the operator's role in the preset's algorithm:
+ * carriers emphasise envelope shape and level, modulators emphasise the
+ * values that set brightness (TL, MUL, detune). Distances are Euclidean over
+ * the weighted vectors, so the index is a true metric space and can be
+ * searched with a vantage-point tree.
+ *
+ * Immutable after construction; build on a background thread and share.
+ */
+class PresetSimilarityIndex
+{
+public:
+    static constexpr int FeatureCount = 64;
+    using FeatureVector = std::array<uint8_t, FeatureCount>;
+
+    struct Neighbour
+    {
+        int presetIndex = -1;
+        float distance = 0.0f;
+    };
+
+    /**
+     * Builds the VP-tree
+     * @param features One feature vector per preset, in preset index order
+     * @param generation Library generation the features were taken from
+     */
+    PresetSimilarityIndex(std::vector<FeatureVector> features, uint32_t generation);
+
+    /**
+     * Finds the k nearest presets to a feature vector
+     * @param query Feature vector to search for
+     * @param k Number of neighbours to return
+     * @param excludeIndex Preset index to skip (usually the query preset itself)
+     * @return Neighbours ordered by increasing distance
+     */
+    std::vector<Neighbour> findNearest(const FeatureVector& query, int k, int excludeIndex = -1) const;
+
+    int getNumPresets() const { return static_cast<int>(features.size()); }
+    uint32_t getGeneration() const { return generation; }
+
+    /** Computes the weighted, quantized feature vector of a preset */
+    static FeatureVector extractFeatures(const Preset& preset);
+    static FeatureVector extractFeatures(const PackedPreset& preset);
+
+    /** Squared Euclidean distance; a plain loop the compiler vectorises */
+    static uint32_t distanceSquared(const FeatureVector& a, const FeatureVector& b) noexcept;
+
+    /** Brute-force k nearest neighbours (used while no index is available) */
+    static std::vector<Neighbour> findNearestLinear(const std::vector<FeatureVector>& features,
+                                                    const FeatureVector& query, int k, int excludeIndex = -1);
+
+private:
+    struct Node
+    {
+        int item = -1;          // preset index of the vantage point
+        float threshold = 0.0f; // median distance to the vantage point
+        int inside = -1;        // child with distance <= threshold
+        int outside = -1;       // child with distance >= threshold
+    };
+
+    struct SearchState;
+
+    std::vector<FeatureVector> features;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> distanceScratch;  // only used while building
+    int root = -1;
+    uint32_t generation = 0;
+
+    int buildNode(std::vector<int>& items, int begin, int end, juce::Random& random);
+    void searchNode(int nodeIndex, SearchState& state) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetSimilarityIndex)
+};
+
+} // namespace ymulatorsynth
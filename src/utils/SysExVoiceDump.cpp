@@ -0,0 +1,279 @@
+#include "SysExVoiceDump.h"
+#include "Debug.h"
+
+namespace ymulatorsynth {
+
+namespace {
+
+constexpr uint8_t SysExStart = 0xF0;
+constexpr uint8_t SysExEnd = 0xF7;
+
+uint8_t to7Bit(int value)
+{
+    return static_cast<uint8_t>(juce::jlimit(0, 127, value));
+}
+
+} // namespace
+
+// ============================================================================
+// Transmit
+// ============================================================================
+
+juce::MemoryBlock SysExVoiceDump::createVoiceDump(const VOPMVoice& voice)
+{
+    std::vector<uint8_t> payload;
+    payload.reserve(VoiceRecordSize);
+    writeVoiceRecord(voice, payload);
+    return createMessage(Type::Voice, payload);
+}
+
+juce::MemoryBlock SysExVoiceDump::createBankDump(const std::vector<VOPMVoice>& voices)
+{
+    const int count = juce::jmin(static_cast<int>(voices.size()), MaxBankVoices);
+
+    std::vector<uint8_t> payload;
+    payload.reserve(static_cast<size_t>(2 + count * VoiceRecordSize));
+    payload.push_back(static_cast<uint8_t>(count >> 7));
+    payload.push_back(static_cast<uint8_t>(count & 0x7f));
+    for (int i = 0; i < count; ++i)
+    {
+        writeVoiceRecord(voices[static_cast<size_t>(i)], payload);
+    }
+    return createMessage(Type::Bank, payload);
+}
+
+juce::MemoryBlock SysExVoiceDump::createOpmTextDump(const juce::String& opmContent)
+{
+    std::vector<uint8_t> payload;
+    const auto* text = opmContent.toRawUTF8();
+    for (; *text != 0; ++text)
+    {
+        // Anything outside 7-bit ASCII cannot travel in SysEx
+        const auto c = static_cast<uint8_t>(*text);
+        payload.push_back(c < 0x80 ? c : static_cast<uint8_t>('?'));
+    }
+    return createMessage(Type::OpmText, payload);
+}
+
+juce::MemoryBlock SysExVoiceDump::createMessage(Type type, const std::vector<uint8_t>& payload)
+{
+    juce::MemoryBlock message;
+    message.ensureSize(payload.size() + HeaderSize + 2);
+
+    const uint8_t header[] = { SysExStart, ManufacturerId, SignatureY, SignatureM, static_cast<uint8_t>(type) };
+    message.append(header, sizeof(header));
+    message.append(payload.data(), payload.size());
+
+    int sum = static_cast<int>(type);
+    for (auto byte : payload)
+    {
+        sum += byte;
+    }
+    const uint8_t trailer[] = { static_cast<uint8_t>((128 - (sum & 0x7f)) & 0x7f), SysExEnd };
+    message.append(trailer, sizeof(trailer));
+    return message;
+}
+
+void SysExVoiceDump::writeVoiceRecord(const VOPMVoice& voice, std::vector<uint8_t>& out)
+{
+    const auto name = voice.name.toRawUTF8();
+    bool nameEnded = false;
+    for (int i = 0; i < NameLength; ++i)
+    {
+        nameEnded = nameEnded || name[i] == 0;
+        const auto c = nameEnded ? static_cast<uint8_t>(' ') : static_cast<uint8_t>(name[i]);
+        out.push_back(c >= 0x20 && c < 0x7f ? c : static_cast<uint8_t>('?'));
+    }
+
+    const int lfrq = juce::jlimit(0, 255, voice.lfo.frequency);
+    out.push_back(static_cast<uint8_t>(lfrq >> 7));
+    out.push_back(static_cast<uint8_t>(lfrq & 0x7f));
+    out.push_back(to7Bit(voice.lfo.amd));
+    out.push_back(to7Bit(voice.lfo.pmd));
+    out.push_back(to7Bit(voice.lfo.waveform));
+    out.push_back(to7Bit(voice.lfo.noiseFreq));
+
+    out.push_back(to7Bit(voice.channel.pan));
+    out.push_back(to7Bit(voice.channel.feedback));
+    out.push_back(to7Bit(voice.channel.algorithm));
+    out.push_back(to7Bit(voice.channel.ams));
+    out.push_back(to7Bit(voice.channel.pms));
+    out.push_back(to7Bit(voice.channel.slotMask));
+    out.push_back(to7Bit(voice.channel.noiseEnable));
+
+    for (const auto& op : voice.operators)
+    {
+        out.push_back(to7Bit(op.attackRate));
+        out.push_back(to7Bit(op.decay1Rate));
+        out.push_back(to7Bit(op.decay2Rate));
+        out.push_back(to7Bit(op.releaseRate));
+        out.push_back(to7Bit(op.decay1Level));
+        out.push_back(to7Bit(op.totalLevel));
+        out.push_back(to7Bit(op.keyScale));
+        out.push_back(to7Bit(op.multiple));
+        out.push_back(to7Bit(op.detune1));
+        out.push_back(to7Bit(op.detune2));
+        out.push_back(to7Bit(op.amsEnable));
+    }
+}
+
+// ============================================================================
+// Receive
+// ============================================================================
+
+bool SysExVoiceDump::isYMulatorMessage(const uint8_t* data, int size)
+{
+    return data != nullptr && size > HeaderSize
+        && data[0] == SysExStart && data[1] == ManufacturerId
+        && data[2] == SignatureY && data[3] == SignatureM;
+}
+
+SysExVoiceDump::Result SysExVoiceDump::parse(const uint8_t* data, int size)
+{
+    Result result;
+
+    // juce::MidiMessage::getSysExData() leaves out F0 and F7, raw buffers keep them
+    if (data != nullptr && size > 0 && data[0] == SysExStart)
+    {
+        ++data;
+        --size;
+    }
+    if (data != nullptr && size > 0 && data[size - 1] == SysExEnd)
+    {
+        --size;
+    }
+
+    // ID, signature, type and checksum
+    if (data == nullptr || size < 5 || data[0] != ManufacturerId || data[1] != SignatureY || data[2] != SignatureM)
+    {
+        result.error = "Not a YMulator SysEx message";
+        return result;
+    }
+
+    int sum = 0;
+    for (int i = 3; i < size; ++i)
+    {
+        if (data[i] >= 0x80)
+        {
+            result.error = "Status byte inside SysEx data at offset " + juce::String(i);
+            return result;
+        }
+        sum += data[i];
+    }
+    if ((sum & 0x7f) != 0)
+    {
+        result.error = "Checksum mismatch";
+        return result;
+    }
+
+    const uint8_t* payload = data + 4;
+    const int payloadSize = size - 5;
+
+    switch (data[3])
+    {
+        case static_cast<uint8_t>(Type::Voice):
+            result.type = Type::Voice;
+            if (payloadSize != VoiceRecordSize)
+            {
+                result.error = "Voice dump has " + juce::String(payloadSize) + " data bytes, expected "
+                             + juce::String(VoiceRecordSize);
+                return result;
+            }
+            result.voices.push_back(readVoiceRecord(payload, 0));
+            break;
+
+        case static_cast<uint8_t>(Type::Bank):
+        {
+            result.type = Type::Bank;
+            const int count = payloadSize >= 2 ? (payload[0] << 7) | payload[1] : 0;
+            if (count < 1 || count > MaxBankVoices || payloadSize != 2 + count * VoiceRecordSize)
+            {
+                result.error = "Bank dump size does not match its voice count";
+                return result;
+            }
+            result.voices.reserve(static_cast<size_t>(count));
+            for (int i = 0; i < count; ++i)
+            {
+                result.voices.push_back(readVoiceRecord(payload + 2 + i * VoiceRecordSize, i));
+            }
+            break;
+        }
+
+        case static_cast<uint8_t>(Type::OpmText):
+            result.type = Type::OpmText;
+            result.voices = VOPMParser::parseContent(
+                juce::String::fromUTF8(reinterpret_cast<const char*>(payload), payloadSize));
+            if (result.voices.empty())
+            {
+                result.error = "OPM text dump holds no complete voice";
+                return result;
+            }
+            break;
+
+        default:
+            result.error = "Unknown dump type " + juce::String(data[3]);
+            return result;
+    }
+
+    // Same checks as an imported .opm file
+    for (const auto& voice : result.voices)
+    {
+        auto validation = VOPMParser::validate(voice);
+        if (!validation.isValid)
+        {
+            result.voices.clear();
+            result.error = "Voice " + juce::String(voice.number) + ": " + validation.errors.joinIntoString(", ");
+            return result;
+        }
+        for (const auto& warning : validation.warnings)
+        {
+            result.warnings.add("Voice " + juce::String(voice.number) + ": " + warning);
+        }
+    }
+
+    result.isValid = true;
+    return result;
+}
+
+VOPMVoice SysExVoiceDump::readVoiceRecord(const uint8_t* record, int number)
+{
+    VOPMVoice voice;
+    voice.number = number;
+    voice.name = juce::String::fromUTF8(reinterpret_cast<const char*>(record), NameLength).trimEnd();
+
+    const uint8_t* p = record + NameLength;
+    voice.lfo.frequency = (p[0] << 7) | p[1];
+    voice.lfo.amd = p[2];
+    voice.lfo.pmd = p[3];
+    voice.lfo.waveform = p[4];
+    voice.lfo.noiseFreq = p[5];
+    p += 6;
+
+    voice.channel.pan = p[0];
+    voice.channel.feedback = p[1];
+    voice.channel.algorithm = p[2];
+    voice.channel.ams = p[3];
+    voice.channel.pms = p[4];
+    voice.channel.slotMask = p[5];
+    voice.channel.noiseEnable = p[6];
+    p += 7;
+
+    for (auto& op : voice.operators)
+    {
+        op.attackRate = p[0];
+        op.decay1Rate = p[1];
+        op.decay2Rate = p[2];
+        op.releaseRate = p[3];
+        op.decay1Level = p[4];
+        op.totalLevel = p[5];
+        op.keyScale = p[6];
+        op.multiple = p[7];
+        op.detune1 = p[8];
+        op.detune2 = p[9];
+        op.amsEnable = p[10];
+        p += 11;
+    }
+    return voice;
+}
+
+} // namespace ymulatorsynth
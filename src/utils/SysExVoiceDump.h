@@ -0,0 +1,86 @@
+#pragma once
+
+#include "VOPMParser.h"
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <vector>
+
+namespace ymulatorsynth {
+
+/**
+ * SysExVoiceDump - YMulator voice and bank dumps as MIDI System Exclusive
+ *
+ * Message layout (every byte between F0 and F7 is 7-bit):
+ *
+ *   F0 7D 59 4D <type> <payload...> <checksum> F7
+ *
+ *   7D          manufacturer ID for non-commercial use
+ *   59 4D       "YM"
+ *   type        01 = voice dump, 02 = bank dump, 03 = OPM text dump
+ *   checksum    makes the sum of type, payload and checksum a multiple of 128
+ *
+ * Voice dump payload: one voice record. Bank dump payload: the voice count
+ * as two 7-bit bytes (MSB first, 1-128), then that many voice records. OPM
+ * text dump payload: the ASCII text of a .opm file, one or more voices,
+ * parsed by VOPMParser exactly like a file.
+ *
+ * A voice record is 73 bytes in VOPMVoice order and units:
+ *   name      16 ASCII bytes, space padded
+ *   LFO       LFRQ (2 bytes, MSB first), AMD, PMD, WF, NFRQ
+ *   CH        PAN (0 off, 1 right, 2 left, 3 centre), FL, CON, AMS, PMS, SLOT (0-15), NE
+ *   M1 C1 M2 C2  AR, D1R, D2R, RR, D1L, TL, KS, MUL, DT1, DT2, AMS-EN (0-1) each
+ *
+ * Received voices go through VOPMParser::validate() like imported files;
+ * a voice with errors rejects the whole message.
+ */
+class SysExVoiceDump
+{
+public:
+    enum class Type : uint8_t
+    {
+        Voice = 0x01,
+        Bank = 0x02,
+        OpmText = 0x03
+    };
+
+    static constexpr uint8_t ManufacturerId = 0x7D;
+    static constexpr uint8_t SignatureY = 0x59;
+    static constexpr uint8_t SignatureM = 0x4D;
+    static constexpr int HeaderSize = 5;             // F0, ID, signature, type
+    static constexpr int NameLength = 16;
+    static constexpr int VoiceRecordSize = NameLength + 6 + 7 + 4 * 11;
+    static constexpr int MaxBankVoices = 128;
+
+    struct Result
+    {
+        bool isValid = false;
+        Type type = Type::Voice;
+        std::vector<VOPMVoice> voices;
+        juce::String error;
+        juce::StringArray warnings;
+    };
+
+    /** Complete messages, F0 to F7 */
+    static juce::MemoryBlock createVoiceDump(const VOPMVoice& voice);
+    static juce::MemoryBlock createBankDump(const std::vector<VOPMVoice>& voices);
+    static juce::MemoryBlock createOpmTextDump(const juce::String& opmContent);
+
+    /**
+     * Cheap header check, safe on the audio thread
+     * @param data Message bytes, starting with F0
+     */
+    static bool isYMulatorMessage(const uint8_t* data, int size);
+
+    /**
+     * Checks, decodes and validates a message
+     * @param data Message bytes, with or without F0 and F7
+     */
+    static Result parse(const uint8_t* data, int size);
+
+private:
+    static juce::MemoryBlock createMessage(Type type, const std::vector<uint8_t>& payload);
+    static void writeVoiceRecord(const VOPMVoice& voice, std::vector<uint8_t>& out);
+    static VOPMVoice readVoiceRecord(const uint8_t* record, int number);
+};
+
+} // namespace ymulatorsynth
@@ -0,0 +1,473 @@
+#include "UserPresetJournal.h"
+#include "Debug.h"
+#include <array>
+#include <cstring>
+
+namespace ymulatorsynth {
+
+namespace {
+    constexpr char JournalMagic[4] = { 'Y', 'M', 'J', '1' };
+    constexpr int HeaderSize = 8;        // magic + generation
+    constexpr int RecordHeaderSize = 8;  // payload size + crc
+    constexpr int MaxPayloadSize = 1 << 20;
+}
+
+UserPresetJournal::UserPresetJournal(const juce::File& dataDirectory)
+    : directory(dataDirectory)
+{
+}
+
+UserPresetJournal::~UserPresetJournal()
+{
+    // ThreadPool drops jobs that have not started, so drain the queue first
+    waitUntilWritten(5000);
+}
+
+//==============================================================================
+// Loading
+
+std::vector<Preset> UserPresetJournal::load()
+{
+    waitUntilWritten(5000);
+    journalStream.reset();
+
+    std::vector<Preset> userPresets;
+    uint32_t snapshotGeneration = 0;
+
+    auto snapshotFile = getSnapshotFile();
+    if (snapshotFile.existsAsFile())
+    {
+        if (auto xml = juce::XmlDocument::parse(snapshotFile))
+        {
+            snapshotGeneration = static_cast<uint32_t>(xml->getIntAttribute("journalGeneration", 0));
+            for (auto* presetElement : xml->getChildWithTagNameIterator("Preset"))
+                userPresets.push_back(presetFromXml(*presetElement));
+        }
+        else
+        {
+            CS_DBG("Failed to parse user presets XML");
+        }
+    }
+
+    const auto scan = scanJournal(snapshotGeneration, &userPresets);
+    generation = snapshotGeneration;
+    generationKnown = true;
+    numRecords = scan.numRecords;
+
+    CS_DBG("User presets: " + juce::String(userPresets.size()) + " loaded, "
+           + juce::String(scan.numRecords) + " journal records replayed");
+    return userPresets;
+}
+
+UserPresetJournal::ScanResult UserPresetJournal::scanJournal(uint32_t expectedGeneration, std::vector<Preset>* replayInto) const
+{
+    ScanResult result;
+
+    juce::MemoryBlock contents;
+    if (!getJournalFile().loadFileAsData(contents) || contents.getSize() < HeaderSize)
+        return result;
+
+    const auto* bytes = static_cast<const uint8_t*>(contents.getData());
+    if (std::memcmp(bytes, JournalMagic, sizeof(JournalMagic)) != 0)
+        return result;
+
+    result.generation = juce::ByteOrder::littleEndianInt(bytes + 4);
+    if (result.generation != expectedGeneration)
+    {
+        // Left over from a compaction that already folded it into the snapshot
+        CS_DBG("Ignoring stale user preset journal (generation " + juce::String(result.generation) + ")");
+        return result;
+    }
+
+    result.headerValid = true;
+    result.validBytes = HeaderSize;
+
+    const auto size = static_cast<int64_t>(contents.getSize());
+    while (result.validBytes + RecordHeaderSize <= size)
+    {
+        const auto* record = bytes + result.validBytes;
+        const auto payloadSize = static_cast<int64_t>(juce::ByteOrder::littleEndianInt(record));
+        const auto checksum = juce::ByteOrder::littleEndianInt(record + 4);
+
+        if (payloadSize < 5 || payloadSize > MaxPayloadSize
+            || result.validBytes + RecordHeaderSize + payloadSize > size)
+            break;  // Torn write
+
+        const auto* payload = record + RecordHeaderSize;
+        if (crc32(payload, static_cast<size_t>(payloadSize)) != checksum)
+            break;  // Corrupt record; nothing after it can be trusted
+
+        if (replayInto != nullptr)
+        {
+            auto& list = *replayInto;
+            const auto operation = static_cast<Operation>(payload[0]);
+            const auto position = static_cast<int>(juce::ByteOrder::littleEndianInt(payload + 1));
+            const auto* data = reinterpret_cast<const char*>(payload + 5);
+            const auto dataSize = static_cast<size_t>(payloadSize - 5);
+            const bool inRange = position >= 0 && position < static_cast<int>(list.size());
+
+            if (operation == Operation::Add)
+            {
+                if (auto xml = juce::XmlDocument::parse(juce::String::fromUTF8(data, static_cast<int>(dataSize))))
+                {
+                    const auto insertAt = juce::jlimit(0, static_cast<int>(list.size()), position);
+                    list.insert(list.begin() + insertAt, presetFromXml(*xml));
+                }
+            }
+            else if (operation == Operation::Rename && inRange)
+            {
+                list[static_cast<size_t>(position)].name = juce::String::fromUTF8(data, static_cast<int>(dataSize));
+            }
+            else if (operation == Operation::Delete && inRange)
+            {
+                list.erase(list.begin() + position);
+            }
+        }
+
+        result.validBytes += RecordHeaderSize + payloadSize;
+        ++result.numRecords;
+    }
+
+    if (result.validBytes < size)
+        CS_DBG("User preset journal has " + juce::String(size - result.validBytes) + " unreadable trailing bytes");
+
+    return result;
+}
+
+uint32_t UserPresetJournal::readSnapshotGeneration() const
+{
+    auto snapshotFile = getSnapshotFile();
+    if (!snapshotFile.existsAsFile())
+        return 0;
+
+    auto xml = juce::XmlDocument::parse(snapshotFile);
+    return xml != nullptr ? static_cast<uint32_t>(xml->getIntAttribute("journalGeneration", 0)) : 0;
+}
+
+//==============================================================================
+// Mutations
+
+void UserPresetJournal::appendAdd(int position, const Preset& preset)
+{
+    const auto text = presetToXml(preset)->toString(juce::XmlElement::TextFormat().singleLine().withoutHeader());
+    juce::MemoryBlock data(text.toRawUTF8(), text.getNumBytesAsUTF8());
+    appendRecord(Operation::Add, position, data);
+}
+
+void UserPresetJournal::appendRename(int position, const juce::String& newName)
+{
+    juce::MemoryBlock data(newName.toRawUTF8(), newName.getNumBytesAsUTF8());
+    appendRecord(Operation::Rename, position, data);
+}
+
+void UserPresetJournal::appendDelete(int position)
+{
+    appendRecord(Operation::Delete, position, {});
+}
+
+void UserPresetJournal::appendRecord(Operation operation, int position, const juce::MemoryBlock& data)
+{
+    juce::MemoryOutputStream payload;
+    payload.writeByte(static_cast<char>(operation));
+    payload.writeInt(position);
+    if (data.getSize() > 0)
+        payload.write(data.getData(), data.getSize());
+
+    juce::MemoryOutputStream record;
+    record.writeInt(static_cast<int>(payload.getDataSize()));
+    record.writeInt(static_cast<int>(crc32(payload.getData(), payload.getDataSize())));
+    record.write(payload.getData(), payload.getDataSize());
+
+    ++numRecords;
+    writer.addJob([this, block = record.getMemoryBlock()] { writeRecordOnWriter(block); });
+}
+
+void UserPresetJournal::compact(std::vector<Preset> userPresets)
+{
+    numRecords = 0;
+    writer.addJob([this, presets = std::move(userPresets)] { compactOnWriter(presets); });
+}
+
+void UserPresetJournal::compact(std::shared_ptr<const PresetLibrarySnapshot> library, int userBankIndex)
+{
+    numRecords = 0;
+    writer.addJob([this, library = std::move(library), userBankIndex]
+    {
+        std::vector<Preset> userPresets;
+        if (userBankIndex >= 0 && userBankIndex < static_cast<int>(library->banks->size()))
+        {
+            const auto& indices = (*library->banks)[static_cast<size_t>(userBankIndex)].presetIndices;
+            userPresets.reserve(indices.size());
+            for (int presetIndex : indices)
+            {
+                if (const auto preset = library->getPreset(presetIndex))
+                    userPresets.push_back(*preset);
+            }
+        }
+        compactOnWriter(userPresets);
+    });
+}
+
+bool UserPresetJournal::waitUntilWritten(int timeoutMs)
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMs);
+    while (writer.getNumJobs() > 0)
+    {
+        if (juce::Time::getMillisecondCounter() >= deadline)
+            return false;
+        juce::Thread::sleep(1);
+    }
+    return true;
+}
+
+//==============================================================================
+// Writer thread
+
+void UserPresetJournal::writeRecordOnWriter(const juce::MemoryBlock& record)
+{
+    if (!openJournalOnWriter())
+        return;
+
+    if (!journalStream->write(record.getData(), record.getSize()))
+    {
+        reportFailure("Failed to append to user preset journal");
+        journalStream.reset();
+        return;
+    }
+
+    journalStream->flush();
+    if (journalStream->getStatus().failed())
+    {
+        reportFailure("Failed to flush user preset journal: " + journalStream->getStatus().getErrorMessage());
+        journalStream.reset();
+    }
+}
+
+void UserPresetJournal::compactOnWriter(const std::vector<Preset>& userPresets)
+{
+    if (!directory.createDirectory())
+    {
+        reportFailure("Failed to create user data directory: " + directory.getFullPathName());
+        return;
+    }
+
+    if (!generationKnown)
+    {
+        generation = readSnapshotGeneration();
+        generationKnown = true;
+    }
+
+    const auto newGeneration = generation + 1;
+
+    juce::XmlElement root("UserPresets");
+    root.setAttribute("journalGeneration", static_cast<int>(newGeneration));
+    for (const auto& preset : userPresets)
+        root.addChildElement(presetToXml(preset).release());
+
+    // writeTo() goes through a temporary file, so the old snapshot survives a failed write
+    if (!root.writeTo(getSnapshotFile()))
+    {
+        reportFailure("Failed to write user presets snapshot");
+        return;
+    }
+
+    // The old journal is now stale; a crash before this point leaves it ignored on load
+    startNewJournalOnWriter(newGeneration);
+    CS_DBG("Compacted user presets: " + juce::String(userPresets.size()) + " presets, generation " + juce::String(newGeneration));
+}
+
+bool UserPresetJournal::openJournalOnWriter()
+{
+    if (journalStream != nullptr)
+        return true;
+
+    if (!directory.createDirectory())
+    {
+        reportFailure("Failed to create user data directory: " + directory.getFullPathName());
+        return false;
+    }
+
+    if (!generationKnown)
+    {
+        generation = readSnapshotGeneration();
+        generationKnown = true;
+    }
+
+    const auto scan = scanJournal(generation, nullptr);
+    if (!scan.headerValid)
+        return startNewJournalOnWriter(generation);
+
+    journalStream = std::make_unique<juce::FileOutputStream>(getJournalFile());
+    if (journalStream->failedToOpen())
+    {
+        reportFailure("Failed to open user preset journal: " + journalStream->getStatus().getErrorMessage());
+        journalStream.reset();
+        return false;
+    }
+
+    // Cut off a torn tail so new records follow the last good one
+    if (journalStream->getPosition() != scan.validBytes)
+    {
+        journalStream->setPosition(scan.validBytes);
+        journalStream->truncate();
+    }
+    return true;
+}
+
+bool UserPresetJournal::startNewJournalOnWriter(uint32_t newGeneration)
+{
+    journalStream.reset();
+
+    juce::MemoryOutputStream header;
+    header.write(JournalMagic, sizeof(JournalMagic));
+    header.writeInt(static_cast<int>(newGeneration));
+
+    juce::TemporaryFile temp(getJournalFile());
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen() || !out.write(header.getData(), header.getDataSize()))
+        {
+            reportFailure("Failed to create user preset journal");
+            return false;
+        }
+        out.flush();
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+    {
+        reportFailure("Failed to replace user preset journal");
+        return false;
+    }
+
+    generation = newGeneration;
+    journalStream = std::make_unique<juce::FileOutputStream>(getJournalFile());
+    if (journalStream->failedToOpen())
+    {
+        reportFailure("Failed to open user preset journal: " + journalStream->getStatus().getErrorMessage());
+        journalStream.reset();
+        return false;
+    }
+    return true;
+}
+
+void UserPresetJournal::reportFailure(const juce::String& message)
+{
+    writeFailed = true;
+    CS_DBG(message);
+}
+
+//==============================================================================
+// Serialisation
+
+std::unique_ptr<juce::XmlElement> UserPresetJournal::presetToXml(const Preset& preset)
+{
+    auto presetElement = std::make_unique<juce::XmlElement>("Preset");
+    presetElement->setAttribute("name", preset.name);
+    presetElement->setAttribute("algorithm", preset.algorithm);
+    presetElement->setAttribute("feedback", preset.feedback);
+
+    // LFO settings
+    auto lfoElement = presetElement->createNewChildElement("LFO");
+    lfoElement->setAttribute("rate", preset.lfo.rate);
+    lfoElement->setAttribute("amd", preset.lfo.amd);
+    lfoElement->setAttribute("pmd", preset.lfo.pmd);
+    lfoElement->setAttribute("waveform", preset.lfo.waveform);
+    lfoElement->setAttribute("noiseFreq", preset.lfo.noiseFreq);
+
+    // Operators
+    for (int op = 0; op < 4; ++op) {
+        auto opElement = presetElement->createNewChildElement("Operator");
+        opElement->setAttribute("index", op);
+        opElement->setAttribute("totalLevel", preset.operators[op].totalLevel);
+        opElement->setAttribute("multiple", preset.operators[op].multiple);
+        opElement->setAttribute("detune1", preset.operators[op].detune1);
+        opElement->setAttribute("detune2", preset.operators[op].detune2);
+        opElement->setAttribute("keyScale", preset.operators[op].keyScale);
+        opElement->setAttribute("attackRate", preset.operators[op].attackRate);
+        opElement->setAttribute("decay1Rate", preset.operators[op].decay1Rate);
+        opElement->setAttribute("decay2Rate", preset.operators[op].decay2Rate);
+        opElement->setAttribute("releaseRate", preset.operators[op].releaseRate);
+        opElement->setAttribute("sustainLevel", preset.operators[op].sustainLevel);
+        opElement->setAttribute("amsEnable", preset.operators[op].amsEnable);
+        opElement->setAttribute("slotEnable", preset.operators[op].slotEnable);
+    }
+
+    // Channel settings (first channel as template)
+    auto channelElement = presetElement->createNewChildElement("Channel");
+    channelElement->setAttribute("ams", preset.channels[0].ams);
+    channelElement->setAttribute("pms", preset.channels[0].pms);
+    channelElement->setAttribute("noiseEnable", preset.channels[0].noiseEnable);
+
+    return presetElement;
+}
+
+Preset UserPresetJournal::presetFromXml(const juce::XmlElement& presetElement)
+{
+    Preset preset;
+    preset.name = presetElement.getStringAttribute("name", "User Preset");
+    preset.algorithm = presetElement.getIntAttribute("algorithm", 0);
+    preset.feedback = presetElement.getIntAttribute("feedback", 0);
+
+    // Load LFO settings
+    if (auto* lfoElement = presetElement.getChildByName("LFO")) {
+        preset.lfo.rate = lfoElement->getIntAttribute("rate", 0);
+        preset.lfo.amd = lfoElement->getIntAttribute("amd", 0);
+        preset.lfo.pmd = lfoElement->getIntAttribute("pmd", 0);
+        preset.lfo.waveform = lfoElement->getIntAttribute("waveform", 0);
+        preset.lfo.noiseFreq = lfoElement->getIntAttribute("noiseFreq", 0);
+    }
+
+    // Load operators
+    for (auto* opElement : presetElement.getChildWithTagNameIterator("Operator")) {
+        int opIndex = opElement->getIntAttribute("index", 0);
+        if (opIndex >= 0 && opIndex < 4) {
+            preset.operators[opIndex].totalLevel = opElement->getDoubleAttribute("totalLevel", 0.0);
+            preset.operators[opIndex].multiple = opElement->getDoubleAttribute("multiple", 1.0);
+            preset.operators[opIndex].detune1 = opElement->getDoubleAttribute("detune1", 3.0);
+            preset.operators[opIndex].detune2 = opElement->getDoubleAttribute("detune2", 0.0);
+            preset.operators[opIndex].keyScale = opElement->getDoubleAttribute("keyScale", 0.0);
+            preset.operators[opIndex].attackRate = opElement->getDoubleAttribute("attackRate", 31.0);
+            preset.operators[opIndex].decay1Rate = opElement->getDoubleAttribute("decay1Rate", 0.0);
+            preset.operators[opIndex].decay2Rate = opElement->getDoubleAttribute("decay2Rate", 0.0);
+            preset.operators[opIndex].releaseRate = opElement->getDoubleAttribute("releaseRate", 7.0);
+            preset.operators[opIndex].sustainLevel = opElement->getDoubleAttribute("sustainLevel", 0.0);
+            preset.operators[opIndex].amsEnable = opElement->getBoolAttribute("amsEnable", false);
+            preset.operators[opIndex].slotEnable = opElement->getBoolAttribute("slotEnable", true);
+        }
+    }
+
+    // Load channel settings
+    if (auto* channelElement = presetElement.getChildByName("Channel")) {
+        for (int ch = 0; ch < 8; ++ch) {
+            preset.channels[ch].ams = channelElement->getIntAttribute("ams", 0);
+            preset.channels[ch].pms = channelElement->getIntAttribute("pms", 0);
+            preset.channels[ch].noiseEnable = channelElement->getIntAttribute("noiseEnable", 0);
+        }
+    }
+
+    return preset;
+}
+
+uint32_t UserPresetJournal::crc32(const void* data, size_t size) noexcept
+{
+    static const auto table = []
+    {
+        std::array<uint32_t, 256> t {};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xffffffffu;
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+} // namespace ymulatorsynth
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "PresetManager.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace ymulatorsynth {
+
+/**
+ * UserPresetJournal - Crash-safe, append-only storage for the User bank
+ *
+ * The User bank is persisted as a snapshot (user-presets.xml, the format
+ * earlier versions wrote) plus a journal of the mutations made since that
+ * snapshot. Saving a preset appends one small record instead of rewriting
+ * the whole bank, and all file I/O runs on a dedicated writer thread in the
+ * order the mutations were made.
+ *
+ * Journal layout (little-endian):
+ *   header:  "YMJ1", uint32 generation
+ *   record:  uint32 payloadSize, uint32 crc32(payload), payload
+ *   payload: uint8 operation, int32 position, operation data
+ *
+ * Positions are indices into the User bank at the time of the mutation, so
+ * replaying the records in order reproduces the bank. A torn or corrupt
+ * tail record (e.g. after a crash mid-write) ends the replay and is cut off
+ * before the next append.
+ *
+ * Compaction writes a new snapshot through a temporary file and then starts
+ * an empty journal. Snapshot and journal carry a generation number, so a
+ * crash between the two steps leaves a stale journal that load() ignores
+ * rather than replaying twice.
+ */
+class UserPresetJournal
+{
+public:
+    enum class Operation : uint8_t
+    {
+        Add = 1,     // data: preset as XML
+        Rename = 2,  // data: new name (UTF-8)
+        Delete = 3   // no data
+    };
+
+    /** Journal records after which the owner should compact */
+    static constexpr int CompactionThreshold = 256;
+
+    explicit UserPresetJournal(const juce::File& directory);
+
+    /** Waits for pending writes */
+    ~UserPresetJournal();
+
+    /**
+     * Reads the snapshot and replays the journal
+     * @return User presets in bank order
+     */
+    std::vector<Preset> load();
+
+    // Mutations - serialise the record on the calling thread, write in the background
+    void appendAdd(int position, const Preset& preset);
+    void appendRename(int position, const juce::String& newName);
+    void appendDelete(int position);
+
+    /**
+     * Replaces snapshot and journal with the given bank contents (in the background)
+     * @param userPresets Complete User bank, in bank order
+     */
+    void compact(std::vector<Preset> userPresets);
+
+    /**
+     * Replaces snapshot and journal with the User bank of a published library.
+     * The presets are read on the writer thread; the snapshot keeps them alive.
+     */
+    void compact(std::shared_ptr<const PresetLibrarySnapshot> library, int userBankIndex);
+
+    /** True once enough records have accumulated that compaction is worthwhile */
+    bool needsCompaction() const { return numRecords.load() >= CompactionThreshold; }
+    int getNumRecords() const { return numRecords.load(); }
+
+    /** False once a background write has failed */
+    bool isHealthy() const { return !writeFailed.load(); }
+
+    /**
+     * Blocks until every queued write has reached the disk
+     * @return true if the queue drained within the timeout
+     */
+    bool waitUntilWritten(int timeoutMs);
+
+    juce::File getSnapshotFile() const { return directory.getChildFile("user-presets.xml"); }
+    juce::File getJournalFile() const { return directory.getChildFile("user-presets.journal"); }
+
+    // Preset <-> XML, shared by the snapshot and Add records
+    static std::unique_ptr<juce::XmlElement> presetToXml(const Preset& preset);
+    static Preset presetFromXml(const juce::XmlElement& element);
+
+    /** CRC-32 (IEEE) used to validate records */
+    static uint32_t crc32(const void* data, size_t size) noexcept;
+
+private:
+    struct ScanResult
+    {
+        bool headerValid = false;
+        uint32_t generation = 0;
+        int64_t validBytes = 0;
+        int numRecords = 0;
+    };
+
+    ScanResult scanJournal(uint32_t expectedGeneration, std::vector<Preset>* replayInto) const;
+    uint32_t readSnapshotGeneration() const;
+    void appendRecord(Operation operation, int position, const juce::MemoryBlock& data);
+    void writeRecordOnWriter(const juce::MemoryBlock& record);
+    void compactOnWriter(const std::vector<Preset>& userPresets);
+    bool openJournalOnWriter();
+    bool startNewJournalOnWriter(uint32_t newGeneration);
+    void reportFailure(const juce::String& message);
+
+    const juce::File directory;
+
+    // Only touched by the writer thread once load() has returned
+    std::unique_ptr<juce::FileOutputStream> journalStream;
+    uint32_t generation = 0;
+    bool generationKnown = false;
+
+    std::atomic<int> numRecords { 0 };
+    std::atomic<bool> writeFailed { false };
+
+    // Single thread, so jobs run in the order the mutations were made
+    juce::ThreadPool writer { 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UserPresetJournal)
+};
+
+} // namespace ymulatorsynth
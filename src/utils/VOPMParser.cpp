@@ -1,5 +1,6 @@
 #include "VOPMParser.h"
 #include "Debug.h"
+#include "OPMWriter.h"
 
 namespace ymulatorsynth {
 
@@ -230,49 +231,13 @@ ValidationResult VOPMParser::validate(const VOPMVoice& voice)
 
 juce::String VOPMParser::voiceToString(const VOPMVoice& voice)
 {
-    juce::String result;
-    
-    // Voice header
-    result << "@:" << voice.number << " " << voice.name << "\n";
-    
-    // LFO line
-    result << "LFO: " 
-           << voice.lfo.frequency << " "
-           << voice.lfo.amd << " "
-           << voice.lfo.pmd << " "
-           << voice.lfo.waveform << " "
-           << voice.lfo.noiseFreq << "\n";
-    
-    // Channel line
-    result << "CH: "
-           << convertInternalPanToOpm(voice.channel.pan) << " "
-           << voice.channel.feedback << " "
-           << voice.channel.algorithm << " "
-           << voice.channel.ams << " "
-           << voice.channel.pms << " "
-           << convertInternalSlotToOpm(voice.channel.slotMask) << " "
-           << voice.channel.noiseEnable << "\n";
-    
-    // Operator lines
-    juce::StringArray opLabels = {"M1", "C1", "M2", "C2"};
-    for (int i = 0; i < 4; ++i)
+    // Same formatting as bank export, so there is a single definition of the format
+    juce::MemoryOutputStream stream;
     {
-        const auto& op = voice.operators[i];
-        result << opLabels[i] << ": "
-               << op.attackRate << " "
-               << op.decay1Rate << " "
-               << op.decay2Rate << " "
-               << op.releaseRate << " "
-               << op.decay1Level << " "
-               << op.totalLevel << " "
-               << op.keyScale << " "
-               << op.multiple << " "
-               << op.detune1 << " "
-               << op.detune2 << " "
-               << convertInternalAmeToOpm(op.amsEnable) << "\n";
+        OPMWriter writer(stream);
+        writer.writeVoiceBody(voice);
     }
-    
-    return result;
+    return stream.toUTF8();
 }
 
 // OPM format conversion functions
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "utils/VOPMParser.h"
+#include <juce_core/juce_core.h>
+
+namespace YMulatorSynth {
+namespace Test {
+
+/**
+ * A voice with every field set to a distinct, valid value, so that writers
+ * and dumps can be checked field by field. The algorithm, total levels and
+ * multiples follow the voice number.
+ */
+inline ymulatorsynth::VOPMVoice createTestVoice(int number, const juce::String& name, int pan = 3) {
+    ymulatorsynth::VOPMVoice voice;
+    voice.number = number;
+    voice.name = name;
+    voice.lfo = { 200, 64, 32, 2, 17 };
+    voice.channel.pan = pan;
+    voice.channel.feedback = 5;
+    voice.channel.algorithm = number % 8;
+    voice.channel.ams = 1;
+    voice.channel.pms = 6;
+    voice.channel.slotMask = 15;
+    voice.channel.noiseEnable = 1;
+    for (int i = 0; i < 4; ++i) {
+        auto& op = voice.operators[i];
+        op.attackRate = 31 - i;
+        op.decay1Rate = 10 + i;
+        op.decay2Rate = i;
+        op.releaseRate = 7 + i;
+        op.decay1Level = 3;
+        op.totalLevel = (number + i * 20) % 128;
+        op.keyScale = i % 4;
+        op.multiple = (number + i) % 16;
+        op.detune1 = i;
+        op.detune2 = 3 - i;
+        op.amsEnable = i % 2;
+    }
+    return voice;
+}
+
+} // namespace Test
+} // namespace YMulatorSynth
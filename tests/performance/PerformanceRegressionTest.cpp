@@ -356,6 +356,40 @@ TEST_F(PerformanceRegressionTest, PresetSwitchingLatency) {
     host->sendMidiNoteOff(*processor, 1, 60);
 }
 
+TEST_F(PerformanceRegressionTest, RegisterImageSwitchLatency) {
+    // Applying a precompiled register image is the audio-thread part of a
+    // preset switch and must stay well below a millisecond
+    YmfmWrapper wrapper;
+    wrapper.initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
+    ymulatorsynth::ParameterManager manager(wrapper, *processor, nullptr);
+    
+    std::vector<ymulatorsynth::RegisterImage> images;
+    for (const auto& preset : ymulatorsynth::PresetManager::createFactoryPresets()) {
+        images.push_back(preset.toRegisterImage());
+    }
+    ASSERT_FALSE(images.empty());
+    
+    const int numSwitches = 1000;
+    double maxSwitchTime = 0.0;
+    auto totalStart = std::chrono::high_resolution_clock::now();
+    
+    for (int i = 0; i < numSwitches; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        manager.applyRegisterImage(images[static_cast<size_t>(i) % images.size()]);
+        auto end = std::chrono::high_resolution_clock::now();
+        maxSwitchTime = std::max(maxSwitchTime, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    
+    auto totalEnd = std::chrono::high_resolution_clock::now();
+    double avgSwitchTime = std::chrono::duration<double, std::milli>(totalEnd - totalStart).count() / numSwitches;
+    
+    EXPECT_LT(avgSwitchTime, 0.5) << "Average register image switch too slow";
+    EXPECT_LT(maxSwitchTime, 5.0) << "Peak register image switch too slow";
+    
+    CS_DBG("Register Image Switch Performance:");
+    CS_DBG("  Switch time: " + juce::String(avgSwitchTime) + "ms (avg), " + juce::String(maxSwitchTime) + "ms (peak)");
+}
+
 // =============================================================================
 // 4. Extended Operation Performance Tests
 // =============================================================================
@@ -466,5 +500,60 @@ TEST_F(PerformanceRegressionTest, MemoryUsageStability) {
     CS_DBG("Memory Usage Test: Completed " + juce::String(cycles) + " cycles without issues");
 }
 
+// =============================================================================
+// 6. Instantiation Performance
+// =============================================================================
+
+TEST_F(PerformanceRegressionTest, ProcessorInstantiationColdAndWarm) {
+    // Construct the way a host does: as a plugin, on the message thread, so
+    // only the factory presets are loaded before the constructor returns
+    const bool ownsMessageManager = juce::MessageManager::getInstanceWithoutCreating() == nullptr;
+    juce::MessageManager::getInstance();
+    juce::AudioProcessor::setTypeOfNextNewPlugin(juce::AudioProcessor::wrapperType_Standalone);
+    
+    struct Instantiation {
+        double constructionMs = 0.0;  // until the Init voice is playable
+        double libraryMs = 0.0;       // until the full preset library is published
+    };
+    
+    auto instantiate = []() {
+        Instantiation timing;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto instance = std::make_unique<YMulatorSynthAudioProcessor>();
+        auto constructed = std::chrono::high_resolution_clock::now();
+        
+        EXPECT_EQ(instance->getCurrentProgram(), 7);
+        EXPECT_TRUE(instance->getPresetManager().finishInitialization(10000));
+        auto loaded = std::chrono::high_resolution_clock::now();
+        
+        timing.constructionMs = std::chrono::duration<double, std::milli>(constructed - start).count();
+        timing.libraryMs = std::chrono::duration<double, std::milli>(loaded - start).count();
+        return timing;
+    };
+    
+    // The first instance pays for cold file system caches; the rest find them warm
+    const auto cold = instantiate();
+    const int numWarm = 5;
+    Instantiation warm;
+    for (int i = 0; i < numWarm; ++i) {
+        const auto timing = instantiate();
+        warm.constructionMs += timing.constructionMs / numWarm;
+        warm.libraryMs += timing.libraryMs / numWarm;
+    }
+    
+    juce::AudioProcessor::setTypeOfNextNewPlugin(juce::AudioProcessor::wrapperType_Undefined);
+    if (ownsMessageManager) {
+        juce::MessageManager::deleteInstance();
+    }
+    
+    // Relaxed thresholds for CI/CD environments with varying performance
+    EXPECT_LT(cold.constructionMs, 250.0) << "Cold instantiation too slow";
+    EXPECT_LT(warm.constructionMs, 100.0) << "Warm instantiation too slow";
+    
+    CS_DBG("Instantiation Performance:");
+    CS_DBG("  Cold: " + juce::String(cold.constructionMs) + "ms to construct, " + juce::String(cold.libraryMs) + "ms to full library");
+    CS_DBG("  Warm: " + juce::String(warm.constructionMs) + "ms to construct, " + juce::String(warm.libraryMs) + "ms to full library (avg)");
+}
+
 } // namespace Performance  
 } // namespace YMulatorSynth
\ No newline at end of file
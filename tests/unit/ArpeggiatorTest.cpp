@@ -0,0 +1,349 @@
+#include <gtest/gtest.h>
+#include "PluginProcessor.h"
+#include "core/Arpeggiator.h"
+#include "core/MidiProcessor.h"
+#include "core/VoiceManager.h"
+#include "dsp/YmfmWrapper.h"
+#include <set>
+#include <vector>
+
+using namespace ymulatorsynth;
+
+namespace {
+
+/** A transport at a fixed tempo whose position the test moves block by block */
+class TestPlayHead : public juce::AudioPlayHead {
+public:
+    juce::Optional<PositionInfo> getPosition() const override {
+        PositionInfo info;
+        info.setBpm(bpm);
+        info.setIsPlaying(isPlaying);
+        info.setPpqPosition(ppq);
+        return info;
+    }
+
+    double bpm = 120.0;
+    double ppq = 0.0;
+    bool isPlaying = true;
+};
+
+} // namespace
+
+class ArpeggiatorTest : public ::testing::Test {
+protected:
+    static constexpr double SampleRate = 48000.0;
+    static constexpr int BlockSize = 512;
+    static constexpr int SixteenthAt120 = 6000;   // samples per step at 48 kHz
+
+    struct PlayedNote {
+        int64_t sample;
+        uint8_t note;
+        bool isNoteOn;
+    };
+
+    void SetUp() override {
+        arp.prepare(SampleRate);
+        arp.setEnabled(true);
+    }
+
+    /**
+     * Runs blocks until the given sample, feeding notes at their absolute
+     * positions and advancing the play head (if any) with the samples
+     */
+    void run(int64_t untilSample, TestPlayHead* playHead = nullptr) {
+        while (position < untilSample) {
+            arp.prepareBlock(playHead, BlockSize);
+            for (auto it = pendingInput.begin(); it != pendingInput.end();) {
+                if (it->sample < position + BlockSize) {
+                    const int offset = static_cast<int>(it->sample - position);
+                    if (it->isNoteOn) {
+                        arp.noteOn(0, it->note, 100, offset);
+                    } else {
+                        arp.noteOff(0, it->note, offset);
+                    }
+                    it = pendingInput.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            arp.renderSteps();
+
+            for (int i = 0; i < arp.getNumEvents(); ++i) {
+                const auto& event = arp.getEvent(i);
+                played.push_back({ position + event.sampleOffset, event.note, event.isNoteOn });
+            }
+            position += BlockSize;
+            if (playHead != nullptr) {
+                playHead->ppq += BlockSize * playHead->bpm / (60.0 * SampleRate);
+            }
+        }
+    }
+
+    void press(int64_t sample, uint8_t note) { pendingInput.push_back({ sample, note, true }); }
+    void release(int64_t sample, uint8_t note) { pendingInput.push_back({ sample, note, false }); }
+
+    std::vector<PlayedNote> noteOns() const {
+        std::vector<PlayedNote> ons;
+        for (const auto& note : played) {
+            if (note.isNoteOn) {
+                ons.push_back(note);
+            }
+        }
+        return ons;
+    }
+
+    Arpeggiator arp;
+    int64_t position = 0;
+    std::vector<PlayedNote> pendingInput;
+    std::vector<PlayedNote> played;
+};
+
+// =============================================================================
+// 1. Timing
+// =============================================================================
+
+TEST_F(ArpeggiatorTest, StepsFollowTheHostGrid) {
+    TestPlayHead playHead;
+    press(0, 60);
+    press(0, 64);
+    press(0, 67);
+    run(4 * SixteenthAt120 + 1, &playHead);
+
+    const auto ons = noteOns();
+    ASSERT_EQ(ons.size(), 5u);
+    const uint8_t expected[] = { 60, 64, 67, 60, 64 };
+    for (size_t i = 0; i < ons.size(); ++i) {
+        EXPECT_EQ(ons[i].sample, static_cast<int64_t>(i) * SixteenthAt120) << "step " << i;
+        EXPECT_EQ(ons[i].note, expected[i]) << "step " << i;
+    }
+}
+
+TEST_F(ArpeggiatorTest, SyncedNotesWaitForTheNextStep) {
+    TestPlayHead playHead;
+    playHead.ppq = 0.1;   // 0.4 of a sixteenth in
+    press(100, 60);
+    run(SixteenthAt120 + 1, &playHead);
+
+    const auto ons = noteOns();
+    ASSERT_FALSE(ons.empty());
+    EXPECT_EQ(ons[0].sample, 3600);
+}
+
+TEST_F(ArpeggiatorTest, FreeRunningStartsOnTheFirstNote) {
+    press(700, 62);
+    run(2 * SixteenthAt120);
+
+    // Default 120 BPM and half-step gate, sample-accurate inside the block
+    ASSERT_GE(played.size(), 3u);
+    EXPECT_EQ(played[0].sample, 700);
+    EXPECT_TRUE(played[0].isNoteOn);
+    EXPECT_EQ(played[1].sample, 700 + SixteenthAt120 / 2);
+    EXPECT_FALSE(played[1].isNoteOn);
+    EXPECT_EQ(played[2].sample, 700 + SixteenthAt120);
+}
+
+TEST_F(ArpeggiatorTest, ReleasedNotesLeaveThePattern) {
+    press(0, 60);
+    press(0, 67);
+    release(SixteenthAt120 + 10, 67);
+    release(3 * SixteenthAt120 + 10, 60);
+    run(6 * SixteenthAt120);
+
+    const auto ons = noteOns();
+    ASSERT_EQ(ons.size(), 4u);
+    EXPECT_EQ(ons[0].note, 60);
+    EXPECT_EQ(ons[1].note, 67);
+    EXPECT_EQ(ons[2].note, 60);
+    EXPECT_EQ(ons[3].note, 60);
+
+    // Every note-on is closed
+    EXPECT_EQ(played.size(), 2 * ons.size());
+    EXPECT_FALSE(played.back().isNoteOn);
+}
+
+TEST_F(ArpeggiatorTest, SamePitchOnTwoChannelsIsReleasedOnBoth) {
+    // Layered parts or MPE: one pitch held on two MIDI channels
+    arp.prepareBlock(nullptr, BlockSize);
+    EXPECT_TRUE(arp.noteOn(0, 60, 100, 0));
+    EXPECT_TRUE(arp.noteOn(1, 60, 100, 0));
+    arp.renderSteps();
+
+    arp.prepareBlock(nullptr, BlockSize);
+    EXPECT_TRUE(arp.noteOff(0, 60, 0));
+    EXPECT_TRUE(arp.noteOff(1, 60, 0));
+    EXPECT_FALSE(arp.noteOff(1, 60, 0));   // already released
+    arp.renderSteps();
+
+    // Nothing is left to arpeggiate
+    for (int block = 0; block < 64; ++block) {
+        arp.prepareBlock(nullptr, BlockSize);
+        arp.renderSteps();
+        for (int i = 0; i < arp.getNumEvents(); ++i) {
+            EXPECT_FALSE(arp.getEvent(i).isNoteOn) << "block " << block;
+        }
+    }
+}
+
+// =============================================================================
+// 2. Patterns
+// =============================================================================
+
+TEST_F(ArpeggiatorTest, UpDownSpansOctavesWithoutRepeatingTheEnds) {
+    arp.setMode(Arpeggiator::Mode::UpDown);
+    arp.setOctaves(2);
+    press(0, 64);
+    press(0, 60);
+    run(7 * SixteenthAt120 - 1);
+
+    const auto ons = noteOns();
+    const uint8_t expected[] = { 60, 64, 72, 76, 72, 64, 60 };
+    ASSERT_EQ(ons.size(), 7u);
+    for (size_t i = 0; i < ons.size(); ++i) {
+        EXPECT_EQ(ons[i].note, expected[i]) << "step " << i;
+    }
+}
+
+TEST_F(ArpeggiatorTest, AsPlayedKeepsThePressOrder) {
+    arp.setMode(Arpeggiator::Mode::AsPlayed);
+    press(0, 67);
+    press(0, 60);
+    press(0, 64);
+    run(3 * SixteenthAt120 - 1);
+
+    const auto ons = noteOns();
+    ASSERT_EQ(ons.size(), 3u);
+    EXPECT_EQ(ons[0].note, 67);
+    EXPECT_EQ(ons[1].note, 60);
+    EXPECT_EQ(ons[2].note, 64);
+}
+
+// =============================================================================
+// 3. Real-Time Limits
+// =============================================================================
+
+TEST_F(ArpeggiatorTest, AnyTempoStaysInsideTheEventPool) {
+    TestPlayHead playHead;
+    playHead.bpm = 100000.0;   // far beyond the shortest step
+    arp.setRate(Arpeggiator::Rate::ThirtySecond);
+    arp.setGate(0.3f);
+
+    const int hugeBlock = 65536;
+    for (int block = 0; block < 4; ++block) {
+        arp.prepareBlock(&playHead, hugeBlock);
+        if (block == 0) {
+            for (uint8_t note = 48; note < 80; ++note) {
+                arp.noteOn(0, note, 100, 0);
+            }
+        }
+        arp.renderSteps();
+        playHead.ppq += hugeBlock * playHead.bpm / (60.0 * SampleRate);
+
+        // In order, inside the block, and never two notes sounding at once
+        ASSERT_LE(arp.getNumEvents(), Arpeggiator::EventPoolSize);
+        int lastOffset = 0;
+        bool lastWasNoteOn = false;
+        for (int i = 0; i < arp.getNumEvents(); ++i) {
+            const auto& event = arp.getEvent(i);
+            EXPECT_GE(event.sampleOffset, lastOffset);
+            EXPECT_LT(event.sampleOffset, hugeBlock);
+            EXPECT_FALSE(event.isNoteOn && lastWasNoteOn);
+            lastOffset = event.sampleOffset;
+            lastWasNoteOn = event.isNoteOn;
+        }
+    }
+    EXPECT_GT(arp.getNumDroppedSteps(), 0);
+}
+
+TEST_F(ArpeggiatorTest, FloodedBlockReleasesEveryNote) {
+    // Every note on every channel held, a few blocks at a time
+    for (int channel = 0; channel < 16; ++channel) {
+        arp.prepareBlock(nullptr, BlockSize);
+        for (int note = 0; note < 128; ++note) {
+            ASSERT_TRUE(arp.noteOn(channel, static_cast<uint8_t>(note), 100, 0)) << channel << "/" << note;
+        }
+        arp.renderSteps();
+    }
+
+    // One block releases all of them and presses and releases a full set of note-ons on top
+    arp.prepareBlock(nullptr, BlockSize);
+    for (int channel = 0; channel < 16; ++channel) {
+        for (int note = 0; note < 128; ++note) {
+            EXPECT_TRUE(arp.noteOff(channel, static_cast<uint8_t>(note), 1)) << channel << "/" << note;
+        }
+    }
+    for (int i = 0; i < Arpeggiator::MaxQueuedNoteOns; ++i) {
+        const auto note = static_cast<uint8_t>(i);
+        ASSERT_TRUE(arp.noteOn(0, note, 100, 2));
+        EXPECT_TRUE(arp.noteOff(0, note, 3));
+    }
+    EXPECT_FALSE(arp.noteOn(1, 60, 100, 4));   // past the per-block cap: played directly
+    arp.renderSteps();
+
+    // Nothing is left held, so nothing plays again
+    for (int block = 0; block < 64; ++block) {
+        arp.prepareBlock(nullptr, BlockSize);
+        arp.renderSteps();
+        for (int i = 0; i < arp.getNumEvents(); ++i) {
+            EXPECT_FALSE(arp.getEvent(i).isNoteOn) << "block " << block;
+        }
+    }
+}
+
+// =============================================================================
+// 4. Voice Allocation
+// =============================================================================
+
+TEST_F(ArpeggiatorTest, StepsReuseOneChannel) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    YmfmWrapper chip;
+    chip.initialize(YmfmWrapperInterface::ChipType::OPM, static_cast<uint32_t>(SampleRate));
+    VoiceManager voices;
+    MidiProcessor midi(voices, chip, processor->getParameters(), processor->getParameterManager());
+    midi.setArpeggiator(&arp);
+
+    // Held before the arpeggiator comes on: played and released directly
+    juce::MidiBuffer buffer;
+    arp.setEnabled(false);
+    arp.prepareBlock(nullptr, BlockSize);
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 48, static_cast<juce::uint8>(100)), 0);
+    midi.processMidiMessages(buffer);
+    const int directChannel = voices.getChannelForNote(48);
+    ASSERT_GE(directChannel, 0);
+
+    arp.setEnabled(true);
+    arp.setGate(1.0f);
+    arp.prepareBlock(nullptr, BlockSize);
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOff(1, 48), 0);
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 60, static_cast<juce::uint8>(100)), 10);
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 64, static_cast<juce::uint8>(100)), 10);
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 67, static_cast<juce::uint8>(100)), 10);
+    midi.processMidiMessages(buffer);
+    EXPECT_FALSE(voices.isVoiceActive(directChannel));
+    EXPECT_EQ(voices.getChannelForNote(60), -1);   // held by the arpeggiator, not played
+
+    // Legato steps: each note-off frees the channel the next note-on takes
+    std::set<int> channels;
+    int numSteps = 0;
+    for (int block = 0; block < 64; ++block) {
+        if (block > 0) {
+            arp.prepareBlock(nullptr, BlockSize);
+            buffer.clear();
+            midi.processMidiMessages(buffer);
+        }
+        arp.renderSteps();
+        for (int i = 0; i < arp.getNumEvents(); ++i) {
+            const auto& event = arp.getEvent(i);
+            if (event.isNoteOn) {
+                midi.processMidiNoteOn(juce::MidiMessage::noteOn(event.midiChannel + 1, event.note, event.velocity));
+                channels.insert(voices.getChannelForNote(event.note));
+                ++numSteps;
+            } else {
+                midi.processMidiNoteOff(juce::MidiMessage::noteOff(event.midiChannel + 1, event.note));
+            }
+        }
+    }
+
+    EXPECT_GE(numSteps, 5);
+    EXPECT_EQ(channels.size(), 1u);
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "utils/BankDirectoryWatcher.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class BankDirectoryWatcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("BankDirectoryWatcherTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+        banksDir = tempDir.getChildFile("banks");
+        banksDir.createDirectory();
+    }
+
+    void TearDown() override {
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    // Writes an OPM bank with the given voice names
+    static void writeBank(const juce::File& file, const juce::StringArray& names) {
+        juce::String content = "//MiOPMdrv sound bank Paramer Ver2002.04.22\n";
+        for (int i = 0; i < names.size(); ++i) {
+            content << "@:" << i << " " << names[i] << "\n"
+                    << "LFO:  0   0   0   0   0\n"
+                    << "CH: 64   " << (i % 8) << "   4   0   0  15   0\n"
+                    << "M1: 31   8   8  11   1  20   0   1   0   0   0\n"
+                    << "C1: 31   8   8  11   1   0   0   1   0   0   0\n"
+                    << "M2: 31   8   8  11   1  " << (20 + i) << "   0   1   0   0   0\n"
+                    << "C2: 31   8   8  11   1   0   0   1   0   0   0\n\n";
+        }
+        ASSERT_TRUE(file.replaceWithText(content));
+    }
+
+    static int findBank(const PresetManager& manager, const std::string& fileName) {
+        const auto banks = manager.getBanks();
+        for (int i = 0; i < static_cast<int>(banks->size()); ++i) {
+            if ((*banks)[i].fileName == fileName)
+                return i;
+        }
+        return -1;
+    }
+
+    juce::File tempDir;
+    juce::File banksDir;
+};
+
+// =============================================================================
+// 1. Change Detection
+// =============================================================================
+
+TEST_F(BankDirectoryWatcherTest, ScanReportsOnlyDifferences) {
+    writeBank(banksDir.getChildFile("a.opm"), { "A1", "A2" });
+    BankDirectoryWatcher watcher({ banksDir });
+
+    auto changes = watcher.scanForChanges();
+    ASSERT_EQ(changes.added.size(), 1u);
+    EXPECT_EQ(changes.added[0].voices.size(), 2u);
+    EXPECT_TRUE(watcher.scanForChanges().isEmpty());
+
+    writeBank(banksDir.getChildFile("b.opm"), { "B1" });
+    changes = watcher.scanForChanges();
+    ASSERT_EQ(changes.added.size(), 1u);
+    EXPECT_EQ(changes.added[0].file.getFileName(), "b.opm");
+    EXPECT_TRUE(changes.modified.empty());
+
+    writeBank(banksDir.getChildFile("a.opm"), { "A1", "A2", "A3" });
+    banksDir.getChildFile("b.opm").deleteFile();
+    banksDir.getChildFile("notes.txt").replaceWithText("ignored");
+    changes = watcher.scanForChanges();
+    EXPECT_TRUE(changes.added.empty());
+    ASSERT_EQ(changes.modified.size(), 1u);
+    EXPECT_EQ(changes.modified[0].voices.size(), 3u);
+    ASSERT_EQ(changes.removed.size(), 1u);
+    EXPECT_EQ(changes.removed[0].getFileName(), "b.opm");
+}
+
+TEST_F(BankDirectoryWatcherTest, BaselineFilesAreNotReported) {
+    auto loaded = banksDir.getChildFile("loaded.opm");
+    writeBank(loaded, { "L1" });
+    writeBank(banksDir.getChildFile("new.opm"), { "N1" });
+
+    BankDirectoryWatcher watcher({ banksDir, tempDir.getChildFile("missing") });
+    watcher.setBaseline({ loaded });
+
+    const auto changes = watcher.scanForChanges();
+    ASSERT_EQ(changes.added.size(), 1u);
+    EXPECT_EQ(changes.added[0].file.getFileName(), "new.opm");
+}
+
+TEST_F(BankDirectoryWatcherTest, BackgroundThreadDeliversChanges) {
+    BankDirectoryWatcher watcher({ banksDir });
+    juce::WaitableEvent delivered;
+    std::vector<juce::String> addedNames;
+
+    watcher.start([&](BankDirectoryWatcher::ChangeSet changes) {
+        for (const auto& bankFile : changes.added)
+            addedNames.push_back(bankFile.file.getFileName());
+        delivered.signal();
+    }, 20);
+
+    // Give the thread time to set up its watches before the file appears
+    juce::Thread::sleep(100);
+    writeBank(banksDir.getChildFile("dropped.opm"), { "D1" });
+
+    ASSERT_TRUE(delivered.wait(5000));
+    watcher.stop();
+    ASSERT_EQ(addedNames.size(), 1u);
+    EXPECT_EQ(addedNames[0], "dropped.opm");
+}
+
+// =============================================================================
+// 2. Incremental Reload in PresetManager
+// =============================================================================
+
+TEST_F(BankDirectoryWatcherTest, ManagerMergesOnlyChangedBanks) {
+    PresetManager manager;
+    manager.setUserDataDirectory(tempDir);
+    BankDirectoryWatcher watcher({ banksDir });
+
+    writeBank(banksDir.getChildFile("first.opm"), { "F1", "F2", "F3" });
+    writeBank(banksDir.getChildFile("second.opm"), { "S1", "S2" });
+    EXPECT_TRUE(manager.applyBankChanges(watcher.scanForChanges()));
+    EXPECT_EQ(manager.getNumPresets(), 5);
+
+    const int second = findBank(manager, "second.opm");
+    ASSERT_GE(second, 0);
+    EXPECT_EQ(manager.getPresetsForBank(second), juce::StringArray({ "S1", "S2" }));
+    const int s1 = manager.getGlobalPresetIndex(second, 0);
+    const int s2 = manager.getGlobalPresetIndex(second, 1);
+
+    // Shrinking the first bank keeps the second bank's presets intact
+    writeBank(banksDir.getChildFile("first.opm"), { "F1 new" });
+    EXPECT_TRUE(manager.applyBankChanges(watcher.scanForChanges()));
+    EXPECT_EQ(manager.getPresetsForBank(findBank(manager, "first.opm")), juce::StringArray({ "F1 new" }));
+    EXPECT_EQ(manager.getPresetsForBank(findBank(manager, "second.opm")), juce::StringArray({ "S1", "S2" }));
+    EXPECT_NE(manager.getPreset("S2"), nullptr);
+
+    // Removing a file drops its bank and presets
+    banksDir.getChildFile("first.opm").deleteFile();
+    EXPECT_TRUE(manager.applyBankChanges(watcher.scanForChanges()));
+    EXPECT_EQ(findBank(manager, "first.opm"), -1);
+    EXPECT_EQ(manager.getPreset("F1 new"), nullptr);
+
+    // Global indices held elsewhere (current preset, staged MIDI banks, parts) still point at the same presets
+    const int secondNow = findBank(manager, "second.opm");
+    EXPECT_EQ(manager.getGlobalPresetIndex(secondNow, 0), s1);
+    EXPECT_EQ(manager.getGlobalPresetIndex(secondNow, 1), s2);
+    ASSERT_NE(manager.getPreset(s2), nullptr);
+    EXPECT_EQ(manager.getPreset(s2)->name, "S2");
+
+    // Nothing changed, nothing to do
+    EXPECT_FALSE(manager.applyBankChanges(watcher.scanForChanges()));
+}
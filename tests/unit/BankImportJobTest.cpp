@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "utils/BankImportJob.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class BankImportJobTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("BankImportJobTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+        sourceDir = tempDir.getChildFile("source");
+        sourceDir.createDirectory();
+
+        manager = std::make_unique<PresetManager>();
+        manager->setUserDataDirectory(tempDir.getChildFile("user"));
+    }
+
+    void TearDown() override {
+        manager.reset();
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    // Writes an OPM bank with the given number of distinct voices
+    juce::File writeBank(const juce::String& fileName, int numVoices) {
+        juce::String content = "//MiOPMdrv sound bank Paramer Ver2002.04.22\n";
+        for (int i = 0; i < numVoices; ++i) {
+            content << "@:" << i << " Voice " << i << "\n"
+                    << "LFO:  0   0   0   0   0\n"
+                    << "CH: 64   " << (i % 8) << "   4   0   0  15   0\n"
+                    << "M1: 31   8   8  11   1  20   0   1   0   0   0\n"
+                    << "C1: 31   8   8  11   1   0   0   1   0   0   0\n"
+                    << "M2: 31   8   8  11   1  " << (i % 128) << "   0   1   0   0   0\n"
+                    << "C2: 31   8   8  11   1   0   0   " << (1 + i / 128) << "   0   0   0\n\n";
+        }
+        auto file = sourceDir.getChildFile(fileName);
+        file.replaceWithText(content);
+        return file;
+    }
+
+    // Runs the background stages to completion and publishes on this thread
+    void runToCompletion(const std::shared_ptr<BankImportJob>& job) {
+        ASSERT_TRUE(job->waitUntilReadyToPublish(10000));
+        manager->dispatchPendingUpdates();
+        ASSERT_TRUE(job->isFinished());
+    }
+
+    juce::File banksDir() const {
+        return tempDir.getChildFile("user").getChildFile("banks");
+    }
+
+    juce::File tempDir;
+    juce::File sourceDir;
+    std::unique_ptr<PresetManager> manager;
+};
+
+// =============================================================================
+// 1. Successful Import
+// =============================================================================
+
+TEST_F(BankImportJobTest, ImportPublishesBankOnMessageThread) {
+    const auto file = writeBank("async.opm", 200);
+    const int presetsBefore = manager->getNumPresets();
+    int completions = 0;
+
+    auto job = manager->importOPMFileAsync(file, [&](const BankImportJob& finished) {
+        EXPECT_TRUE(finished.isFinished());
+        ++completions;
+    });
+    ASSERT_TRUE(job->waitUntilReadyToPublish(10000));
+
+    // Nothing is visible until the job is published
+    EXPECT_EQ(manager->getNumPresets(), presetsBefore);
+    EXPECT_EQ(completions, 0);
+
+    manager->dispatchPendingUpdates();
+    EXPECT_EQ(completions, 1);
+    EXPECT_EQ(job->getStatus(), BankImportJob::Status::Succeeded);
+    EXPECT_EQ(job->getNumPresets(), 200);
+    EXPECT_FLOAT_EQ(job->getProgress(), 1.0f);
+
+    const auto banks = manager->getBanks();
+    ASSERT_GE(job->getBankIndex(), 0);
+    ASSERT_LT(job->getBankIndex(), static_cast<int>(banks->size()));
+    EXPECT_EQ((*banks)[static_cast<size_t>(job->getBankIndex())].fileName, "async.opm");
+    EXPECT_EQ(manager->getPresetsForBank(job->getBankIndex()).size(), 200);
+
+    // The copy is stored under its final name only once published
+    EXPECT_TRUE(banksDir().getChildFile("async.opm").existsAsFile());
+    EXPECT_FALSE(banksDir().getChildFile("async.opm.importing").exists());
+}
+
+// =============================================================================
+// 2. Cancellation and Failures
+// =============================================================================
+
+TEST_F(BankImportJobTest, CancelledJobPublishesNothing) {
+    const auto file = writeBank("cancelled.opm", 50);
+    const int presetsBefore = manager->getNumPresets();
+    const auto banksBefore = manager->getBanks()->size();
+
+    auto job = manager->importOPMFileAsync(file, nullptr);
+    ASSERT_TRUE(job->waitUntilReadyToPublish(10000));
+    job->cancel();
+    manager->dispatchPendingUpdates();
+
+    EXPECT_EQ(job->getStatus(), BankImportJob::Status::Cancelled);
+    EXPECT_EQ(manager->getNumPresets(), presetsBefore);
+    EXPECT_EQ(manager->getBanks()->size(), banksBefore);
+    EXPECT_FALSE(banksDir().getChildFile("cancelled.opm").exists());
+    EXPECT_FALSE(banksDir().getChildFile("cancelled.opm.importing").exists());
+}
+
+TEST_F(BankImportJobTest, MissingOrOversizedFilesFail) {
+    auto missing = manager->importOPMFileAsync(sourceDir.getChildFile("missing.opm"), nullptr);
+    runToCompletion(missing);
+    EXPECT_EQ(missing->getStatus(), BankImportJob::Status::Failed);
+    EXPECT_TRUE(missing->getErrorMessage().isNotEmpty());
+
+    auto huge = sourceDir.getChildFile("huge.opm");
+    {
+        juce::FileOutputStream out(huge);
+        ASSERT_TRUE(out.openedOk());
+        juce::HeapBlock<char> zeros(1024 * 1024, true);
+        for (int i = 0; i <= static_cast<int>(BankImportJob::MaxFileSize / (1024 * 1024)); ++i)
+            out.write(zeros.get(), 1024 * 1024);
+    }
+    auto oversized = manager->importOPMFileAsync(huge, nullptr);
+    runToCompletion(oversized);
+    EXPECT_EQ(oversized->getStatus(), BankImportJob::Status::Failed);
+
+    auto empty = sourceDir.getChildFile("empty.opm");
+    empty.replaceWithText("// no voices\n");
+    auto noVoices = manager->importOPMFileAsync(empty, nullptr);
+    runToCompletion(noVoices);
+    EXPECT_EQ(noVoices->getStatus(), BankImportJob::Status::Failed);
+}
+
+TEST_F(BankImportJobTest, AlreadyLoadedBankIsRejected) {
+    const auto file = writeBank("twice.opm", 3);
+
+    auto first = manager->importOPMFileAsync(file, nullptr);
+    runToCompletion(first);
+    ASSERT_EQ(first->getStatus(), BankImportJob::Status::Succeeded);
+    const int presetsAfterFirst = manager->getNumPresets();
+
+    auto second = manager->importOPMFileAsync(file, nullptr);
+    runToCompletion(second);
+    EXPECT_EQ(second->getStatus(), BankImportJob::Status::Failed);
+    EXPECT_EQ(manager->getNumPresets(), presetsAfterFirst);
+}
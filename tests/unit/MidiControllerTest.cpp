@@ -0,0 +1,395 @@
+#include <gtest/gtest.h>
+#include "../../src/PluginProcessor.h"
+#include "../../src/core/MidiProcessor.h"
+#include "../../src/core/VoiceManager.h"
+#include "../../src/dsp/YmfmWrapper.h"
+#include "../../src/dsp/YM2151Registers.h"
+#include "../../src/utils/ParameterIDs.h"
+
+using namespace ymulatorsynth;
+
+namespace {
+    // Counts the parameter changes the host hears about
+    struct HostNotificationCounter : juce::AudioProcessorListener {
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override { ++parameterChanges; }
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details) override {
+            if (details.nonParameterStateChanged) {
+                ++stateChanges;
+            }
+        }
+        int parameterChanges = 0;
+        int stateChanges = 0;
+    };
+}
+
+/**
+ * MIDI controller handling on a MidiProcessor of its own, driving a real chip
+ * with the processor's parameters. There is no message loop here, so the host
+ * sync only happens when a test dispatches it.
+ */
+class MidiControllerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        processor = std::make_unique<YMulatorSynthAudioProcessor>();
+        chip.initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
+        midi = std::make_unique<MidiProcessor>(voices, chip, processor->getParameters(), processor->getParameterManager());
+        processor->addListener(&counter);
+    }
+
+    void TearDown() override {
+        processor->removeListener(&counter);
+        midi.reset();
+        processor.reset();
+        ParameterManager::resetStaticState();
+    }
+
+    juce::RangedAudioParameter* parameter(const juce::String& id) {
+        return processor->getParameters().getParameter(id);
+    }
+
+    std::unique_ptr<YMulatorSynthAudioProcessor> processor;
+    YmfmWrapper chip;
+    VoiceManager voices;
+    std::unique_ptr<MidiProcessor> midi;
+    HostNotificationCounter counter;
+};
+
+// ============================================================================
+// CC Dispatch Tests
+// ============================================================================
+
+TEST_F(MidiControllerTest, CCWritesRegistersImmediately) {
+    auto* tl = parameter(ParamID::Op::tl(1));
+    auto* algorithm = parameter(ParamID::Global::Algorithm);
+
+    midi->handleMidiCC(ParamID::MIDI_CC::Op1_TL, 100);
+    midi->handleMidiCC(ParamID::MIDI_CC::Algorithm, 127);
+
+    EXPECT_FLOAT_EQ(tl->convertFrom0to1(tl->getValue()), 100.0f);
+    EXPECT_FLOAT_EQ(algorithm->convertFrom0to1(algorithm->getValue()), 7.0f);
+
+    // Same scaling as the periodic parameter update
+    const auto expectedTL = static_cast<uint8_t>(tl->getValue() * 127.0f);
+    for (uint8_t channel = 0; channel < 8; ++channel) {
+        EXPECT_EQ(chip.readCurrentRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, 0, channel)),
+                  expectedTL) << "channel " << static_cast<int>(channel);
+        EXPECT_EQ(chip.readCurrentRegister(YM2151Regs::REG_ALGORITHM_FEEDBACK_BASE + channel) & YM2151Regs::MASK_ALGORITHM, 7);
+    }
+}
+
+TEST_F(MidiControllerTest, ChannelPanCCsTakePrecedenceOverOperatorRange) {
+    // CC 32 also falls inside Op2's block of 11 CCs
+    auto* pan = parameter(ParamID::Channel::pan(0));
+    auto* op2Ks = parameter(ParamID::Op::ks(2));
+    const float ksBefore = op2Ks->getValue();
+
+    midi->handleMidiCC(ParamID::MIDI_CC::Ch0_Pan, 0);
+
+    EXPECT_FLOAT_EQ(pan->getValue(), 0.0f);
+    EXPECT_FLOAT_EQ(op2Ks->getValue(), ksBefore);
+}
+
+// ============================================================================
+// Deferred Host Sync Tests
+// ============================================================================
+
+TEST_F(MidiControllerTest, HostIsNotifiedOnlyWhenSyncIsDispatched) {
+    // A dense controller sweep on two CCs
+    for (int value = 0; value < 128; ++value) {
+        midi->handleMidiCC(ParamID::MIDI_CC::Op1_TL, value);
+        midi->handleMidiCC(ParamID::MIDI_CC::Feedback, 127 - value);
+    }
+    EXPECT_EQ(counter.parameterChanges, 0);
+
+    // One notification per parameter, with the last value
+    EXPECT_EQ(midi->dispatchPendingParameterSync(), 2);
+    EXPECT_EQ(counter.parameterChanges, 2);
+    EXPECT_FLOAT_EQ(parameter(ParamID::Op::tl(1))->convertFrom0to1(parameter(ParamID::Op::tl(1))->getValue()), 127.0f);
+
+    EXPECT_EQ(midi->dispatchPendingParameterSync(), 0);
+    EXPECT_EQ(counter.parameterChanges, 2);
+}
+
+TEST_F(MidiControllerTest, QueueOverflowResendsEveryBoundParameter) {
+    for (int i = 0; i < MidiProcessor::ParameterSyncQueueSize + 10; ++i) {
+        midi->handleMidiCC(ParamID::MIDI_CC::Op1_TL, i % 128);
+    }
+
+    const int numSynced = midi->dispatchPendingParameterSync();
+    EXPECT_GT(numSynced, 1);
+    EXPECT_EQ(counter.parameterChanges, numSynced);
+
+    // The queue is usable again afterwards
+    midi->handleMidiCC(ParamID::MIDI_CC::Feedback, 0);
+    EXPECT_EQ(midi->dispatchPendingParameterSync(), 1);
+}
+
+// ============================================================================
+// Controller Coalescing Tests
+// ============================================================================
+
+TEST_F(MidiControllerTest, DenseControllerBlockIsCoalesced) {
+    juce::MidiBuffer buffer;
+    for (int i = 0; i < 50; ++i) {
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::Op1_TL, 40 + i), i * 10);
+        buffer.addEvent(juce::MidiMessage::pitchWheel(1, 8192 + i * 100), i * 10 + 1);
+        buffer.addEvent(juce::MidiMessage::channelPressureChange(1, i), i * 10 + 2);
+    }
+
+    midi->processMidiMessages(buffer);
+
+    // Only the last of each 50 reaches the chip
+    EXPECT_EQ(midi->getNumCoalescedEvents(), 3 * 49);
+    auto* tl = parameter(ParamID::Op::tl(1));
+    EXPECT_FLOAT_EQ(tl->convertFrom0to1(tl->getValue()), 89.0f);
+    EXPECT_EQ(midi->dispatchPendingParameterSync(), 1);
+}
+
+TEST_F(MidiControllerTest, NotesSplitCoalescing) {
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::Feedback, 10), 0);
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 60, static_cast<juce::uint8>(100)), 1);
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::Feedback, 127), 2);
+    buffer.addEvent(juce::MidiMessage::controllerEvent(2, ParamID::MIDI_CC::Feedback, 127), 3);  // other MIDI channel
+
+    midi->processMidiMessages(buffer);
+
+    // Each change is on its own side of the note or on its own channel
+    EXPECT_EQ(midi->getNumCoalescedEvents(), 0);
+    auto* feedback = parameter(ParamID::Global::Feedback);
+    EXPECT_FLOAT_EQ(feedback->convertFrom0to1(feedback->getValue()), 7.0f);
+}
+
+// ============================================================================
+// NRPN and High-Resolution CC Tests
+// ============================================================================
+
+namespace {
+    void addNRPN(juce::MidiBuffer& buffer, int group, int parameter, int value, int& time) {
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::NrpnMsb, group), time++);
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::NrpnLsb, parameter), time++);
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::DataEntryMsb, value >> 7), time++);
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::DataEntryLsb, value & 0x7f), time++);
+    }
+}
+
+TEST_F(MidiControllerTest, NRPNReachesRegistersAtFullResolution) {
+    juce::MidiBuffer buffer;
+    int time = 0;
+    addNRPN(buffer, ParamID::NRPN::GlobalGroup, ParamID::NRPN::LfoRate, 200, time);
+    addNRPN(buffer, ParamID::NRPN::Op1Group, ParamID::NRPN::OpTL, 101, time);
+    midi->processMidiMessages(buffer);
+
+    // Both complete in one block; nothing is coalesced away
+    auto* lfoRate = parameter(ParamID::Global::LfoRate);
+    auto* tl = parameter(ParamID::Op::tl(1));
+    EXPECT_FLOAT_EQ(lfoRate->convertFrom0to1(lfoRate->getValue()), 200.0f);
+    EXPECT_FLOAT_EQ(tl->convertFrom0to1(tl->getValue()), 101.0f);
+    EXPECT_EQ(chip.readCurrentRegister(YM2151Regs::REG_LFO_RATE), 200);
+    EXPECT_EQ(chip.readCurrentRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, 0, 3)), 101);
+
+    // Increment steps the selected parameter by one unit
+    midi->handleMidiCC(0, ParamID::MIDI_CC::DataIncrement, 0);
+    EXPECT_FLOAT_EQ(tl->convertFrom0to1(tl->getValue()), 102.0f);
+    EXPECT_EQ(midi->dispatchPendingParameterSync(), 2);
+}
+
+TEST_F(MidiControllerTest, DataEntryLsbIsChannelPanWithoutSelection) {
+    auto* pan = parameter(ParamID::Channel::pan(6));
+    auto* tl = parameter(ParamID::Op::tl(1));
+
+    midi->handleMidiCC(0, ParamID::MIDI_CC::NrpnMsb, ParamID::NRPN::Op1Group);
+    midi->handleMidiCC(0, ParamID::MIDI_CC::NrpnLsb, ParamID::NRPN::OpTL);
+    midi->handleMidiCC(0, ParamID::MIDI_CC::DataEntryLsb, 50);
+    EXPECT_FLOAT_EQ(tl->convertFrom0to1(tl->getValue()), 50.0f);
+    EXPECT_FLOAT_EQ(pan->getValue(), 0.5f);
+
+    // The null parameter number gives CC 38 back to the pan
+    midi->handleMidiCC(0, ParamID::MIDI_CC::NrpnMsb, 127);
+    midi->handleMidiCC(0, ParamID::MIDI_CC::NrpnLsb, 127);
+    midi->handleMidiCC(0, ParamID::MIDI_CC::DataEntryLsb, 0);
+    EXPECT_FLOAT_EQ(pan->getValue(), 0.0f);
+    EXPECT_FLOAT_EQ(tl->convertFrom0to1(tl->getValue()), 50.0f);
+}
+
+TEST_F(MidiControllerTest, RPNZeroSetsPitchBendRange) {
+    auto* range = parameter(ParamID::Global::PitchBendRange);
+
+    midi->handleMidiCC(0, ParamID::MIDI_CC::RpnMsb, 0);
+    midi->handleMidiCC(0, ParamID::MIDI_CC::RpnLsb, ParamID::NRPN::RpnPitchBendSensitivity);
+    midi->handleMidiCC(0, ParamID::MIDI_CC::DataEntryMsb, 12);
+    EXPECT_FLOAT_EQ(range->convertFrom0to1(range->getValue()), 12.0f);
+
+    // Parser state is per MIDI channel
+    midi->handleMidiCC(1, ParamID::MIDI_CC::DataEntryMsb, 3);
+    EXPECT_FLOAT_EQ(range->convertFrom0to1(range->getValue()), 12.0f);
+}
+
+// ============================================================================
+// Program Change Tests
+// ============================================================================
+
+namespace {
+    void addBankAndProgram(juce::MidiBuffer& buffer, int bankMsb, int bankLsb, int program, int& time) {
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::BankSelectMsb, bankMsb), time++);
+        if (bankLsb >= 0) {
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::BankSelectLsb, bankLsb), time++);
+        }
+        buffer.addEvent(juce::MidiMessage::programChange(1, program), time++);
+    }
+}
+
+TEST_F(MidiControllerTest, ProgramChangeSelectsPresetFromStagedBank) {
+    // The processor's own MidiProcessor has the program selector; bank 0 is staged up front
+    auto* processorMidi = processor->getMidiProcessor();
+    const auto library = processor->getPresetManager().getSnapshot();
+    const int expected = library->getGlobalPresetIndex(0, 3);
+    ASSERT_GE(expected, 0);
+    ASSERT_NE(processor->getCurrentProgram(), expected);
+
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::programChange(1, 3), 0);
+    processorMidi->processMidiMessages(buffer);
+
+    // Applied within the block; without a message loop the parameters follow at once
+    EXPECT_EQ(processor->getCurrentProgram(), expected);
+    auto* algorithm = parameter(ParamID::Global::Algorithm);
+    EXPECT_FLOAT_EQ(algorithm->convertFrom0to1(algorithm->getValue()),
+                    static_cast<float>(library->getPreset(expected)->algorithm));
+    EXPECT_EQ(processor->getParameterManager().getPendingParameterSync(), -1);
+}
+
+TEST_F(MidiControllerTest, BankSelectLsbIsChannelPanOnlyOutsideBankSelect) {
+    auto* processorMidi = processor->getMidiProcessor();
+    auto* pan = parameter(ParamID::Channel::pan(0));
+    const float panBefore = pan->getValue();
+
+    // CC 0 then CC 32 is bank 0 / 0, not a pan change
+    juce::MidiBuffer buffer;
+    int time = 0;
+    addBankAndProgram(buffer, 0, 0, 1, time);
+    processorMidi->processMidiMessages(buffer);
+    EXPECT_FLOAT_EQ(pan->getValue(), panBefore);
+    EXPECT_EQ(processor->getCurrentProgram(), processor->getPresetManager().getGlobalPresetIndex(0, 1));
+
+    // On its own CC 32 is the pan again
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::Ch0_Pan, 0), 0);
+    processorMidi->processMidiMessages(buffer);
+    EXPECT_FLOAT_EQ(pan->getValue(), 0.0f);
+}
+
+TEST_F(MidiControllerTest, ProgramChangeWaitsForItsBankToBeStaged) {
+    auto* processorMidi = processor->getMidiProcessor();
+    const int before = processor->getCurrentProgram();
+
+    // Bank 128 (MSB 1) does not exist: once staged it is empty and the program is dropped
+    juce::MidiBuffer buffer;
+    int time = 0;
+    addBankAndProgram(buffer, 1, -1, 2, time);
+    processorMidi->processMidiMessages(buffer);
+    EXPECT_EQ(processor->getCurrentProgram(), before);
+
+    // Back to bank 0, which now has to be staged again before program 4 applies
+    const int expected = processor->getPresetManager().getGlobalPresetIndex(0, 4);
+    buffer.clear();
+    time = 0;
+    addBankAndProgram(buffer, 0, -1, 4, time);
+    juce::MidiBuffer empty;
+    for (int block = 0; block < 1000 && processor->getCurrentProgram() != expected; ++block) {
+        processorMidi->processMidiMessages(block == 0 ? buffer : empty);
+        juce::Thread::sleep(2);
+    }
+    EXPECT_EQ(processor->getCurrentProgram(), expected);
+}
+
+// ============================================================================
+// MIDI Learn Tests
+// ============================================================================
+
+TEST_F(MidiControllerTest, LearnCapturesTheNextController) {
+    auto* lfoRate = parameter(ParamID::Global::LfoRate);
+    auto* tl = parameter(ParamID::Op::tl(1));
+    const float tlBefore = tl->getValue();
+
+    ASSERT_TRUE(midi->armMidiLearn(ParamID::Op::tl(1)));
+    EXPECT_FALSE(midi->armMidiLearn("noSuchParameter"));
+    ASSERT_TRUE(midi->armMidiLearn(ParamID::Global::LfoRate));
+
+    // Data entry cannot be learned; the mod wheel is captured, not applied
+    midi->handleMidiCC(ParamID::MIDI_CC::DataEntryMsb, 10);
+    midi->handleMidiCC(1, 100);
+    EXPECT_FALSE(midi->isMidiLearnArmed());
+    ASSERT_TRUE(midi->applyLearnedController());
+    EXPECT_EQ(midi->getMappedParameter(1), ParamID::Global::LfoRate);
+
+    midi->handleMidiCC(1, 127);
+    EXPECT_FLOAT_EQ(lfoRate->getValue(), 1.0f);
+    EXPECT_EQ(chip.readCurrentRegister(YM2151Regs::REG_LFO_RATE), 255);
+
+    // Relearning the parameter on another CC frees the first one
+    ASSERT_TRUE(midi->armMidiLearn(ParamID::Global::LfoRate));
+    midi->handleMidiCC(ParamID::MIDI_CC::Op1_TL, 5);
+    ASSERT_TRUE(midi->applyLearnedController());
+    EXPECT_EQ(midi->getMappedParameter(ParamID::MIDI_CC::Op1_TL), ParamID::Global::LfoRate);
+    EXPECT_TRUE(midi->getMappedParameter(1).isEmpty());
+    EXPECT_FLOAT_EQ(tl->getValue(), tlBefore);
+
+    // Back to the VOPMex layout
+    midi->clearMidiMappings();
+    EXPECT_EQ(midi->getMappedParameter(ParamID::MIDI_CC::Op1_TL), juce::String(ParamID::Op::tl(1)));
+}
+
+TEST_F(MidiControllerTest, UnmappedAndRemappedControllers) {
+    // An empty mapping silences a VOPMex CC
+    auto* algorithm = parameter(ParamID::Global::Algorithm);
+    const float algorithmBefore = algorithm->getValue();
+    ASSERT_TRUE(midi->setMidiMapping(ParamID::MIDI_CC::Algorithm, ""));
+    midi->handleMidiCC(ParamID::MIDI_CC::Algorithm, algorithmBefore > 0.5f ? 0 : 127);
+    EXPECT_FLOAT_EQ(algorithm->getValue(), algorithmBefore);
+
+    // Maps swapped out while a block may still read them stay valid
+    for (int i = 0; i < 100; ++i) {
+        midi->setMidiMapping(2, i % 2 == 0 ? ParamID::Global::Algorithm : ParamID::Global::Feedback);
+        midi->handleMidiCC(2, 127);
+    }
+    EXPECT_EQ(midi->getMappedParameter(2), ParamID::Global::Feedback);
+    EXPECT_FALSE(midi->setMidiMapping(ParamID::MIDI_CC::NrpnMsb, ParamID::Global::Algorithm));
+}
+
+TEST_F(MidiControllerTest, LearnedMappingsAreSavedWithPluginState) {
+    auto* processorMidi = dynamic_cast<MidiProcessor*>(processor->getMidiProcessor());
+    ASSERT_NE(processorMidi, nullptr);
+    ASSERT_TRUE(processorMidi->setMidiMapping(1, ParamID::Global::LfoPmd));
+    ASSERT_TRUE(processorMidi->setMidiMapping(ParamID::MIDI_CC::Algorithm, ""));
+
+    juce::MemoryBlock state;
+    processor->getStateInformation(state);
+
+    processorMidi->clearMidiMappings();
+    EXPECT_TRUE(processorMidi->getMappedParameter(1).isEmpty());
+
+    processor->setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+    EXPECT_EQ(processorMidi->getMappedParameter(1), ParamID::Global::LfoPmd);
+    EXPECT_TRUE(processorMidi->getMappedParameter(ParamID::MIDI_CC::Algorithm).isEmpty());
+    EXPECT_EQ(processorMidi->getMidiMappings().size(), 2u);
+}
+
+TEST_F(MidiControllerTest, LearningMarksThePluginStateChanged) {
+    auto* processorMidi = dynamic_cast<MidiProcessor*>(processor->getMidiProcessor());
+    ASSERT_NE(processorMidi, nullptr);
+
+    ASSERT_TRUE(processorMidi->armMidiLearn(ParamID::Global::LfoRate));
+    processorMidi->handleMidiCC(1, 64);
+    ASSERT_TRUE(processorMidi->applyLearnedController());
+    EXPECT_EQ(counter.stateChanges, 1);
+
+    ASSERT_TRUE(processorMidi->setMidiMapping(2, ParamID::Global::LfoPmd));
+    EXPECT_EQ(counter.stateChanges, 2);
+
+    // The saved mappings come from the published map
+    const auto mappings = processorMidi->getMidiMappings();
+    ASSERT_EQ(mappings.size(), 2u);
+    EXPECT_EQ(mappings.at(1), ParamID::Global::LfoRate);
+    EXPECT_EQ(mappings.at(2), ParamID::Global::LfoPmd);
+}
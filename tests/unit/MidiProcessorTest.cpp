@@ -44,6 +44,9 @@ public:
     MOCK_METHOD(int, allocateVoiceWithNoisePriority, (uint8_t note, uint8_t velocity, bool needsNoise), (override));
     MOCK_METHOD(void, releaseVoice, (uint8_t note), (override));
     MOCK_METHOD(void, releaseAllVoices, (), (override));
+    MOCK_METHOD(int, allocateVoiceInPool, (uint8_t note, uint8_t velocity, uint8_t channelMask), (override));
+    MOCK_METHOD(int, getChannelForNoteInPool, (uint8_t note, uint8_t channelMask), (const, override));
+    MOCK_METHOD(void, releaseChannel, (int channel), (override));
     MOCK_METHOD(int, getChannelForNote, (uint8_t note), (const, override));
     MOCK_METHOD(uint8_t, getNoteForChannel, (int channel), (const, override));
     MOCK_METHOD(uint8_t, getVelocityForChannel, (int channel), (const, override));
@@ -100,6 +103,10 @@ public:
         // Stub implementation for testing
     }
     
+    // Precompiled preset register images
+    MOCK_METHOD(void, applyRegisterImage, (uint8_t channel, const ymulatorsynth::RegisterImage& image), (override));
+    MOCK_METHOD(void, applyRegisterImageGlobals, (const ymulatorsynth::RegisterImage& image), (override));
+    
     // Debug and monitoring
     MOCK_METHOD(YmfmWrapperInterface::EnvelopeDebugInfo, getEnvelopeDebugInfo, (uint8_t channel, uint8_t operator_num), (const, override));
 };
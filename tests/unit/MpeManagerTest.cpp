@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "PluginProcessor.h"
+#include "core/MpeManager.h"
+#include "core/MidiProcessor.h"
+#include "core/VoiceManager.h"
+#include "dsp/YmfmWrapper.h"
+#include "dsp/YM2151Registers.h"
+#include "utils/ParameterIDs.h"
+
+using namespace ymulatorsynth;
+
+class MpeManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        chip.initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
+        mpe = std::make_unique<MpeManager>(chip);
+    }
+
+    void TearDown() override {
+        mpe.reset();
+        ParameterManager::resetStaticState();
+    }
+
+    // Algorithm 4 (carriers: operators 2 and 3) with every TL at the same level
+    void setLevels(uint8_t channel, uint8_t tl) {
+        chip.setAlgorithm(channel, 4);
+        for (uint8_t op = 0; op < 4; ++op) {
+            chip.writeRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, op, channel), tl);
+        }
+    }
+
+    uint8_t readTL(uint8_t op, uint8_t channel) const {
+        return chip.readCurrentRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, op, channel));
+    }
+
+    uint8_t readKeyCode(uint8_t channel) const {
+        return chip.readCurrentRegister(YM2151Regs::REG_KEY_CODE_BASE + channel);
+    }
+
+    static uint8_t keyCodeOf(int note) {
+        return static_cast<uint8_t>(YM2151Regs::pitchToKeyCode(note * YM2151Regs::KF_SCALE_FACTOR) >> YM2151Regs::SHIFT_KEY_CODE);
+    }
+
+    YmfmWrapper chip;
+    std::unique_ptr<MpeManager> mpe;
+};
+
+// =============================================================================
+// 1. Zones
+// =============================================================================
+
+TEST_F(MpeManagerTest, ZonesDoNotOverlap) {
+    EXPECT_FALSE(mpe->isEnabled());
+
+    mpe->setZones(7, 7);
+    EXPECT_TRUE(mpe->isZoneChannel(0));
+    EXPECT_TRUE(mpe->isZoneChannel(7));
+    EXPECT_TRUE(mpe->isZoneChannel(8));
+    EXPECT_TRUE(mpe->isZoneChannel(15));
+
+    // The upper zone gives way
+    mpe->setZones(10, 10);
+    EXPECT_EQ(mpe->getLowerZoneMemberChannels(), 10);
+    EXPECT_EQ(mpe->getUpperZoneMemberChannels(), 4);
+
+    mpe->setZones(3, 0);
+    EXPECT_TRUE(mpe->isZoneChannel(3));
+    EXPECT_FALSE(mpe->isZoneChannel(4));
+    EXPECT_FALSE(mpe->isZoneChannel(15));
+}
+
+TEST_F(MpeManagerTest, ConfigurationMessageOnlyOnMasterChannels) {
+    mpe->handleConfigurationMessage(15, 5);
+    EXPECT_EQ(mpe->getUpperZoneMemberChannels(), 5);
+
+    // The zone being configured wins
+    mpe->handleConfigurationMessage(0, 15);
+    EXPECT_EQ(mpe->getLowerZoneMemberChannels(), 15);
+    EXPECT_EQ(mpe->getUpperZoneMemberChannels(), 0);
+
+    mpe->handleConfigurationMessage(4, 0);
+    EXPECT_EQ(mpe->getLowerZoneMemberChannels(), 15);
+}
+
+// =============================================================================
+// 2. Per-Note Expression
+// =============================================================================
+
+TEST_F(MpeManagerTest, PitchBendMovesOnlyItsChannelsNote) {
+    mpe->setZones(15, 0);
+    mpe->noteOn(0, 1, 60, 100);
+    mpe->noteOn(1, 2, 60, 100);
+
+    // 12 semitones of the default 48
+    mpe->setPitchBend(1, 8192 + 8192 / 4);
+    EXPECT_EQ(readKeyCode(0), keyCodeOf(72));
+    EXPECT_EQ(readKeyCode(1), keyCodeOf(60));
+
+    // The master channel bends the whole zone, on top of the member bend
+    mpe->setPitchBend(0, 16383);
+    EXPECT_EQ(readKeyCode(0), keyCodeOf(74));
+    EXPECT_EQ(readKeyCode(1), keyCodeOf(62));
+}
+
+TEST_F(MpeManagerTest, PressureAndTimbreOffsetCarriersAndModulators) {
+    mpe->setZones(15, 0);
+    setLevels(3, 40);
+    mpe->noteOn(3, 5, 64, 100);
+    EXPECT_EQ(mpe->findVoice(5, 64), 3);
+
+    mpe->setChannelPressure(5, 127);
+    EXPECT_EQ(mpe->applyExpression(), 1);
+    EXPECT_EQ(readTL(0, 3), 40);
+    EXPECT_EQ(readTL(2, 3), 40 - MpeManager::PressureDepth);
+    EXPECT_EQ(readTL(3, 3), 40 - MpeManager::PressureDepth);
+
+    mpe->setTimbre(5, 0);
+    mpe->applyExpression();
+    EXPECT_EQ(readTL(0, 3), 40 + MpeManager::TimbreDepth);
+    EXPECT_EQ(readTL(1, 3), 40 + MpeManager::TimbreDepth);
+
+    // Poly aftertouch reaches the one note
+    mpe->setPolyPressure(5, 64, 0);
+    mpe->applyExpression();
+    EXPECT_EQ(readTL(3, 3), 40);
+}
+
+TEST_F(MpeManagerTest, UnchangedLevelsAreNotRewritten) {
+    mpe->setZones(15, 0);
+    setLevels(3, 40);
+    mpe->noteOn(3, 5, 64, 100);
+    mpe->setChannelPressure(5, 127);
+    EXPECT_EQ(mpe->applyExpression(), 1);
+    EXPECT_EQ(mpe->applyExpression(), 0);
+
+    // A parameter update that puts the preset's TL back is undone next block
+    chip.writeRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, 3, 3), 40);
+    EXPECT_EQ(mpe->applyExpression(), 1);
+    EXPECT_EQ(readTL(3, 3), 40 - MpeManager::PressureDepth);
+}
+
+TEST_F(MpeManagerTest, NotesThroughMidiProcessorGetTheirOwnVoices) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    VoiceManager voices;
+    MidiProcessor midi(voices, chip, processor->getParameters(), processor->getParameterManager());
+    midi.setMpeManager(mpe.get());
+
+    // MPE Configuration Message: lower zone with 15 member channels
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::RpnMsb, 0), 0);
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::RpnLsb, ParamID::NRPN::RpnMpeConfiguration), 0);
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, ParamID::MIDI_CC::DataEntryMsb, 15), 0);
+    midi.processMidiMessages(buffer);
+    ASSERT_EQ(mpe->getLowerZoneMemberChannels(), 15);
+
+    // The same note on two member channels
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOn(2, 60, static_cast<juce::uint8>(100)), 0);
+    buffer.addEvent(juce::MidiMessage::noteOn(3, 60, static_cast<juce::uint8>(100)), 1);
+    buffer.addEvent(juce::MidiMessage::pitchWheel(3, 8192 - 8192 / 48), 2);
+    midi.processMidiMessages(buffer);
+
+    const int first = mpe->findVoice(1, 60);
+    const int second = mpe->findVoice(2, 60);
+    ASSERT_GE(first, 0);
+    ASSERT_GE(second, 0);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(readKeyCode(static_cast<uint8_t>(first)), keyCodeOf(60));
+    EXPECT_EQ(readKeyCode(static_cast<uint8_t>(second)), keyCodeOf(59));
+
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOff(2, 60), 0);
+    midi.processMidiMessages(buffer);
+    EXPECT_FALSE(voices.isVoiceActive(first));
+    EXPECT_TRUE(voices.isVoiceActive(second));
+}
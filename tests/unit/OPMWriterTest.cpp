@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "utils/OPMWriter.h"
+#include "utils/PackedPreset.h"
+#include "utils/PresetManager.h"
+#include "../mocks/TestVoices.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class OPMWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("OPMWriterTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+    }
+
+    void TearDown() override {
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    static VOPMVoice createVoice(int number, const juce::String& name) {
+        return YMulatorSynth::Test::createTestVoice(number, name);
+    }
+
+    juce::File tempDir;
+};
+
+// =============================================================================
+// 1. Format
+// =============================================================================
+
+TEST_F(OPMWriterTest, WritesVOPMTextFormat) {
+    const auto name = juce::String::fromUTF8("Caf\xc3\xa9 Bass");
+    juce::MemoryOutputStream stream;
+    {
+        OPMWriter writer(stream);
+        writer.writeHeader({ "Title" });
+        writer.writeVoice(createVoice(3, name));
+        EXPECT_TRUE(writer.flush());
+    }
+
+    const juce::String voiceText = "@:3 " + name + "\n"
+        "LFO: 200 64 32 2 17\n"
+        "CH: 192 5 3 1 6 120 1\n"
+        "M1: 31 10 0 7 3 3 0 3 0 3 0\n"
+        "C1: 30 11 1 8 3 23 1 4 1 2 128\n"
+        "M2: 29 12 2 9 3 43 2 5 2 1 0\n"
+        "C2: 28 13 3 10 3 63 3 6 3 0 128\n";
+    const juce::String header =
+        ";==================================================\n"
+        "; Title\n"
+        ";==================================================\n"
+        "\n";
+
+    EXPECT_EQ(stream.toUTF8(), header + voiceText + "\n");
+    EXPECT_EQ(VOPMParser::voiceToString(createVoice(3, name)), voiceText);
+}
+
+TEST_F(OPMWriterTest, PackedPresetMatchesPresetConversion) {
+    auto preset = Preset::fromVOPM(createVoice(42, "Packed"));
+    PresetStringPool names;
+    const auto packed = PackedPreset::pack(preset, names.add(preset.name));
+
+    juce::MemoryOutputStream fromPacked, fromPreset;
+    {
+        OPMWriter packedWriter(fromPacked);
+        packedWriter.writeVoice(packed, names);
+        OPMWriter presetWriter(fromPreset);
+        presetWriter.writeVoice(preset.toVOPM());
+    }
+    EXPECT_EQ(fromPacked.toUTF8(), fromPreset.toUTF8());
+}
+
+// =============================================================================
+// 2. Streaming
+// =============================================================================
+
+TEST_F(OPMWriterTest, OutputLargerThanBufferRoundTrips) {
+    constexpr int numVoices = 2000;  // several times OPMWriter::BufferSize
+    juce::MemoryOutputStream stream;
+    {
+        OPMWriter writer(stream);
+        for (int i = 0; i < numVoices; ++i)
+            writer.writeVoice(createVoice(i, "Voice " + juce::String(i)));
+    }
+    ASSERT_GT(stream.getDataSize(), OPMWriter::BufferSize * 3);
+
+    const auto voices = VOPMParser::parseContent(stream.toUTF8());
+    ASSERT_EQ(voices.size(), static_cast<size_t>(numVoices));
+    EXPECT_EQ(voices[1234].name, "Voice 1234");
+    EXPECT_EQ(voices[1234].operators[2].totalLevel, createVoice(1234, {}).operators[2].totalLevel);
+    EXPECT_EQ(voices.back().number, numVoices - 1);
+}
+
+TEST_F(OPMWriterTest, FailedFileLeavesTargetUntouched) {
+    auto target = tempDir.getChildFile("bank.opm");
+    ASSERT_TRUE(target.replaceWithText("original"));
+
+    EXPECT_FALSE(OPMWriter::writeFile(tempDir.getChildFile("missing").getChildFile("bank.opm"),
+                                      [](OPMWriter&) {}));
+    EXPECT_TRUE(OPMWriter::writeFile(target, [](OPMWriter& writer) {
+        writer.writeVoice(createVoice(1, "Replaced"));
+    }));
+    EXPECT_TRUE(target.loadFileAsString().startsWith("@:1 Replaced"));
+}
+
+// =============================================================================
+// 3. Library Export
+// =============================================================================
+
+TEST_F(OPMWriterTest, AsyncExportWritesSnapshot) {
+    PresetManager manager;
+    manager.addPreset(Preset::fromVOPM(createVoice(0, "First")));
+    manager.addPreset(Preset::fromVOPM(createVoice(1, "Second")));
+    const int numPresets = manager.getNumPresets();
+
+    auto file = tempDir.getChildFile("library.opm");
+    const auto callerThread = juce::Thread::getCurrentThreadId();
+    bool done = false;
+    bool saved = false;
+    juce::Thread::ThreadID completedOn = nullptr;
+    manager.saveOPMFileAsync(file, [&](bool result) {
+        saved = result;
+        completedOn = juce::Thread::getCurrentThreadId();
+        done = true;
+    });
+
+    // Completion is delivered with the manager's pending updates, not from the worker
+    for (int attempt = 0; attempt < 1000 && !done; ++attempt) {
+        juce::Thread::sleep(10);
+        manager.dispatchPendingUpdates();
+    }
+    ASSERT_TRUE(done);
+    EXPECT_TRUE(saved);
+    EXPECT_EQ(completedOn, callerThread);
+    const auto voices = VOPMParser::parseFile(file);
+    ASSERT_EQ(static_cast<int>(voices.size()), numPresets);
+    EXPECT_EQ(voices[static_cast<size_t>(numPresets - 1)].name, "Second");
+
+    // The synchronous export writes the same file
+    auto syncFile = tempDir.getChildFile("library-sync.opm");
+    ASSERT_TRUE(manager.saveOPMFile(syncFile));
+    EXPECT_EQ(syncFile.loadFileAsString(), file.loadFileAsString());
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include "utils/PackedPreset.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class PackedPresetTest : public ::testing::Test {
+protected:
+    static Preset makePreset(const juce::String& name) {
+        Preset preset;
+        preset.id = 7;
+        preset.name = name;
+        preset.algorithm = 5;
+        preset.feedback = 6;
+        preset.lfo.rate = 200;
+        preset.lfo.amd = 64;
+        preset.lfo.pmd = 100;
+        preset.lfo.waveform = 2;
+        preset.lfo.noiseFreq = 17;
+        for (auto& channel : preset.channels) {
+            channel.ams = 2;
+            channel.pms = 5;
+            channel.noiseEnable = 1;
+        }
+        for (int i = 0; i < 4; ++i) {
+            auto& op = preset.operators[i];
+            op.totalLevel = 100.0f + i;
+            op.attackRate = 31.0f - i;
+            op.decay1Rate = 10.0f + i;
+            op.decay2Rate = 3.0f + i;
+            op.releaseRate = 15.0f - i;
+            op.sustainLevel = 2.0f + i;
+            op.keyScale = static_cast<float>(i);
+            op.multiple = 12.0f + i;
+            op.detune1 = 4.0f + i;
+            op.detune2 = static_cast<float>(3 - i);
+            op.amsEnable = (i % 2) == 0;
+            op.slotEnable = i != 2;
+        }
+        return preset;
+    }
+};
+
+// =============================================================================
+// 1. Packing
+// =============================================================================
+
+TEST_F(PackedPresetTest, FitsOneCacheLine) {
+    EXPECT_EQ(sizeof(PackedPreset), 64u);
+    EXPECT_EQ(sizeof(PackedPreset::Operator), 8u);
+}
+
+TEST_F(PackedPresetTest, RoundTripPreservesEveryField) {
+    PresetStringPool names;
+    const auto original = makePreset(juce::String::fromUTF8("Br\xc3\xa4ss Lead"));
+    const auto packed = PackedPreset::pack(original, names.add(original.name));
+    const auto restored = packed.unpack(names);
+
+    EXPECT_EQ(restored.id, original.id);
+    EXPECT_EQ(restored.name, original.name);
+    EXPECT_EQ(restored.algorithm, original.algorithm);
+    EXPECT_EQ(restored.feedback, original.feedback);
+    EXPECT_EQ(restored.lfo.rate, original.lfo.rate);
+    EXPECT_EQ(restored.lfo.amd, original.lfo.amd);
+    EXPECT_EQ(restored.lfo.pmd, original.lfo.pmd);
+    EXPECT_EQ(restored.lfo.waveform, original.lfo.waveform);
+    EXPECT_EQ(restored.lfo.noiseFreq, original.lfo.noiseFreq);
+
+    for (const auto& channel : restored.channels) {
+        EXPECT_EQ(channel.ams, 2);
+        EXPECT_EQ(channel.pms, 5);
+        EXPECT_EQ(channel.noiseEnable, 1);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        const auto& a = original.operators[i];
+        const auto& b = restored.operators[i];
+        EXPECT_FLOAT_EQ(b.totalLevel, a.totalLevel) << "op " << i;
+        EXPECT_FLOAT_EQ(b.attackRate, a.attackRate) << "op " << i;
+        EXPECT_FLOAT_EQ(b.decay1Rate, a.decay1Rate) << "op " << i;
+        EXPECT_FLOAT_EQ(b.decay2Rate, a.decay2Rate) << "op " << i;
+        EXPECT_FLOAT_EQ(b.releaseRate, a.releaseRate) << "op " << i;
+        EXPECT_FLOAT_EQ(b.sustainLevel, a.sustainLevel) << "op " << i;
+        EXPECT_FLOAT_EQ(b.keyScale, a.keyScale) << "op " << i;
+        EXPECT_FLOAT_EQ(b.multiple, a.multiple) << "op " << i;
+        EXPECT_FLOAT_EQ(b.detune1, a.detune1) << "op " << i;
+        EXPECT_FLOAT_EQ(b.detune2, a.detune2) << "op " << i;
+        EXPECT_EQ(b.amsEnable, a.amsEnable) << "op " << i;
+        EXPECT_EQ(b.slotEnable, a.slotEnable) << "op " << i;
+    }
+
+    // Hash and tags are carried along so scans never recompute them
+    EXPECT_EQ(packed.soundHash, PresetHash::compute(original));
+    EXPECT_EQ(packed.soundHash, PresetHash::compute(restored));
+}
+
+TEST_F(PackedPresetTest, OutOfRangeValuesAreClamped) {
+    PresetStringPool names;
+    auto preset = makePreset("Clamp");
+    preset.operators[0].totalLevel = 200.0f;
+    preset.operators[1].multiple = -3.0f;
+    preset.lfo.rate = 999;
+
+    const auto restored = PackedPreset::pack(preset, names.add(preset.name)).unpack(names);
+    EXPECT_FLOAT_EQ(restored.operators[0].totalLevel, 127.0f);
+    EXPECT_FLOAT_EQ(restored.operators[1].multiple, 0.0f);
+    EXPECT_EQ(restored.lfo.rate, 255);
+}
+
+// =============================================================================
+// 2. String Pool
+// =============================================================================
+
+TEST_F(PackedPresetTest, StringPoolStoresNamesBackToBack) {
+    PresetStringPool names;
+    const auto a = names.add("Bass");
+    const auto b = names.add("");
+    const auto c = names.add("Strings");
+
+    EXPECT_EQ(names.get(a), "Bass");
+    EXPECT_EQ(names.get(b), "");
+    EXPECT_EQ(names.get(c), "Strings");
+    EXPECT_EQ(names.getSizeInBytes(), 5u + 1u + 8u);
+
+    names.clear();
+    EXPECT_EQ(names.getSizeInBytes(), 0u);
+}
+
+// =============================================================================
+// 3. PresetManager Integration
+// =============================================================================
+
+TEST_F(PackedPresetTest, ManagerKeepsPackedCopiesInSync) {
+    PresetManager manager;
+
+    auto a = makePreset("First");
+    a.id = 1;
+    auto b = makePreset("Second");
+    b.id = 2;
+    b.algorithm = 1;
+    manager.addPreset(a);
+    manager.addPreset(b);
+
+    ASSERT_NE(manager.getPackedPreset(1), nullptr);
+    EXPECT_EQ(manager.getPackedPreset(2), nullptr);
+    EXPECT_STREQ(manager.getPackedPresetName(1), "Second");
+    EXPECT_EQ(manager.getPackedPreset(1)->voice.algorithm, 1u);
+    EXPECT_EQ(manager.getPresetHash(1), PresetHash::compute(b));
+
+    // Replacing by ID updates the packed copy in place
+    b.name = "Second v2";
+    b.algorithm = 3;
+    manager.addPreset(b);
+    EXPECT_STREQ(manager.getPackedPresetName(1), "Second v2");
+    EXPECT_EQ(manager.getPackedPreset(1)->voice.algorithm, 3u);
+
+    // Removal empties the slot; the other preset keeps its index
+    manager.removePreset(1);
+    EXPECT_EQ(manager.getPackedPreset(0), nullptr);
+    ASSERT_NE(manager.getPackedPreset(1), nullptr);
+    EXPECT_STREQ(manager.getPackedPresetName(1), "Second v2");
+}
+
+TEST_F(PackedPresetTest, PackedLibraryIsTheOnlyCopy) {
+    constexpr int numPresets = 10000;
+    std::vector<Preset> received;
+    size_t nameBytes = 0;
+    for (int i = 0; i < numPresets; ++i) {
+        received.push_back(makePreset("Voice " + juce::String(i)));
+        received.back().id = i;
+        nameBytes += received.back().name.getNumBytesAsUTF8() + 1;
+    }
+
+    PresetManager manager;
+    ASSERT_GE(manager.addReceivedPresets("Footprint", received), 0);
+    ASSERT_EQ(manager.getNumPresets(), numPresets);
+
+    // One packed preset and one register image per slot, rounded up to whole chunks, plus the names
+    const size_t numChunks = (numPresets + PresetChunk::Capacity - 1) / PresetChunk::Capacity;
+    const size_t packedBound = numChunks * PresetChunk::Capacity * (sizeof(PackedPreset) + sizeof(RegisterImage))
+                               + nameBytes;
+    EXPECT_LE(manager.getPackedLibrarySize(), packedBound);
+    EXPECT_EQ(manager.getSnapshot()->getStorageSizeInBytes(), manager.getPackedLibrarySize());
+
+    // The baseline kept a full Preset next to the packed preset and image of every slot
+    const size_t baseline = numPresets * (sizeof(Preset) + sizeof(PackedPreset) + sizeof(RegisterImage)) + nameBytes;
+    EXPECT_LT(manager.getPackedLibrarySize(), baseline / 2);
+
+    // Presets are still complete when expanded
+    const auto preset = manager.getPreset(numPresets - 1);
+    ASSERT_NE(preset, nullptr);
+    EXPECT_EQ(preset->name, "Voice " + juce::String(numPresets - 1));
+    EXPECT_EQ(preset->algorithm, 5);
+}
+
+TEST_F(PackedPresetTest, RenamesDoNotGrowTheNamePool) {
+    PresetManager manager;
+    auto preset = makePreset("Original");
+    preset.id = 0;
+    manager.addPreset(preset);
+    const auto initialSize = manager.getPackedLibrarySize();
+
+    // Each published change copies the chunk with only the names still in use
+    for (int i = 0; i < 200; ++i) {
+        preset.name = "Renamed Voice " + juce::String(i);
+        manager.addPreset(preset);
+    }
+
+    EXPECT_STREQ(manager.getPackedPresetName(0), "Renamed Voice 199");
+    EXPECT_LE(manager.getPackedLibrarySize(), initialSize + 2 * sizeof("Renamed Voice 199"));
+}
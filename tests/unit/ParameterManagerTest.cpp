@@ -267,6 +267,18 @@ TEST_F(ParameterManagerTest, ParameterApplicationBasicTest) {
     EXPECT_NO_THROW(processor->processBlock(buffer, midiBuffer));
 }
 
+TEST_F(ParameterManagerTest, ProgramChangeLoadsLfoAndNoiseParameters) {
+    auto& parameters = processor->getParameters();
+    parameters.getParameter(ParamID::Global::LfoRate)->setValueNotifyingHost(0.5f);
+    parameters.getParameter(ParamID::Global::NoiseEnable)->setValueNotifyingHost(1.0f);
+    
+    // Factory presets do not use LFO or noise
+    processor->setCurrentProgram(0);
+    
+    EXPECT_FLOAT_EQ(parameters.getParameter(ParamID::Global::LfoRate)->getValue(), 0.0f);
+    EXPECT_FLOAT_EQ(parameters.getParameter(ParamID::Global::NoiseEnable)->getValue(), 0.0f);
+}
+
 // ============================================================================
 // Memory and Resource Management Tests
 // ============================================================================
@@ -291,4 +303,88 @@ TEST_F(ParameterManagerTest, ProcessorDestruction) {
     // Destruction should clean up listeners properly
     EXPECT_NO_THROW(tempProcessor.reset());
     EXPECT_NO_THROW(tempHost.reset());
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Parameter Transaction Tests
+// ============================================================================
+
+namespace {
+    // Counts what the host hears during a change
+    struct HostNotificationCounter : juce::AudioProcessorListener {
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override { ++parameterChanges; }
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details) override {
+            if (details.programChanged) {
+                ++programChanges;
+            }
+        }
+        int parameterChanges = 0;
+        int programChanges = 0;
+    };
+}
+
+TEST_F(ParameterManagerTest, TransactionSetsOnlyChangedValues) {
+    auto& parameters = processor->getParameters();
+    auto* algorithm = parameters.getParameter(ParamID::Global::Algorithm);
+    auto* feedback = parameters.getParameter(ParamID::Global::Feedback);
+    
+    HostNotificationCounter counter;
+    processor->addListener(&counter);
+    int numChanged = 0;
+    {
+        ParameterManager::Transaction transaction(processor->getParameterManager());
+        transaction.set(ParamID::Global::Algorithm, algorithm->convertTo0to1(3.0f));
+        transaction.set(ParamID::Global::Algorithm, algorithm->convertTo0to1(5.0f));  // last value wins
+        transaction.set(ParamID::Global::Feedback, feedback->getValue());             // unchanged
+        transaction.set("noSuchParameter", 0.5f);
+        
+        // Nothing is applied before the commit
+        EXPECT_NE(algorithm->getValue(), algorithm->convertTo0to1(5.0f));
+        numChanged = transaction.commit();
+    }
+    processor->removeListener(&counter);
+    
+    EXPECT_EQ(numChanged, 1);
+    EXPECT_EQ(counter.parameterChanges, 1);
+    EXPECT_EQ(counter.programChanges, 0);
+    EXPECT_FLOAT_EQ(algorithm->convertFrom0to1(algorithm->getValue()), 5.0f);
+}
+
+TEST_F(ParameterManagerTest, TransactionCommitsOnDestruction) {
+    auto* lfoRate = processor->getParameters().getParameter(ParamID::Global::LfoRate);
+    {
+        ParameterManager::Transaction transaction(processor->getParameterManager());
+        transaction.set(*lfoRate, lfoRate->convertTo0to1(100.0f));
+    }
+    EXPECT_FLOAT_EQ(lfoRate->convertFrom0to1(lfoRate->getValue()), 100.0f);
+}
+
+TEST_F(ParameterManagerTest, PresetLoadNotifiesHostOnceForProgramChange) {
+    processor->setCurrentProgram(0);
+    
+    HostNotificationCounter counter;
+    processor->addListener(&counter);
+    processor->setCurrentProgram(0);  // same values: nothing to set
+    const int unchangedNotifications = counter.parameterChanges;
+    processor->setCurrentProgram(1);
+    processor->removeListener(&counter);
+    
+    EXPECT_EQ(unchangedNotifications, 0);
+    EXPECT_GT(counter.parameterChanges, 0);
+    EXPECT_LT(counter.parameterChanges, 4 * 11 + 8);  // presets 0 and 1 share their LFO and noise values
+    EXPECT_EQ(counter.programChanges, 2);
+    EXPECT_FALSE(processor->isInCustomMode());
+}
+
+TEST_F(ParameterManagerTest, ListenersStayActiveAfterTransaction) {
+    auto& parameters = processor->getParameters();
+    processor->setCurrentProgram(0);
+    
+    // A gesture after the preset load still switches to custom mode
+    auto* tl = parameters.getParameter(ParamID::Op::tl(1));
+    tl->beginChangeGesture();
+    tl->setValueNotifyingHost(tl->getValue() > 0.5f ? 0.0f : 1.0f);
+    tl->endChangeGesture();
+    
+    EXPECT_TRUE(processor->isInCustomMode());
+}
@@ -0,0 +1,328 @@
+#include <gtest/gtest.h>
+#include "PluginProcessor.h"
+#include "core/PartManager.h"
+#include "core/MidiProcessor.h"
+#include "core/VoiceManager.h"
+#include "dsp/YmfmWrapper.h"
+#include "dsp/YM2151Registers.h"
+
+using namespace ymulatorsynth;
+
+class PartManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        chip.initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
+        parts = std::make_unique<PartManager>(chip);
+    }
+
+    void TearDown() override {
+        parts.reset();
+        ParameterManager::resetStaticState();
+    }
+
+    // Algorithm 4: operators 2 and 3 are the carriers
+    static RegisterImage makeImage(uint8_t tl) {
+        RegisterImage image;
+        image.connection = 4;
+        for (auto& op : image.operators) {
+            op[1] = tl;
+        }
+        return image;
+    }
+
+    uint8_t readTL(uint8_t op, uint8_t channel) const {
+        return chip.readCurrentRegister(YM2151Regs::getOperatorRegister(YM2151Regs::REG_TOTAL_LEVEL_BASE, op, channel));
+    }
+
+    YmfmWrapper chip;
+    std::unique_ptr<PartManager> parts;
+};
+
+// =============================================================================
+// 1. Part Images
+// =============================================================================
+
+TEST_F(PartManagerTest, VolumeAttenuatesCarriersOnly) {
+    const auto image = makeImage(10);
+
+    // Half volume is 6 dB, 8 steps of 0.75 dB
+    const auto half = PartManager::compileImage(image, 0.5f);
+    EXPECT_EQ(half.operators[0][1], 10);
+    EXPECT_EQ(half.operators[1][1], 10);
+    EXPECT_EQ(half.operators[2][1], 18);
+    EXPECT_EQ(half.operators[3][1], 18);
+
+    const auto silent = PartManager::compileImage(image, 0.0f);
+    EXPECT_EQ(silent.operators[3][1], 127);
+    EXPECT_EQ(silent.operators[0][1], 10);
+}
+
+// =============================================================================
+// 2. Register Writes
+// =============================================================================
+
+TEST_F(PartManagerTest, NothingIsWrittenInSingleMode) {
+    auto settings = PartManager::makeDefaultPart(0);
+    settings.image = makeImage(20);
+    ASSERT_TRUE(parts->setPart(0, settings));
+    EXPECT_EQ(parts->applyPendingChanges(), 0);
+}
+
+TEST_F(PartManagerTest, OnlyChangedPartsAreRewritten) {
+    parts->setEnabled(true);
+    EXPECT_EQ(parts->applyPendingChanges(), 8);  // every part once, when the mode comes on
+    EXPECT_EQ(parts->applyPendingChanges(), 0);
+
+    auto settings = PartManager::makeDefaultPart(2);
+    settings.image = makeImage(20);
+    settings.channelMask = 0x0C;  // channels 2 and 3
+    settings.pan = 0.0f;
+    ASSERT_TRUE(parts->setPart(2, settings));
+    const uint8_t untouched = readTL(3, 5);
+
+    EXPECT_EQ(parts->applyPendingChanges(), 2);
+    for (uint8_t channel : { 2, 3 }) {
+        EXPECT_EQ(readTL(0, channel), 20);
+        EXPECT_EQ(readTL(3, channel), 20);
+        EXPECT_EQ(chip.readCurrentRegister(YM2151Regs::REG_ALGORITHM_FEEDBACK_BASE + channel) & YM2151Regs::MASK_PAN_LR,
+                  YM2151Regs::PAN_LEFT_ONLY);
+    }
+    EXPECT_EQ(readTL(3, 5), untouched);
+    EXPECT_EQ(parts->getChannelMask(2), 0x0C);
+}
+
+TEST_F(PartManagerTest, PartsAreFoundByMidiChannel) {
+    auto layered = PartManager::makeDefaultPart(5);
+    layered.midiChannel = 0;
+    ASSERT_TRUE(parts->setPart(5, layered));
+    parts->applyPendingChanges();
+
+    EXPECT_EQ(parts->getPartsForMidiChannel(0), 0x21);
+    EXPECT_EQ(parts->getPartsForMidiChannel(5), 0x00);
+    EXPECT_EQ(parts->getPartsForMidiChannel(15), 0x00);
+}
+
+// =============================================================================
+// 3. Notes and Parameters
+// =============================================================================
+
+TEST_F(PartManagerTest, NotesPlayInTheirPartsPool) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    VoiceManager voices;
+    MidiProcessor midi(voices, chip, processor->getParameters(), processor->getParameterManager());
+    midi.setPartManager(parts.get());
+
+    auto part = PartManager::makeDefaultPart(1);
+    part.channelMask = 0x06;  // channels 1 and 2
+    ASSERT_TRUE(parts->setPart(1, part));
+    parts->setEnabled(true);
+    parts->applyPendingChanges();
+
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::noteOn(2, 60, static_cast<juce::uint8>(100)), 0);
+    buffer.addEvent(juce::MidiMessage::noteOn(2, 64, static_cast<juce::uint8>(100)), 1);
+    midi.processMidiMessages(buffer);
+
+    // Part 2 changed after part 1, so channel 1 is the one already holding part 1's image
+    EXPECT_EQ(voices.getChannelForNoteInPool(60, 0x06), 1);
+    EXPECT_EQ(voices.getChannelForNoteInPool(64, 0x06), 2);
+    EXPECT_FALSE(voices.isVoiceActive(7));
+
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOff(2, 60), 0);
+    midi.processMidiMessages(buffer);
+    EXPECT_FALSE(voices.isVoiceActive(1));
+    EXPECT_TRUE(voices.isVoiceActive(2));
+}
+
+TEST_F(PartManagerTest, SplitZonesPlayOnTheirOwnChannels) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    VoiceManager voices;
+    MidiProcessor midi(voices, chip, processor->getParameters(), processor->getParameterManager());
+    midi.setPartManager(parts.get());
+
+    // Bass below middle C on channels 0-1, pad from middle C up on channels 2-7
+    auto bass = PartManager::makeDefaultPart(0);
+    bass.channelMask = 0x03;
+    bass.highNote = 59;
+    bass.image = makeImage(20);
+    auto pad = PartManager::makeDefaultPart(1);
+    pad.midiChannel = 0;
+    pad.channelMask = 0xFC;
+    pad.lowNote = 60;
+    pad.image = makeImage(40);
+    ASSERT_TRUE(parts->setPart(0, bass));
+    ASSERT_TRUE(parts->setPart(1, pad));
+    for (int part = 2; part < PartManager::NumParts; ++part) {
+        auto off = PartManager::makeDefaultPart(part);
+        off.midiChannel = -1;
+        ASSERT_TRUE(parts->setPart(part, off));
+    }
+    parts->setEnabled(true);
+    parts->applyPendingChanges();
+
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 40, static_cast<juce::uint8>(100)), 0);
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 72, static_cast<juce::uint8>(100)), 1);
+    midi.processMidiMessages(buffer);
+
+    const int bassChannel = voices.getChannelForNoteInPool(40, 0xFF);
+    const int padChannel = voices.getChannelForNoteInPool(72, 0xFF);
+    ASSERT_GE(bassChannel, 0);
+    ASSERT_GE(padChannel, 0);
+    EXPECT_TRUE((0x03 >> bassChannel) & 1);
+    EXPECT_TRUE((0xFC >> padChannel) & 1);
+    EXPECT_EQ(readTL(0, static_cast<uint8_t>(bassChannel)), 20);
+    EXPECT_EQ(readTL(0, static_cast<uint8_t>(padChannel)), 40);
+
+    // Each note is in one zone only
+    EXPECT_EQ(voices.getChannelForNoteInPool(40, 0xFC), -1);
+    EXPECT_EQ(voices.getChannelForNoteInPool(72, 0x03), -1);
+
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOff(1, 40), 0);
+    buffer.addEvent(juce::MidiMessage::noteOff(1, 72), 0);
+    midi.processMidiMessages(buffer);
+    EXPECT_FALSE(voices.isVoiceActive(bassChannel));
+    EXPECT_FALSE(voices.isVoiceActive(padChannel));
+}
+
+TEST_F(PartManagerTest, SharedChannelIsRewrittenOnlyWhenTheZoneChanges) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    VoiceManager voices;
+    MidiProcessor midi(voices, chip, processor->getParameters(), processor->getParameterManager());
+    midi.setPartManager(parts.get());
+
+    // Two velocity layers sharing channel 0
+    auto soft = PartManager::makeDefaultPart(0);
+    soft.highVelocity = 63;
+    soft.image = makeImage(20);
+    auto hard = PartManager::makeDefaultPart(1);
+    hard.midiChannel = 0;
+    hard.channelMask = 0x01;
+    hard.lowVelocity = 64;
+    hard.image = makeImage(40);
+    ASSERT_TRUE(parts->setPart(0, soft));
+    ASSERT_TRUE(parts->setPart(1, hard));
+    parts->setEnabled(true);
+    parts->applyPendingChanges();
+    EXPECT_EQ(parts->getChannelOwner(0), 1);  // the part written last
+
+    const auto play = [&](juce::uint8 velocity) {
+        juce::MidiBuffer buffer;
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, velocity), 0);
+        buffer.addEvent(juce::MidiMessage::noteOff(1, 60), 1);
+        midi.processMidiMessages(buffer);
+    };
+
+    play(30);
+    EXPECT_EQ(parts->getChannelOwner(0), 0);
+    EXPECT_EQ(readTL(0, 0), 20);
+    EXPECT_FALSE(voices.isVoiceActive(0));
+
+    // Same zone again: no rewrite
+    EXPECT_FALSE(parts->claimChannel(0, 0));
+
+    play(100);
+    EXPECT_EQ(parts->getChannelOwner(0), 1);
+    EXPECT_EQ(readTL(0, 0), 40);
+    EXPECT_TRUE(parts->claimChannel(0, 0));
+    EXPECT_EQ(parts->getOwnedChannels(0), 0x01);
+    EXPECT_EQ(parts->getOwnedChannels(1), 0x00);
+}
+
+TEST_F(PartManagerTest, PartChangeLeavesSoundingNotesToTheirZone) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    VoiceManager voices;
+    MidiProcessor midi(voices, chip, processor->getParameters(), processor->getParameterManager());
+    midi.setPartManager(parts.get());
+
+    // Parts 0 and 1 share channel 2
+    auto first = PartManager::makeDefaultPart(0);
+    first.channelMask = 0x04;
+    first.image = makeImage(20);
+    auto second = PartManager::makeDefaultPart(1);
+    second.channelMask = 0x04;
+    second.image = makeImage(40);
+    ASSERT_TRUE(parts->setPart(0, first));
+    ASSERT_TRUE(parts->setPart(1, second));
+    parts->setEnabled(true);
+    parts->applyPendingChanges();
+
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 60, static_cast<juce::uint8>(100)), 0);
+    midi.processMidiMessages(buffer);
+    ASSERT_TRUE(voices.isVoiceActive(2));
+    EXPECT_EQ(parts->getChannelOwner(2), 0);
+
+    // The other part changes preset while the note sounds
+    second.image = makeImage(50);
+    ASSERT_TRUE(parts->setPart(1, second));
+    EXPECT_EQ(parts->applyPendingChanges(0x04), 0);
+    EXPECT_EQ(parts->getChannelOwner(2), 0);
+    EXPECT_EQ(readTL(0, 2), 20);
+
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOff(1, 60), 0);
+    midi.processMidiMessages(buffer);
+    EXPECT_FALSE(voices.isVoiceActive(2));
+
+    // Its next note takes the channel back with the new image
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOn(2, 62, static_cast<juce::uint8>(100)), 0);
+    midi.processMidiMessages(buffer);
+    EXPECT_EQ(parts->getChannelOwner(2), 1);
+    EXPECT_EQ(readTL(0, 2), 50);
+}
+
+TEST_F(PartManagerTest, EmptyZonesAreRejected) {
+    auto settings = PartManager::makeDefaultPart(0);
+    settings.lowNote = 72;
+    settings.highNote = 60;
+    EXPECT_FALSE(parts->setPart(0, settings));
+
+    settings = PartManager::makeDefaultPart(0);
+    settings.lowVelocity = 100;
+    settings.highVelocity = 99;
+    EXPECT_FALSE(parts->setPart(0, settings));
+
+    settings = PartManager::makeDefaultPart(0);
+    settings.highNote = 200;
+    EXPECT_FALSE(parts->setPart(0, settings));
+
+    settings.highNote = 60;
+    EXPECT_TRUE(parts->setPart(0, settings));
+}
+
+TEST_F(PartManagerTest, ZonesFilterNotesAndVelocities) {
+    auto zone = PartManager::makeDefaultPart(3);
+    zone.lowNote = 36;
+    zone.highNote = 47;
+    zone.lowVelocity = 64;
+    ASSERT_TRUE(parts->setPart(3, zone));
+    parts->applyPendingChanges();
+
+    EXPECT_TRUE(parts->acceptsNote(3, 36, 64));
+    EXPECT_TRUE(parts->acceptsNote(3, 47, 127));
+    EXPECT_FALSE(parts->acceptsNote(3, 35, 100));
+    EXPECT_FALSE(parts->acceptsNote(3, 48, 100));
+    EXPECT_FALSE(parts->acceptsNote(3, 40, 63));
+    EXPECT_TRUE(parts->acceptsNote(0, 0, 1));  // default zone is the whole keyboard
+    EXPECT_FALSE(parts->acceptsNote(PartManager::NumParts, 60, 100));
+}
+
+TEST_F(PartManagerTest, ProcessorHandsChannelRegistersToParts) {
+    auto processor = std::make_unique<YMulatorSynthAudioProcessor>();
+    auto& parameterManager = processor->getParameterManager();
+    EXPECT_TRUE(parameterManager.ownsChannelRegisters());
+
+    processor->setMultitimbralMode(true);
+    EXPECT_TRUE(processor->isMultitimbralMode());
+    EXPECT_FALSE(parameterManager.ownsChannelRegisters());
+
+    // Parts that had no preset start with the current program
+    EXPECT_EQ(processor->getPartManager()->getPart(0).presetIndex, processor->getCurrentProgram());
+
+    processor->setMultitimbralMode(false);
+    EXPECT_TRUE(parameterManager.ownsChannelRegisters());
+}
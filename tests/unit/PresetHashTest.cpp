@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include "utils/PresetHash.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class PresetHashTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("PresetHashTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+    }
+
+    void TearDown() override {
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    static Preset makePreset(const juce::String& name) {
+        Preset preset;
+        preset.id = 1;
+        preset.name = name;
+        preset.algorithm = 4;
+        preset.feedback = 5;
+        for (int i = 0; i < 4; ++i) {
+            preset.operators[i].totalLevel = 20.0f + i * 4;
+            preset.operators[i].multiple = 1.0f + i;
+            preset.operators[i].detune1 = 0.0f;
+            preset.operators[i].attackRate = 31.0f;
+            preset.operators[i].decay1Rate = 5.0f;
+            preset.operators[i].releaseRate = 7.0f;
+        }
+        return preset;
+    }
+
+    juce::File tempDir;
+
+    // Voices 0 and 1 differ only in name and DT1 0 vs 4; voice 2 is a different sound
+    const juce::String duplicateOPMContent = R"(//MiOPMdrv sound bank Paramer Ver2002.04.22
+@:0 Organ
+LFO:  0   0   0   0   0
+CH: 64   6   4   0   0  15   0
+M1: 31   8   8  11   1  20   0   1   0   0   0
+C1: 31   8   8  11   1   0   0   1   0   0   0
+M2: 31   8   8  11   1  20   0   1   0   0   0
+C2: 31   8   8  11   1   0   0   1   0   0   0
+
+@:1 Organ Copy
+LFO:  0   0   0   0   0
+CH: 64   6   4   0   0  15   0
+M1: 31   8   8  11   1  20   0   1   4   0   0
+C1: 31   8   8  11   1   0   0   1   0   0   0
+M2: 31   8   8  11   1  20   0   1   0   0   0
+C2: 31   8   8  11   1   0   0   1   4   0   0
+
+@:2 Brass
+LFO:  0   0   0   0   0
+CH: 64   7   2   0   0  15   0
+M1: 25  10   0   5   1  29   1   1   1   0   0
+C1: 25  11   0   8   5  15   1   5   1   0   0
+M2: 28  13   0   6   2  45   1   1   0   0   0
+C2: 14   4   0   6   0   0   1   1   0   0   0
+)";
+};
+
+// =============================================================================
+// 1. Canonicalization
+// =============================================================================
+
+TEST_F(PresetHashTest, NameAndIdAreIgnored) {
+    auto a = makePreset("Lead");
+    auto b = makePreset("Another Name");
+    b.id = 42;
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(b));
+}
+
+TEST_F(PresetHashTest, SoundChangesChangeHash) {
+    const auto base = PresetHash::compute(makePreset("Lead"));
+
+    auto tl = makePreset("Lead");
+    tl.operators[1].totalLevel += 1.0f;
+    EXPECT_NE(PresetHash::compute(tl), base);
+
+    auto alg = makePreset("Lead");
+    alg.algorithm = 5;
+    EXPECT_NE(PresetHash::compute(alg), base);
+
+    auto dt1 = makePreset("Lead");
+    dt1.operators[2].detune1 = 7.0f;  // downward detune is audible
+    EXPECT_NE(PresetHash::compute(dt1), base);
+}
+
+TEST_F(PresetHashTest, Detune1FourEqualsZero) {
+    auto a = makePreset("Lead");
+    auto b = makePreset("Lead");
+    b.operators[0].detune1 = 4.0f;
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(b));
+}
+
+TEST_F(PresetHashTest, SilentSlotsAreIgnored) {
+    auto a = makePreset("Lead");
+    a.operators[2].slotEnable = false;
+    auto b = a;
+    b.operators[2].totalLevel = 99.0f;
+    b.operators[2].multiple = 9.0f;
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(b));
+
+    // AR 0 never leaves full attenuation either
+    auto c = a;
+    c.operators[2].slotEnable = true;
+    c.operators[2].attackRate = 0.0f;
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(c));
+
+    // Feedback only acts on M1
+    auto d = makePreset("Lead");
+    d.operators[0].slotEnable = false;
+    auto e = d;
+    e.feedback = 0;
+    EXPECT_EQ(PresetHash::compute(d), PresetHash::compute(e));
+}
+
+TEST_F(PresetHashTest, UnusedLfoSettingsAreIgnored) {
+    auto a = makePreset("Lead");
+    auto b = makePreset("Lead");
+    b.lfo.rate = 200;
+    b.lfo.waveform = 2;
+    b.lfo.amd = 100;                    // no AMS, no AMS-EN: cannot reach the output
+    b.operators[1].amsEnable = true;    // AMS is 0
+    b.channels[0].pms = 3;              // PMD is 0
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(b));
+
+    b.lfo.pmd = 10;                     // now phase modulation is audible
+    EXPECT_NE(PresetHash::compute(a), PresetHash::compute(b));
+}
+
+TEST_F(PresetHashTest, NoiseSettings) {
+    auto a = makePreset("Lead");
+    auto b = makePreset("Lead");
+    b.lfo.noiseFreq = 17;               // noise is off
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(b));
+
+    // With noise on, C2 pitch fields no longer matter but noise frequency does
+    a.channels[0].noiseEnable = 1;
+    b.channels[0].noiseEnable = 1;
+    a.lfo.noiseFreq = 17;
+    b.operators[3].multiple = 12.0f;
+    EXPECT_EQ(PresetHash::compute(a), PresetHash::compute(b));
+    b.lfo.noiseFreq = 3;
+    EXPECT_NE(PresetHash::compute(a), PresetHash::compute(b));
+}
+
+// =============================================================================
+// 2. PresetManager Duplicate Groups
+// =============================================================================
+
+TEST_F(PresetHashTest, DuplicateGroupsTrackMutations) {
+    PresetManager manager;
+
+    auto a = makePreset("Lead A");
+    a.id = 10;
+    auto b = makePreset("Lead B");
+    b.id = 11;
+    b.operators[3].detune1 = 4.0f;
+    auto c = makePreset("Other");
+    c.id = 12;
+    c.algorithm = 7;
+
+    manager.addPreset(a);
+    manager.addPreset(b);
+    manager.addPreset(c);
+
+    auto groups = manager.getDuplicateGroups();
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0], std::vector<int>({ 0, 1 }));
+    EXPECT_EQ(manager.getPresetHash(0), manager.getPresetHash(1));
+    EXPECT_EQ(manager.findPresetWithSameSound(makePreset("Query")), 0);
+
+    // Replacing a preset by ID moves it out of the group
+    b.algorithm = 2;
+    manager.addPreset(b);
+    EXPECT_TRUE(manager.getDuplicateGroups().empty());
+
+    manager.removePreset(10);
+    EXPECT_EQ(manager.findPresetWithSameSound(makePreset("Query")), -1);
+}
+
+// =============================================================================
+// 3. Collapsing Duplicates on Import
+// =============================================================================
+
+TEST_F(PresetHashTest, ImportKeepsDuplicatesByDefault) {
+    PresetManager manager;
+    auto file = tempDir.getChildFile("hash_keep.opm");
+    file.replaceWithText(duplicateOPMContent);
+
+    EXPECT_EQ(manager.loadOPMFile(file), 3);
+    EXPECT_EQ(manager.getNumPresets(), 3);
+    EXPECT_EQ(manager.getDuplicateGroups().size(), 1u);
+}
+
+TEST_F(PresetHashTest, ImportCollapsesDuplicatesWhenEnabled) {
+    PresetManager manager;
+    manager.setCollapseDuplicatesOnImport(true);
+    auto file = tempDir.getChildFile("hash_collapse.opm");
+    file.replaceWithText(duplicateOPMContent);
+
+    EXPECT_EQ(manager.loadOPMFile(file), 3);
+    EXPECT_EQ(manager.getNumPresets(), 2);
+    EXPECT_TRUE(manager.getDuplicateGroups().empty());
+
+    // The bank still lists all three voices; the copy points at the original
+    const auto banks = manager.getBanks();
+    const auto& bank = banks->back();
+    ASSERT_EQ(bank.presetIndices.size(), 3u);
+    EXPECT_EQ(bank.presetIndices[0], bank.presetIndices[1]);
+    EXPECT_NE(bank.presetIndices[1], bank.presetIndices[2]);
+    EXPECT_EQ(manager.getPreset(bank.presetIndices[2])->name, "Brass");
+}
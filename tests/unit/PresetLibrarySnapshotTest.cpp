@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace ymulatorsynth;
+
+class PresetLibrarySnapshotTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("PresetLibrarySnapshotTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+
+        manager = std::make_unique<PresetManager>();
+        manager->setUserDataDirectory(tempDir);
+    }
+
+    void TearDown() override {
+        manager.reset();
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    static Preset createPreset(int id, const juce::String& name) {
+        Preset preset;
+        preset.id = id;
+        preset.name = name;
+        preset.algorithm = id % 8;
+        preset.operators[3].totalLevel = static_cast<float>(id % 128);
+        return preset;
+    }
+
+    // RegisterImage is all bytes, without padding
+    static bool sameImage(const RegisterImage& a, const RegisterImage& b) {
+        return std::memcmp(&a, &b, sizeof(RegisterImage)) == 0;
+    }
+
+    juce::File tempDir;
+    std::unique_ptr<PresetManager> manager;
+};
+
+// =============================================================================
+// 1. Publishing
+// =============================================================================
+
+TEST_F(PresetLibrarySnapshotTest, EmptyManagerHasSnapshot) {
+    auto snapshot = manager->getSnapshot();
+    ASSERT_NE(snapshot, nullptr);
+    EXPECT_EQ(snapshot->getNumPresets(), 0);
+    EXPECT_EQ(snapshot->getPreset(0), nullptr);
+    EXPECT_EQ(snapshot->getGlobalPresetIndex(0, 0), -1);
+}
+
+TEST_F(PresetLibrarySnapshotTest, HeldSnapshotIsUnaffectedByChanges) {
+    manager->addPreset(createPreset(0, "First"));
+    manager->addPreset(createPreset(1, "Second"));
+
+    auto before = manager->getSnapshot();
+    const auto first = before->getPreset(0);
+    ASSERT_NE(first, nullptr);
+
+    manager->addPreset(createPreset(0, "Replaced"));
+    manager->removePreset(1);
+    for (int i = 2; i < 100; ++i)
+        manager->addPreset(createPreset(i, "Added " + juce::String(i)));
+
+    // The old snapshot still describes the old library
+    EXPECT_EQ(before->getNumPresets(), 2);
+    EXPECT_EQ(before->getPreset(0)->name, "First");
+    EXPECT_EQ(first->name, "First");
+    ASSERT_NE(before->findPresetByName("Second"), nullptr);
+    EXPECT_EQ(before->findPresetByName("Second")->id, 1);
+    EXPECT_EQ(before->getPresetNames(), juce::StringArray({ "First", "Second" }));
+
+    auto after = manager->getSnapshot();
+    EXPECT_GT(after->generation, before->generation);
+    EXPECT_EQ(after->getNumPresets(), 100);   // the removed preset leaves its slot empty
+    EXPECT_EQ(after->getPreset(0)->name, "Replaced");
+    EXPECT_EQ(after->getPreset(1), nullptr);
+    EXPECT_EQ(after->findPresetByName("Second"), nullptr);
+}
+
+TEST_F(PresetLibrarySnapshotTest, ProgramsSkipRemovedPresets) {
+    for (int i = 0; i < 4; ++i)
+        manager->addPreset(createPreset(i, "Preset " + juce::String(i)));
+    EXPECT_EQ(manager->getSnapshot()->getPresetIndexForProgram(2), 2);
+
+    manager->removePreset(1);
+    auto library = manager->getSnapshot();
+
+    // Global indices keep the empty slot, host programs close up around it
+    EXPECT_EQ(library->getNumPresets(), 4);
+    EXPECT_EQ(library->getNumLivePresets(), 3);
+    EXPECT_EQ(library->getPresetIndexForProgram(0), 0);
+    EXPECT_EQ(library->getPresetIndexForProgram(1), 2);
+    EXPECT_EQ(library->getPresetIndexForProgram(2), 3);
+    EXPECT_EQ(library->getPresetIndexForProgram(3), -1);
+    EXPECT_EQ(library->getProgramForPresetIndex(1), -1);
+    EXPECT_EQ(library->getProgramForPresetIndex(3), 2);
+}
+
+TEST_F(PresetLibrarySnapshotTest, UnchangedChunksAreShared) {
+    for (int i = 0; i <= PresetChunk::Capacity; ++i)
+        manager->addPreset(createPreset(i, "Preset " + juce::String(i)));
+    auto before = manager->getSnapshot();
+    ASSERT_EQ(before->chunks.size(), 2u);
+
+    manager->addPreset(createPreset(PresetChunk::Capacity + 1, "Other"));
+    auto after = manager->getSnapshot();
+
+    // Only the chunk that changed is copied
+    EXPECT_EQ(before->chunks[0], after->chunks[0]);
+    EXPECT_NE(before->chunks[1], after->chunks[1]);
+    EXPECT_EQ(before->getNumPresets(), PresetChunk::Capacity + 1);
+    EXPECT_EQ(after->getPreset(PresetChunk::Capacity + 1)->name, "Other");
+}
+
+TEST_F(PresetLibrarySnapshotTest, ReturnedPresetsOutliveRemoval) {
+    manager->addPreset(createPreset(0, "Removed"));
+    const auto preset = manager->getPreset(0);
+    const auto image = manager->getRegisterImage(0);
+    const auto banks = manager->getBanks();
+    ASSERT_NE(preset, nullptr);
+    ASSERT_NE(image, nullptr);
+    const auto expectedImage = preset->toRegisterImage();
+
+    manager->clear();
+    for (int i = 0; i < 10; ++i)
+        manager->addPreset(createPreset(i, "Later " + juce::String(i)));
+    EXPECT_EQ(manager->getNumPresets(), 10);
+
+    // Each keeps what it points into alive, however often the library changes
+    EXPECT_EQ(preset->name, "Removed");
+    EXPECT_TRUE(sameImage(*image, expectedImage));
+    EXPECT_TRUE(banks->empty());
+}
+
+TEST_F(PresetLibrarySnapshotTest, ReplacedSnapshotsAreFreedWithoutReaders) {
+    manager->addPreset(createPreset(0, "First"));
+    std::weak_ptr<const PresetLibrarySnapshot> replaced = manager->getSnapshot();
+    ASSERT_FALSE(replaced.expired());
+
+    // No reader is taking a reference, so the next publish frees it rather than waiting
+    manager->addPreset(createPreset(1, "Second"));
+    EXPECT_TRUE(replaced.expired());
+
+    // A held snapshot is kept until its holder lets go, then freed by the writer
+    auto held = manager->getSnapshot();
+    replaced = held;
+    manager->addPreset(createPreset(2, "Third"));
+    held.reset();
+    EXPECT_FALSE(replaced.expired());
+    manager->addPreset(createPreset(3, "Fourth"));
+    EXPECT_TRUE(replaced.expired());
+}
+
+TEST_F(PresetLibrarySnapshotTest, UnchangedBanksAreShared) {
+    manager->initialize();
+    auto before = manager->getSnapshot();
+    manager->addPreset(createPreset(1000, "Not In A Bank"));
+    auto after = manager->getSnapshot();
+
+    EXPECT_GT(after->generation, before->generation);
+    EXPECT_EQ(before->banks, after->banks);
+}
+
+TEST_F(PresetLibrarySnapshotTest, InitializePublishesCompleteLibrary) {
+    manager->initialize();
+    auto snapshot = manager->getSnapshot();
+
+    EXPECT_EQ(snapshot->getNumPresets(), manager->getNumPresets());
+    ASSERT_FALSE(snapshot->banks->empty());
+    EXPECT_EQ((*snapshot->banks)[0].name, "Factory");
+    EXPECT_EQ(snapshot->getBankPresetNames(0), manager->getPresetsForBank(0));
+    EXPECT_TRUE(snapshot->getBankPresetNames(static_cast<int>(snapshot->banks->size())).isEmpty());
+    EXPECT_EQ(manager->getPresetInBank(0, 0)->name, snapshot->getPreset(snapshot->getGlobalPresetIndex(0, 0))->name);
+}
+
+TEST_F(PresetLibrarySnapshotTest, RenamedUserPresetIsNewObject) {
+    manager->initialize();
+    ASSERT_TRUE(manager->addUserPreset(createPreset(0, "Before")));
+    const int userBank = 1;  // right after Factory
+    ASSERT_EQ((*manager->getBanks())[userBank].name, "User");
+    const auto original = manager->getPresetInBank(userBank, 0);
+    ASSERT_NE(original, nullptr);
+
+    ASSERT_TRUE(manager->renameUserPreset(0, "After"));
+    EXPECT_EQ(original->name, "Before");
+    EXPECT_EQ(manager->getPresetInBank(userBank, 0)->name, "After");
+    EXPECT_EQ(manager->getPresetsForBank(userBank), juce::StringArray("After"));
+    EXPECT_TRUE(manager->waitForUserDataWrites(5000));
+}
+
+// =============================================================================
+// 2. Concurrent Readers
+// =============================================================================
+
+TEST_F(PresetLibrarySnapshotTest, ReadersSeeConsistentLibraryWhileWriterChangesIt) {
+    std::atomic<bool> stop { false };
+    std::atomic<int> inconsistencies { 0 };
+    std::atomic<int> reads { 0 };
+
+    auto reader = [&]() {
+        do {
+            auto snapshot = manager->getSnapshot();
+            const int numPresets = snapshot->getNumPresets();
+            if (snapshot->getPresetNames().size() != numPresets)
+                ++inconsistencies;
+
+            for (int i = 0; i < numPresets; ++i) {
+                const auto preset = snapshot->getPreset(i);
+                if (preset == nullptr) {
+                    // A removed preset's slot is empty throughout
+                    if (snapshot->getRegisterImage(i) != nullptr || snapshot->getPresetName(i).isNotEmpty())
+                        ++inconsistencies;
+                    continue;
+                }
+                if (preset->name != snapshot->getPresetName(i)
+                    || !sameImage(preset->toRegisterImage(), *snapshot->getRegisterImage(i)))
+                    ++inconsistencies;
+            }
+            ++reads;
+        } while (!stop.load());
+    };
+
+    std::thread first(reader), second(reader);
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 50; ++i)
+            manager->addPreset(createPreset(i, "Round " + juce::String(round) + " " + juce::String(i)));
+        for (int i = 0; i < 50; i += 3)
+            manager->removePreset(i);
+        if (round % 5 == 4)
+            manager->clear();
+    }
+    stop = true;
+    first.join();
+    second.join();
+
+    EXPECT_GT(reads.load(), 0);
+    EXPECT_EQ(inconsistencies.load(), 0);
+}
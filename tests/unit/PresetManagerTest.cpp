@@ -89,7 +89,7 @@ TEST_F(PresetManagerTest, ConstructorInitializesCorrectly) {
     // Should start with no presets
     EXPECT_EQ(presetManager->getNumPresets(), 0);
     EXPECT_TRUE(presetManager->getPresetNames().isEmpty());
-    EXPECT_TRUE(presetManager->getBanks().empty());
+    EXPECT_TRUE(presetManager->getBanks()->empty());
 }
 
 TEST_F(PresetManagerTest, InitializeLoadsFactoryPresets) {
@@ -126,6 +126,46 @@ TEST_F(PresetManagerTest, FactoryPresetsAreValid) {
     }
 }
 
+TEST_F(PresetManagerTest, DeferredInitializationMatchesInitialize) {
+    // User data with an imported bank, read from disk by both managers
+    presetManager->setUserDataDirectory(tempDir);
+    presetManager->initialize();
+    ASSERT_GT(presetManager->loadOPMFile(createTestOPMFile("Imported.opm", validOPMContent)), 0);
+    presetManager->initialize();
+    
+    PresetManager deferred;
+    deferred.setUserDataDirectory(tempDir);
+    bool readyCalled = false;
+    deferred.initializeAsync([&readyCalled]() { readyCalled = true; });
+    
+    // The factory bank, including Init, is usable before the rest has loaded
+    EXPECT_FALSE(deferred.isLibraryReady());
+    ASSERT_EQ(deferred.getBanks()->size(), 1u);
+    EXPECT_EQ(deferred.getBanks()->front().name, "Factory");
+    ASSERT_NE(deferred.getPreset(7), nullptr);
+    EXPECT_EQ(deferred.getPreset(7)->name, "Init");
+    EXPECT_FALSE(readyCalled);
+    
+    ASSERT_TRUE(deferred.finishInitialization(10000));
+    EXPECT_TRUE(deferred.isLibraryReady());
+    EXPECT_TRUE(readyCalled);
+    EXPECT_EQ(deferred.getNumPresets(), presetManager->getNumPresets());
+    EXPECT_EQ(deferred.getPresetNames(), presetManager->getPresetNames());
+    ASSERT_EQ(deferred.getBanks()->size(), presetManager->getBanks()->size());
+    EXPECT_EQ(deferred.getBanks()->back().name, "Imported");
+}
+
+TEST_F(PresetManagerTest, ChangesDuringDeferredInitializationAreKept) {
+    presetManager->setUserDataDirectory(tempDir);
+    presetManager->initializeAsync(nullptr);
+    
+    // The change waits for the load instead of being replaced by it
+    presetManager->addPreset(createTestPreset(9999, "Added While Loading"));
+    EXPECT_TRUE(presetManager->isLibraryReady());
+    EXPECT_NE(presetManager->getPreset("Added While Loading"), nullptr);
+    EXPECT_TRUE(presetManager->finishInitialization(0));
+}
+
 // =============================================================================
 // 2. OPM File Loading Testing
 // =============================================================================
@@ -184,11 +224,11 @@ TEST_F(PresetManagerTest, LoadOPMFileCreatesBank) {
     presetManager->loadOPMFile(opmFile);
     
     // Should create a bank
-    auto& banks = presetManager->getBanks();
-    EXPECT_EQ(banks.size(), 1);
-    EXPECT_EQ(banks[0].name, "testbank");
-    EXPECT_EQ(banks[0].fileName, "testbank.opm");
-    EXPECT_EQ(banks[0].presetIndices.size(), 2);
+    auto banks = presetManager->getBanks();
+    EXPECT_EQ(banks->size(), 1);
+    EXPECT_EQ((*banks)[0].name, "testbank");
+    EXPECT_EQ((*banks)[0].fileName, "testbank.opm");
+    EXPECT_EQ((*banks)[0].presetIndices.size(), 2);
 }
 
 TEST_F(PresetManagerTest, LoadDuplicateOPMFile) {
@@ -264,10 +304,82 @@ TEST_F(PresetManagerTest, GetNumPresets) {
     EXPECT_EQ(presetManager->getNumPresets(), 2);
 }
 
+TEST_F(PresetManagerTest, GetPresetByNameIsExact) {
+    presetManager->addPreset(createTestPreset(0, "Brass Section"));
+    presetManager->addPreset(createTestPreset(1, "brass section"));
+    
+    auto exact = presetManager->getPreset("brass section");
+    ASSERT_NE(exact, nullptr);
+    EXPECT_EQ(exact->id, 1);
+    EXPECT_EQ(presetManager->getPreset("  BRASS SECTION "), nullptr);
+    
+    // Case and surrounding whitespace are only ignored when asked for, exact matches first
+    auto library = presetManager->getSnapshot();
+    auto normalized = library->findPresetByNormalizedName("  BRASS SECTION ");
+    ASSERT_NE(normalized, nullptr);
+    EXPECT_EQ(normalized->id, 0);
+    ASSERT_NE(library->findPresetByNormalizedName("brass section"), nullptr);
+    EXPECT_EQ(library->findPresetByNormalizedName("brass section")->id, 1);
+}
+
+TEST_F(PresetManagerTest, NameCachesInvalidatedOnMutation) {
+    presetManager->addPreset(createTestPreset(0, "First"));
+    EXPECT_EQ(presetManager->getPresetNames().size(), 1);
+    
+    presetManager->addPreset(createTestPreset(1, "Second"));
+    auto names = presetManager->getPresetNames();
+    EXPECT_EQ(names.size(), 2);
+    EXPECT_TRUE(names.contains("Second"));
+    
+    // Replacing by ID updates both the name list and the name index
+    presetManager->addPreset(createTestPreset(1, "Renamed"));
+    names = presetManager->getPresetNames();
+    EXPECT_EQ(names.size(), 2);
+    EXPECT_FALSE(names.contains("Second"));
+    EXPECT_EQ(presetManager->getPreset("Second"), nullptr);
+    ASSERT_NE(presetManager->getPreset("Renamed"), nullptr);
+    
+    presetManager->removePreset(0);
+    EXPECT_EQ(presetManager->getPreset("First"), nullptr);
+    ASSERT_NE(presetManager->getPreset("Renamed"), nullptr);
+    EXPECT_EQ(presetManager->getPreset("Renamed")->id, 1);
+}
+
 // =============================================================================
 // 4. Preset Management Testing
 // =============================================================================
 
+TEST_F(PresetManagerTest, RegisterImagesCompiledOnAdd) {
+    auto preset = createTestPreset(500, "Image Test");
+    preset.operators[1].detune1 = 6.0f;
+    preset.operators[1].keyScale = 2.0f;
+    preset.operators[1].amsEnable = true;
+    preset.channels[0].ams = 2;
+    preset.channels[0].pms = 5;
+    preset.channels[0].noiseEnable = 1;
+    preset.lfo.noiseFreq = 9;
+    presetManager->addPreset(preset);
+    
+    const int index = presetManager->getNumPresets() - 1;
+    const auto image = presetManager->getRegisterImage(index);
+    ASSERT_NE(image, nullptr);
+    EXPECT_EQ(image->operators[1][0], (6 << 4) | 2);      // DT1/MUL
+    EXPECT_EQ(image->operators[1][1], 25);                // TL
+    EXPECT_EQ(image->operators[1][2], (2 << 6) | 31);     // KS/AR
+    EXPECT_EQ(image->operators[1][3] & 0x80, 0x80);       // AMS-EN
+    EXPECT_EQ(image->connection, (3 << 3) | 4);
+    EXPECT_EQ(image->amsPms, (5 << 4) | 2);
+    EXPECT_EQ(image->noise, 0x80 | 9);
+    
+    // Replacing the preset recompiles its image
+    preset.algorithm = 7;
+    presetManager->addPreset(preset);
+    EXPECT_EQ(presetManager->getRegisterImage(index)->connection, (3 << 3) | 7);
+    
+    EXPECT_EQ(presetManager->getRegisterImage(-1), nullptr);
+    EXPECT_EQ(presetManager->getRegisterImage(presetManager->getNumPresets()), nullptr);
+}
+
 TEST_F(PresetManagerTest, AddPreset) {
     auto testPreset = createTestPreset(42, "Test Preset");
     
@@ -304,7 +416,12 @@ TEST_F(PresetManagerTest, RemovePreset) {
     EXPECT_EQ(presetManager->getNumPresets(), 3);
     
     presetManager->removePreset(1);
-    EXPECT_EQ(presetManager->getNumPresets(), 2);
+    
+    // The slot stays empty so the following preset keeps its index
+    EXPECT_EQ(presetManager->getNumPresets(), 3);
+    EXPECT_EQ(presetManager->getPreset(1), nullptr);
+    ASSERT_NE(presetManager->getPreset(2), nullptr);
+    EXPECT_EQ(presetManager->getPreset(2)->name, "Keep Too");
     
     // Verify the correct preset was removed
     auto names = presetManager->getPresetNames();
@@ -330,7 +447,7 @@ TEST_F(PresetManagerTest, ClearPresets) {
     presetManager->clear();
     EXPECT_EQ(presetManager->getNumPresets(), 0);
     EXPECT_TRUE(presetManager->getPresetNames().isEmpty());
-    EXPECT_TRUE(presetManager->getBanks().empty());
+    EXPECT_TRUE(presetManager->getBanks()->empty());
 }
 
 // =============================================================================
@@ -339,15 +456,15 @@ TEST_F(PresetManagerTest, ClearPresets) {
 
 TEST_F(PresetManagerTest, GetBanks) {
     // Initially no banks
-    EXPECT_TRUE(presetManager->getBanks().empty());
+    EXPECT_TRUE(presetManager->getBanks()->empty());
     
     // Load an OPM file to create a bank
     auto opmFile = createTestOPMFile("testbank.opm", validOPMContent);
     presetManager->loadOPMFile(opmFile);
     
-    auto& banks = presetManager->getBanks();
-    EXPECT_EQ(banks.size(), 1);
-    EXPECT_EQ(banks[0].name, "testbank");
+    auto banks = presetManager->getBanks();
+    EXPECT_EQ(banks->size(), 1);
+    EXPECT_EQ((*banks)[0].name, "testbank");
 }
 
 TEST_F(PresetManagerTest, GetPresetsForBank) {
@@ -595,6 +712,14 @@ TEST_F(PresetManagerTest, HandleManyPresets) {
     auto foundPreset = presetManager->getPreset("Preset 750");
     ASSERT_NE(foundPreset, nullptr);
     EXPECT_EQ(foundPreset->id, 750);
+    
+    // Re-adding every ID replaces in place instead of growing the library
+    for (int i = 0; i < numPresets; ++i) {
+        presetManager->addPreset(createTestPreset(i, "Replaced " + juce::String(i)));
+    }
+    EXPECT_EQ(presetManager->getNumPresets(), numPresets);
+    EXPECT_EQ(presetManager->getPreset("Preset 750"), nullptr);
+    ASSERT_NE(presetManager->getPreset("Replaced 750"), nullptr);
 }
 
 TEST_F(PresetManagerTest, HandleRepeatedInitialization) {
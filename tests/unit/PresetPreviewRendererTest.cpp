@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "dsp/PresetPreviewRenderer.h"
+#include "dsp/PresetPreviewPlayer.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace ymulatorsynth;
+
+class PresetPreviewRendererTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("PresetPreviewRendererTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+
+        settings.holdMs = 200;
+        settings.releaseMs = 100;
+        image = PresetManager().getFactoryPresets()[0].toRegisterImage();
+    }
+
+    void TearDown() override {
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    juce::File tempDir;
+    PreviewSettings settings;
+    RegisterImage image;
+};
+
+// =============================================================================
+// 1. Offline Rendering
+// =============================================================================
+
+TEST_F(PresetPreviewRendererTest, RendersAudibleDeterministicNote) {
+    auto first = PresetPreviewRenderer::render(image, settings);
+    auto second = PresetPreviewRenderer::render(image, settings);
+
+    ASSERT_FALSE(first->samples.empty());
+    EXPECT_LE(first->samples.size(), static_cast<size_t>(settings.sampleRate * 0.3) + 1);
+    EXPECT_TRUE(std::any_of(first->samples.begin(), first->samples.end(),
+                            [](int16_t sample) { return std::abs(sample) > 100; }));
+
+    // Each render has its own chip, so the same input gives the same output
+    EXPECT_EQ(first->samples, second->samples);
+    EXPECT_EQ(first->key, PresetPreviewRenderer::makeKey(image, settings));
+}
+
+TEST_F(PresetPreviewRendererTest, KeyCoversRegistersAndSettings) {
+    const auto key = PresetPreviewRenderer::makeKey(image, settings);
+
+    auto otherImage = image;
+    otherImage.operators[3][1] ^= 0x01;  // carrier TL
+    EXPECT_NE(PresetPreviewRenderer::makeKey(otherImage, settings), key);
+
+    auto otherSettings = settings;
+    otherSettings.note = 72;
+    EXPECT_NE(PresetPreviewRenderer::makeKey(image, otherSettings), key);
+}
+
+// =============================================================================
+// 2. Cache
+// =============================================================================
+
+TEST_F(PresetPreviewRendererTest, BackgroundRenderIsStoredAndReused) {
+    const auto cacheDir = tempDir.getChildFile("previews");
+    std::shared_ptr<const PresetPreview> rendered;
+    {
+        PresetPreviewRenderer renderer(cacheDir, settings);
+        EXPECT_EQ(renderer.getCachedPreview(image), nullptr);
+
+        juce::WaitableEvent done;
+        renderer.requestPreview(image, [&](std::shared_ptr<const PresetPreview> preview) {
+            rendered = preview;
+            done.signal();
+        });
+        ASSERT_TRUE(done.wait(10000));
+        ASSERT_NE(rendered, nullptr);
+        EXPECT_TRUE(renderer.getCacheFile(rendered->key).existsAsFile());
+    }
+
+    // A new renderer finds the preview on disk and delivers it without rendering
+    PresetPreviewRenderer renderer(cacheDir, settings);
+    auto cached = renderer.getCachedPreview(image);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->samples, rendered->samples);
+    EXPECT_DOUBLE_EQ(cached->sampleRate, settings.sampleRate);
+
+    bool deliveredImmediately = false;
+    renderer.requestPreview(image, [&](std::shared_ptr<const PresetPreview>) { deliveredImmediately = true; });
+    EXPECT_TRUE(deliveredImmediately);
+}
+
+TEST_F(PresetPreviewRendererTest, RenderMissingSkipsCachedImages) {
+    const auto presets = PresetManager().getFactoryPresets();
+    std::vector<RegisterImage> images;
+    for (const auto& preset : presets)
+        images.push_back(preset.toRegisterImage());
+
+    PresetPreviewRenderer renderer(tempDir.getChildFile("previews"), settings);
+    renderer.renderMissing(images);
+    for (int i = 0; i < 1000 && renderer.getNumPendingRenders() > 0; ++i)
+        juce::Thread::sleep(10);
+    ASSERT_EQ(renderer.getNumPendingRenders(), 0);
+
+    for (const auto& renderedImage : images)
+        EXPECT_TRUE(renderer.getCacheFile(PresetPreviewRenderer::makeKey(renderedImage, settings)).existsAsFile());
+
+    renderer.renderMissing(images);
+    EXPECT_EQ(renderer.getNumPendingRenders(), 0);
+}
+
+TEST_F(PresetPreviewRendererTest, MemoryKeepsRecentlyUsedPreviews) {
+    PresetPreviewRenderer renderer(tempDir.getChildFile("previews"), settings);
+    juce::WaitableEvent done;
+    renderer.requestPreview(image, [&](std::shared_ptr<const PresetPreview>) { done.signal(); });
+    ASSERT_TRUE(done.wait(10000));
+    const auto file = renderer.getCacheFile(PresetPreviewRenderer::makeKey(image, settings));
+
+    // Other previews on disk, loaded into memory one by one
+    std::vector<RegisterImage> others;
+    for (int i = 0; i < PresetPreviewRenderer::MaxPreviewsInMemory; ++i) {
+        auto other = image;
+        other.operators[3][1] = static_cast<uint8_t>(image.operators[3][1] ^ (i + 1));
+        ASSERT_TRUE(file.copyFileTo(renderer.getCacheFile(PresetPreviewRenderer::makeKey(other, settings))));
+        others.push_back(other);
+    }
+    for (int i = 0; i < PresetPreviewRenderer::MaxPreviewsInMemory - 1; ++i)
+        ASSERT_NE(renderer.getCachedPreview(others[static_cast<size_t>(i)]), nullptr);
+
+    // Used again before the memory fills up, the first preview outlives the next one loaded
+    ASSERT_NE(renderer.getCachedPreview(image), nullptr);
+    ASSERT_NE(renderer.getCachedPreview(others.back()), nullptr);
+
+    ASSERT_TRUE(file.deleteFile());
+    ASSERT_TRUE(renderer.getCacheFile(PresetPreviewRenderer::makeKey(others.front(), settings)).deleteFile());
+    EXPECT_NE(renderer.getCachedPreview(image), nullptr);
+    EXPECT_EQ(renderer.getCachedPreview(others.front()), nullptr);
+}
+
+// =============================================================================
+// 3. Playback
+// =============================================================================
+
+TEST_F(PresetPreviewRendererTest, PlayerMixesPreviewUntilItEnds) {
+    auto preview = std::make_shared<PresetPreview>();
+    preview->samples = { 16384, -16384, 8192 };
+
+    PresetPreviewPlayer player;
+    player.play(preview, 1.0f);
+    EXPECT_TRUE(player.isPlaying());
+
+    float left[2] = { 0.25f, 0.25f };
+    float right[2] = { 0.0f, 0.0f };
+    player.renderNextBlock(left, right, 2);
+    EXPECT_FLOAT_EQ(left[0], 0.75f);
+    EXPECT_FLOAT_EQ(left[1], -0.25f);
+    EXPECT_FLOAT_EQ(right[0], 0.5f);
+    EXPECT_TRUE(player.isPlaying());
+
+    float tail[4] = {};
+    player.renderNextBlock(tail, tail, 4);
+    EXPECT_FLOAT_EQ(tail[0], 0.25f);
+    EXPECT_FLOAT_EQ(tail[1], 0.0f);
+    EXPECT_FALSE(player.isPlaying());
+
+    player.play(preview, 1.0f);
+    player.stop();
+    EXPECT_FALSE(player.isPlaying());
+}
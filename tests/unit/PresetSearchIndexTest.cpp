@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "utils/PresetSearchIndex.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class PresetSearchIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        documents = {
+            makeDocument("Electric Piano", "Factory", 4, 6, false, false),
+            makeDocument("Synth Bass", "Factory", 6, 7, false, false),
+            makeDocument("Noise Snare", "Drums", 7, 0, true, false),
+            makeDocument("Vibrato Lead", "Leads", 4, 3, false, true),
+            makeDocument("Utopia Pad", "Pads", 2, 0, false, true),
+        };
+        index = std::make_unique<PresetSearchIndex>(documents, 1);
+    }
+
+    static PresetSearchIndex::Document makeDocument(const juce::String& name, const juce::String& bank,
+                                                    int algorithm, int feedback, bool noise, bool lfo) {
+        PresetSearchIndex::Document doc;
+        doc.name = name;
+        doc.bankName = bank;
+        doc.tags = PresetSearchIndex::makeTags(algorithm, feedback, noise, lfo);
+        return doc;
+    }
+
+    std::vector<PresetSearchIndex::Document> documents;
+    std::unique_ptr<PresetSearchIndex> index;
+};
+
+// =============================================================================
+// 1. Text Queries
+// =============================================================================
+
+TEST_F(PresetSearchIndexTest, SubstringMatchesNameAndBank) {
+    EXPECT_EQ(index->search("piano", 10), std::vector<int>({ 0 }));
+    EXPECT_EQ(index->search("ACTOR", 10), std::vector<int>({ 0, 1 }));   // "Factory", case-insensitive
+    EXPECT_EQ(index->search("bass fact", 10), std::vector<int>({ 1 }));  // all terms must match
+    EXPECT_TRUE(index->search("xylophone", 10).empty());
+}
+
+TEST_F(PresetSearchIndexTest, ShortTermsMatchWordPrefixes) {
+    EXPECT_EQ(index->search("p", 10), std::vector<int>({ 0, 4 }));   // Piano, Pad/Pads
+    EXPECT_EQ(index->search("pi", 10), std::vector<int>({ 0 }));     // not "Utopia"
+    EXPECT_EQ(index->search("pia", 10), std::vector<int>({ 0, 4 })); // substring from three characters
+}
+
+TEST_F(PresetSearchIndexTest, MaxResultsLimitsOutput) {
+    EXPECT_TRUE(index->search("a", 10).empty()); // no word starts with "a"
+    EXPECT_EQ(index->search("s", 10).size(), 2u); // Synth, Snare
+    EXPECT_EQ(index->search("s", 1), std::vector<int>({ 1 }));
+}
+
+// =============================================================================
+// 2. Tag Queries
+// =============================================================================
+
+TEST_F(PresetSearchIndexTest, TagQueries) {
+    EXPECT_EQ(index->search("alg:4", 10), std::vector<int>({ 0, 3 }));
+    EXPECT_EQ(index->search("fb:0", 10), std::vector<int>({ 2, 4 }));
+    EXPECT_EQ(index->search("is:noise", 10), std::vector<int>({ 2 }));
+    EXPECT_EQ(index->search("is:lfo alg:2", 10), std::vector<int>({ 4 }));
+    EXPECT_EQ(index->search("is:lfo lead", 10), std::vector<int>({ 3 }));
+}
+
+TEST_F(PresetSearchIndexTest, InvalidTagIsTreatedAsText) {
+    EXPECT_TRUE(index->search("alg:9", 10).empty());
+}
+
+// =============================================================================
+// 3. Incremental Refinement and Fallback
+// =============================================================================
+
+TEST_F(PresetSearchIndexTest, RefineNarrowsPreviousResults) {
+    auto first = index->search("lea", 10);
+    EXPECT_EQ(first, std::vector<int>({ 3 }));
+    EXPECT_EQ(index->refine(first, "lead", 10), std::vector<int>({ 3 }));
+    EXPECT_TRUE(index->refine(first, "leaf", 10).empty());
+}
+
+TEST_F(PresetSearchIndexTest, LinearMatchAgreesWithIndex) {
+    const juce::StringArray queries { "piano", "p", "pi", "alg:4", "is:lfo pad", "drums", "zzz" };
+
+    for (const auto& q : queries) {
+        const auto parsed = PresetSearchIndex::parseQuery(q);
+        std::vector<int> linear;
+        for (int i = 0; i < static_cast<int>(documents.size()); ++i) {
+            if (PresetSearchIndex::matches(documents[static_cast<size_t>(i)], parsed))
+                linear.push_back(i);
+        }
+        EXPECT_EQ(index->search(q, 100), linear) << "query: " << q;
+    }
+}
+
+TEST_F(PresetSearchIndexTest, PunctuationAndCaseMatchTheSameOnBothPaths) {
+    documents.push_back(makeDocument("E-Piano MkII", "User", 4, 0, false, false));
+    documents.push_back(makeDocument("-Init-", "User", 0, 0, false, false));
+    PresetSearchIndex withPunctuation(documents, 2);
+
+    const juce::StringArray queries { "e-", "E-P", "mkii", "Init-", "USER", "p" };
+    for (const auto& q : queries) {
+        const auto parsed = PresetSearchIndex::parseQuery(q);
+        std::vector<int> linear;
+        for (int i = 0; i < static_cast<int>(documents.size()); ++i) {
+            // Names are matched as stored, without normalizing them first
+            const auto& doc = documents[static_cast<size_t>(i)];
+            if (PresetSearchIndex::matches(doc.name, doc.bankName, doc.tags, parsed))
+                linear.push_back(i);
+        }
+        EXPECT_FALSE(linear.empty()) << "query: " << q;
+        EXPECT_EQ(withPunctuation.search(q, 100), linear) << "query: " << q;
+    }
+}
+
+// =============================================================================
+// 4. PresetManager Integration
+// =============================================================================
+
+TEST_F(PresetSearchIndexTest, PresetManagerSearchesBeforeAndAfterIndexBuild) {
+    PresetManager manager;
+    manager.initialize();
+
+    // Results are correct even before the background index is ready
+    auto results = manager.searchPresets("bass", 50);
+    ASSERT_FALSE(results.empty());
+    EXPECT_TRUE(manager.getPreset(results.front())->name.containsIgnoreCase("bass"));
+
+    ASSERT_TRUE(manager.waitForSearchIndex(5000));
+    EXPECT_EQ(manager.searchPresets("bass", 50), results);
+
+    // Mutations make the index stale until it is rebuilt
+    Preset extra;
+    extra.id = 100000;
+    extra.name = "Searchable Bass Patch";
+    manager.addPreset(extra);
+    EXPECT_FALSE(manager.isSearchIndexReady());
+
+    auto updated = manager.searchPresets("searchable", 50);
+    ASSERT_EQ(updated.size(), 1u);
+    EXPECT_EQ(manager.getPreset(updated.front())->name, "Searchable Bass Patch");
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "utils/PresetSimilarityIndex.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class PresetSimilarityIndexTest : public ::testing::Test {
+protected:
+    // Random but valid preset, reproducible from the seed
+    static Preset makeRandomPreset(juce::Random& random) {
+        Preset preset;
+        preset.algorithm = random.nextInt(8);
+        preset.feedback = random.nextInt(8);
+        preset.lfo.amd = random.nextBool() ? random.nextInt(128) : 0;
+        preset.lfo.rate = random.nextInt(256);
+        for (auto& op : preset.operators) {
+            op.totalLevel = static_cast<float>(random.nextInt(128));
+            op.attackRate = static_cast<float>(random.nextInt(32));
+            op.decay1Rate = static_cast<float>(random.nextInt(32));
+            op.releaseRate = static_cast<float>(random.nextInt(16));
+            op.sustainLevel = static_cast<float>(random.nextInt(16));
+            op.multiple = static_cast<float>(random.nextInt(16));
+            op.detune1 = static_cast<float>(random.nextInt(8));
+        }
+        return preset;
+    }
+};
+
+// =============================================================================
+// 1. Feature Extraction
+// =============================================================================
+
+TEST_F(PresetSimilarityIndexTest, IdenticalSoundsHaveZeroDistance) {
+    auto presets = PresetManager::createFactoryPresets();
+    auto a = presets[0];
+    auto b = presets[0];
+    b.name = "Renamed copy";
+    b.id = 1234;
+
+    EXPECT_EQ(PresetSimilarityIndex::distanceSquared(PresetSimilarityIndex::extractFeatures(a),
+                                                     PresetSimilarityIndex::extractFeatures(b)), 0u);
+}
+
+TEST_F(PresetSimilarityIndexTest, CarrierAndModulatorWeightedDifferently) {
+    Preset base;
+    base.algorithm = 4;  // operators 2 and 3 are carriers, 0 and 1 modulators
+
+    auto modulatorChanged = base;
+    modulatorChanged.operators[0].multiple = 8.0f;
+    auto carrierChanged = base;
+    carrierChanged.operators[2].multiple = 8.0f;
+
+    const auto f = PresetSimilarityIndex::extractFeatures(base);
+    const auto fm = PresetSimilarityIndex::extractFeatures(modulatorChanged);
+    const auto fc = PresetSimilarityIndex::extractFeatures(carrierChanged);
+
+    // MUL moves the spectrum more on a modulator than on a carrier
+    EXPECT_GT(PresetSimilarityIndex::distanceSquared(f, fm), PresetSimilarityIndex::distanceSquared(f, fc));
+}
+
+TEST_F(PresetSimilarityIndexTest, Detune1ZeroAndFourAreEquivalent) {
+    Preset a, b;
+    a.operators[1].detune1 = 0.0f;
+    b.operators[1].detune1 = 4.0f;
+    EXPECT_EQ(PresetSimilarityIndex::extractFeatures(a), PresetSimilarityIndex::extractFeatures(b));
+}
+
+// =============================================================================
+// 2. Nearest Neighbour Queries
+// =============================================================================
+
+TEST_F(PresetSimilarityIndexTest, TreeMatchesBruteForce) {
+    juce::Random random(42);
+    std::vector<PresetSimilarityIndex::FeatureVector> features;
+    for (int i = 0; i < 2000; ++i)
+        features.push_back(PresetSimilarityIndex::extractFeatures(makeRandomPreset(random)));
+
+    PresetSimilarityIndex index(features, 1);
+    EXPECT_EQ(index.getNumPresets(), 2000);
+
+    for (int q = 0; q < 20; ++q) {
+        const auto query = PresetSimilarityIndex::extractFeatures(makeRandomPreset(random));
+        auto fromTree = index.findNearest(query, 5);
+        auto bruteForce = PresetSimilarityIndex::findNearestLinear(features, query, 5);
+
+        ASSERT_EQ(fromTree.size(), 5u);
+        ASSERT_EQ(bruteForce.size(), 5u);
+        for (size_t i = 0; i < 5; ++i)
+            EXPECT_FLOAT_EQ(fromTree[i].distance, bruteForce[i].distance);
+    }
+}
+
+TEST_F(PresetSimilarityIndexTest, ExcludesQueryPreset) {
+    juce::Random random(7);
+    std::vector<PresetSimilarityIndex::FeatureVector> features;
+    for (int i = 0; i < 50; ++i)
+        features.push_back(PresetSimilarityIndex::extractFeatures(makeRandomPreset(random)));
+
+    PresetSimilarityIndex index(features, 1);
+    auto withSelf = index.findNearest(features[10], 3);
+    ASSERT_FALSE(withSelf.empty());
+    EXPECT_EQ(withSelf.front().presetIndex, 10);
+    EXPECT_FLOAT_EQ(withSelf.front().distance, 0.0f);
+
+    for (const auto& n : index.findNearest(features[10], 3, 10))
+        EXPECT_NE(n.presetIndex, 10);
+}
+
+TEST_F(PresetSimilarityIndexTest, PresetManagerFindsRenamedDuplicate) {
+    PresetManager manager;
+    for (const auto& preset : PresetManager::createFactoryPresets())
+        manager.addPreset(preset);
+
+    auto copy = *manager.getPreset(2);
+    copy.id = 100;
+    copy.name = "Brass Copy";
+    copy.operators[0].totalLevel += 1.0f;  // nearly identical
+    manager.addPreset(copy);
+
+    auto similar = manager.findSimilarPresets(2, 3);
+    ASSERT_FALSE(similar.empty());
+    EXPECT_EQ(manager.getPreset(similar.front())->name, "Brass Copy");
+}
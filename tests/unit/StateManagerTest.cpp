@@ -3,6 +3,7 @@
 #include "../mocks/MockAudioProcessorHost.h"
 #include "../../src/utils/ParameterIDs.h"
 #include "../../src/utils/Debug.h"
+#include <cstring>
 
 using namespace ymulatorsynth;
 
@@ -383,4 +384,274 @@ TEST_F(StateManagerTest, ProcessorDestructionCleansUp) {
     // Destruction should be clean
     EXPECT_NO_THROW(tempProcessor.reset());
     EXPECT_NO_THROW(tempHost.reset());
-}
\ No newline at end of file
+}
+// ============================================================================
+// Binary State Format Tests
+// ============================================================================
+
+TEST_F(StateManagerTest, BinaryStateIsSmallerThanXml) {
+    processor->setCurrentProgram(3);
+    
+    juce::MemoryBlock binaryState;
+    processor->getStateInformation(binaryState);
+    ASSERT_GE(binaryState.getSize(), 4u);
+    EXPECT_EQ(juce::ByteOrder::littleEndianInt(binaryState.getData()), 0x54534d59u);  // "YMST"
+    
+    juce::MemoryBlock xmlState;
+    auto xml = processor->getParameters().copyState().createXml();
+    juce::AudioProcessor::copyXmlToBinary(*xml, xmlState);
+    EXPECT_LT(binaryState.getSize() * 4, xmlState.getSize());
+}
+
+TEST_F(StateManagerTest, BinaryStateRestoresPresetAndEdits) {
+    auto& parameters = processor->getParameters();
+    processor->setCurrentProgram(3);
+    auto* tlParam = parameters.getParameter(ParamID::Op::tl(1));
+    auto* algParam = parameters.getParameter(ParamID::Global::Algorithm);
+    const float presetTl = tlParam->getValue();
+    algParam->setValueNotifyingHost(algParam->convertTo0to1(5.0f));
+    processor->setCustomMode(true, "Edited");
+    
+    juce::MemoryBlock savedState;
+    processor->getStateInformation(savedState);
+    
+    processor->setCurrentProgram(1);
+    algParam->setValueNotifyingHost(algParam->convertTo0to1(0.0f));
+    
+    processor->setStateInformation(savedState.getData(), static_cast<int>(savedState.getSize()));
+    
+    // Values from the reference preset and the stored delta both come back
+    EXPECT_FLOAT_EQ(tlParam->getValue(), presetTl);
+    EXPECT_FLOAT_EQ(algParam->convertFrom0to1(algParam->getValue()), 5.0f);
+    EXPECT_TRUE(processor->isInCustomMode());
+    EXPECT_EQ(processor->getCustomPresetName(), "Edited");
+    EXPECT_EQ(processor->getCurrentProgram(), processor->getNumPrograms() - 1);  // custom slot
+}
+
+TEST_F(StateManagerTest, StateSurvivesRemovalOfItsPreset) {
+    // A preset that exists only in this session, e.g. one received as SysEx
+    auto& presetManager = processor->getPresetManager();
+    auto preset = PresetManager::createFactoryPresets()[2];
+    preset.name = "Session Only";
+    preset.algorithm = 6;
+    preset.feedback = 3;
+    preset.operators[0].totalLevel = 42;
+    preset.lfo.rate = 123;
+    const int index = presetManager.addReceivedPresets("Session", { preset });
+    ASSERT_GE(index, 0);
+    processor->setCurrentPreset(index);
+    
+    auto& parameters = processor->getParameters();
+    auto* fbParam = parameters.getParameter(ParamID::Global::Feedback);
+    fbParam->setValueNotifyingHost(fbParam->convertTo0to1(5.0f));
+    
+    std::vector<float> savedValues;
+    for (auto* param : processor->getParameters().processor.getParameters()) {
+        savedValues.push_back(param->getValue());
+    }
+    juce::MemoryBlock savedState;
+    processor->getStateInformation(savedState);
+    
+    // The next session no longer has the preset
+    presetManager.removePreset(presetManager.getSnapshot()->getPreset(index)->id);
+    processor->setCurrentProgram(1);
+    
+    processor->setStateInformation(savedState.getData(), static_cast<int>(savedState.getSize()));
+    const auto& allParams = processor->getParameters().processor.getParameters();
+    ASSERT_EQ(static_cast<size_t>(allParams.size()), savedValues.size());
+    for (int i = 0; i < allParams.size(); ++i) {
+        EXPECT_FLOAT_EQ(allParams[i]->getValue(), savedValues[static_cast<size_t>(i)]) << allParams[i]->getName(64);
+    }
+}
+
+TEST_F(StateManagerTest, HostProgramsSkipRemovedPresets) {
+    auto& presetManager = processor->getPresetManager();
+    auto removed = PresetManager::createFactoryPresets()[2];
+    removed.name = "Removed";
+    auto kept = removed;
+    kept.name = "Kept";
+    const int first = presetManager.addReceivedPresets("Session", { removed, kept });
+    ASSERT_GE(first, 0);
+    const int numPrograms = processor->getNumPrograms();
+    
+    presetManager.removePreset(presetManager.getSnapshot()->getPreset(first)->id);
+    
+    // The host sees one program fewer, and the preset after the gap takes its number
+    EXPECT_EQ(processor->getNumPrograms(), numPrograms - 1);
+    EXPECT_EQ(processor->getProgramName(first), "Kept");
+    for (int program = 0; program < processor->getNumPrograms(); ++program) {
+        EXPECT_FALSE(processor->getProgramName(program).isEmpty()) << program;
+    }
+    
+    processor->setCurrentProgram(first);
+    EXPECT_EQ(processor->getCurrentPresetIndex(), first + 1);
+    EXPECT_EQ(processor->getCurrentProgram(), first);
+}
+
+TEST_F(StateManagerTest, MultitimbralPartsAreSavedWithTheState) {
+    auto* parts = processor->getPartManager();
+    ASSERT_NE(parts, nullptr);
+    processor->setMultitimbralMode(true);
+    ASSERT_TRUE(processor->setPartPreset(1, 3));
+    
+    auto split = parts->getPart(1);
+    split.midiChannel = 0;
+    split.channelMask = 0x0c;
+    split.lowNote = 60;
+    split.highNote = 96;
+    split.lowVelocity = 40;
+    split.highVelocity = 110;
+    split.volume = 0.5f;
+    split.pan = 1.0f;
+    ASSERT_TRUE(parts->setPart(1, split));
+    
+    juce::MemoryBlock savedState;
+    processor->getStateInformation(savedState);
+    
+    // Back to single mode with default parts, then reload
+    processor->setMultitimbralMode(false);
+    ASSERT_TRUE(parts->setPart(1, PartManager::makeDefaultPart(1)));
+    processor->setStateInformation(savedState.getData(), static_cast<int>(savedState.getSize()));
+    
+    EXPECT_TRUE(parts->isEnabled());
+    const auto& restored = parts->getPart(1);
+    EXPECT_EQ(restored.midiChannel, 0);
+    EXPECT_EQ(restored.channelMask, 0x0c);
+    EXPECT_EQ(restored.lowNote, 60);
+    EXPECT_EQ(restored.highNote, 96);
+    EXPECT_EQ(restored.lowVelocity, 40);
+    EXPECT_EQ(restored.highVelocity, 110);
+    EXPECT_FLOAT_EQ(restored.volume, 0.5f);
+    EXPECT_FLOAT_EQ(restored.pan, 1.0f);
+    EXPECT_EQ(restored.presetIndex, 3);
+    EXPECT_EQ(std::memcmp(&restored.image, processor->getPresetManager().getSnapshot()->getRegisterImage(3),
+                          sizeof(RegisterImage)), 0);
+}
+
+TEST_F(StateManagerTest, StatesWithoutPartsRestoreSingleMode) {
+    // A version 2 state ends after the MIDI mappings
+    juce::MemoryBlock savedState;
+    processor->getStateInformation(savedState);
+    const int numParts = PartManager::NumParts;
+    const size_t partsSize = 2 + static_cast<size_t>(numParts) * (6 + 4 + 4 + 4 + sizeof(RegisterImage));
+    ASSERT_GT(savedState.getSize(), partsSize);
+    juce::MemoryBlock versionTwo(savedState.getData(), savedState.getSize() - partsSize);
+    static_cast<uint8_t*>(versionTwo.getData())[4] = 2;
+    
+    processor->setMultitimbralMode(true);
+    processor->setStateInformation(versionTwo.getData(), static_cast<int>(versionTwo.getSize()));
+    EXPECT_FALSE(processor->getPartManager()->isEnabled());
+    EXPECT_EQ(processor->getPartManager()->getPart(2).midiChannel, 2);
+}
+
+TEST_F(StateManagerTest, XmlStateFromOlderSessionsIsRead) {
+    auto& parameters = processor->getParameters();
+    auto state = parameters.copyState();
+    state.setProperty("currentPreset", 2, nullptr);
+    state.setProperty("isCustomPreset", true, nullptr);
+    state.setProperty("customPresetName", "Old Session", nullptr);
+    auto* fbParam = parameters.getParameter(ParamID::Global::Feedback);
+    for (auto child : state) {
+        if (child.getProperty("id").toString() == ParamID::Global::Feedback) {
+            child.setProperty("value", 6.0f, nullptr);
+        }
+    }
+    
+    juce::MemoryBlock xmlState;
+    juce::AudioProcessor::copyXmlToBinary(*state.createXml(), xmlState);
+    processor->setStateInformation(xmlState.getData(), static_cast<int>(xmlState.getSize()));
+    
+    EXPECT_FLOAT_EQ(fbParam->convertFrom0to1(fbParam->getValue()), 6.0f);
+    EXPECT_TRUE(processor->isInCustomMode());
+    EXPECT_EQ(processor->getCustomPresetName(), "Old Session");
+}
+
+TEST_F(StateManagerTest, TruncatedBinaryStateIsIgnored) {
+    auto& parameters = processor->getParameters();
+    processor->setCurrentProgram(3);
+    auto* algParam = parameters.getParameter(ParamID::Global::Algorithm);
+    algParam->setValueNotifyingHost(algParam->convertTo0to1(6.0f));
+    
+    juce::MemoryBlock savedState;
+    processor->getStateInformation(savedState);
+    
+    algParam->setValueNotifyingHost(algParam->convertTo0to1(2.0f));
+    for (size_t size = 4; size < savedState.getSize(); size += 3) {
+        EXPECT_NO_THROW(processor->setStateInformation(savedState.getData(), static_cast<int>(size)));
+    }
+    EXPECT_FLOAT_EQ(algParam->convertFrom0to1(algParam->getValue()), 2.0f);
+}
+
+// ============================================================================
+// Deferred Library Tests
+// ============================================================================
+
+namespace {
+    // A user data folder holding one imported bank, as a previous session left it
+    juce::File createUserDataWithImportedBank() {
+        auto directory = juce::File::createTempFile("StateManagerTest");
+        directory.deleteFile();
+        directory.createDirectory();
+        
+        auto voice = PresetManager::createFactoryPresets()[1].toVOPM();
+        voice.name = "Imported";
+        auto bankFile = directory.getChildFile("Imported.opm");
+        bankFile.replaceWithText(VOPMParser::voiceToString(voice));
+        
+        PresetManager setup;
+        setup.setUserDataDirectory(directory);
+        setup.loadOPMFile(bankFile);
+        return directory;
+    }
+}
+
+TEST_F(StateManagerTest, ProgramRequestWaitsForDeferredLibrary) {
+    auto userData = createUserDataWithImportedBank();
+    {
+        PresetManager library;
+        library.setUserDataDirectory(userData);
+        StateManager state(processor->getParameters(), library, processor->getParameterManager());
+        library.initializeAsync([&state]() { state.handlePresetLibraryReady(); });
+        
+        // Only the factory presets are there; a later program is queued
+        ASSERT_FALSE(library.isLibraryReady());
+        const int firstLoadedLater = library.getNumPresets();
+        state.setCurrentProgram(firstLoadedLater);
+        EXPECT_EQ(state.getCurrentProgram(), 7);
+        
+        ASSERT_TRUE(library.finishInitialization(10000));
+        EXPECT_TRUE(library.isLibraryReady());
+        EXPECT_GT(library.getNumPresets(), firstLoadedLater);
+        EXPECT_EQ(state.getCurrentProgram(), firstLoadedLater);
+    }
+    userData.deleteRecursively();
+}
+
+TEST_F(StateManagerTest, StateRestoreWaitsForDeferredLibrary) {
+    auto& parameters = processor->getParameters();
+    auto* algParam = parameters.getParameter(ParamID::Global::Algorithm);
+    processor->setCurrentProgram(3);
+    algParam->setValueNotifyingHost(algParam->convertTo0to1(5.0f));
+    
+    juce::MemoryBlock savedState;
+    processor->getStateInformation(savedState);
+    processor->setCurrentProgram(1);
+    algParam->setValueNotifyingHost(algParam->convertTo0to1(0.0f));
+    
+    PresetManager library;
+    library.setUserDataDirectory(juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("StateManagerTestEmpty"));
+    StateManager state(parameters, library, processor->getParameterManager());
+    library.initializeAsync([&state]() { state.handlePresetLibraryReady(); });
+    
+    state.setStateInformation(savedState.getData(), static_cast<int>(savedState.getSize()));
+    EXPECT_FLOAT_EQ(algParam->convertFrom0to1(algParam->getValue()), 0.0f);
+    
+    // Saving in the meantime keeps the state that is still waiting
+    juce::MemoryBlock stateWhileLoading;
+    state.getStateInformation(stateWhileLoading);
+    EXPECT_EQ(stateWhileLoading, savedState);
+    
+    ASSERT_TRUE(library.finishInitialization(10000));
+    EXPECT_FLOAT_EQ(algParam->convertFrom0to1(algParam->getValue()), 5.0f);
+    EXPECT_EQ(state.getCurrentProgram(), 3);
+}
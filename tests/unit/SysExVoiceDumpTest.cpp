@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "utils/SysExVoiceDump.h"
+#include "utils/PresetManager.h"
+#include "core/SysExReceiver.h"
+#include "../mocks/TestVoices.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+
+using namespace ymulatorsynth;
+
+class SysExVoiceDumpTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("SysExVoiceDumpTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+
+        manager = std::make_unique<PresetManager>();
+        manager->setUserDataDirectory(tempDir.getChildFile("user"));
+        manager->initialize();
+    }
+
+    void TearDown() override {
+        manager.reset();
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    static VOPMVoice createVoice(int number, const juce::String& name) {
+        return YMulatorSynth::Test::createTestVoice(number, name, 2);
+    }
+
+    static SysExVoiceDump::Result parse(const juce::MemoryBlock& message) {
+        return SysExVoiceDump::parse(static_cast<const uint8_t*>(message.getData()), static_cast<int>(message.getSize()));
+    }
+
+    std::unique_ptr<PresetManager> manager;
+    juce::File tempDir;
+};
+
+// =============================================================================
+// 1. Format
+// =============================================================================
+
+TEST_F(SysExVoiceDumpTest, VoiceDumpRoundTrips) {
+    const auto voice = createVoice(5, "Brass 1");
+    const auto message = SysExVoiceDump::createVoiceDump(voice);
+
+    const auto* bytes = static_cast<const uint8_t*>(message.getData());
+    ASSERT_EQ(message.getSize(), static_cast<size_t>(SysExVoiceDump::HeaderSize + SysExVoiceDump::VoiceRecordSize + 2));
+    EXPECT_EQ(bytes[0], 0xF0);
+    EXPECT_EQ(bytes[1], SysExVoiceDump::ManufacturerId);
+    EXPECT_EQ(bytes[message.getSize() - 1], 0xF7);
+    for (size_t i = 1; i + 1 < message.getSize(); ++i) {
+        EXPECT_LT(bytes[i], 0x80) << "at " << i;
+    }
+
+    const auto result = parse(message);
+    ASSERT_TRUE(result.isValid) << result.error;
+    EXPECT_EQ(result.type, SysExVoiceDump::Type::Voice);
+    ASSERT_EQ(result.voices.size(), 1u);
+
+    // Written back as the same OPM text
+    auto expected = voice;
+    expected.number = 0;
+    EXPECT_EQ(VOPMParser::voiceToString(result.voices[0]), VOPMParser::voiceToString(expected));
+}
+
+TEST_F(SysExVoiceDumpTest, BankDumpHoldsAll128Voices) {
+    std::vector<VOPMVoice> voices;
+    for (int i = 0; i < SysExVoiceDump::MaxBankVoices; ++i) {
+        voices.push_back(createVoice(i, "Voice " + juce::String(i)));
+    }
+
+    const auto result = parse(SysExVoiceDump::createBankDump(voices));
+    ASSERT_TRUE(result.isValid) << result.error;
+    EXPECT_EQ(result.type, SysExVoiceDump::Type::Bank);
+    ASSERT_EQ(result.voices.size(), voices.size());
+    EXPECT_EQ(VOPMParser::voiceToString(result.voices[127]), VOPMParser::voiceToString(voices[127]));
+}
+
+TEST_F(SysExVoiceDumpTest, OpmTextDumpUsesTheFileParser) {
+    const auto text = VOPMParser::voiceToString(createVoice(3, "Strings")) + "\n"
+                    + VOPMParser::voiceToString(createVoice(4, "Organ"));
+
+    const auto result = parse(SysExVoiceDump::createOpmTextDump(text));
+    ASSERT_TRUE(result.isValid) << result.error;
+    EXPECT_EQ(result.type, SysExVoiceDump::Type::OpmText);
+    ASSERT_EQ(result.voices.size(), 2u);
+    EXPECT_EQ(result.voices[1].name, "Organ");
+}
+
+// =============================================================================
+// 2. Rejection
+// =============================================================================
+
+TEST_F(SysExVoiceDumpTest, RejectsCorruptMessages) {
+    auto message = SysExVoiceDump::createVoiceDump(createVoice(1, "Bass"));
+    auto* bytes = static_cast<uint8_t*>(message.getData());
+
+    // A changed data byte no longer matches the checksum
+    bytes[SysExVoiceDump::HeaderSize + 20] ^= 0x01;
+    EXPECT_FALSE(parse(message).isValid);
+    bytes[SysExVoiceDump::HeaderSize + 20] ^= 0x01;
+    EXPECT_TRUE(parse(message).isValid);
+
+    // Truncated
+    juce::MemoryBlock truncated(message.getData(), message.getSize() - 10);
+    EXPECT_FALSE(parse(truncated).isValid);
+
+    // Another manufacturer's message
+    bytes[1] = 0x43;
+    EXPECT_FALSE(SysExVoiceDump::isYMulatorMessage(bytes, static_cast<int>(message.getSize())));
+    EXPECT_FALSE(parse(message).isValid);
+}
+
+// =============================================================================
+// 3. Receiving
+// =============================================================================
+
+TEST_F(SysExVoiceDumpTest, ReceiverPublishesDumpsAsBanks) {
+    SysExReceiver receiver(*manager);
+    int selected = -1;
+    receiver.onDumpReceived = [&selected](int index, bool isSingleVoice) {
+        if (isSingleVoice) {
+            selected = index;
+        }
+    };
+
+    std::vector<VOPMVoice> voices;
+    for (int i = 0; i < SysExVoiceDump::MaxBankVoices; ++i) {
+        voices.push_back(createVoice(i, "Voice " + juce::String(i)));
+    }
+    const auto bank = SysExVoiceDump::createBankDump(voices);
+    const auto voice = SysExVoiceDump::createVoiceDump(createVoice(9, "Lead"));
+    auto corrupt = voice;
+    static_cast<uint8_t*>(corrupt.getData())[SysExVoiceDump::HeaderSize] ^= 0x01;
+
+    EXPECT_TRUE(receiver.push(static_cast<const uint8_t*>(bank.getData()), static_cast<int>(bank.getSize())));
+    EXPECT_TRUE(receiver.push(static_cast<const uint8_t*>(voice.getData()), static_cast<int>(voice.getSize())));
+    EXPECT_TRUE(receiver.push(static_cast<const uint8_t*>(corrupt.getData()), static_cast<int>(corrupt.getSize())));
+
+    ASSERT_TRUE(receiver.waitUntilParsed(5000));
+    receiver.dispatchPendingUpdates();
+    EXPECT_EQ(receiver.getNumReceived(), 2);
+    EXPECT_EQ(receiver.getNumRejected(), 1);
+    EXPECT_EQ(receiver.getNumDropped(), 0);
+
+    const auto banks = manager->getBanks();
+    const auto findBank = [&banks](const std::string& name) {
+        for (const auto& b : *banks) {
+            if (b.name == name) {
+                return static_cast<int>(b.presetIndices.size());
+            }
+        }
+        return -1;
+    };
+    EXPECT_EQ(findBank("SysEx Bank 1"), SysExVoiceDump::MaxBankVoices);
+    EXPECT_EQ(findBank("SysEx"), -1);
+
+    const auto lead = manager->getSnapshot()->getPreset(selected);
+    ASSERT_NE(lead, nullptr);
+    EXPECT_EQ(lead->name, "Lead");
+}
+
+TEST_F(SysExVoiceDumpTest, ReceivedVoiceIsKeptWithTheUserPresets) {
+    SysExReceiver receiver(*manager);
+    int selected = -1;
+    receiver.onDumpReceived = [&selected](int index, bool) { selected = index; };
+
+    const auto voice = SysExVoiceDump::createVoiceDump(createVoice(9, "Lead"));
+    ASSERT_TRUE(receiver.push(static_cast<const uint8_t*>(voice.getData()), static_cast<int>(voice.getSize())));
+    ASSERT_TRUE(receiver.waitUntilParsed(5000));
+    receiver.dispatchPendingUpdates();
+
+    // The selected preset is in the User bank
+    const auto banks = manager->getBanks();
+    const auto user = std::find_if(banks->begin(), banks->end(), [](const Bank& b) { return b.name == "User"; });
+    ASSERT_NE(user, banks->end());
+    ASSERT_FALSE(user->presetIndices.empty());
+    EXPECT_EQ(user->presetIndices.back(), selected);
+
+    // ...and is there again in the next session
+    ASSERT_TRUE(manager->waitForUserDataWrites(5000));
+    PresetManager reloaded;
+    reloaded.setUserDataDirectory(tempDir.getChildFile("user"));
+    reloaded.initialize();
+    const auto reloadedBanks = reloaded.getBanks();
+    const auto reloadedUser = std::find_if(reloadedBanks->begin(), reloadedBanks->end(),
+                                           [](const Bank& b) { return b.name == "User"; });
+    ASSERT_NE(reloadedUser, reloadedBanks->end());
+    ASSERT_FALSE(reloadedUser->presetIndices.empty());
+    EXPECT_EQ(reloaded.getSnapshot()->getPreset(reloadedUser->presetIndices.back())->name, "Lead");
+}
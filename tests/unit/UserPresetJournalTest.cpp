@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include "utils/UserPresetJournal.h"
+#include "utils/PresetManager.h"
+#include <juce_core/juce_core.h>
+
+using namespace ymulatorsynth;
+
+class UserPresetJournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tempDir = juce::File::createTempFile("UserPresetJournalTest");
+        tempDir.deleteFile();
+        tempDir.createDirectory();
+    }
+
+    void TearDown() override {
+        if (tempDir.exists()) {
+            tempDir.deleteRecursively();
+        }
+    }
+
+    static Preset makePreset(const juce::String& name, int algorithm) {
+        Preset preset;
+        preset.name = name;
+        preset.algorithm = algorithm;
+        preset.feedback = 3;
+        preset.operators[1].totalLevel = 42.0f;
+        return preset;
+    }
+
+    static juce::StringArray namesOf(const std::vector<Preset>& presets) {
+        juce::StringArray names;
+        for (const auto& preset : presets)
+            names.add(preset.name);
+        return names;
+    }
+
+    juce::File tempDir;
+};
+
+// =============================================================================
+// 1. Append and Replay
+// =============================================================================
+
+TEST_F(UserPresetJournalTest, ReplayReproducesMutations) {
+    {
+        UserPresetJournal journal(tempDir);
+        journal.load();
+        journal.appendAdd(0, makePreset("Bass", 0));
+        journal.appendAdd(1, makePreset("Lead", 4));
+        journal.appendAdd(2, makePreset("Pad", 7));
+        journal.appendRename(1, "Lead 2");
+        journal.appendDelete(0);
+        ASSERT_TRUE(journal.waitUntilWritten(5000));
+        EXPECT_TRUE(journal.isHealthy());
+        EXPECT_EQ(journal.getNumRecords(), 5);
+    }
+
+    UserPresetJournal reopened(tempDir);
+    const auto presets = reopened.load();
+    EXPECT_EQ(namesOf(presets), juce::StringArray({ "Lead 2", "Pad" }));
+    EXPECT_EQ(presets[0].algorithm, 4);
+    EXPECT_FLOAT_EQ(presets[0].operators[1].totalLevel, 42.0f);
+    EXPECT_EQ(reopened.getNumRecords(), 5);
+}
+
+TEST_F(UserPresetJournalTest, LoadsLegacySnapshotWithoutJournal) {
+    juce::XmlElement root("UserPresets");
+    root.addChildElement(UserPresetJournal::presetToXml(makePreset("Old", 2)).release());
+    ASSERT_TRUE(root.writeTo(tempDir.getChildFile("user-presets.xml")));
+
+    UserPresetJournal journal(tempDir);
+    const auto presets = journal.load();
+    ASSERT_EQ(presets.size(), 1u);
+    EXPECT_EQ(presets[0].name, "Old");
+
+    // New records apply on top of the legacy snapshot
+    journal.appendAdd(1, makePreset("New", 1));
+    ASSERT_TRUE(journal.waitUntilWritten(5000));
+    UserPresetJournal reopened(tempDir);
+    EXPECT_EQ(namesOf(reopened.load()), juce::StringArray({ "Old", "New" }));
+}
+
+// =============================================================================
+// 2. Crash Safety
+// =============================================================================
+
+TEST_F(UserPresetJournalTest, TornTailIsDiscardedAndOverwritten) {
+    {
+        UserPresetJournal journal(tempDir);
+        journal.load();
+        journal.appendAdd(0, makePreset("A", 0));
+        journal.appendAdd(1, makePreset("B", 0));
+        ASSERT_TRUE(journal.waitUntilWritten(5000));
+    }
+
+    // Simulate a crash part-way through writing a record
+    auto journalFile = tempDir.getChildFile("user-presets.journal");
+    {
+        juce::FileOutputStream out(journalFile);
+        const char partial[] = { 100, 0, 0, 0, 1, 2 };
+        out.write(partial, sizeof(partial));
+    }
+
+    UserPresetJournal journal(tempDir);
+    EXPECT_EQ(namesOf(journal.load()), juce::StringArray({ "A", "B" }));
+
+    journal.appendAdd(2, makePreset("C", 0));
+    ASSERT_TRUE(journal.waitUntilWritten(5000));
+
+    UserPresetJournal reopened(tempDir);
+    EXPECT_EQ(namesOf(reopened.load()), juce::StringArray({ "A", "B", "C" }));
+}
+
+TEST_F(UserPresetJournalTest, CorruptRecordEndsReplay) {
+    {
+        UserPresetJournal journal(tempDir);
+        journal.load();
+        journal.appendAdd(0, makePreset("A", 0));
+        journal.appendAdd(1, makePreset("B", 0));
+        ASSERT_TRUE(journal.waitUntilWritten(5000));
+    }
+
+    // Flip a byte inside the last record's payload
+    auto journalFile = tempDir.getChildFile("user-presets.journal");
+    juce::MemoryBlock contents;
+    ASSERT_TRUE(journalFile.loadFileAsData(contents));
+    contents[contents.getSize() - 3] ^= 0x20;
+    ASSERT_TRUE(journalFile.replaceWithData(contents.getData(), contents.getSize()));
+
+    UserPresetJournal journal(tempDir);
+    EXPECT_EQ(namesOf(journal.load()), juce::StringArray({ "A" }));
+}
+
+// =============================================================================
+// 3. Compaction
+// =============================================================================
+
+TEST_F(UserPresetJournalTest, CompactionFoldsJournalIntoSnapshot) {
+    UserPresetJournal journal(tempDir);
+    journal.load();
+    journal.appendAdd(0, makePreset("A", 0));
+    journal.appendAdd(1, makePreset("B", 0));
+    journal.compact({ makePreset("A", 0), makePreset("B", 0) });
+    journal.appendRename(0, "A2");
+    ASSERT_TRUE(journal.waitUntilWritten(5000));
+    EXPECT_EQ(journal.getNumRecords(), 1);
+
+    auto snapshot = juce::XmlDocument::parse(tempDir.getChildFile("user-presets.xml"));
+    ASSERT_NE(snapshot, nullptr);
+    EXPECT_EQ(snapshot->getIntAttribute("journalGeneration"), 1);
+
+    UserPresetJournal reopened(tempDir);
+    EXPECT_EQ(namesOf(reopened.load()), juce::StringArray({ "A2", "B" }));
+    EXPECT_EQ(reopened.getNumRecords(), 1);
+}
+
+TEST_F(UserPresetJournalTest, StaleJournalAfterInterruptedCompactionIsIgnored) {
+    {
+        UserPresetJournal journal(tempDir);
+        journal.load();
+        journal.appendAdd(0, makePreset("A", 0));
+        ASSERT_TRUE(journal.waitUntilWritten(5000));
+    }
+
+    // Snapshot already folded the record in, but the journal was never reset
+    juce::XmlElement root("UserPresets");
+    root.setAttribute("journalGeneration", 1);
+    root.addChildElement(UserPresetJournal::presetToXml(makePreset("A", 0)).release());
+    ASSERT_TRUE(root.writeTo(tempDir.getChildFile("user-presets.xml")));
+
+    UserPresetJournal journal(tempDir);
+    EXPECT_EQ(namesOf(journal.load()), juce::StringArray({ "A" }));
+    EXPECT_EQ(journal.getNumRecords(), 0);
+}
+
+// =============================================================================
+// 4. PresetManager Integration
+// =============================================================================
+
+TEST_F(UserPresetJournalTest, UserBankPersistsThroughJournal) {
+    {
+        PresetManager manager;
+        manager.setUserDataDirectory(tempDir);
+        manager.initialize();
+
+        EXPECT_TRUE(manager.addUserPreset(makePreset("Mine 1", 1)));
+        EXPECT_TRUE(manager.addUserPreset(makePreset("Mine 2", 2)));
+        EXPECT_TRUE(manager.addUserPreset(makePreset("Mine 3", 3)));
+        EXPECT_TRUE(manager.renameUserPreset(2, "Mine Three"));
+        EXPECT_TRUE(manager.deleteUserPreset(0));
+        EXPECT_FALSE(manager.deleteUserPreset(5));
+        ASSERT_TRUE(manager.waitForUserDataWrites(5000));
+
+        // Saving a preset no longer rewrites the snapshot
+        EXPECT_FALSE(tempDir.getChildFile("user-presets.xml").exists());
+    }
+
+    PresetManager reloaded;
+    reloaded.setUserDataDirectory(tempDir);
+    reloaded.initialize();
+
+    int userBank = -1;
+    for (int i = 0; i < static_cast<int>(reloaded.getBanks()->size()); ++i) {
+        if ((*reloaded.getBanks())[i].name == "User")
+            userBank = i;
+    }
+    ASSERT_GE(userBank, 0);
+    EXPECT_EQ(reloaded.getPresetsForBank(userBank), juce::StringArray({ "Mine 2", "Mine Three" }));
+    EXPECT_EQ(reloaded.getPresetInBank(userBank, 1)->algorithm, 3);
+}
+
+TEST_F(UserPresetJournalTest, DeletingKeepsOtherGlobalIndices) {
+    PresetManager manager;
+    manager.setUserDataDirectory(tempDir);
+    manager.initialize();
+
+    ASSERT_TRUE(manager.addUserPreset(makePreset("Mine 1", 1)));
+    ASSERT_TRUE(manager.addUserPreset(makePreset("Mine 2", 2)));
+    int userBank = -1;
+    for (int i = 0; i < static_cast<int>(manager.getBanks()->size()); ++i) {
+        if ((*manager.getBanks())[i].name == "User")
+            userBank = i;
+    }
+    ASSERT_GE(userBank, 0);
+    const int firstIndex = manager.getGlobalPresetIndex(userBank, 0);
+    const int secondIndex = manager.getGlobalPresetIndex(userBank, 1);
+    ASSERT_GE(secondIndex, 0);
+
+    // The current preset, staged MIDI banks and parts hold global indices like this one
+    EXPECT_TRUE(manager.deleteUserPreset(0));
+    EXPECT_EQ(manager.getPreset(firstIndex), nullptr);
+    ASSERT_NE(manager.getPreset(secondIndex), nullptr);
+    EXPECT_EQ(manager.getPreset(secondIndex)->name, "Mine 2");
+    EXPECT_EQ(manager.getGlobalPresetIndex(userBank, 0), secondIndex);
+    ASSERT_TRUE(manager.waitForUserDataWrites(5000));
+}
+
+TEST_F(UserPresetJournalTest, ManagerCompactsFromThePublishedLibrary) {
+    {
+        PresetManager manager;
+        manager.setUserDataDirectory(tempDir);
+        manager.initialize();
+
+        for (int i = 0; i < UserPresetJournal::CompactionThreshold; ++i)
+            ASSERT_TRUE(manager.addUserPreset(makePreset("Mine " + juce::String(i), i % 8)));
+        EXPECT_TRUE(manager.renameUserPreset(0, "First"));
+        EXPECT_TRUE(manager.deleteUserPreset(1));
+        ASSERT_TRUE(manager.waitForUserDataWrites(5000));
+
+        // Compaction ran on the writer thread and started a new journal
+        EXPECT_TRUE(tempDir.getChildFile("user-presets.xml").exists());
+    }
+
+    PresetManager reloaded;
+    reloaded.setUserDataDirectory(tempDir);
+    reloaded.initialize();
+
+    int userBank = -1;
+    for (int i = 0; i < static_cast<int>(reloaded.getBanks()->size()); ++i) {
+        if ((*reloaded.getBanks())[i].name == "User")
+            userBank = i;
+    }
+    ASSERT_GE(userBank, 0);
+    const auto names = reloaded.getPresetsForBank(userBank);
+    ASSERT_EQ(names.size(), UserPresetJournal::CompactionThreshold - 1);
+    EXPECT_EQ(names[0], "First");
+    EXPECT_EQ(names[1], "Mine 2");
+    EXPECT_EQ(names[names.size() - 1], "Mine " + juce::String(UserPresetJournal::CompactionThreshold - 1));
+}
@@ -313,7 +313,37 @@ TEST_F(VoiceManagerTest, NoiseVoiceAllocationWithoutNoise) {
 }
 
 // =============================================================================
-// 6. Edge Cases and Error Handling
+// 6. Channel Pool Allocation Testing
+// =============================================================================
+
+TEST_F(VoiceManagerTest, PoolAllocationStaysInPool) {
+    const uint8_t pool = 0x0C;  // channels 2 and 3
+    EXPECT_EQ(voiceManager->allocateVoiceInPool(60, 100, pool), 3);
+    EXPECT_EQ(voiceManager->allocateVoiceInPool(62, 100, pool), 2);
+    
+    // Full pool: the oldest voice in it is stolen, the rest of the chip is untouched
+    EXPECT_EQ(voiceManager->allocateVoiceInPool(64, 100, pool), 3);
+    for (int channel : { 0, 1, 4, 5, 6, 7 }) {
+        EXPECT_FALSE(voiceManager->isVoiceActive(channel));
+    }
+    
+    EXPECT_EQ(voiceManager->allocateVoiceInPool(60, 100, 0), -1);
+}
+
+TEST_F(VoiceManagerTest, SameNoteInTwoPoolsPlaysTwice) {
+    const int first = voiceManager->allocateVoiceInPool(60, 100, 0x01);
+    const int second = voiceManager->allocateVoiceInPool(60, 100, 0x02);
+    EXPECT_EQ(first, 0);
+    EXPECT_EQ(second, 1);
+    
+    EXPECT_EQ(voiceManager->getChannelForNoteInPool(60, 0x02), 1);
+    voiceManager->releaseChannel(second);
+    EXPECT_EQ(voiceManager->getChannelForNoteInPool(60, 0x02), -1);
+    EXPECT_EQ(voiceManager->getChannelForNoteInPool(60, 0x01), 0);
+}
+
+// =============================================================================
+// 7. Edge Cases and Error Handling
 // =============================================================================
 
 TEST_F(VoiceManagerTest, InvalidNoteNumbers) {
@@ -362,7 +392,7 @@ TEST_F(VoiceManagerTest, InvalidChannelQueries) {
 }
 
 // =============================================================================
-// 7. Complex Scenarios Testing
+// 8. Complex Scenarios Testing
 // =============================================================================
 
 TEST_F(VoiceManagerTest, ComplexAllocationReleasePattern) {
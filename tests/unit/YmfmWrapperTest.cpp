@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "dsp/YmfmWrapper.h"
+#include "dsp/YM2151Registers.h"
 #include "core/ParameterManager.h"
 #include "utils/Debug.h"
 #include <vector>
@@ -386,6 +387,31 @@ TEST_F(YmfmWrapperTest, PitchBendFunctionality) {
     EXPECT_NO_THROW(wrapper->setPitchBend(0, -12.0f));  // Down 1 octave
 }
 
+TEST_F(YmfmWrapperTest, PitchBendKeyCodeAndFraction) {
+    wrapper->initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
+    const auto keyCode = [this]() { return wrapper->readCurrentRegister(YM2151Regs::REG_KEY_CODE_BASE); };
+    const auto keyFraction = [this]() { return wrapper->readCurrentRegister(YM2151Regs::REG_KEY_FRACTION_BASE); };
+    
+    wrapper->noteOn(0, 60, 100);  // C4: octave 4, note code 0
+    EXPECT_EQ(keyCode(), 0x40);
+    EXPECT_EQ(keyFraction(), 0x00);
+    
+    // Three quarters up stays on C with KF 48
+    wrapper->setPitchBend(0, 0.75f);
+    EXPECT_EQ(keyCode(), 0x40);
+    EXPECT_EQ(keyFraction(), 48 << YM2151Regs::SHIFT_KEY_FRACTION);
+    
+    // A quarter down is three quarters above B3 (note code 14)
+    wrapper->setPitchBend(0, -0.25f);
+    EXPECT_EQ(keyCode(), 0x3E);
+    EXPECT_EQ(keyFraction(), 48 << YM2151Regs::SHIFT_KEY_FRACTION);
+    
+    // MPE ranges reach past the chip's top octave, which clamps
+    wrapper->setPitchBend(0, 48.0f);
+    EXPECT_EQ(keyCode(), 0x7E);
+    EXPECT_EQ(keyFraction(), 63 << YM2151Regs::SHIFT_KEY_FRACTION);
+}
+
 TEST_F(YmfmWrapperTest, PanControlFunctionality) {
     wrapper->initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
     
@@ -429,6 +455,33 @@ TEST_F(YmfmWrapperTest, DirectRegisterWrite) {
     EXPECT_NO_THROW(wrapper->writeRegister(0x28, 0xF4)); // Frequency register
 }
 
+TEST_F(YmfmWrapperTest, ApplyRegisterImage) {
+    wrapper->initialize(YmfmWrapperInterface::ChipType::OPM, 44100);
+    wrapper->writeRegister(0x23, 0x40);  // channel 3: left only, ALG 0, FB 0
+    
+    ymulatorsynth::RegisterImage image;
+    for (int op = 0; op < 4; ++op) {
+        for (int reg = 0; reg < ymulatorsynth::RegisterImage::RegistersPerOperator; ++reg) {
+            image.operators[op][reg] = static_cast<uint8_t>(op * 16 + reg + 1);
+        }
+    }
+    image.connection = (5 << 3) | 4;
+    image.amsPms = 0x32;
+    
+    wrapper->applyRegisterImage(3, image);
+    
+    for (int op = 0; op < 4; ++op) {
+        EXPECT_EQ(wrapper->readCurrentRegister(0x40 + op * 8 + 3), op * 16 + 1);  // DT1/MUL
+        EXPECT_EQ(wrapper->readCurrentRegister(0x60 + op * 8 + 3), op * 16 + 2);  // TL
+        EXPECT_EQ(wrapper->readCurrentRegister(0xE0 + op * 8 + 3), op * 16 + 6);  // D1L/RR
+    }
+    EXPECT_EQ(wrapper->readCurrentRegister(0x23), 0x40 | (5 << 3) | 4);  // pan preserved
+    EXPECT_EQ(wrapper->readCurrentRegister(0x3B), 0x32);
+    
+    // Other channels are untouched
+    EXPECT_NE(wrapper->readCurrentRegister(0x60 + 2), 2);
+}
+
 // =============================================================================
 // 7. Edge Cases and Error Handling
 // =============================================================================